@@ -23,6 +23,7 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <algorithm>
 #include <cstdlib>
 #include <stdio.h>
 #include <tchar.h>
@@ -30,11 +31,22 @@
 #include "Application.h"
 #include "Config.h"
 #include "Constants.h"
+#include "Scene.h"
 #include "Kinect/Kinect.h"
+#include "Kinect/KeyframeReducer.h"
 #include "Util/RenderUtils.h"
+#include "Util/GLExtensions.h"
 #include "Util/ImageManager.h"
+#include "Util/Latency.h"
+#include "Util/Profiler.h"
+#include "Util/Tracer.h"
 
 const sf::VideoMode Application::videoMode = sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_BPP);
+const std::string Application::poseIndexFileName("../../Res/Out/poses.idx");
+const std::string Application::profileFileName("../../Res/Out/profile.csv");
+const std::string Application::latencyFileName("../../Res/Out/latency.csv");
+const std::string Application::traceFileName("../../Res/Out/trace.json");
+const std::string Application::calibrationFileName("../../Res/calibration.txt");
 
 const sf::ContextSettings contextSettings(16, 0, 2); // depth bits, stencil bits, aa level
 
@@ -43,16 +55,21 @@ Application::Application()
 	: window(Application::videoMode, "Kinect Testbed", sf::Style::Fullscreen, contextSettings)
 	, clock()
 	, gui()
-	, colorTextureId(0)
-	, depthTextureId(0)
-	, colorData(new GLubyte[Kinect::COLOR_STREAM_BYTES])
-	, depthData(new GLubyte[Kinect::DEPTH_STREAM_BYTES])
+	, scheduler(constants::max_frame_rate)
+	, colorTexture(Kinect::COLOR_STREAM_WIDTH, Kinect::COLOR_STREAM_HEIGHT)
+	, depthTexture(Kinect::DEPTH_STREAM_WIDTH, Kinect::DEPTH_STREAM_HEIGHT)
 	, showColor(true)
 	, showDepth(true)
 	, showSkeleton(true)
 	, handControl(false)
 	, autoPlay(false)
 	, lastFrameTime(0.f)
+	, lastDrawDuration(0.f)
+	, showProfile(false)
+	, lastProfileTime(0.f)
+	, loadedFileName()
+	, poseIndex()
+	, indexedFileNames()
 	, rightMouseDown(false)
 	, leftMouseDown(false)
 	, shiftDown(false)
@@ -64,27 +81,30 @@ Application::Application()
 	, lastTangent(constants::worldZ)
 	, projection(1.f)
 	, modelview(1.f)
-{
-	memset(colorData, 0, Kinect::COLOR_STREAM_BYTES);
-	memset(depthData, 0, Kinect::DEPTH_STREAM_BYTES);
-}
+{}
 
 Application::~Application()
-{
-	delete[] colorData;
-	delete[] depthData;
-}
+{}
 
-void Application::startup()
+void Application::startup( SensorSource *source )
 {
 	ImageManager::get().addResourceDir("../../Res/");
 
-	kinect.initialize();
+	kinect.initialize(source);
 	gui.setInfo(kinect.getDeviceId());
 
+	// Sensor placements for fusing several sensors, all of them at the origin without one
+	if (std::ifstream(calibrationFileName.c_str())) {
+		kinect.getFusion().loadCalibration(calibrationFileName);
+	}
+
+	Tracer::setThreadName("main");
+
 	initOpenGL();
 	mainLoop();
 	shutdownOpenGL();
+
+	Tracer::stop();
 }
 
 void Application::shutdown()
@@ -97,8 +117,13 @@ void Application::loadFile()
 	std::wstring wfilename(showFileChooser());
 	std::string filename; filename.assign(wfilename.begin(), wfilename.end());
 	if (kinect.getSkeleton().loadFile(filename)) {
+		loadedFileName = filename;
 		gui.setFileName(filename);
+		if (std::find(indexedFileNames.begin(), indexedFileNames.end(), filename) == indexedFileNames.end()) {
+			indexedFileNames.push_back(filename);
+		}
 	} else {
+		loadedFileName.clear();
 		gui.setFileName("No file loaded");
 	}
 }
@@ -106,9 +131,51 @@ void Application::loadFile()
 void Application::closeFile()
 {
 	kinect.getSkeleton().clearLoadedFrames();
+	loadedFileName.clear();
 	gui.setFileName("No file loaded");
 }
 
+void Application::refilterFile()
+{
+	Skeleton& skeleton = kinect.getSkeleton();
+	if (!skeleton.isLoaded()) return;
+
+	// Re-filter with the current filtering level and keep the result next to the original
+	skeleton.refilter(skeleton.getFilterLevel());
+	skeleton.saveFile(loadedFileName + ".filtered");
+	gui.setFileName(loadedFileName + " (filtered)");
+}
+
+void Application::reduceFile()
+{
+	Skeleton& skeleton = kinect.getSkeleton();
+	if (!skeleton.isLoaded()) return;
+
+	// Keep the keyframes next to the original, opening them plays back the rebuilt frames
+	const KeyframeReducer::Bounds bounds(constants::keyframe_position_error, constants::keyframe_orientation_error);
+	KeyframeReducer::Keyframes keyframes;
+	KeyframeReducer::Report report;
+	KeyframeReducer::reduce(skeleton.getJointFrames(), bounds, keyframes, report);
+	KeyframeReducer::print(report);
+	KeyframeReducer::save(loadedFileName + ".keyframes", keyframes);
+}
+
+void Application::findSimilarPoses()
+{
+	if (!poseIndex.isOpen() && !poseIndex.open(poseIndexFileName)) return;
+
+	std::vector<PoseIndex::Result> results;
+	if (!poseIndex.query(kinect.getSkeleton().getVisibleJointFrame(), 5, results)) {
+		std::cout << "Visible frame has no usable pose to search for" << std::endl;
+		return;
+	}
+	std::cout << "Closest poses to frame " << kinect.getSkeleton().getFrameIndex() << ":" << std::endl;
+	for (const auto& result : results) {
+		std::cout << "  " << result.filename << " frame " << result.frameIndex
+		          << " (distance " << result.distance << ")" << std::endl;
+	}
+}
+
 void Application::moveToNextFrame()
 {
 	kinect.getSkeleton().nextFrame();
@@ -136,9 +203,27 @@ void Application::setJointFrameIndex( const float fraction )
 void Application::mainLoop()
 {
 	clock.restart();    
+	std::vector<HANDLE> events;
 	while (window.isOpen()) {
-		processEvents();
-		draw();
+		// Sleep until the sensor, the user or playback has something new to show
+		events.clear();
+		kinect.getFrameEvents(events, showColor || showDepth);
+		scheduler.wait(events);
+
+		Profiler::beginFrame();
+		{
+			Profiler::Scope scope(Profiler::FRAME);
+			processEvents();
+			update();
+			if (scheduler.beginFrame()) {
+				draw();
+			}
+		}
+
+		// Images captured this frame reach their textures next frame, make sure there is one
+		if (colorTexture.isPending() || depthTexture.isPending()) {
+			scheduler.invalidate(FrameScheduler::SENSOR_FRAME);
+		}
 	}
 }
 
@@ -148,6 +233,21 @@ void Application::processEvents()
 	while (window.pollEvent(event)) {
 		gui.handleEvent(event);
 
+		switch (event.type) {
+			case sf::Event::KeyPressed:
+			case sf::Event::KeyReleased:
+			case sf::Event::TextEntered:
+			case sf::Event::MouseMoved:
+			case sf::Event::MouseButtonPressed:
+			case sf::Event::MouseButtonReleased:
+			case sf::Event::MouseWheelMoved:
+				scheduler.invalidate(FrameScheduler::INPUT_EVENT);
+				break;
+			default:
+				scheduler.invalidate(FrameScheduler::INTERFACE_CHANGE);
+				break;
+		}
+
 		if ((event.type == sf::Event::KeyPressed && sf::Keyboard::isKeyPressed(sf::Keyboard::Escape))
 		 || (event.type == sf::Event::Closed)) {
 			window.close();
@@ -157,6 +257,52 @@ void Application::processEvents()
 			if      (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) moveToNextFrame();
 			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left))  moveToPreviousFrame();
 			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift)) shiftDown = true;
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::F4) && isLoaded()) {
+				kinect.getSkeleton().recomputeOrientations();
+			}
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::F5) && isLoaded()) {
+				// Use the loaded recording as a template for live gesture recognition
+				const unsigned int numTemplates = kinect.addGestureTemplate(loadedFileName, kinect.getSkeleton().getJointFrames());
+				std::cout << "Added gesture template '" << loadedFileName << "', "
+				          << numTemplates << " templates loaded" << std::endl;
+			}
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::F7) && !indexedFileNames.empty()) {
+				// Rebuild the pose index over every recording in the folders loaded from so far
+				std::vector<std::string> recordings(indexedFileNames);
+				for (const auto& filename : indexedFileNames) {
+					const size_t slash = filename.find_last_of("/\\");
+					if (slash != std::string::npos) PoseIndex::findRecordings(filename.substr(0, slash), recordings);
+				}
+				std::sort(recordings.begin(), recordings.end());
+				recordings.erase(std::unique(recordings.begin(), recordings.end()), recordings.end());
+				poseIndex.close();
+				PoseIndex::benchmark(recordings, poseIndexFileName);
+			}
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::F8) && isLoaded()) {
+				findSimilarPoses();
+			}
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Home)) {
+				showProfile = !showProfile;
+				gui.setProfile(showProfile ? Profiler::getReport() + "\n" + Latency::getReport() : "");
+				lastProfileTime = clock.getElapsedTime().asSeconds();
+			}
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::End)) {
+				Profiler::writeCsv(profileFileName);
+				Latency::writeCsv(latencyFileName);
+			}
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Insert)) {
+				if (Tracer::isTracing()) Tracer::stop();
+				else                     Tracer::start(traceFileName);
+			}
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Delete)) {
+				kinect.togglePublish();
+			}
+			else if (sf::Keyboard::isKeyPressed(sf::Keyboard::PageUp) || sf::Keyboard::isKeyPressed(sf::Keyboard::PageDown)) {
+				Skeleton& skeleton = kinect.getSkeleton();
+				const unsigned int length = skeleton.getTrailLength();
+				skeleton.setTrailLength(sf::Keyboard::isKeyPressed(sf::Keyboard::PageUp) ? length * 2 : length / 2);
+				std::cout << "Joint trails show " << skeleton.getTrailLength() << " frames" << std::endl;
+			}
 		}
 
 		if (event.type == sf::Event::KeyReleased) {
@@ -184,20 +330,54 @@ void Application::processEvents()
 	}
 }
 
+void Application::update()
+{
+	Skeleton& skeleton = kinect.getSkeleton();
+
+	if (kinect.update()) {
+		scheduler.invalidate(FrameScheduler::SENSOR_FRAME);
+	}
+
+	if ((showColor || showDepth) && kinect.isInitialized() && updateKinectImageStreams()) {
+		scheduler.invalidate(FrameScheduler::SENSOR_FRAME);
+	}
+
+	if (autoPlay && skeleton.isLoaded()) {
+		// Play rate is display seconds per recorded frame, evaluate between frames at that speed
+		const float thisFrameTime = clock.getElapsedTime().asSeconds();
+		skeleton.advancePlayback((thisFrameTime - lastFrameTime) * skeleton.getFrameSpacing() / gui.getPlayRate());
+		lastFrameTime = thisFrameTime;
+		gui.setProgress(skeleton.getFrameIndex() / (float) (skeleton.getNumFrames() - 1));
+		gui.setIndex(skeleton.getFrameIndex());
+		scheduler.invalidate(FrameScheduler::PLAYBACK_TICK);
+	}
+
+	// Dragging with the right button keeps turning the camera while the mouse is still
+	if (rightMouseDown) {
+		scheduler.invalidate(FrameScheduler::INPUT_EVENT);
+	}
+}
+
 void Application::draw()
 {
-	window.setActive();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	const float drawStartTime = clock.getElapsedTime().asSeconds();
 
+	// Tagged with the frame on screen, the sensor's or the recording's
 	Skeleton& skeleton = kinect.getSkeleton();
+	Tracer::Scope drawTrace("draw", "render", skeleton.isLoaded() ? skeleton.getFrameIndex() : kinect.getFrameNumber());
+
+	window.setActive();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	bool useLast = false;
 	glm::vec3 binormal = constants::worldX;
 	glm::vec3 normal   = constants::worldY;
 	glm::vec3 tangent  = constants::worldZ;
 	if (handControl && !skeleton.getCurrentJointFrame().empty()) {
-		const Skeleton::Joint& rightHand = skeleton.getCurrentRightHand();
-		const Skeleton::Joint& leftHand  = skeleton.getCurrentLeftHand();
+		// Extrapolate the hands to when this frame should reach the screen,
+		// assuming it takes about as long to draw as the last one did
+		const Skeleton::Joint rightHand = kinect.getPredictedJoint(Skeleton::HAND_RIGHT, lastDrawDuration);
+		const Skeleton::Joint leftHand  = kinect.getPredictedJoint(Skeleton::HAND_LEFT,  lastDrawDuration);
 		//const Skeleton::Joint& head      = skeleton.getCurrentJointFrame().at(Skeleton::HEAD);
 		if (rightHand.trackingState == Skeleton::TRACKED && leftHand.trackingState == Skeleton::TRACKED) {
 			// Build a coordinate frame, but only if hands are reasonably far apart
@@ -250,55 +430,45 @@ void Application::draw()
 			modelview[2][0] = tangent.x;  modelview[2][1] = tangent.y;  modelview[2][2] = tangent.z;
 			modelview = glm::rotate(modelview, 180.f, constants::worldY); // Face skeleton
 		} else {
-			modelview = glm::rotate(modelview, getCameraRotationX(), constants::worldX);
-			modelview = glm::rotate(modelview, getCameraRotationY(), constants::worldY);
-			modelview = glm::rotate(modelview, 180.f, constants::worldY);
+			modelview = Scene::getCamera(glm::vec3(camerax, cameray, cameraz), getCameraRotationX(), getCameraRotationY());
 		}
 		glLoadMatrixf(glm::value_ptr(modelview));
 
-		kinect.update();
-
-		if (autoPlay && skeleton.isLoaded()) {
-			const float thisFrameTime = clock.getElapsedTime().asSeconds();
-			if (thisFrameTime - lastFrameTime > gui.getPlayRate()) {
-				lastFrameTime = thisFrameTime;
-				moveToNextFrame();
-			}
-		}
-
-		// Draw reflected skeleton first
-		if (showSkeleton) {
-			glPushMatrix();
-			glScalef(1.f, -1.f, 1.f);
-			skeleton.render();
-			glPopMatrix();
-		}
-
-		// Create imperfect reflector effect by blending ground over reflected scene with alpha
-		glClear (GL_DEPTH_BUFFER_BIT);
-		glPushAttrib (0xffffffff);
-		glEnable (GL_BLEND);
-		glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		Render::ground(0.5f);
-		glDisable(GL_BLEND);
-		glPopAttrib();
-
-		Render::basis();
-
-		// Draw normal skeleton
-		if (showSkeleton) {
-			skeleton.render();
+		{
+			Tracer::Scope trace("scene", "render");
+			Scene::draw(skeleton, showSkeleton);
 		}
 
 		// Draw hand/camera orientation basis
 		//Render::basis(1.f, constants::origin + constants::worldY, binormal, normal, tangent);
 
-		drawKinectImageStreams();
+		{
+			Tracer::Scope trace("image streams", "render");
+			drawKinectImageStreams();
+		}
 	glPopMatrix();
 
-	gui.draw(window);
+	// Refresh the profiler overlay a few times a second, every frame would be unreadable
+	if (showProfile && clock.getElapsedTime().asSeconds() - lastProfileTime > 0.25f) {
+		gui.setProfile(Profiler::getReport() + "\n" + Latency::getReport());
+		lastProfileTime = clock.getElapsedTime().asSeconds();
+	}
 
-	window.display();
+	{
+		Profiler::Scope scope(Profiler::GUI_DRAW);
+		Tracer::Scope trace("gui", "render");
+		gui.draw(window);
+	}
+	{
+		Profiler::Scope scope(Profiler::WINDOW_DISPLAY);
+		Tracer::Scope trace("display", "render");
+		window.display();
+	}
+	// How old the live frame just shown was, recordings being played back have no age
+	if (!skeleton.isLoaded()) {
+		Latency::record(Latency::DISPLAYED, kinect.getLiveCaptureTime());
+	}
+	lastDrawDuration = clock.getElapsedTime().asSeconds() - drawStartTime;
 
 	lastBinormal = binormal;
 	lastNormal   = normal;
@@ -415,85 +585,48 @@ std::wstring Application::showFileChooser() {
 }
 
 void Application::initOpenGL(){
-	glGenTextures(1, &colorTextureId);
-	glBindTexture(GL_TEXTURE_2D, colorTextureId);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
-		Kinect::COLOR_STREAM_WIDTH, Kinect::COLOR_STREAM_HEIGHT,
-		0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, (GLvoid *) colorData);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	glGenTextures(1, &depthTextureId);
-	glBindTexture(GL_TEXTURE_2D, depthTextureId);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
-		Kinect::DEPTH_STREAM_WIDTH, Kinect::DEPTH_STREAM_HEIGHT,
-		0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, (GLvoid *) depthData);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	glClearColor(0,0,0,0);
-	glClearDepth(1.f);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_TEXTURE_2D);
-	glPointSize(10.f);
-	glEnable(GL_POINT_SMOOTH);
+	GLExtensions::load();
+
+	colorTexture.create();
+	depthTexture.create();
+
+	Scene::initState();
 
 	// Set viewport and projection
 	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-	const float aspect = (float) WINDOW_WIDTH / (float) WINDOW_HEIGHT;
-	projection = glm::perspective(constants::camera_fov, aspect, constants::camera_z_near, constants::camera_z_far);
-	glMatrixMode(GL_PROJECTION);
-	glLoadMatrixf(glm::value_ptr(projection));
-
-	glMatrixMode(GL_MODELVIEW);
+	projection = Scene::setProjection(WINDOW_WIDTH, WINDOW_HEIGHT);
 	glLoadMatrixf(glm::value_ptr(modelview));
-
-	GLfloat mat_ambient[] = { 0.3f, 0.3f, 0.3f, 1.0f };
-	GLfloat mat_diffuse[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	GLfloat mat_specular[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	GLfloat mat_shininess[] = { 50.0f };
-	GLfloat light_position[] = { 0.0f, 0.5f, 0.0f, 1.0f };
-	glMaterialfv(GL_FRONT, GL_AMBIENT, mat_ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
-	glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
-	glLightfv(GL_LIGHT0, GL_POSITION, light_position);
-
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
-	glShadeModel (GL_SMOOTH);
 }
 
 void Application::shutdownOpenGL() {
-	glDeleteTextures(1, &colorTextureId);
-	glDeleteTextures(1, &depthTextureId);
+	colorTexture.destroy();
+	depthTexture.destroy();
 }
 
-void Application::updateKinectImageStreams()
+bool Application::updateKinectImageStreams()
 {
-	glBindTexture(GL_TEXTURE_2D, colorTextureId);
-	kinect.getStreamData(colorData, COLOR, 0);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-		Kinect::COLOR_STREAM_WIDTH, Kinect::COLOR_STREAM_HEIGHT,
-		GL_BGRA_EXT, GL_UNSIGNED_BYTE, (GLvoid *) colorData);
-
-	glBindTexture(GL_TEXTURE_2D, depthTextureId);
-	kinect.getStreamData(depthData, DEPTH, 0);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-		Kinect::DEPTH_STREAM_WIDTH, Kinect::DEPTH_STREAM_HEIGHT,
-		GL_BGRA_EXT, GL_UNSIGNED_BYTE, (GLvoid *) depthData);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
+	Profiler::Scope scope(Profiler::IMAGE_STREAMS);
+	Tracer::Scope trace("image upload", "capture", kinect.getFrameNumber());
+
+	// Textures take the images captured last frame while the newest
+	// images from the capture worker are copied into the mapped buffers
+	const bool uploaded = colorTexture.upload() | depthTexture.upload();
+
+	GLubyte *color = colorTexture.beginWrite();
+	const bool colorChanged = color != nullptr && kinect.getStreamData(color, COLOR);
+	colorTexture.endWrite(colorChanged);
+
+	GLubyte *depth = depthTexture.beginWrite();
+	const bool depthChanged = depth != nullptr && kinect.getStreamData(depth, DEPTH);
+	depthTexture.endWrite(depthChanged);
+
+	return uploaded || colorChanged || depthChanged;
 }
 
 void Application::drawKinectImageStreams()
 {
-	// Get kinect frame and update textures
+	// Textures are kept current by update()
 	if ((showColor || showDepth) && kinect.isInitialized()) {
-		updateKinectImageStreams();
-
 		glDisable(GL_DEPTH_TEST);
 		glDisable(GL_CULL_FACE);
 		glDisable(GL_LIGHTING);
@@ -503,7 +636,7 @@ void Application::drawKinectImageStreams()
 		glLoadIdentity();
 		glTranslatef(3.75f,2.25f,-5.f); // fix in upper right corner of window
 		if (showColor) {
-			glBindTexture(GL_TEXTURE_2D, colorTextureId);
+			glBindTexture(GL_TEXTURE_2D, colorTexture.getTexture());
 			glBegin(GL_QUADS);
 			glTexCoord2f(0, 1); glVertex3f(0.f, -1.f, 0.f);
 			glTexCoord2f(1, 1); glVertex3f(2.f, -1.f, 0.f);
@@ -512,7 +645,7 @@ void Application::drawKinectImageStreams()
 			glEnd();
 		}
 		if (showDepth) {
-			glBindTexture(GL_TEXTURE_2D, depthTextureId);
+			glBindTexture(GL_TEXTURE_2D, depthTexture.getTexture());
 			glBegin(GL_QUADS);
 			glTexCoord2f(0, 1); glVertex3f(0.f, -3.f, 0.f);
 			glTexCoord2f(1, 1); glVertex3f(2.f, -3.f, 0.f);
@@ -12,26 +12,34 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include "Core/Config.h"
 #include "Kinect/Kinect.h"
+#include "Kinect/PoseIndex.h"
 #include "UI/UserInterface.h"
+#include "Util/TextureStream.h"
+#include "Util/FrameScheduler.h"
 
 
 class Application
 {
 private:
 	static const sf::VideoMode videoMode;
+	static const std::string poseIndexFileName;
+	static const std::string profileFileName;
+	static const std::string latencyFileName;
+	static const std::string traceFileName;
+	static const std::string calibrationFileName;
 
 	sf::Clock clock;
 	sf::RenderWindow window;
 	UserInterface gui;
+	FrameScheduler scheduler;
 
 	// TODO : move to OpenGLEnvironment class?
-	GLuint colorTextureId;
-	GLuint depthTextureId;
-	GLubyte *colorData;
-	GLubyte *depthData;
+	TextureStream colorTexture;
+	TextureStream depthTexture;
 
 	Kinect kinect;
 
@@ -42,6 +50,15 @@ private:
 
 	bool autoPlay;
 	float lastFrameTime;
+	float lastDrawDuration;
+
+	bool showProfile;
+	float lastProfileTime;
+
+	std::string loadedFileName;
+
+	PoseIndex poseIndex;
+	std::vector<std::string> indexedFileNames; // recordings loaded this session
 
 	bool rightMouseDown;
 	bool leftMouseDown;
@@ -71,20 +88,26 @@ public:
 
 	~Application();
 
-	void startup();
+	// Runs until the window closes, frames come from source if given, from the sensor otherwise
+	void startup(SensorSource *source = nullptr);
 	void shutdown();
 
 	void loadFile();
 	void closeFile();
+	void refilterFile();
+	void reduceFile();
+	void findSimilarPoses();
 	void moveToNextFrame();
 	void moveToPreviousFrame();
 	void setJointFrameIndex(const float fraction);
 
-	void toggleAutoPlay()      { autoPlay     = !autoPlay;     }
+	void toggleAutoPlay()      { autoPlay     = !autoPlay; lastFrameTime = clock.getElapsedTime().asSeconds(); }
+	void setMaxFrameRate(const float framesPerSecond) { scheduler.setMaxFrameRate(framesPerSecond); }
 	void toggleShowColor()     { showColor    = !showColor;    }
 	void toggleShowDepth()     { showDepth    = !showDepth;    }
 	void toggleShowSkeleton()  { showSkeleton = !showSkeleton; }
 	void toggleHandControl()   { handControl  = !handControl;  }
+	void toggleFilteredTrack() { kinect.getSkeleton().toggleFilteredTrack(); }
 
 	bool isSaving()     const { return kinect.isSaving(); }
 	bool isLoaded()     const { return kinect.getSkeleton().isLoaded(); }
@@ -98,6 +121,7 @@ public:
 private:
 	void mainLoop();
 	void processEvents();
+	void update();
 	void draw();
 
 	float getCameraRotationX();
@@ -109,6 +133,6 @@ private:
 
 	// Kinect methods -------------------------------------
 	// TODO : move these to Kinect class?
-	void updateKinectImageStreams();
+	bool updateKinectImageStreams();
 	void drawKinectImageStreams() ;
 };
@@ -0,0 +1,264 @@
+/************************************************************************/
+/* Benchmark
+/* ---------
+/* A static helper class for timing the hot kernels on synthetic data
+/************************************************************************/
+#include "Benchmark.h"
+#include "Kinect/Skeleton.h"
+#include "Kinect/ImageConversion.h"
+#include "Util/ImageManager.h"
+#include "Util/Random.h"
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/System/Clock.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+namespace
+{
+	const unsigned int numFrames = 900; // 30 seconds of recording
+	const unsigned int colorPixels = 1280 * 960;
+	const unsigned int depthPixels = 640 * 480;
+	const char *recordingFileName = "benchmark_recording.tmp";
+	const char *imageFileName     = "benchmark_image.png";
+
+	// Results depend on these, the compiler can't drop the work that feeds them
+	volatile float sink;
+
+	// Joints jittered around a standing pose, a few inferred or not tracked
+	void makeFrames( Skeleton::JointFrames& frames )
+	{
+		Random random(1234);
+		frames.resize(numFrames);
+		for (unsigned int f = 0; f < numFrames; ++f) {
+			for (int i = 0; i < Skeleton::NUM_JOINT_TYPES; ++i) {
+				Skeleton::Joint joint;
+				memset(&joint, 0, sizeof(Skeleton::Joint));
+				joint.timestamp   = f / 30.f;
+				joint.position    = glm::vec3(0.4f * random.uniform() - 0.2f, 0.1f * i, 2.f + 0.1f * random.uniform());
+				joint.orientation = glm::mat4(1.f);
+				joint.type        = (Skeleton::EJointType) i;
+				const unsigned int state = random.next() % 20;
+				joint.trackingState = (state == 0) ? Skeleton::NOT_TRACKED
+				                    : (state == 1) ? Skeleton::INFERRED : Skeleton::TRACKED;
+				frames[f][joint.type] = joint;
+			}
+		}
+	}
+
+	// Time numRuns calls of kernel after one warm up call
+	void measure( const char *name, const unsigned int items, const unsigned int numRuns,
+	              const std::function<void()>& kernel, Benchmark::Results& results )
+	{
+		kernel();
+
+		std::vector<double> times;
+		sf::Clock clock;
+		for (unsigned int i = 0; i < numRuns; ++i) {
+			clock.restart();
+			kernel();
+			times.push_back(clock.getElapsedTime().asMicroseconds() * 1000.0 / items);
+		}
+		std::sort(times.begin(), times.end());
+
+		Benchmark::Result result;
+		result.name   = name;
+		result.items  = items;
+		result.runs   = numRuns;
+		result.median = times[times.size() / 2];
+		result.min    = times.front();
+		results.push_back(result);
+
+		std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+		          << std::setw(12) << result.median << " ns median"
+		          << std::setw(12) << result.min    << " ns min" << std::endl;
+	}
+}
+
+
+void Benchmark::run( Results& results, const unsigned int numRuns )
+{
+	std::cout << "Benchmarking kernels, " << numRuns << " runs each, per item times" << std::endl;
+
+	Skeleton::JointFrames frames;
+	makeFrames(frames);
+
+	// Recording decoding, the same file layout Kinect writes while saving
+	{
+		std::ofstream stream(recordingFileName, std::ios::binary | std::ios::out | std::ios::trunc);
+		for (const auto& frame : frames) {
+			for (const auto& entry : frame) {
+				stream.write((const char *) &entry.second, sizeof(Skeleton::Joint));
+			}
+		}
+	}
+	measure("read_recording", numFrames, numRuns, [&]() {
+		Skeleton::JointFrames decoded;
+		Skeleton::readFile(recordingFileName, decoded);
+		sink = decoded.empty() ? 0.f : decoded.back().begin()->second.position.x;
+	}, results);
+	remove(recordingFileName);
+
+	// Sensor image conversion, a gradient with the player index bits set
+	{
+		std::vector<unsigned char> color(4 * colorPixels), bgra(4 * colorPixels);
+		Random random(5678);
+		for (auto& value : color) {
+			value = (unsigned char) random.next();
+		}
+		measure("color_to_bgra", colorPixels, numRuns, [&]() {
+			ImageConversion::colorToBGRA(&color[0], &bgra[0], colorPixels);
+			sink = bgra[random.next() % bgra.size()];
+		}, results);
+	}
+	{
+		std::vector<unsigned short> depth(depthPixels);
+		std::vector<unsigned char> bgra(4 * depthPixels);
+		for (unsigned int i = 0; i < depthPixels; ++i) {
+			depth[i] = (unsigned short) (((800 + i % 3200) << ImageConversion::PLAYER_INDEX_SHIFT) | (i & 7));
+		}
+		measure("depth_to_bgra", depthPixels, numRuns, [&]() {
+			ImageConversion::depthToBGRA(&depth[0], &bgra[0], depthPixels);
+			sink = bgra[(depthPixels / 2) * 4 + 1];
+		}, results);
+	}
+
+	// Joint lookup by type, as the renderer and filters do for every joint of a frame
+	measure("joint_lookup", numFrames * Skeleton::NUM_JOINT_TYPES, numRuns, [&]() {
+		float sum = 0.f;
+		for (const auto& frame : frames) {
+			for (int i = 0; i < Skeleton::NUM_JOINT_TYPES; ++i) {
+				const auto it = frame.find((Skeleton::EJointType) i);
+				if (it != frame.end()) sum += it->second.position.y;
+			}
+		}
+		sink = sum;
+	}, results);
+
+	// Bone placement for the batched renderer, every bone of every frame
+	measure("bone_transform", numFrames * (Skeleton::NUM_JOINT_TYPES - 1), numRuns, [&]() {
+		float sum = 0.f;
+		glm::mat4 transform;
+		glm::mat3 normalTransform;
+		for (const auto& frame : frames) {
+			for (int i = 1; i < Skeleton::NUM_JOINT_TYPES; ++i) {
+				const Skeleton::EJointType type = (Skeleton::EJointType) i;
+				const glm::vec3& from = frame.find(Skeleton::getParentJoint(type))->second.position;
+				const glm::vec3& to   = frame.find(type)->second.position;
+				if (Skeleton::getBoneTransform(from, to, 0.04f, transform, normalTransform)) {
+					sum += transform[3][0];
+				}
+			}
+		}
+		sink = sum;
+	}, results);
+
+	// Image cache hits, the first call loads the image
+	{
+		std::vector<unsigned char> pixels(4 * 64 * 64);
+		Random random(91011);
+		for (auto& value : pixels) {
+			value = (unsigned char) random.next();
+		}
+		sf::Image image;
+		image.create(64, 64, &pixels[0]);
+		if (image.saveToFile(imageFileName)) {
+			const unsigned int numLookups = 10000;
+			measure("image_cache_hit", numLookups, numRuns, [&]() {
+				unsigned int sum = 0;
+				for (unsigned int i = 0; i < numLookups; ++i) {
+					sum += GetImage(imageFileName).getSize().x;
+				}
+				sink = (float) sum;
+			}, results);
+			ImageManager::get().deleteImage(imageFileName);
+			remove(imageFileName);
+		} else {
+			std::cerr << "Skipped image_cache_hit, failed to write '" << imageFileName << "'." << std::endl;
+		}
+	}
+}
+
+bool Benchmark::write( const std::string& filename, const Results& results )
+{
+	std::ofstream stream(filename, std::ios::out | std::ios::trunc);
+	if (!stream.is_open()) {
+		std::cerr << "Failed to open '" << filename << "' for writing." << std::endl;
+		return false;
+	}
+	stream << "name,items,runs,median_ns,min_ns" << std::endl << std::fixed << std::setprecision(3);
+	for (const auto& result : results) {
+		stream << result.name << "," << result.items << "," << result.runs << ","
+		       << result.median << "," << result.min << std::endl;
+	}
+	std::cout << "Wrote " << results.size() << " benchmark results to '" << filename << "'." << std::endl;
+	return stream.good();
+}
+
+bool Benchmark::read( const std::string& filename, Results& results )
+{
+	std::ifstream stream(filename);
+	if (!stream.is_open()) {
+		std::cerr << "Failed to open '" << filename << "'." << std::endl;
+		return false;
+	}
+
+	std::string line;
+	std::getline(stream, line); // header
+	while (std::getline(stream, line)) {
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::stringstream ss(line);
+		Result result;
+		if (ss >> result.name >> result.items >> result.runs >> result.median >> result.min) {
+			results.push_back(result);
+		}
+	}
+	return true;
+}
+
+bool Benchmark::compare( const Results& baseline, const Results& current, const float tolerance )
+{
+	bool passed = true;
+	std::cout << "Change against baseline, median per item" << std::endl;
+	for (const auto& result : current) {
+		const auto it = std::find_if(baseline.begin(), baseline.end(),
+			[&](const Result& other) { return other.name == result.name; });
+		std::cout << std::left << std::setw(20) << result.name << std::right;
+		if (it == baseline.end() || it->median <= 0.0) {
+			std::cout << "  no baseline" << std::endl;
+			continue;
+		}
+
+		const double change = result.median / it->median - 1.0;
+		const bool regressed = change > tolerance;
+		std::cout << std::fixed << std::setprecision(2)
+		          << std::setw(12) << it->median << " -> " << std::setw(10) << result.median << " ns"
+		          << std::showpos << std::setw(9) << 100.0 * change << "%" << std::noshowpos
+		          << (regressed ? "  REGRESSION" : "") << std::endl;
+		passed = passed && !regressed;
+	}
+	return passed;
+}
+
+int Benchmark::runAndCompare( const std::string& resultsFilename, const std::string& baselineFilename )
+{
+	Results results;
+	run(results);
+	if (!resultsFilename.empty() && !write(resultsFilename, results)) return 1;
+	if (!baselineFilename.empty()) {
+		Results baseline;
+		if (!read(baselineFilename, baseline)) return 1;
+		return compare(baseline, results) ? 0 : 2;
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+/************************************************************************/
+/* Benchmark
+/* ---------
+/* A static helper class for timing the hot kernels on synthetic data
+/************************************************************************/
+#include <string>
+#include <vector>
+
+
+// Covers recording decoding, sensor image conversion, joint lookup, bone
+// transforms and image cache hits. Inputs come from a fixed seed, so runs
+// on different commits time the same work. Nothing here needs a sensor,
+// a window or an OpenGL context.
+class Benchmark
+{
+public:
+	struct Result
+	{
+		std::string name;
+		unsigned int items; // per run: frames, pixels, lookups, ...
+		unsigned int runs;
+		double median;      // nanoseconds per item
+		double min;
+	};
+	typedef std::vector<Result> Results;
+
+	static void run(Results& results, const unsigned int numRuns = 7);
+
+	// CSV with a header row, name,items,runs,median_ns,min_ns
+	static bool write(const std::string& filename, const Results& results);
+	static bool read(const std::string& filename, Results& results);
+
+	// Print the change of every kernel against a baseline, false if any median
+	// got slower by more than tolerance (0.1 is 10%)
+	static bool compare(const Results& baseline, const Results& current, const float tolerance = 0.1f);
+
+	// Run, write the results if given a filename and compare them against a
+	// baseline if given one. Exit code 1 if a file failed, 2 on a regression.
+	static int runAndCompare(const std::string& resultsFilename = "", const std::string& baselineFilename = "");
+};
@@ -0,0 +1,400 @@
+/************************************************************************/
+/* CommandLine
+/* -----------
+/* A static helper class for the modes that run without a window or sensor
+/************************************************************************/
+#include "CommandLine.h"
+#include "Benchmark.h"
+#include "Constants.h"
+#include "Exporter.h"
+#include "Scene.h"
+#include "Kinect/BoneOrientation.h"
+#include "Kinect/FrameHub.h"
+#include "Kinect/FramePipeline.h"
+#include "Kinect/GestureRecognizer.h"
+#include "Kinect/JointFilter.h"
+#include "Kinect/JointPredictor.h"
+#include "Kinect/Kinect.h"
+#include "Kinect/PoseIndex.h"
+#include "Kinect/ReplaySource.h"
+#include "Kinect/SkeletonFusion.h"
+#include "Kinect/StreamSync.h"
+#include "Kinect/SyntheticSource.h"
+#include "Util/Framebuffer.h"
+#include "Util/GLExtensions.h"
+#include "Util/TextureStream.h"
+#include "Util/FrameBus.h"
+#include "Util/ImageManager.h"
+#include "Util/OffscreenContext.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	// Load the recording argv[2] names, with usage printed if there is none
+	bool loadRecording( int argc, char *argv[], const char *arguments, Skeleton& skeleton )
+	{
+		if (argc < 3) {
+			std::cerr << "Usage: " << argv[0] << " " << argv[1] << " " << arguments << std::endl;
+			return false;
+		}
+		if (!skeleton.loadFile(argv[2]) || skeleton.getNumFrames() == 0) {
+			std::cerr << "Failed to load frames from '" << argv[2] << "'." << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// Render into framebuffer from where the window's camera starts
+	void setUpView( Framebuffer& framebuffer )
+	{
+		framebuffer.bind();
+		Scene::initState();
+		Scene::setProjection(framebuffer.getWidth(), framebuffer.getHeight());
+		const glm::mat4 camera = Scene::getCamera(glm::vec3(0.f, constants::initial_camera_y, constants::initial_camera_z), 0.f, 0.f);
+		glLoadMatrixf(glm::value_ptr(camera));
+	}
+}
+
+
+bool CommandLine::run( int argc, char *argv[], int& exitCode )
+{
+	exitCode = 0;
+
+	// Kernel timings on synthetic data as CSV, compared against an earlier run if given:
+	// --bench [results.csv] [baseline.csv]
+	if (argc > 1 && std::string(argv[1]) == "--bench") {
+		exitCode = Benchmark::runAndCompare((argc > 2) ? argv[2] : "", (argc > 3) ? argv[3] : "");
+		return true;
+	}
+
+	// Time preview uploads without a window or sensor, works under software GL
+	if (argc > 1 && std::string(argv[1]) == "--bench-upload") {
+		OffscreenContext context;
+		if (!context.isValid()) {
+			exitCode = 1;
+			return true;
+		}
+		GLExtensions::load();
+		TextureStream::benchmark(Kinect::COLOR_STREAM_WIDTH, Kinect::COLOR_STREAM_HEIGHT, 300);
+		TextureStream::benchmark(Kinect::DEPTH_STREAM_WIDTH, Kinect::DEPTH_STREAM_HEIGHT, 300);
+		return true;
+	}
+
+	// Immediate mode against batched skeleton rendering into an offscreen framebuffer,
+	// on the first frame of a recording or a generated body: --bench-rendering [recording]
+	if (argc > 1 && std::string(argv[1]) == "--bench-rendering") {
+		OffscreenContext context;
+		if (!context.isValid()) {
+			exitCode = 1;
+			return true;
+		}
+		GLExtensions::load();
+		Framebuffer framebuffer(1280, 720);
+		if (!framebuffer.create()) {
+			exitCode = 1;
+			return true;
+		}
+
+		Skeleton skeleton;
+		if (argc > 2) {
+			if (!skeleton.loadFile(argv[2]) || skeleton.getNumFrames() == 0) {
+				std::cerr << "Failed to load a frame from '" << argv[2] << "'." << std::endl;
+				exitCode = 1;
+				return true;
+			}
+		} else {
+			SyntheticSource::Options options;
+			options.frameRate = 0.f;
+			SyntheticSource source(options);
+			SensorSource::SkeletonFrame frame;
+			if (!source.open() || !source.getSkeletonFrame(frame, Skeleton::OFF) || frame.bodies.empty()) {
+				std::cerr << "Failed to generate a body to render." << std::endl;
+				exitCode = 1;
+				return true;
+			}
+			skeleton.getCurrentJointFrame() = frame.bodies[0];
+		}
+		skeleton.setRenderFlags(Skeleton::R_JOINTS | Skeleton::R_BONES | Skeleton::R_INFER);
+
+		setUpView(framebuffer);
+		skeleton.benchmarkRendering();
+		framebuffer.unbind();
+		return true;
+	}
+
+	// Immediate mode joint paths against the trail buffer, offscreen: --bench-trails <recording>
+	if (argc > 1 && std::string(argv[1]) == "--bench-trails") {
+		Skeleton skeleton;
+		if (!loadRecording(argc, argv, "<recording>", skeleton)) {
+			exitCode = 1;
+			return true;
+		}
+		OffscreenContext context;
+		if (!context.isValid()) {
+			exitCode = 1;
+			return true;
+		}
+		GLExtensions::load();
+		Framebuffer framebuffer(1280, 720);
+		if (!framebuffer.create()) {
+			exitCode = 1;
+			return true;
+		}
+
+		setUpView(framebuffer);
+		skeleton.benchmarkTrails();
+		framebuffer.unbind();
+		return true;
+	}
+
+	// Sequential against parallel re-filtering of a recording: --bench-filter <recording> [level 1-3]
+	if (argc > 1 && std::string(argv[1]) == "--bench-filter") {
+		Skeleton skeleton;
+		if (!loadRecording(argc, argv, "<recording> [level 1-3]", skeleton)) {
+			exitCode = 1;
+			return true;
+		}
+		const int level = (argc > 3) ? std::min(std::max(1, atoi(argv[3])), static_cast<int>(Skeleton::HIGH)) : Skeleton::MEDIUM;
+		JointFilter::benchmark(skeleton.getJointFrames(), JointFilter::getParameters(static_cast<Skeleton::EFilteringLevel>(level)));
+		return true;
+	}
+
+	// Hand prediction error at display time horizons over a recording: --eval-predictor <recording>
+	if (argc > 1 && std::string(argv[1]) == "--eval-predictor") {
+		Skeleton skeleton;
+		if (!loadRecording(argc, argv, "<recording>", skeleton)) {
+			exitCode = 1;
+			return true;
+		}
+		static const double horizons[] = { 0.016, 0.033, 0.050 };
+		JointPredictor::evaluate(skeleton.getJointFrames(), horizons, 3);
+		return true;
+	}
+
+	// Solved bone orientations against the recorded ones, and the solve rate: --bench-orientations <recording>
+	if (argc > 1 && std::string(argv[1]) == "--bench-orientations") {
+		Skeleton skeleton;
+		if (!loadRecording(argc, argv, "<recording>", skeleton)) {
+			exitCode = 1;
+			return true;
+		}
+		BoneOrientation::compare(skeleton.getJointFrames());
+		return true;
+	}
+
+	// Gesture matching with and without lower bound pruning: --bench-gestures <recording>
+	if (argc > 1 && std::string(argv[1]) == "--bench-gestures") {
+		Skeleton skeleton;
+		if (!loadRecording(argc, argv, "<recording>", skeleton)) {
+			exitCode = 1;
+			return true;
+		}
+		GestureRecognizer::benchmark(skeleton.getJointFrames());
+		return true;
+	}
+
+	// Joint kinematics of a recording: --bench-kinematics <recording>
+	if (argc > 1 && std::string(argv[1]) == "--bench-kinematics") {
+		Skeleton skeleton;
+		if (!loadRecording(argc, argv, "<recording>", skeleton)) {
+			exitCode = 1;
+			return true;
+		}
+		skeleton.benchmarkKinematics();
+		return true;
+	}
+
+	// Interpolated playback of a recording: --bench-playback <recording>
+	if (argc > 1 && std::string(argv[1]) == "--bench-playback") {
+		Skeleton skeleton;
+		if (!loadRecording(argc, argv, "<recording>", skeleton)) {
+			exitCode = 1;
+			return true;
+		}
+		skeleton.benchmarkPlayback();
+		return true;
+	}
+
+	// Build a pose index over recordings and folders of them, then time queries on it:
+	// --bench-pose-index <index> <recording or folder>...
+	if (argc > 1 && std::string(argv[1]) == "--bench-pose-index") {
+		std::vector<std::string> recordings;
+		for (int i = 3; i < argc; ++i) {
+			PoseIndex::findRecordings(argv[i], recordings);
+		}
+		if (recordings.empty()) {
+			std::cerr << "Usage: " << argv[0] << " --bench-pose-index <index> <recording or folder>..." << std::endl;
+			exitCode = 1;
+			return true;
+		}
+		PoseIndex::benchmark(recordings, argv[2]);
+		return true;
+	}
+
+	// Frame bus throughput and latency with reader threads, at the sensor's rate by default:
+	// --bench-bus [readers] [seconds] [frame rate]
+	if (argc > 1 && std::string(argv[1]) == "--bench-bus") {
+		const int numReaders = (argc > 2) ? std::max(1, atoi(argv[2])) : 8;
+		const float seconds  = (argc > 3) ? static_cast<float>(atof(argv[3])) : 5.f;
+		const float rate     = (argc > 4) ? static_cast<float>(atof(argv[4])) : 30.f;
+		FrameBus::benchmark(numReaders, seconds, rate, Kinect::DEPTH_STREAM_BYTES);
+		return true;
+	}
+
+	// Delivery of live frames to 1 through 32 subscribers
+	if (argc > 1 && std::string(argv[1]) == "--bench-subscribers") {
+		FrameHub::benchmark();
+		return true;
+	}
+
+	// Alignment of color, depth and skeleton streams delivered with jitter: --bench-sync [frames]
+	if (argc > 1 && std::string(argv[1]) == "--bench-sync") {
+		const int numFrames = (argc > 2) ? std::max(1, atoi(argv[2])) : 3000;
+		StreamSync::benchmark(numFrames);
+		return true;
+	}
+
+	// Cost of merging the bodies of several sensors per frame: --bench-fusion [sensors] [bodies]
+	if (argc > 1 && std::string(argv[1]) == "--bench-fusion") {
+		const int numSensors = (argc > 2) ? std::max(1, atoi(argv[2])) : 3;
+		const int numBodies  = (argc > 3) ? std::max(1, atoi(argv[3])) : 6;
+		SkeletonFusion::benchmark(numSensors, numBodies);
+		return true;
+	}
+
+	// Scaling of the per frame job graph over 1 to 16 threads, on a recording replayed
+	// as fast as possible or on generated bodies: --bench-jobs [recording] [frames]
+	if (argc > 1 && std::string(argv[1]) == "--bench-jobs") {
+		const int numFrames = (argc > 3) ? std::max(1, atoi(argv[3])) : 600;
+		std::unique_ptr<SensorSource> source;
+		if (argc > 2) {
+			source.reset(new ReplaySource(argv[2], 0.f));
+		} else {
+			SyntheticSource::Options options;
+			options.frameRate = 0.f;
+			source.reset(new SyntheticSource(options));
+		}
+		FramePipeline::benchmark(source.get(), numFrames);
+		return true;
+	}
+
+	// Smooth a recording and solve its orientations through the frame pipeline,
+	// images alongside: --process <recording> <output> [level 0-3]
+	if (argc > 1 && std::string(argv[1]) == "--process") {
+		if (argc < 4) {
+			std::cerr << "Usage: " << argv[0] << " --process <recording> <output> [level 0-3]" << std::endl;
+			exitCode = 1;
+			return true;
+		}
+		const int level = (argc > 4) ? std::min(std::max(0, atoi(argv[4])), static_cast<int>(Skeleton::HIGH)) : Skeleton::MEDIUM;
+		if (!FramePipeline::process(argv[2], argv[3], static_cast<Skeleton::EFilteringLevel>(level))) {
+			exitCode = 1;
+		}
+		return true;
+	}
+
+	// Render a recording to numbered images without a window or sensor:
+	// --export <recording> <prefix> [width height] [format]
+	if (argc > 1 && std::string(argv[1]) == "--export") {
+		if (argc < 4) {
+			std::cerr << "Usage: " << argv[0] << " --export <recording> <prefix> [width height] [format]" << std::endl;
+			exitCode = 1;
+			return true;
+		}
+		Exporter::Options options;
+		options.prefix = argv[3];
+		if (argc > 5) {
+			options.width  = std::max(1, atoi(argv[4]));
+			options.height = std::max(1, atoi(argv[5]));
+		}
+		if (argc > 6) {
+			options.format = argv[6];
+		}
+
+		OffscreenContext context;
+		if (!context.isValid()) {
+			exitCode = 1;
+			return true;
+		}
+		ImageManager::get().addResourceDir("../../Res/");
+		GLExtensions::load();
+		exitCode = Exporter::exportRecording(argv[2], options) ? 0 : 1;
+		return true;
+	}
+
+	// Run the processing pipeline on a recording replayed by one or more sensors without
+	// a window, as fast as possible by default: --load-test <recording> [speed] [seconds] [sensors]
+	if (argc > 1 && std::string(argv[1]) == "--load-test") {
+		if (argc < 3) {
+			std::cerr << "Usage: " << argv[0] << " --load-test <recording> [speed] [seconds] [sensors]" << std::endl;
+			exitCode = 1;
+			return true;
+		}
+		const float speed   = (argc > 3) ? static_cast<float>(atof(argv[3])) : 0.f;
+		const float seconds = (argc > 4) ? static_cast<float>(atof(argv[4])) : 10.f;
+		const int numSensors = (argc > 5) ? std::max(1, atoi(argv[5])) : 1;
+		std::vector<SensorSource *> sources;
+		for (int i = 0; i < numSensors; ++i) {
+			sources.push_back(new ReplaySource(argv[2], speed));
+		}
+		Kinect::benchmark(sources, seconds);
+		return true;
+	}
+
+	// The same on generated bodies and depth images, as fast as possible by default:
+	// --load-test-synthetic [bodies] [frame rate] [seconds] [sensors] [depth width height]
+	if (argc > 1 && std::string(argv[1]) == "--load-test-synthetic") {
+		SyntheticSource::Options options;
+		options.frameRate = 0.f;
+		if (argc > 2) options.numBodies = static_cast<unsigned int>(std::max(0, atoi(argv[2])));
+		if (argc > 3) options.frameRate = static_cast<float>(atof(argv[3]));
+		const float seconds = (argc > 4) ? static_cast<float>(atof(argv[4])) : 10.f;
+		const int numSensors = (argc > 5) ? std::max(1, atoi(argv[5])) : 1;
+		if (argc > 7) {
+			options.depthWidth  = static_cast<unsigned int>(std::max(1, atoi(argv[6])));
+			options.depthHeight = static_cast<unsigned int>(std::max(1, atoi(argv[7])));
+		}
+		std::vector<SensorSource *> sources;
+		for (int i = 0; i < numSensors; ++i) {
+			options.seed = i + 1;
+			sources.push_back(new SyntheticSource(options));
+		}
+		Kinect::benchmark(sources, seconds);
+		return true;
+	}
+
+	return false;
+}
+
+void CommandLine::printUsage( const char *program, std::ostream& stream )
+{
+	stream << "Usage: " << program << " <mode> [arguments]" << std::endl
+	       << "  --bench [results.csv] [baseline.csv]" << std::endl
+	       << "  --bench-upload" << std::endl
+	       << "  --bench-rendering [recording]" << std::endl
+	       << "  --bench-trails <recording>" << std::endl
+	       << "  --bench-filter <recording> [level 1-3]" << std::endl
+	       << "  --eval-predictor <recording>" << std::endl
+	       << "  --bench-orientations <recording>" << std::endl
+	       << "  --bench-gestures <recording>" << std::endl
+	       << "  --bench-kinematics <recording>" << std::endl
+	       << "  --bench-playback <recording>" << std::endl
+	       << "  --bench-pose-index <index> <recording or folder>..." << std::endl
+	       << "  --bench-bus [readers] [seconds] [frame rate]" << std::endl
+	       << "  --bench-subscribers" << std::endl
+	       << "  --bench-sync [frames]" << std::endl
+	       << "  --bench-fusion [sensors] [bodies]" << std::endl
+	       << "  --bench-jobs [recording] [frames]" << std::endl
+	       << "  --process <recording> <output> [level 0-3]" << std::endl
+	       << "  --export <recording> <prefix> [width height] [format]" << std::endl
+	       << "  --load-test <recording> [speed] [seconds] [sensors]" << std::endl
+	       << "  --load-test-synthetic [bodies] [frame rate] [seconds] [sensors] [depth width height]" << std::endl;
+}
@@ -0,0 +1,20 @@
+#pragma once
+/************************************************************************/
+/* CommandLine
+/* -----------
+/* A static helper class for the modes that run without a window or sensor
+/************************************************************************/
+#include <iostream>
+
+
+// Benchmarks, load tests and export, shared by the testbed and the headless
+// driver that builds without the Kinect SDK. Nothing here includes
+// Windows.h, NuiApi or the Application.
+class CommandLine
+{
+public:
+	// Run the mode argv[1] names, false if it is not one of these
+	static bool run(int argc, char *argv[], int& exitCode);
+
+	static void printUsage(const char *program, std::ostream& stream);
+};
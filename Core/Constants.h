@@ -26,13 +26,25 @@ namespace constants
 	const float camera_z_far  = 100.f;
 	const float camera_fov    = 66.f;
 
+	// frames drawn per second at most, 0 for no cap
+	const float max_frame_rate = 120.f;
+
 	const glm::vec3 worldX(1,0,0);
 	const glm::vec3 worldY(0,1,0);
 	const glm::vec3 worldZ(0,0,1);
 	const glm::vec3 origin(0,0,0);
 
-	const NUI_TRANSFORM_SMOOTH_PARAMETERS joint_smooth_params_low[]  = { 0.5f, 0.5f, 0.5f, 0.05f, 0.04f };
-	const NUI_TRANSFORM_SMOOTH_PARAMETERS joint_smooth_params_med[]  = { 0.5f, 0.1f, 0.5f, 0.1f , 0.1f  };
-	const NUI_TRANSFORM_SMOOTH_PARAMETERS joint_smooth_params_high[] = { 0.7f, 0.3f, 1.0f, 1.0f , 1.0f  };
+	// smoothing, correction, prediction, jitter radius, max deviation radius
+	const float joint_smooth_params_low[]  = { 0.5f, 0.5f, 0.5f, 0.05f, 0.04f };
+	const float joint_smooth_params_med[]  = { 0.5f, 0.1f, 0.5f, 0.1f , 0.1f  };
+	const float joint_smooth_params_high[] = { 0.7f, 0.3f, 1.0f, 1.0f , 1.0f  };
+
+	// keyframe reduction error bounds, meters and degrees
+	const float keyframe_position_error    = 0.01f;
+	const float keyframe_orientation_error = 5.f;
+
+	// joint trails, frames kept per joint and frames drawn by default
+	const unsigned int trail_capacity = 4096;
+	const unsigned int trail_length   = 60;
 
 };
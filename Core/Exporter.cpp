@@ -0,0 +1,90 @@
+/************************************************************************/
+/* Exporter
+/* --------
+/* A static helper class for rendering recordings to image sequences
+/************************************************************************/
+#include "Exporter.h"
+#include "Constants.h"
+#include "Scene.h"
+#include "Kinect/Skeleton.h"
+#include "Util/Framebuffer.h"
+#include "Util/ImageSequenceWriter.h"
+#include "Util/Parallel.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <SFML/OpenGL.hpp>
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+
+Exporter::Options::Options()
+	: width(1280)
+	, height(720)
+	, prefix("frame")
+	, format("png")
+	, numThreads(0)
+{}
+
+bool Exporter::exportRecording( const std::string& filename, const Options& options )
+{
+	Framebuffer framebuffer(options.width, options.height);
+	if (!framebuffer.create()) {
+		return false;
+	}
+
+	Skeleton skeleton;
+	if (!skeleton.loadFile(filename) || skeleton.getNumFrames() == 0) {
+		std::cerr << "Nothing to export from '" << filename << "'." << std::endl;
+		return false;
+	}
+	skeleton.setRenderFlags(Skeleton::R_JOINTS | Skeleton::R_BONES | Skeleton::R_INFER | Skeleton::R_PATH);
+
+	framebuffer.bind();
+	Scene::initState();
+	Scene::setProjection(options.width, options.height);
+	const glm::mat4 camera = Scene::getCamera(glm::vec3(0.f, constants::initial_camera_y, constants::initial_camera_z), 0.f, 0.f);
+
+	// The render thread stays free for drawing, one encoder per remaining core
+	const unsigned int numThreads = (options.numThreads > 0) ? options.numThreads
+	                              : std::max(1u, Parallel::getNumThreads() - 1);
+	ImageSequenceWriter writer(options.prefix, options.format, numThreads, 2 * numThreads);
+
+	std::cout << "Exporting " << skeleton.getNumFrames() << " frames at "
+	          << options.width << "x" << options.height << " to '" << writer.getFileName(0) << "'..." << std::endl;
+
+	sf::Clock clock;
+	std::vector<GLubyte> pixels;
+	unsigned int numRead = 0;
+	const unsigned int numFrames = skeleton.getNumFrames();
+	for (unsigned int i = 0; i < numFrames; ++i) {
+		if (i > 0) skeleton.nextFrame();
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glLoadMatrixf(glm::value_ptr(camera));
+		Scene::draw(skeleton);
+
+		// Collect the oldest frame only once the ring is full, by then its copy has finished
+		if (framebuffer.getNumQueued() == Framebuffer::NUM_READ_BUFFERS && framebuffer.finishRead(pixels)) {
+			writer.write(numRead++, options.width, options.height, pixels, true);
+		}
+		framebuffer.queueRead();
+	}
+	while (framebuffer.finishRead(pixels)) {
+		writer.write(numRead++, options.width, options.height, pixels, true);
+	}
+	framebuffer.unbind();
+
+	const bool written = writer.finish();
+	const float seconds = clock.getElapsedTime().asSeconds();
+	std::cout << "Exported " << writer.getNumWritten() << " of " << numFrames << " frames in "
+	          << seconds << " s (" << ((seconds > 0.f) ? writer.getNumWritten() / seconds : 0.f) << " fps) "
+	          << "with " << numThreads << " encoder threads." << std::endl;
+
+	framebuffer.destroy();
+	return written && writer.getNumWritten() == numFrames;
+}
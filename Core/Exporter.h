@@ -0,0 +1,27 @@
+#pragma once
+/************************************************************************/
+/* Exporter
+/* --------
+/* A static helper class for rendering recordings to image sequences
+/************************************************************************/
+#include <string>
+
+
+class Exporter
+{
+public:
+	struct Options
+	{
+		unsigned int width;
+		unsigned int height;
+		std::string prefix;     // output files are prefix00000.format, ...
+		std::string format;     // png, bmp, tga, jpg or raw
+		unsigned int numThreads; // encoders, 0 picks one less than the hardware threads
+
+		Options();
+	};
+
+	// Render every frame of a recording offscreen and write it as an image,
+	// needs a current context. Reports the frame rate, false on any failure.
+	static bool exportRecording(const std::string& filename, const Options& options);
+};
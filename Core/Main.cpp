@@ -2,10 +2,52 @@
 #define WIN32_LEAN_AND_MEAN
 
 #include "Application.h"
+#include "CommandLine.h"
+#include "Kinect/ReplaySource.h"
+#include "Kinect/SyntheticSource.h"
+#include "Util/FrameScheduler.h"
+#include "Core/Constants.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
 
-int main()
+
+int main(int argc, char *argv[])
 {
+	// Benchmarks, load tests and export, also built without the Kinect SDK as the headless driver
+	int exitCode = 0;
+	if (CommandLine::run(argc, argv, exitCode)) {
+		return exitCode;
+	}
+
+	// Idle CPU and wake latency of the main loop, driven by a synthetic sensor and replayed input
+	if (argc > 1 && std::string(argv[1]) == "--bench-frames") {
+		FrameScheduler::benchmark(10.f, constants::max_frame_rate);
+		return 0;
+	}
+
+	// Generated bodies in place of the sensor, at its 30 Hz by default: --synthetic [bodies] [frame rate]
+	if (argc > 1 && std::string(argv[1]) == "--synthetic") {
+		SyntheticSource::Options options;
+		if (argc > 2) options.numBodies = static_cast<unsigned int>(std::max(0, atoi(argv[2])));
+		if (argc > 3) options.frameRate = static_cast<float>(atof(argv[3]));
+		Application::request().startup(new SyntheticSource(options));
+		return 0;
+	}
+
+	// Stand a recording in for the sensor, at its own pace by default: --replay <recording> [speed]
+	if (argc > 1 && std::string(argv[1]) == "--replay") {
+		if (argc < 3) {
+			std::cerr << "Usage: " << argv[0] << " --replay <recording> [speed]" << std::endl;
+			return 1;
+		}
+		const float speed = (argc > 3) ? static_cast<float>(atof(argv[3])) : 1.f;
+		Application::request().startup(new ReplaySource(argv[2], speed));
+		return 0;
+	}
+
     Application::request().startup();
     return 0;
 }
@@ -0,0 +1,87 @@
+/************************************************************************/
+/* Scene
+/* -----
+/* A static helper class for the 3D view shared by the window and exports
+/************************************************************************/
+#include "Scene.h"
+#include "Constants.h"
+#include "Kinect/Skeleton.h"
+#include "Util/RenderUtils.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <SFML/OpenGL.hpp>
+
+
+void Scene::initState()
+{
+	glClearColor(0,0,0,0);
+	glClearDepth(1.f);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_TEXTURE_2D);
+	glPointSize(10.f);
+	glEnable(GL_POINT_SMOOTH);
+
+	GLfloat mat_ambient[] = { 0.3f, 0.3f, 0.3f, 1.0f };
+	GLfloat mat_diffuse[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	GLfloat mat_specular[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	GLfloat mat_shininess[] = { 50.0f };
+	GLfloat light_position[] = { 0.0f, 0.5f, 0.0f, 1.0f };
+	glMaterialfv(GL_FRONT, GL_AMBIENT, mat_ambient);
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, mat_diffuse);
+	glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
+	glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
+	glLightfv(GL_LIGHT0, GL_POSITION, light_position);
+
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glShadeModel (GL_SMOOTH);
+}
+
+glm::mat4 Scene::setProjection( const int width, const int height )
+{
+	const float aspect = (float) width / (float) height;
+	const glm::mat4 projection = glm::perspective(constants::camera_fov, aspect, constants::camera_z_near, constants::camera_z_far);
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(glm::value_ptr(projection));
+	glMatrixMode(GL_MODELVIEW);
+	return projection;
+}
+
+glm::mat4 Scene::getCamera( const glm::vec3& position, const float rotationX, const float rotationY )
+{
+	glm::mat4 camera = glm::translate(glm::mat4(1), -position);
+	camera = glm::rotate(camera, rotationX, constants::worldX);
+	camera = glm::rotate(camera, rotationY, constants::worldY);
+	camera = glm::rotate(camera, 180.f, constants::worldY);
+	return camera;
+}
+
+void Scene::draw( Skeleton& skeleton, const bool showSkeleton )
+{
+	// Draw reflected skeleton first, both passes share one set of batches
+	if (showSkeleton) {
+		skeleton.updateRenderBatches();
+		glPushMatrix();
+		glScalef(1.f, -1.f, 1.f);
+		skeleton.render();
+		glPopMatrix();
+	}
+
+	// Create imperfect reflector effect by blending ground over reflected scene with alpha
+	glClear (GL_DEPTH_BUFFER_BIT);
+	glPushAttrib (0xffffffff);
+	glEnable (GL_BLEND);
+	glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	Render::ground(0.5f);
+	glDisable(GL_BLEND);
+	glPopAttrib();
+
+	Render::basis();
+
+	// Draw normal skeleton
+	if (showSkeleton) {
+		skeleton.render();
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+/************************************************************************/
+/* Scene
+/* -----
+/* A static helper class for the 3D view shared by the window and exports
+/************************************************************************/
+#include <glm/glm.hpp>
+
+class Skeleton;
+
+
+class Scene
+{
+public:
+	// Depth test, lighting and materials, once per context
+	static void initState();
+
+	// Perspective projection for a viewport of the given size, loaded into GL_PROJECTION
+	static glm::mat4 setProjection(const int width, const int height);
+
+	// Camera at position turned by the given angles in degrees, facing the skeleton
+	static glm::mat4 getCamera(const glm::vec3& position, const float rotationX, const float rotationY);
+
+	// Skeleton reflected in a translucent ground, then the world axes and
+	// the skeleton itself, with the current modelview
+	static void draw(Skeleton& skeleton, const bool showSkeleton = true);
+};
@@ -0,0 +1,216 @@
+#include "BoneOrientation.h"
+#include "Util/Float4.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+
+namespace
+{
+
+	const unsigned int LANES = 4;
+
+	struct Vec4x3 {
+		Float4 x, y, z;
+		Vec4x3() {}
+		Vec4x3(const Float4& x, const Float4& y, const Float4& z) : x(x), y(y), z(z) {}
+	};
+
+	inline Vec4x3 operator-(const Vec4x3& a, const Vec4x3& b) { return Vec4x3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline Vec4x3 operator*(const Vec4x3& a, const Float4& s) { return Vec4x3(a.x * s, a.y * s, a.z * s); }
+	inline Float4 dot(const Vec4x3& a, const Vec4x3& b)       { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline Vec4x3 cross(const Vec4x3& a, const Vec4x3& b) {
+		return Vec4x3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+	inline Vec4x3 select(const Float4& mask, const Vec4x3& a, const Vec4x3& b) {
+		return Vec4x3(select4(mask, a.x, b.x), select4(mask, a.y, b.y), select4(mask, a.z, b.z));
+	}
+
+	// Normalize a, lanes with (nearly) zero length are replaced with fallback
+	inline Vec4x3 normalizeOr(const Vec4x3& a, const Vec4x3& fallback) {
+		const Float4 lengthSquared = dot(a, a);
+		const Float4 valid = greater4(lengthSquared, Float4(1e-12f));
+		const Float4 invLength = Float4(1.f) / sqrt4(max4(lengthSquared, Float4(1e-12f)));
+		return select(valid, a * invLength, fallback);
+	}
+
+	// Rotation matrix with columns x, y, z to quaternion, branch free per lane
+	inline void toQuaternions(const Vec4x3& x, const Vec4x3& y, const Vec4x3& z, glm::quat *out, const unsigned int count) {
+		const Float4 one(1.f), half(0.5f), zero(0.f);
+		const Float4 qw = half * sqrt4(max4(zero, one + x.x + y.y + z.z));
+		const Float4 qx = copysign4(half * sqrt4(max4(zero, one + x.x - y.y - z.z)), y.z - z.y);
+		const Float4 qy = copysign4(half * sqrt4(max4(zero, one - x.x + y.y - z.z)), z.x - x.z);
+		const Float4 qz = copysign4(half * sqrt4(max4(zero, one - x.x - y.y + z.z)), x.y - y.x);
+
+		float w[LANES], a[LANES], b[LANES], c[LANES];
+		qw.store(w); qx.store(a); qy.store(b); qz.store(c);
+		for (unsigned int i = 0; i < count; ++i) {
+			out[i] = glm::quat(w[i], a[i], b[i], c[i]);
+		}
+	}
+
+	inline bool isTorso(const Skeleton::EJointType type) {
+		return type == Skeleton::SPINE || type == Skeleton::SHOULDER_CENTER || type == Skeleton::HEAD;
+	}
+
+	// Solve up to LANES frames at once, starting at frames[0]
+	void solveBatch(const Skeleton::JointFrame *const *frames, const unsigned int count, BoneOrientation::Orientations *out)
+	{
+		const unsigned int numJoints = Skeleton::NUM_JOINT_TYPES;
+
+		// Gather positions into structure of arrays form, one lane per frame
+		Vec4x3 positions[Skeleton::NUM_JOINT_TYPES];
+		for (unsigned int j = 0; j < numJoints; ++j) {
+			float px[LANES] = { 0 }, py[LANES] = { 0 }, pz[LANES] = { 0 };
+			for (unsigned int i = 0; i < count; ++i) {
+				const auto it = frames[i]->find(static_cast<Skeleton::EJointType>(j));
+				if (it == frames[i]->end() || it->second.trackingState == Skeleton::NOT_TRACKED) continue;
+				px[i] = it->second.position.x;
+				py[i] = it->second.position.y;
+				pz[i] = it->second.position.z;
+			}
+			positions[j] = Vec4x3(Float4::load(px), Float4::load(py), Float4::load(pz));
+		}
+
+		const Float4 zero(0.f), one(1.f);
+		const Vec4x3 worldX(one, zero, zero);
+		const Vec4x3 worldY(zero, one, zero);
+		const Vec4x3 worldZ(zero, zero, one);
+		const Vec4x3 shoulders = positions[Skeleton::SHOULDER_RIGHT] - positions[Skeleton::SHOULDER_LEFT];
+		const Vec4x3 hips      = positions[Skeleton::HIP_RIGHT]      - positions[Skeleton::HIP_LEFT];
+
+		// Absolute axes of every bone, parents are always solved before their children
+		Vec4x3 axisX[Skeleton::NUM_JOINT_TYPES];
+		Vec4x3 axisY[Skeleton::NUM_JOINT_TYPES];
+		Vec4x3 axisZ[Skeleton::NUM_JOINT_TYPES];
+		glm::quat absolute[LANES], hierarchical[LANES];
+
+		for (unsigned int j = 0; j < numJoints; ++j) {
+			const Skeleton::EJointType type   = static_cast<Skeleton::EJointType>(j);
+			const Skeleton::EJointType parent = Skeleton::getParentJoint(type);
+			const bool root = (type == Skeleton::HIP_CENTER);
+
+			// Y runs along the bone, the root uses the lower spine
+			Vec4x3 y, reference, alternate;
+			if (root) {
+				y         = normalizeOr(positions[Skeleton::SPINE] - positions[Skeleton::HIP_CENTER], worldY);
+				reference = normalizeOr(hips, worldX);
+				alternate = worldZ;
+			} else {
+				y         = normalizeOr(positions[type] - positions[parent], axisY[parent]);
+				reference = isTorso(type) ? normalizeOr(shoulders, axisX[parent]) : axisX[parent];
+				alternate = axisZ[parent];
+			}
+
+			// X is the reference made perpendicular to Y, switching references if it runs along the bone
+			const Float4 parallel = greater4(abs4(dot(reference, y)), Float4(0.99f));
+			reference = select(parallel, alternate, reference);
+			const Vec4x3 x = normalizeOr(reference - y * dot(reference, y), worldX);
+			const Vec4x3 z = cross(x, y);
+
+			axisX[type] = x;
+			axisY[type] = y;
+			axisZ[type] = z;
+			toQuaternions(x, y, z, absolute, count);
+
+			// Hierarchical rotation is the absolute rotation in the parent bone's frame
+			if (root) {
+				toQuaternions(x, y, z, hierarchical, count);
+			} else {
+				const Vec4x3& px = axisX[parent];
+				const Vec4x3& py = axisY[parent];
+				const Vec4x3& pz = axisZ[parent];
+				toQuaternions(Vec4x3(dot(px, x), dot(py, x), dot(pz, x))
+				            , Vec4x3(dot(px, y), dot(py, y), dot(pz, y))
+				            , Vec4x3(dot(px, z), dot(py, z), dot(pz, z))
+				            , hierarchical, count);
+			}
+
+			for (unsigned int i = 0; i < count; ++i) {
+				out[i].absolute[type]     = absolute[i];
+				out[i].hierarchical[type] = hierarchical[i];
+			}
+		}
+	}
+
+}
+
+void BoneOrientation::solve( const Skeleton::JointFrames& frames, OrientationFrames& orientations )
+{
+	const unsigned int numFrames = frames.size();
+	orientations.resize(numFrames);
+
+	const Skeleton::JointFrame *batch[LANES];
+	for (unsigned int first = 0; first < numFrames; first += LANES) {
+		const unsigned int count = std::min(LANES, numFrames - first);
+		for (unsigned int i = 0; i < count; ++i) {
+			batch[i] = &frames[first + i];
+		}
+		solveBatch(batch, count, &orientations[first]);
+	}
+}
+
+void BoneOrientation::solve( const Skeleton::JointFrame& frame, Orientations& orientations )
+{
+	const Skeleton::JointFrame *batch[] = { &frame };
+	solveBatch(batch, 1, &orientations);
+}
+
+void BoneOrientation::apply( Skeleton::JointFrames& frames )
+{
+	OrientationFrames orientations;
+	solve(frames, orientations);
+
+	for (unsigned int i = 0; i < frames.size(); ++i) {
+		for (auto& entry : frames[i]) {
+			entry.second.orientation = glm::mat4_cast(orientations[i].absolute[entry.first]);
+		}
+	}
+}
+
+void BoneOrientation::compare( const Skeleton::JointFrames& frames )
+{
+	if (frames.empty()) return;
+
+	sf::Clock clock;
+	OrientationFrames orientations;
+	solve(frames, orientations);
+	const float seconds = clock.getElapsedTime().asSeconds();
+
+	double sumAngle[Skeleton::NUM_JOINT_TYPES] = { 0 };
+	double maxAngle[Skeleton::NUM_JOINT_TYPES] = { 0 };
+	unsigned int samples[Skeleton::NUM_JOINT_TYPES] = { 0 };
+
+	for (unsigned int i = 0; i < frames.size(); ++i) {
+		for (const auto& entry : frames[i]) {
+			const Skeleton::Joint& joint = entry.second;
+			const Skeleton::EJointType parent = Skeleton::getParentJoint(joint.type);
+			if (joint.trackingState != Skeleton::TRACKED) continue;
+			if (frames[i].at(parent).trackingState != Skeleton::TRACKED) continue;
+
+			// Angle of the rotation between the stored and solved orientations
+			const glm::quat stored = glm::quat_cast(joint.orientation);
+			const glm::quat solved = orientations[i].absolute[joint.type];
+			const float cosHalfAngle = std::min(1.f, std::fabs(glm::dot(stored, solved)));
+			const double angle = glm::degrees(2.f * std::acos(cosHalfAngle));
+
+			sumAngle[joint.type] += angle;
+			maxAngle[joint.type]  = std::max(maxAngle[joint.type], angle);
+			++samples[joint.type];
+		}
+	}
+
+	std::cout << "Solved " << frames.size() << " frames of bone orientations in " << seconds << " seconds ("
+	          << frames.size() / std::max(seconds, 1e-6f) << " frames/sec)" << std::endl
+	          << "Difference from stored orientations, mean / max in degrees:" << std::endl;
+	for (auto j = 0; j < Skeleton::NUM_JOINT_TYPES; ++j) {
+		if (samples[j] == 0) continue;
+		std::cout << "  joint " << j << ": " << sumAngle[j] / samples[j] << " / " << maxAngle[j]
+		          << " over " << samples[j] << " frames" << std::endl;
+	}
+}
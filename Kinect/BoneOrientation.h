@@ -0,0 +1,36 @@
+#pragma once
+#include "Skeleton.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+
+
+// Bone orientation solver over the Skeleton joint hierarchy, a stand in for
+// NuiSkeletonCalculateBoneOrientations that needs only joint positions.
+//
+// Each joint's bone runs from its parent to the joint. The bone's Y axis
+// points along the bone, X is taken from the shoulders for the spine and
+// head and from the parent bone elsewhere, so twist stays continuous down
+// each limb. Frames are solved in batches with SIMD, several frames per lane.
+class BoneOrientation
+{
+public:
+	struct Orientations {
+		glm::quat absolute[Skeleton::NUM_JOINT_TYPES];     // bone rotation in camera space
+		glm::quat hierarchical[Skeleton::NUM_JOINT_TYPES]; // bone rotation relative to its parent bone
+	};
+	typedef std::vector<Orientations> OrientationFrames;
+
+	// Solve every bone of every frame
+	static void solve(const Skeleton::JointFrames& frames, OrientationFrames& orientations);
+	static void solve(const Skeleton::JointFrame& frame, Orientations& orientations);
+
+	// Replace the stored orientation of every joint with the solved absolute rotation
+	static void apply(Skeleton::JointFrames& frames);
+
+	// Solve a recording and print per joint how far the solved absolute
+	// rotations are from the orientations stored in it, and the solve rate
+	static void compare(const Skeleton::JointFrames& frames);
+};
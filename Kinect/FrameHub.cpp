@@ -0,0 +1,314 @@
+#include "FrameHub.h"
+#include "Util/Tracer.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+	// Backstop for a wake up lost between checking the queue and going to sleep
+	const std::chrono::milliseconds maxSleep(10);
+
+	unsigned int roundUpToPowerOfTwo(const unsigned int n)
+	{
+		unsigned int power = 1;
+		while (power < n) power <<= 1;
+		return power;
+	}
+}
+
+
+Subscription::Subscription( const std::string& name, const unsigned int capacity, const EDropPolicy policy, const Callback& callback )
+	: name(name)
+	, policy(policy)
+	, cells(new Cell[roundUpToPowerOfTwo(std::max(capacity, 2u))])
+	, mask(roundUpToPowerOfTwo(std::max(capacity, 2u)) - 1)
+	, enqueuePosition(0)
+	, dequeuePosition(0)
+	, delivered(0)
+	, dropped(0)
+	, consumed(0)
+	, callback(callback)
+	, worker()
+	, running(false)
+	, sleeping(false)
+	, wakeMutex()
+	, wake()
+{
+	for (unsigned int i = 0; i <= mask; ++i) {
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	if (callback) {
+		running = true;
+		worker = std::thread(&Subscription::run, this);
+	}
+}
+
+Subscription::~Subscription()
+{
+	stop();
+}
+
+bool Subscription::pop( LiveFramePtr& frame )
+{
+	if (!tryPop(frame)) return false;
+	++consumed;
+	return true;
+}
+
+Subscription::Stats Subscription::getStats() const
+{
+	Stats stats;
+	stats.delivered = delivered;
+	stats.dropped   = dropped;
+	stats.consumed  = consumed;
+	return stats;
+}
+
+void Subscription::push( const LiveFramePtr& frame )
+{
+	bool pushed = tryPush(frame);
+
+	// Make room by taking the oldest frame ourselves. The consumer may be
+	// halfway through taking the cell we need, then the new frame goes instead.
+	if (!pushed && policy == DROP_OLDEST) {
+		LiveFramePtr oldest;
+		if (tryPop(oldest)) {
+			++dropped;
+			pushed = tryPush(frame);
+		}
+	}
+	if (!pushed) {
+		++dropped;
+		return;
+	}
+	++delivered;
+
+	// Pairs with the worker announcing it sleeps before it checks the queue a last time
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		wake.notify_one();
+	}
+}
+
+bool Subscription::tryPush( const LiveFramePtr& frame )
+{
+	// Only the publisher pushes, the position needs no compare and swap
+	const unsigned int position = enqueuePosition.load(std::memory_order_relaxed);
+	Cell& cell = cells[position & mask];
+	if (cell.sequence.load(std::memory_order_acquire) != position) {
+		return false;
+	}
+	cell.frame = frame;
+	enqueuePosition.store(position + 1, std::memory_order_relaxed);
+	cell.sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+bool Subscription::tryPop( LiveFramePtr& frame )
+{
+	// The consumer and, dropping the oldest, the publisher compete for cells
+	unsigned int position = dequeuePosition.load(std::memory_order_relaxed);
+	Cell *cell;
+	for (;;) {
+		cell = &cells[position & mask];
+		const int difference = static_cast<int>(cell->sequence.load(std::memory_order_acquire) - (position + 1));
+		if (difference == 0) {
+			if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+		} else if (difference < 0) {
+			return false;
+		} else {
+			position = dequeuePosition.load(std::memory_order_relaxed);
+		}
+	}
+	frame = std::move(cell->frame);
+	cell->frame.reset();
+	cell->sequence.store(position + mask + 1, std::memory_order_release);
+	return true;
+}
+
+bool Subscription::isEmpty() const
+{
+	const unsigned int position = dequeuePosition.load(std::memory_order_relaxed);
+	return cells[position & mask].sequence.load(std::memory_order_acquire) != position + 1;
+}
+
+void Subscription::run()
+{
+	Tracer::setThreadName(name);
+
+	LiveFramePtr frame;
+	for (;;) {
+		if (tryPop(frame)) {
+			callback(frame);
+			frame.reset();
+			++consumed;
+			continue;
+		}
+		if (!running) break;
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		sleeping.store(true);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		wake.wait_for(lock, maxSleep, [&]() { return !isEmpty() || !running; });
+		sleeping.store(false);
+	}
+}
+
+void Subscription::stop()
+{
+	if (!worker.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		running = false;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+
+FrameHub::FrameHub()
+	: subscriptions()
+{}
+
+FrameHub::~FrameHub()
+{
+	clear();
+}
+
+Subscription *FrameHub::subscribe( const std::string& name, const unsigned int capacity, const Subscription::EDropPolicy policy )
+{
+	subscriptions.push_back(new Subscription(name, capacity, policy, Subscription::Callback()));
+	return subscriptions.back();
+}
+
+Subscription *FrameHub::subscribe( const std::string& name, const Subscription::Callback& callback,
+                                   const unsigned int capacity, const Subscription::EDropPolicy policy )
+{
+	subscriptions.push_back(new Subscription(name, capacity, policy, callback));
+	return subscriptions.back();
+}
+
+void FrameHub::unsubscribe( Subscription *subscription )
+{
+	auto it = std::find(subscriptions.begin(), subscriptions.end(), subscription);
+	if (it == subscriptions.end()) return;
+	subscriptions.erase(it);
+	delete subscription;
+}
+
+void FrameHub::clear()
+{
+	for (auto subscription : subscriptions) {
+		delete subscription;
+	}
+	subscriptions.clear();
+}
+
+void FrameHub::publish( const LiveFramePtr& frame )
+{
+	for (auto subscription : subscriptions) {
+		subscription->push(frame);
+	}
+}
+
+void FrameHub::benchmark()
+{
+	static const unsigned int numFrames = 1000;
+	static const unsigned int capacity  = 64;
+	static const unsigned int subscriberCounts[] = { 1, 2, 4, 8, 16, 32 };
+
+	// Six people a frame, about what a full scene hands out
+	LiveFrame prototype;
+	prototype.frameNumber = 0;
+	prototype.acquisitionTime = 0.0;
+	prototype.captureTime = 0;
+	prototype.timestamp = 0.f;
+	prototype.people.resize(6);
+	for (auto& person : prototype.people) {
+		person.id = 0;
+		person.numViews = 1;
+		person.hasOrientations = false;
+		for (int j = 0; j < Skeleton::NUM_JOINT_TYPES; ++j) {
+			Skeleton::Joint& joint = person.joints[static_cast<Skeleton::EJointType>(j)];
+			joint.timestamp = 0.f;
+			joint.position = glm::vec3(0.1f * j, 0.f, 2.f);
+			joint.orientation = glm::mat4(1.f);
+			joint.type = static_cast<Skeleton::EJointType>(j);
+			joint.trackingState = Skeleton::TRACKED;
+		}
+	}
+
+	sf::Clock clock;
+	std::cout << std::fixed << std::setprecision(1)
+	          << "Published " << numFrames << " frames at about 1 kHz to callback subscriptions of " << capacity << " frames:" << std::endl
+	          << std::setw(12) << "subscribers" << std::setw(14) << "publish us" << std::setw(14) << "latency us"
+	          << std::setw(10) << "p99 us" << std::setw(12) << "delivered" << std::setw(10) << "dropped" << std::endl;
+
+	// The last run repeats the largest with one subscriber far slower than the frames arrive
+	const unsigned int numRuns = sizeof(subscriberCounts) / sizeof(subscriberCounts[0]);
+	for (unsigned int run = 0; run <= numRuns; ++run) {
+		const bool withSlow = (run == numRuns);
+		const unsigned int numSubscribers = subscriberCounts[withSlow ? numRuns - 1 : run];
+
+		FrameHub hub;
+		std::vector<std::vector<float> > latencies(numSubscribers);
+		std::vector<float> checksums(numSubscribers, 0.f);
+		std::vector<Subscription *> subscriptions;
+		for (unsigned int s = 0; s < numSubscribers; ++s) {
+			latencies[s].reserve(numFrames);
+			const bool slow = withSlow && s == 0;
+			subscriptions.push_back(hub.subscribe("subscriber", [&, s, slow](const LiveFramePtr& frame) {
+				latencies[s].push_back(clock.getElapsedTime().asSeconds() - frame->timestamp);
+				for (auto& person : frame->people) {
+					checksums[s] += person.joints.at(Skeleton::HAND_RIGHT).position.x;
+				}
+				if (slow) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}, capacity, Subscription::DROP_OLDEST));
+		}
+
+		float publishSeconds = 0.f;
+		for (unsigned int f = 0; f < numFrames; ++f) {
+			const float start = clock.getElapsedTime().asSeconds();
+			std::shared_ptr<LiveFrame> frame(new LiveFrame(prototype));
+			frame->frameNumber = f;
+			frame->timestamp = clock.getElapsedTime().asSeconds();
+			hub.publish(frame);
+			publishSeconds += clock.getElapsedTime().asSeconds() - start;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		// Totals over the fast subscribers, once they caught up
+		Subscription::Stats total = { 0, 0, 0 };
+		std::vector<Subscription::Stats> stats;
+		for (auto subscription : subscriptions) {
+			stats.push_back(subscription->getStats());
+		}
+		hub.clear();
+		std::vector<float> all;
+		for (unsigned int s = (withSlow ? 1 : 0); s < numSubscribers; ++s) {
+			all.insert(all.end(), latencies[s].begin(), latencies[s].end());
+			total.delivered += stats[s].delivered;
+			total.dropped   += stats[s].dropped;
+		}
+		std::sort(all.begin(), all.end());
+		float sum = 0.f;
+		for (auto latency : all) sum += latency;
+
+		const unsigned int numFast = numSubscribers - (withSlow ? 1 : 0);
+		std::cout << std::setw(12) << numFast << std::setw(14) << 1e6f * publishSeconds / numFrames
+		          << std::setw(14) << (all.empty() ? 0.f : 1e6f * sum / all.size())
+		          << std::setw(10) << (all.empty() ? 0.f : 1e6f * all[all.size() * 99 / 100])
+		          << std::setw(11) << 100.f * total.delivered / (numFrames * numFast) << "%"
+		          << std::setw(10) << total.dropped;
+		if (withSlow) {
+			std::cout << "  + 1 slow subscriber: " << stats[0].consumed << " handled, " << stats[0].dropped << " dropped";
+		}
+		std::cout << std::endl;
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "SkeletonFusion.h"
+
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// A live frame as Kinect hands it to its subscribers, never changed once
+// published so every subscriber shares the same one
+struct LiveFrame
+{
+	unsigned int frameNumber;       // of the first sensor
+	double acquisitionTime;         // on the first sensor's clock, seconds
+	uint64_t captureTime;           // MonotonicClock::now() as the first sensor's frame was acquired
+	float timestamp;                // seconds from the first skeleton frame's capture
+	SkeletonFusion::People people;  // the first one as the skeleton shows them, orientations solved
+};
+typedef std::shared_ptr<const LiveFrame> LiveFramePtr;
+
+
+// One consumer's bounded queue of live frames. The publisher never waits
+// on it: when the queue is full it drops by the subscription's policy, so
+// a slow consumer only loses its own frames. Frames are either polled with
+// pop() or handed to a callback on a worker thread of the subscription's own.
+class Subscription
+{
+public:
+	enum EDropPolicy {
+		DROP_OLDEST = 0,                 // keep up with the newest frames
+		DROP_NEWEST = (DROP_OLDEST + 1)  // keep a gapless run up to the point it filled
+	};
+
+	typedef std::function<void(const LiveFramePtr&)> Callback;
+
+	struct Stats
+	{
+		unsigned int delivered;  // pushed into the queue
+		unsigned int dropped;    // by the drop policy
+		unsigned int consumed;   // popped or called back
+	};
+
+private:
+	// Each cell's sequence tells whose turn it is, the publisher's to fill
+	// it or a reader's to take it, so neither side needs a lock
+	struct Cell
+	{
+		std::atomic<unsigned int> sequence;
+		LiveFramePtr frame;
+	};
+
+	const std::string name;
+	const EDropPolicy policy;
+	std::unique_ptr<Cell[]> cells;
+	const unsigned int mask;          // capacity - 1
+	std::atomic<unsigned int> enqueuePosition;
+	std::atomic<unsigned int> dequeuePosition;
+
+	std::atomic<unsigned int> delivered;
+	std::atomic<unsigned int> dropped;
+	std::atomic<unsigned int> consumed;
+
+	Callback callback;
+	std::thread worker;
+	std::atomic<bool> running;
+	std::atomic<bool> sleeping;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+
+public:
+	// Oldest queued frame, false if there is none. Polled subscriptions only.
+	bool pop(LiveFramePtr& frame);
+
+	Stats getStats() const;
+	const std::string& getName() const { return name; }
+	EDropPolicy getDropPolicy() const  { return policy; }
+	unsigned int getCapacity() const   { return mask + 1; }
+
+private:
+	friend class FrameHub;
+
+	// Capacity is rounded up to a power of two
+	Subscription(const std::string& name, const unsigned int capacity, const EDropPolicy policy, const Callback& callback);
+	~Subscription();
+
+	void push(const LiveFramePtr& frame);
+	bool tryPush(const LiveFramePtr& frame);
+	bool tryPop(LiveFramePtr& frame);
+	bool isEmpty() const;
+
+	// Callback worker, runs until stopped and the queue is drained
+	void run();
+	void stop();
+
+	Subscription(const Subscription& other);
+	Subscription& operator=(const Subscription& other);
+};
+
+
+// Fans live frames out to any number of subscriptions. Subscribing,
+// unsubscribing and publishing all happen on the publishing thread, the
+// main loop, so the list of subscriptions needs no lock either.
+class FrameHub
+{
+private:
+	std::vector<Subscription *> subscriptions;
+
+public:
+	FrameHub();
+	~FrameHub();
+
+	// A queue to poll with Subscription::pop()
+	Subscription *subscribe(const std::string& name, const unsigned int capacity, const Subscription::EDropPolicy policy);
+	// A callback run for every frame on a worker thread of its own
+	Subscription *subscribe(const std::string& name, const Subscription::Callback& callback,
+	                        const unsigned int capacity, const Subscription::EDropPolicy policy);
+	// Callback subscriptions finish the frames they have queued first
+	void unsubscribe(Subscription *subscription);
+	void clear();
+
+	void publish(const LiveFramePtr& frame);
+	unsigned int getNumSubscriptions() const { return subscriptions.size(); }
+
+	// Time publishing to 1 through 32 callback subscriptions, and how long
+	// frames take to reach them, then one slow subscriber among fast ones
+	static void benchmark();
+
+private:
+	FrameHub(const FrameHub& other);
+	FrameHub& operator=(const FrameHub& other);
+};
@@ -0,0 +1,333 @@
+#include "FramePipeline.h"
+#include "BoneOrientation.h"
+#include "ImageConversion.h"
+#include "Kinect.h"
+#include "ReplaySource.h"
+#include "Util/Random.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+	const unsigned int numColorPixels = Kinect::COLOR_STREAM_WIDTH * Kinect::COLOR_STREAM_HEIGHT;
+	const unsigned int numDepthPixels = Kinect::DEPTH_STREAM_WIDTH * Kinect::DEPTH_STREAM_HEIGHT;
+
+	// Pixels [first, last) of strip out of numStrips
+	void getStrip(const unsigned int strip, const unsigned int numStrips, const unsigned int numPixels,
+	              unsigned int& first, unsigned int& last)
+	{
+		first = static_cast<unsigned int>(static_cast<unsigned long long>(numPixels) * strip / numStrips);
+		last  = static_cast<unsigned int>(static_cast<unsigned long long>(numPixels) * (strip + 1) / numStrips);
+	}
+}
+
+
+FramePipeline::FramePipeline( const Skeleton::EFilteringLevel smoothing, const std::function<void()>& notify )
+	: current(1)
+	, inFlight(false)
+	, smoothing(smoothing)
+	, nextSmoothing(smoothing)
+	, filters()
+	, notify(notify)
+{}
+
+FramePipeline::~FramePipeline()
+{
+	finish();
+}
+
+void FramePipeline::submit( const Input& input )
+{
+	if (inFlight) finish();
+
+	if (nextSmoothing != smoothing) {
+		smoothing = nextSmoothing;
+		filters.clear();
+	}
+
+	current = 1 - current;
+	Slot& slot = slots[current];
+	slot.input = input;
+
+	Output& output = slot.output;
+	output.frameNumber = input.skeleton.frameNumber;
+	output.color.resize(input.color ? 4 * numColorPixels : 0);
+	output.depth.resize(input.depth ? 4 * numDepthPixels : 0);
+	output.skeleton = input.skeleton;
+	output.skeleton.hasOrientations = true;
+	output.record.resize(output.skeleton.bodies.size() * Skeleton::NUM_JOINT_TYPES * sizeof(Skeleton::Joint));
+
+	// Filters follow the sensor's body slots, the previous frame finished with them
+	if (filters.size() < output.skeleton.bodies.size()) {
+		filters.resize(output.skeleton.bodies.size(), JointFilter(JointFilter::getParameters(smoothing)));
+	}
+
+	buildGraph(slot);
+	slot.graph.run(output.frameNumber);
+	inFlight = true;
+}
+
+const FramePipeline::Output *FramePipeline::finish()
+{
+	if (!inFlight) return nullptr;
+	slots[current].graph.wait();
+	inFlight = false;
+	return &slots[current].output;
+}
+
+void FramePipeline::buildGraph( Slot& slot )
+{
+	JobGraph& graph = slot.graph;
+	const Input& input = slot.input;
+	Output& output = slot.output;
+	graph.clear();
+
+	// Images in strips, independent of everything else
+	std::vector<JobGraph::JobId> converted;
+	for (unsigned int strip = 0; input.color && strip < NUM_STRIPS; ++strip) {
+		converted.push_back(graph.add("color conversion", [&input, &output, strip]() {
+			unsigned int first, last;
+			getStrip(strip, NUM_STRIPS, numColorPixels, first, last);
+			ImageConversion::colorToBGRA(input.color + 4 * first, &output.color[4 * first], last - first);
+		}));
+	}
+	for (unsigned int strip = 0; input.depth && strip < NUM_STRIPS; ++strip) {
+		converted.push_back(graph.add("depth conversion", [&input, &output, strip]() {
+			unsigned int first, last;
+			getStrip(strip, NUM_STRIPS, numDepthPixels, first, last);
+			ImageConversion::depthToBGRA(input.depth + first, &output.depth[4 * first], last - first);
+		}));
+	}
+
+	// Each body is smoothed, then solved, and encoded once all of them are
+	std::vector<JobGraph::JobId> solved;
+	for (unsigned int b = 0; b < output.skeleton.bodies.size(); ++b) {
+		Skeleton::JointFrame& body = output.skeleton.bodies[b];
+		JointFilter& filter = filters[b];
+		const Skeleton::EFilteringLevel level = smoothing;
+		const bool solveOrientations = !input.skeleton.hasOrientations;
+
+		const JobGraph::JobId smooth = graph.add("smoothing", [&body, &filter, level]() {
+			if (level != Skeleton::OFF) filter.apply(body);
+		});
+		const JobGraph::JobId solve = graph.add("orientations", [&body, solveOrientations]() {
+			if (!solveOrientations) return;
+			BoneOrientation::Orientations orientations;
+			BoneOrientation::solve(body, orientations);
+			for (auto& entry : body) {
+				entry.second.orientation = glm::mat4_cast(orientations.absolute[entry.first]);
+			}
+		});
+		graph.addDependency(solve, smooth);
+		solved.push_back(solve);
+	}
+
+	const JobGraph::JobId encode = graph.add("record encode", [&output]() {
+		char *dest = output.record.empty() ? nullptr : &output.record[0];
+		for (const auto& body : output.skeleton.bodies) {
+			for (const auto& entry : body) {
+				memcpy(dest, &entry.second, sizeof(Skeleton::Joint));
+				dest += sizeof(Skeleton::Joint);
+			}
+		}
+		output.record.resize(dest - (output.record.empty() ? nullptr : &output.record[0]));
+	});
+	for (auto solve : solved) {
+		graph.addDependency(encode, solve);
+	}
+
+	if (notify) {
+		const JobGraph::JobId done = graph.add("frame done", notify);
+		graph.addDependency(done, encode);
+		for (auto strip : converted) {
+			graph.addDependency(done, strip);
+		}
+	}
+}
+
+bool FramePipeline::process( const std::string& recording, const std::string& output, const Skeleton::EFilteringLevel smoothing )
+{
+	ReplaySource source(recording, 0.f);
+	if (!source.open()) return false;
+
+	// Raw images of the frame in flight and the one submitted after it
+	std::vector<unsigned char> colors[2];
+	std::vector<unsigned short> depths[2];
+	for (unsigned int i = 0; i < 2; ++i) {
+		colors[i].resize(Kinect::COLOR_STREAM_BYTES);
+		depths[i].resize(numDepthPixels);
+	}
+	const bool withColor = source.readImage(COLOR, 0, &colors[0][0]);
+	const bool withDepth = source.readImage(DEPTH, 0, &depths[0][0]);
+
+	std::ofstream jointStream(output, std::ios::binary | std::ios::out | std::ios::trunc);
+	std::ofstream colorStream, depthStream;
+	if (withColor) colorStream.open(output + ".color.raw", std::ios::binary | std::ios::out | std::ios::trunc);
+	if (withDepth) depthStream.open(output + ".depth.raw", std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!jointStream.is_open() || (withColor && !colorStream.is_open()) || (withDepth && !depthStream.is_open())) {
+		std::cerr << "Failed to open '" << output << "' for writing." << std::endl;
+		return false;
+	}
+
+	// Frames without bodies are left out, images stay in step with the joints
+	unsigned int numWritten = 0;
+	auto write = [&](const Output& finished) {
+		if (finished.record.empty()) return;
+		jointStream.write(&finished.record[0], finished.record.size());
+		if (!finished.color.empty()) {
+			colorStream.write(reinterpret_cast<const char *>(&finished.color[0]), finished.color.size());
+		}
+		if (withDepth) {
+			const std::vector<unsigned short>& depth = depths[finished.frameNumber % 2];
+			depthStream.write(reinterpret_cast<const char *>(&depth[0]), depth.size() * sizeof(unsigned short));
+		}
+		++numWritten;
+	};
+
+	JobSystem::start();
+	sf::Clock clock;
+	const unsigned int numFrames = source.getNumFrames();
+	{
+		FramePipeline pipeline(smoothing);
+		Input input;
+		for (unsigned int f = 0; f < numFrames && source.getSkeletonFrame(input.skeleton, Skeleton::OFF); ++f) {
+			// Recorded orientations were solved from the unsmoothed positions
+			input.skeleton.hasOrientations = (smoothing == Skeleton::OFF);
+			const unsigned int slot = input.skeleton.frameNumber % 2;
+			if (withColor && !source.readImage(COLOR, input.skeleton.frameNumber, &colors[slot][0])) {
+				memset(&colors[slot][0], 0, colors[slot].size());
+			}
+			if (withDepth && !source.readImage(DEPTH, input.skeleton.frameNumber, &depths[slot][0])) {
+				memset(&depths[slot][0], 0, depths[slot].size() * sizeof(unsigned short));
+			}
+			input.color = withColor ? &colors[slot][0] : nullptr;
+			input.depth = nullptr;
+
+			const Output *finished = pipeline.finish();
+			pipeline.submit(input);
+			if (finished) write(*finished);
+		}
+		const Output *last = pipeline.finish();
+		if (last) write(*last);
+	}
+	const float seconds = clock.getElapsedTime().asSeconds();
+
+	if (!jointStream.good() || (withColor && !colorStream.good()) || (withDepth && !depthStream.good())) {
+		std::cerr << "Failed to write '" << output << "'." << std::endl;
+		return false;
+	}
+	std::cout << "Processed " << numFrames << " frames in " << seconds << " seconds, "
+	          << numFrames / seconds << " frames/s on " << JobSystem::getNumWorkers() + 1 << " threads. Wrote "
+	          << numWritten << " frames to '" << output << "'." << std::endl;
+	return true;
+}
+
+void FramePipeline::benchmark( SensorSource *source, const unsigned int numFrames )
+{
+	static const unsigned int threadCounts[] = { 1, 2, 4, 8, 16 };
+	static const unsigned int numImages = 2; // raw images cycled through
+
+	if (!source->open()) return;
+
+	// Skeleton frames up front, so the source's own cost stays out of the timings
+	std::vector<SensorSource::SkeletonFrame> frames;
+	SensorSource::SkeletonFrame frame;
+	unsigned int misses = 0;
+	while (frames.size() < numFrames && misses < 1000) {
+		if (source->getSkeletonFrame(frame, Skeleton::OFF)) {
+			frames.push_back(frame);
+			misses = 0;
+			continue;
+		}
+		++misses;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	if (frames.empty()) {
+		std::cerr << "Failed to get skeleton frames from '" << source->getDeviceId() << "'." << std::endl;
+		return;
+	}
+
+	// Raw images are not recorded, conversions cost the same on generated ones
+	std::vector<std::vector<unsigned char> > colors(numImages, std::vector<unsigned char>(4 * numColorPixels));
+	std::vector<std::vector<unsigned short> > depths(numImages, std::vector<unsigned short>(numDepthPixels));
+	Random random;
+	for (unsigned int i = 0; i < numImages; ++i) {
+		for (auto& value : colors[i]) {
+			value = static_cast<unsigned char>(random.next() >> 24);
+		}
+		for (unsigned int p = 0; p < numDepthPixels; ++p) {
+			const unsigned short millimeters = static_cast<unsigned short>(800 + (p + 37 * i) % 3200);
+			depths[i][p] = static_cast<unsigned short>((millimeters << ImageConversion::PLAYER_INDEX_SHIFT) | (p % 7));
+		}
+	}
+
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	if (hardwareThreads > 0 && hardwareThreads < threadCounts[sizeof(threadCounts) / sizeof(threadCounts[0]) - 1]) {
+		std::cerr << "Warning: runs on more than " << hardwareThreads << " threads share hardware threads, "
+		          << "their speedups say nothing about scaling." << std::endl;
+	}
+
+	unsigned int numBodies = 0;
+	for (const auto& f : frames) numBodies += f.bodies.size();
+	std::cout << std::fixed << std::setprecision(1)
+	          << "Pipelined " << frames.size() << " frames from '" << source->getDeviceId() << "' ("
+	          << static_cast<float>(numBodies) / frames.size() << " bodies per frame) with "
+	          << 2 * NUM_STRIPS << " image strips, on " << hardwareThreads << " hardware threads:" << std::endl
+	          << std::setw(10) << "threads" << std::setw(12) << "frames/s" << std::setw(12) << "ms/frame"
+	          << std::setw(10) << "speedup" << std::setw(12) << "result" << std::endl;
+
+	float baseRate = 0.f;
+	unsigned long long baseChecksum = 0;
+	for (auto numThreads : threadCounts) {
+		// The calling thread is one of them, it runs jobs while it waits
+		JobSystem::start(numThreads - 1);
+
+		std::vector<unsigned char> colorTexture(4 * numColorPixels), depthTexture(4 * numDepthPixels);
+		unsigned long long checksum = 0;
+
+		// Stand-in for drawing a finished frame while the next one is processed
+		auto render = [&](const Output& output) {
+			if (!output.color.empty()) memcpy(&colorTexture[0], &output.color[0], output.color.size());
+			if (!output.depth.empty()) memcpy(&depthTexture[0], &output.depth[0], output.depth.size());
+			for (auto byte : output.record) checksum = checksum * 31 + static_cast<unsigned char>(byte);
+			checksum = checksum * 31 + colorTexture[output.frameNumber % colorTexture.size()] + depthTexture[output.frameNumber % depthTexture.size()];
+		};
+
+		sf::Clock clock;
+		{
+			FramePipeline pipeline;
+			for (unsigned int f = 0; f < frames.size(); ++f) {
+				Input input;
+				input.skeleton = frames[f];
+				input.color = &colors[f % numImages][0];
+				input.depth = &depths[f % numImages][0];
+
+				const Output *finished = pipeline.finish();
+				pipeline.submit(input);
+				if (finished) render(*finished);
+			}
+			render(*pipeline.finish());
+		}
+		const float rate = frames.size() / clock.getElapsedTime().asSeconds();
+		if (baseRate == 0.f) {
+			baseRate = rate;
+			baseChecksum = checksum;
+		}
+
+		std::cout << std::setw(10) << numThreads << std::setw(12) << rate << std::setw(12) << std::setprecision(2) << 1000.f / rate
+		          << std::setw(9) << rate / baseRate << "x" << std::setw(12) << ((checksum == baseChecksum) ? "same" : "DIFFERENT")
+		          << ((hardwareThreads > 0 && numThreads > hardwareThreads) ? "  oversubscribed" : "")
+		          << std::setprecision(1) << std::endl;
+	}
+	JobSystem::start();
+}
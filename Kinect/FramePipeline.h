@@ -0,0 +1,87 @@
+#pragma once
+#include "JointFilter.h"
+#include "SensorSource.h"
+#include "Util/JobSystem.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// Processes sensor frames as a graph of jobs each: color and depth images are
+// converted in strips, every body is smoothed and then has its bone
+// orientations solved if the source has none, and the bodies are encoded into the joint records
+// recordings are made of. Frames are pipelined, the graph of one frame runs
+// on the job system while the caller uses the results of the one before.
+class FramePipeline
+{
+public:
+	static const unsigned int NUM_STRIPS = 8; // jobs per image
+
+	// Images as the sensor delivers them, either may be missing
+	struct Input
+	{
+		SensorSource::SkeletonFrame skeleton;
+		const unsigned char *color;       // Kinect::COLOR_STREAM_BYTES, null if none
+		const unsigned short *depth;      // Kinect::DEPTH_STREAM_WIDTH * DEPTH_STREAM_HEIGHT, null if none
+	};
+
+	struct Output
+	{
+		unsigned int frameNumber;
+		std::vector<unsigned char> color; // BGRA, empty without color
+		std::vector<unsigned char> depth; // BGRA, empty without depth
+		SensorSource::SkeletonFrame skeleton; // the input's, its bodies smoothed and with orientations
+		std::vector<char> record;         // every body's joints as Skeleton::Joint records
+	};
+
+private:
+	struct Slot
+	{
+		JobGraph graph;
+		Input input;
+		Output output;
+	};
+
+	Slot slots[2];                    // the frame in flight and the one finished before it
+	unsigned int current;             // slot of the frame submitted last
+	bool inFlight;
+	Skeleton::EFilteringLevel smoothing;
+	Skeleton::EFilteringLevel nextSmoothing;
+	std::vector<JointFilter> filters; // one per body, carried from frame to frame
+	std::function<void()> notify;
+
+public:
+	// notify is called from the job system once the jobs of a frame are done
+	FramePipeline(const Skeleton::EFilteringLevel smoothing = Skeleton::MEDIUM, const std::function<void()>& notify = nullptr);
+	~FramePipeline();
+
+	// From the next frame submitted on, which starts the filters over
+	void setSmoothing(const Skeleton::EFilteringLevel level) { nextSmoothing = level; }
+
+	// Start on a frame, the one before it has to be finished. Images are read
+	// while the frame is in flight and must stay valid until it finishes.
+	void submit(const Input& input);
+
+	// Wait for the frame in flight, running its jobs meanwhile. Its output
+	// stays valid while the frame after it is in flight, null if none was.
+	const Output *finish();
+
+	// Replay one pass of a recording through the pipeline as fast as it goes and
+	// write it to output smoothed at the given level, with orientations solved
+	// again if smoothing moved the joints. Recorded color images are converted
+	// on the way to output + ".color.raw" and depth images copied to
+	// output + ".depth.raw", both only for the frames written.
+	static bool process(const std::string& recording, const std::string& output, const Skeleton::EFilteringLevel smoothing);
+
+	// Replay numFrames skeleton frames of source, with raw images generated
+	// once, through the pipeline on 1 to 16 threads with a stand-in for
+	// rendering each finished frame, and print the frame rates and speedups
+	static void benchmark(SensorSource *source, const unsigned int numFrames = 600);
+
+private:
+	void buildGraph(Slot& slot);
+
+	FramePipeline(const FramePipeline& other);
+	FramePipeline& operator=(const FramePipeline& other);
+};
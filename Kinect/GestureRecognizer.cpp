@@ -0,0 +1,346 @@
+#include "GestureRecognizer.h"
+
+#include <glm/glm.hpp>
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <limits>
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	const Skeleton::EJointType featureJoints[GestureRecognizer::NUM_FEATURE_JOINTS] = {
+		Skeleton::HAND_LEFT, Skeleton::HAND_RIGHT, Skeleton::ELBOW_LEFT, Skeleton::ELBOW_RIGHT
+	};
+
+	const float infinity = std::numeric_limits<float>::infinity();
+
+	inline float squaredDistance(const float *a, const float *b) {
+		float sum = 0.f;
+		for (unsigned int d = 0; d < GestureRecognizer::FEATURE_SIZE; ++d) {
+			const float diff = a[d] - b[d];
+			sum += diff * diff;
+		}
+		return sum;
+	}
+}
+
+
+GestureRecognizer::GestureRecognizer( const float bandFraction )
+	: templates()
+	, history()
+	, capacity(0)
+	, head(0)
+	, numFrames(0)
+	, bandFraction(bandFraction)
+	, projection()
+	, projectionUpper()
+	, projectionLower()
+	, cumulativeBound()
+	, costs()
+	, envelopeQueues()
+{
+	clearStats();
+}
+
+bool GestureRecognizer::addTemplate( const std::string& name, const std::string& filename, const float threshold )
+{
+	Skeleton::JointFrames frames;
+	if (!Skeleton::readFile(filename, frames) || frames.empty()) {
+		std::cerr << "Failed to load gesture template '" << name << "' from '" << filename << "'" << std::endl;
+		return false;
+	}
+	addTemplate(name, frames, threshold);
+	return true;
+}
+
+void GestureRecognizer::addTemplate( const std::string& name, const Skeleton::JointFrames& frames, const float threshold )
+{
+	Template t;
+	t.name = name;
+	t.threshold = threshold;
+
+	// Skip frames without the reference joints rather than failing the whole template
+	t.series.resize(frames.size() * FEATURE_SIZE);
+	unsigned int length = 0;
+	for (const auto& frame : frames) {
+		if (toFeatures(frame, &t.series[length * FEATURE_SIZE])) ++length;
+	}
+	if (length < 2) return;
+
+	t.length = length;
+	t.band   = std::max(1u, static_cast<unsigned int>(bandFraction * length));
+	t.series.resize(length * FEATURE_SIZE);
+	t.upper.resize(t.series.size());
+	t.lower.resize(t.series.size());
+	computeEnvelope(&t.series[0], t.length, t.band, &t.upper[0], &t.lower[0], envelopeQueues);
+
+	templates.push_back(t);
+	growHistory(length);
+}
+
+void GestureRecognizer::clearTemplates()
+{
+	templates.clear();
+	reset();
+}
+
+void GestureRecognizer::reset()
+{
+	head = 0;
+	numFrames = 0;
+}
+
+void GestureRecognizer::clearStats()
+{
+	memset(&stats, 0, sizeof(Stats));
+}
+
+bool GestureRecognizer::update( const Skeleton::JointFrame& frame, Match& match )
+{
+	if (templates.empty()) return false;
+
+	float features[FEATURE_SIZE];
+	if (!toFeatures(frame, features)) return false;
+
+	// Write the frame at head and head + capacity so the newest frames stay contiguous
+	std::copy(features, features + FEATURE_SIZE, &history[head * FEATURE_SIZE]);
+	std::copy(features, features + FEATURE_SIZE, &history[(head + capacity) * FEATURE_SIZE]);
+	head = (head + 1) % capacity;
+	if (numFrames < capacity) ++numFrames;
+
+	// Newest frame is at head + capacity - 1
+	const unsigned int newest = head + capacity - 1;
+
+	const Template *best = nullptr;
+	float bestDistance = infinity;
+	for (const auto& t : templates) {
+		if (t.length > numFrames) continue;
+
+		const float *window = &history[(newest + 1 - t.length) * FEATURE_SIZE];
+		const float bestSoFar = std::min(t.threshold, bestDistance) * t.length;
+		const float distance = compare(t, window, bestSoFar) / t.length;
+		if (distance < bestDistance && distance <= t.threshold) {
+			bestDistance = distance;
+			best = &t;
+		}
+	}
+
+	if (best == nullptr) return false;
+
+	match.name = best->name;
+	match.distance = bestDistance;
+	reset();
+	return true;
+}
+
+float GestureRecognizer::compare( const Template& t, const float *window, const float bestSoFar )
+{
+	++stats.comparisons;
+
+	const unsigned int m = t.length;
+	projection.resize(m * FEATURE_SIZE);
+	cumulativeBound.resize(m + 1);
+
+	// LB_Keogh: distance from the window to the template's envelope, and the
+	// window projected onto that envelope for the LB_Improved pass below
+	float keogh = 0.f;
+	for (unsigned int i = 0; i < m; ++i) {
+		float contribution = 0.f;
+		for (unsigned int d = 0; d < FEATURE_SIZE; ++d) {
+			const unsigned int k = i * FEATURE_SIZE + d;
+			const float x = window[k];
+			float p = x;
+			     if (x > t.upper[k]) p = t.upper[k];
+			else if (x < t.lower[k]) p = t.lower[k];
+			contribution += (x - p) * (x - p);
+			projection[k] = p;
+		}
+		cumulativeBound[i] = contribution;
+		keogh += contribution;
+		if (keogh >= bestSoFar) {
+			++stats.keoghPruned;
+			return infinity;
+		}
+	}
+
+	// Per row bounds summed from the end, used to abandon the DTW early
+	cumulativeBound[m] = 0.f;
+	for (int i = m - 1; i >= 0; --i) {
+		cumulativeBound[i] += cumulativeBound[i + 1];
+	}
+
+	// LB_Improved: add the distance from the template to the projection's envelope
+	projectionUpper.resize(projection.size());
+	projectionLower.resize(projection.size());
+	computeEnvelope(&projection[0], m, t.band, &projectionUpper[0], &projectionLower[0], envelopeQueues);
+	float improved = keogh;
+	for (unsigned int k = 0; k < m * FEATURE_SIZE; ++k) {
+		const float y = t.series[k];
+		     if (y > projectionUpper[k]) improved += (y - projectionUpper[k]) * (y - projectionUpper[k]);
+		else if (y < projectionLower[k]) improved += (projectionLower[k] - y) * (projectionLower[k] - y);
+	}
+	if (improved >= bestSoFar) {
+		++stats.improvedPruned;
+		return infinity;
+	}
+
+	return dtw(t, window, bestSoFar);
+}
+
+float GestureRecognizer::dtw( const Template& t, const float *window, const float bestSoFar )
+{
+	// Rows are window frames, columns template frames, both limited to the band
+	const unsigned int m = t.length;
+	const unsigned int r = t.band;
+	costs.assign(2 * m, infinity);
+	float *prev = &costs[0];
+	float *curr = &costs[m];
+
+	for (unsigned int i = 0; i < m; ++i) {
+		const unsigned int first = (i > r) ? i - r : 0;
+		const unsigned int last  = std::min(m - 1, i + r);
+		const float *a = &window[i * FEATURE_SIZE];
+
+		float rowMin = infinity;
+		for (unsigned int j = first; j <= last; ++j) {
+			float best;
+			if (i == 0 && j == 0) {
+				best = 0.f;
+			} else {
+				const float up       = (i > 0)          ? prev[j]     : infinity;
+				const float left     = (j > first)      ? curr[j - 1] : infinity;
+				const float diagonal = (i > 0 && j > 0) ? prev[j - 1] : infinity;
+				best = std::min(up, std::min(left, diagonal));
+			}
+			curr[j] = best + squaredDistance(a, &t.series[j * FEATURE_SIZE]);
+			rowMin = std::min(rowMin, curr[j]);
+		}
+
+		// Every later row adds at least its LB_Keogh contribution
+		if (rowMin + cumulativeBound[i + 1] >= bestSoFar) {
+			++stats.abandoned;
+			return infinity;
+		}
+
+		// Cells right of the band are never written so they still read as unreachable,
+		// stale cells left of it are never read as the band only moves right
+		std::swap(prev, curr);
+	}
+
+	++stats.completed;
+	return prev[m - 1];
+}
+
+bool GestureRecognizer::toFeatures( const Skeleton::JointFrame& frame, float *features )
+{
+	const auto center = frame.find(Skeleton::SHOULDER_CENTER);
+	const auto left   = frame.find(Skeleton::SHOULDER_LEFT);
+	const auto right  = frame.find(Skeleton::SHOULDER_RIGHT);
+	if (center == frame.end() || left == frame.end() || right == frame.end()) return false;
+	if (center->second.trackingState == Skeleton::NOT_TRACKED) return false;
+
+	// Relative to the shoulder center, in units of shoulder width
+	const glm::vec3& origin = center->second.position;
+	const float width = glm::distance(left->second.position, right->second.position);
+	const float scale = (width > 1e-3f) ? 1.f / width : 1.f;
+
+	for (unsigned int i = 0; i < NUM_FEATURE_JOINTS; ++i) {
+		const auto it = frame.find(featureJoints[i]);
+		if (it == frame.end()) return false;
+		const glm::vec3 p = (it->second.position - origin) * scale;
+		features[3 * i + 0] = p.x;
+		features[3 * i + 1] = p.y;
+		features[3 * i + 2] = p.z;
+	}
+	return true;
+}
+
+void GestureRecognizer::computeEnvelope( const float *series, const unsigned int length, const unsigned int band
+                                       , float *upper, float *lower, std::vector<unsigned int>& queues )
+{
+	// Lemire's streaming min/max, monotonic queues of indices so each dimension is O(length)
+	queues.resize(2 * length);
+	unsigned int *maxQueue = &queues[0];
+	unsigned int *minQueue = &queues[length];
+
+	for (unsigned int d = 0; d < FEATURE_SIZE; ++d) {
+		unsigned int maxFront = 0, maxBack = 0;
+		unsigned int minFront = 0, minBack = 0;
+		#define VALUE(i) series[(i) * FEATURE_SIZE + d]
+
+		for (unsigned int i = 0; i < length + band; ++i) {
+			if (i < length) {
+				while (maxBack > maxFront && VALUE(maxQueue[maxBack - 1]) <= VALUE(i)) --maxBack;
+				while (minBack > minFront && VALUE(minQueue[minBack - 1]) >= VALUE(i)) --minBack;
+				maxQueue[maxBack++] = i;
+				minQueue[minBack++] = i;
+			}
+			if (i >= band) {
+				const unsigned int out = i - band;
+				while (maxQueue[maxFront] + band < out) ++maxFront;
+				while (minQueue[minFront] + band < out) ++minFront;
+				upper[out * FEATURE_SIZE + d] = VALUE(maxQueue[maxFront]);
+				lower[out * FEATURE_SIZE + d] = VALUE(minQueue[minFront]);
+			}
+		}
+
+		#undef VALUE
+	}
+}
+
+void GestureRecognizer::growHistory( const unsigned int length )
+{
+	if (length <= capacity) return;
+	capacity = length;
+	history.assign(2 * capacity * FEATURE_SIZE, 0.f);
+	reset();
+}
+
+void GestureRecognizer::benchmark( const Skeleton::JointFrames& frames )
+{
+	const unsigned int numFrames = frames.size();
+	const unsigned int minLength = 30, maxLength = 90;
+	if (numFrames < 2 * maxLength) {
+		std::cerr << "Gesture benchmark needs at least " << 2 * maxLength << " frames" << std::endl;
+		return;
+	}
+
+	static const unsigned int librarySizes[] = { 10, 50, 100, 200, 500 };
+	std::cout << "Gesture recognition over " << numFrames << " frames:" << std::endl;
+
+	for (auto size : librarySizes) {
+		// Deterministic library of segments cut from the recording itself
+		GestureRecognizer recognizer;
+		for (unsigned int i = 0; i < size; ++i) {
+			const unsigned int length = minLength + (i * 7) % (maxLength - minLength);
+			const unsigned int start  = (i * 7919) % (numFrames - length);
+			std::stringstream name;
+			name << "segment " << i;
+			recognizer.addTemplate(name.str()
+			                     , Skeleton::JointFrames(frames.begin() + start, frames.begin() + start + length)
+			                     , 0.001f);
+		}
+
+		sf::Clock clock;
+		unsigned int matches = 0;
+		Match match;
+		for (const auto& frame : frames) {
+			if (recognizer.update(frame, match)) ++matches;
+		}
+		const float seconds = std::max(clock.getElapsedTime().asSeconds(), 1e-6f);
+
+		const Stats& stats = recognizer.getStats();
+		std::cout << "  " << size << " templates: "
+		          << stats.comparisons / seconds << " comparisons/sec, "
+		          << seconds * 1000.f / numFrames << " ms/frame, "
+		          << matches << " matches; pruned "
+		          << stats.keoghPruned    * 100.f / std::max(1u, stats.comparisons) << "% by LB_Keogh, "
+		          << stats.improvedPruned * 100.f / std::max(1u, stats.comparisons) << "% by LB_Improved, "
+		          << stats.abandoned      * 100.f / std::max(1u, stats.comparisons) << "% abandoned" << std::endl;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "Skeleton.h"
+
+#include <string>
+#include <vector>
+
+
+// Recognizes gestures in a live joint stream by matching the most recent
+// frames against a library of template recordings with dynamic time warping.
+//
+// Joints are made relative to the shoulder center and scaled by shoulder
+// width so templates match other people and positions. Each template is
+// compared against a window of the same length ending at the newest frame.
+// Cheap LB_Keogh and LB_Improved lower bounds reject most templates before
+// any DTW is done, and the DTW itself is limited to a Sakoe-Chiba band and
+// abandoned as soon as it can no longer beat the best match so far.
+class GestureRecognizer
+{
+public:
+	struct Match {
+		std::string name;
+		float distance; // mean squared feature distance per frame along the warping path
+	};
+
+	struct Stats {
+		unsigned int comparisons;  // template comparisons attempted
+		unsigned int keoghPruned;  // rejected by LB_Keogh
+		unsigned int improvedPruned; // rejected by LB_Improved
+		unsigned int abandoned;    // DTW started but abandoned early
+		unsigned int completed;    // full DTW computed
+	};
+
+	static const unsigned int NUM_FEATURE_JOINTS = 4;
+	static const unsigned int FEATURE_SIZE = 3 * NUM_FEATURE_JOINTS;
+
+private:
+	struct Template {
+		std::string name;
+		float threshold;           // max distance for a match
+		unsigned int length;       // in frames
+		unsigned int band;         // Sakoe-Chiba band radius, in frames
+		std::vector<float> series; // length * FEATURE_SIZE features
+		std::vector<float> upper;  // envelope of series within the band
+		std::vector<float> lower;
+	};
+
+	std::vector<Template> templates;
+
+	// Recent live features. Every frame is written twice, capacity apart,
+	// so the newest n frames are always contiguous for any n <= capacity.
+	std::vector<float> history;
+	unsigned int capacity;
+	unsigned int head;
+	unsigned int numFrames;
+
+	float bandFraction;
+	Stats stats;
+
+	// Scratch space reused across comparisons
+	std::vector<float> projection;
+	std::vector<float> projectionUpper;
+	std::vector<float> projectionLower;
+	std::vector<float> cumulativeBound;
+	std::vector<float> costs;
+	std::vector<unsigned int> envelopeQueues;
+
+public:
+	explicit GestureRecognizer(const float bandFraction = 0.1f);
+
+	// Add a template from a recording in the format written while saving
+	bool addTemplate(const std::string& name, const std::string& filename, const float threshold = 0.05f);
+	void addTemplate(const std::string& name, const Skeleton::JointFrames& frames, const float threshold = 0.05f);
+	void clearTemplates();
+	unsigned int getNumTemplates() const { return templates.size(); }
+
+	// Push the next live frame, returns true and the best match if any template matched.
+	// History is cleared after a match so one gesture isn't reported several times.
+	bool update(const Skeleton::JointFrame& frame, Match& match);
+	void reset();
+
+	const Stats& getStats() const { return stats; }
+	void clearStats();
+
+	// Stream a recording through libraries of increasing size built from
+	// its own segments and print the template comparisons per second
+	static void benchmark(const Skeleton::JointFrames& frames);
+
+private:
+	static bool toFeatures(const Skeleton::JointFrame& frame, float *features);
+	static void computeEnvelope(const float *series, const unsigned int length, const unsigned int band
+	                          , float *upper, float *lower, std::vector<unsigned int>& queues);
+
+	void growHistory(const unsigned int length);
+	float compare(const Template& t, const float *window, const float bestSoFar);
+	float dtw(const Template& t, const float *window, const float bestSoFar);
+};
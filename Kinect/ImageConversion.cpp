@@ -0,0 +1,31 @@
+#include "ImageConversion.h"
+
+
+void ImageConversion::colorToBGRA( const unsigned char *src, unsigned char *dest, const unsigned int numPixels )
+{
+	const unsigned char *curr = src;
+	const unsigned char *last = curr + 4 * numPixels;
+
+	while (curr < last) {
+		*dest++ = *curr++;
+	}
+}
+
+void ImageConversion::depthToBGRA( const unsigned short *src, unsigned char *dest, const unsigned int numPixels )
+{
+	const unsigned short *curr = src;
+	const unsigned short *last = curr + numPixels;
+
+	while (curr < last) {
+		// Depth distance stored in top 13 bits, get normalized value
+		unsigned short depth = (unsigned short) (*curr++ >> PLAYER_INDEX_SHIFT);
+		unsigned short dist  = (depth >> 3) / 2^13;
+
+		unsigned char thresh = 128;
+		unsigned char value  = (unsigned char) (dist * 255);
+		*dest++ = (value > thresh) ? 0 : value; 
+		*dest++ = (value);
+		*dest++ = (value > thresh) ? 0 : value;
+		*dest++ = 0xff; 
+	}
+}
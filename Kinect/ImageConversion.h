@@ -0,0 +1,17 @@
+#pragma once
+
+
+// Sensor image formats to the BGRA layout the preview textures take.
+// Kept free of the Kinect SDK so they can be timed on synthetic images.
+class ImageConversion
+{
+public:
+	// Depth pixels pack the player index below the distance
+	static const unsigned int PLAYER_INDEX_SHIFT = 3;
+
+	// Color frames already arrive as BGRA
+	static void colorToBGRA(const unsigned char *src, unsigned char *dest, const unsigned int numPixels);
+
+	// Green ramp over depth, red and blue cut off past the midpoint
+	static void depthToBGRA(const unsigned short *src, unsigned char *dest, const unsigned int numPixels);
+};
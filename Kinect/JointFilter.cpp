@@ -0,0 +1,181 @@
+#include "JointFilter.h"
+#include "Core/Constants.h"
+#include "Util/Parallel.h"
+
+#include <glm/glm.hpp>
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+
+JointFilter::Parameters JointFilter::getParameters( const Skeleton::EFilteringLevel level )
+{
+	const float *p = nullptr;
+	switch (level) {
+		case Skeleton::LOW:    p = constants::joint_smooth_params_low;  break;
+		case Skeleton::MEDIUM: p = constants::joint_smooth_params_med;  break;
+		case Skeleton::HIGH:   p = constants::joint_smooth_params_high; break;
+		// No smoothing, no prediction, no jitter or deviation clamping
+		default: return Parameters(0.f, 1.f, 0.f, 0.f, 1e30f);
+	}
+	return Parameters(p[0], p[1], p[2], p[3], p[4]);
+}
+
+JointFilter::JointFilter( const Parameters& parameters )
+	: parameters(parameters)
+{}
+
+void JointFilter::reset()
+{
+	for (auto i = 0; i < Skeleton::NUM_JOINT_TYPES; ++i) {
+		history[i] = History();
+	}
+}
+
+void JointFilter::apply( Skeleton::Joint& joint )
+{
+	assert(joint.type >= 0 && joint.type < Skeleton::NUM_JOINT_TYPES);
+	History& h = history[joint.type];
+
+	// Inferred joints are noisier, so loosen the filter's hold on them
+	float jitterRadius       = parameters.jitterRadius;
+	float maxDeviationRadius = parameters.maxDeviationRadius;
+	if (joint.trackingState == Skeleton::INFERRED) {
+		jitterRadius       *= 2.f;
+		maxDeviationRadius *= 2.f;
+	}
+
+	// Untracked joints break the track, start over when they come back
+	if (joint.trackingState == Skeleton::NOT_TRACKED) {
+		h.frameCount = 0;
+		return;
+	}
+
+	glm::vec3 rawPosition = joint.position;
+	glm::vec3 filteredPosition;
+	glm::vec3 trend;
+
+	if (h.frameCount == 0) {
+		// First sample, nothing to smooth against yet
+		filteredPosition = rawPosition;
+		trend = glm::vec3(0.f);
+	} else if (h.frameCount == 1) {
+		// Second sample, seed the trend from the first two
+		filteredPosition = (rawPosition + h.rawPosition) * 0.5f;
+		const glm::vec3 diff = filteredPosition - h.filteredPosition;
+		trend = diff * parameters.correction + h.trend * (1.f - parameters.correction);
+	} else {
+		// Damp small movements that are likely to be sensor jitter
+		const glm::vec3 jitter = rawPosition - h.filteredPosition;
+		const float jitterLength = glm::length(jitter);
+		if (jitterLength <= jitterRadius && jitterRadius > 0.f) {
+			const float t = jitterLength / jitterRadius;
+			rawPosition = rawPosition * t + h.filteredPosition * (1.f - t);
+		}
+
+		// Double exponential smoothing of position and trend
+		filteredPosition = rawPosition * (1.f - parameters.smoothing)
+		                 + (h.filteredPosition + h.trend) * parameters.smoothing;
+		const glm::vec3 diff = filteredPosition - h.filteredPosition;
+		trend = diff * parameters.correction + h.trend * (1.f - parameters.correction);
+	}
+
+	// Predict ahead, but never stray too far from the raw data
+	glm::vec3 predictedPosition = filteredPosition + trend * parameters.prediction;
+	const float deviation = glm::distance(predictedPosition, rawPosition);
+	if (deviation > maxDeviationRadius) {
+		const float t = maxDeviationRadius / deviation;
+		predictedPosition = predictedPosition * t + rawPosition * (1.f - t);
+	}
+
+	h.rawPosition      = rawPosition;
+	h.filteredPosition = filteredPosition;
+	h.trend            = trend;
+	if (h.frameCount < 2) ++h.frameCount;
+
+	joint.position = predictedPosition;
+}
+
+void JointFilter::apply( Skeleton::JointFrame& frame )
+{
+	for (auto& entry : frame) {
+		apply(entry.second);
+	}
+}
+
+void JointFilter::applyParallel( const Skeleton::JointFrames& input
+                               , Skeleton::JointFrames& output
+                               , const Parameters& parameters
+                               , const unsigned int chunkFrames
+                               , const unsigned int warmupFrames )
+{
+	assert(chunkFrames > 0);
+
+	// Output frames keep everything but the positions from the input,
+	// tasks below only ever write existing joint entries so no frame is resized
+	output = input;
+
+	const unsigned int numFrames = input.size();
+	const unsigned int numChunks = (numFrames + chunkFrames - 1) / chunkFrames;
+	const unsigned int numJoints = Skeleton::NUM_JOINT_TYPES;
+
+	// One task per (joint, chunk) pair
+	Parallel::forEach(numJoints * numChunks, [&](unsigned int task) {
+		const Skeleton::EJointType type = static_cast<Skeleton::EJointType>(task % numJoints);
+		const unsigned int chunk = task / numJoints;
+		const unsigned int first = chunk * chunkFrames;
+		const unsigned int last  = std::min(first + chunkFrames, numFrames);
+		const unsigned int start = (first > warmupFrames) ? (first - warmupFrames) : 0;
+
+		JointFilter filter(parameters);
+		for (unsigned int i = start; i < last; ++i) {
+			const Skeleton::JointFrame& frame = input[i];
+			const auto it = frame.find(type);
+			if (it == frame.end()) continue;
+
+			Skeleton::Joint joint = it->second;
+			filter.apply(joint);
+			if (i >= first) {
+				output[i].at(type).position = joint.position;
+			}
+		}
+	});
+}
+
+void JointFilter::benchmark( const Skeleton::JointFrames& input, const Parameters& parameters )
+{
+	sf::Clock clock;
+
+	// Serial reference, one filter run straight through the recording
+	Skeleton::JointFrames serial(input);
+	clock.restart();
+	JointFilter filter(parameters);
+	for (auto& frame : serial) {
+		filter.apply(frame);
+	}
+	const float serialSeconds = clock.getElapsedTime().asSeconds();
+
+	Skeleton::JointFrames parallel;
+	clock.restart();
+	applyParallel(input, parallel, parameters);
+	const float parallelSeconds = clock.getElapsedTime().asSeconds();
+
+	float maxError = 0.f;
+	for (unsigned int i = 0; i < serial.size(); ++i) {
+		for (auto& entry : serial[i]) {
+			const glm::vec3& a = entry.second.position;
+			const glm::vec3& b = parallel[i].at(entry.first).position;
+			maxError = std::max(maxError, glm::distance(a, b));
+		}
+	}
+
+	const float recordedHours = input.size() / (30.f * 60.f * 60.f);
+	std::cout << "Re-filtered " << input.size() << " frames (" << recordedHours << " hours at 30 Hz)" << std::endl
+	          << "  serial:   " << serialSeconds   << " seconds, " << input.size() / serialSeconds   << " frames/sec" << std::endl
+	          << "  parallel: " << parallelSeconds << " seconds, " << input.size() / parallelSeconds << " frames/sec"
+	          << " on " << Parallel::getNumThreads() << " threads" << std::endl
+	          << "  speedup:  " << serialSeconds / parallelSeconds << "x, max difference from serial: " << maxError << " m" << std::endl;
+}
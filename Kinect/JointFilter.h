@@ -0,0 +1,65 @@
+#pragma once
+#include "Skeleton.h"
+
+#include <glm/glm.hpp>
+
+
+// Holt double exponential smoothing of joint positions, following the same
+// steps as NuiTransformSmooth so recordings can be re-filtered offline
+class JointFilter
+{
+public:
+	// Same fields and meaning as NUI_TRANSFORM_SMOOTH_PARAMETERS
+	struct Parameters {
+		float smoothing;          // [0..1], higher is smoother but adds latency
+		float correction;         // [0..1], lower corrects more slowly towards raw data
+		float prediction;         // number of frames to predict into the future
+		float jitterRadius;       // in meters, deviations below this are damped
+		float maxDeviationRadius; // in meters, max distance filtered data may stray from raw data
+
+		Parameters(float s, float c, float p, float j, float m)
+			: smoothing(s), correction(c), prediction(p), jitterRadius(j), maxDeviationRadius(m) {}
+	};
+
+	static Parameters getParameters(const Skeleton::EFilteringLevel level);
+
+private:
+	struct History {
+		glm::vec3 rawPosition;
+		glm::vec3 filteredPosition;
+		glm::vec3 trend;
+		unsigned int frameCount;
+
+		History() : rawPosition(), filteredPosition(), trend(), frameCount(0) {}
+	};
+
+	Parameters parameters;
+	History history[Skeleton::NUM_JOINT_TYPES];
+
+public:
+	explicit JointFilter(const Parameters& parameters);
+
+	// Forget all history, the next joints passed in will start a new track
+	void reset();
+
+	// Filter a single joint in place, joints must be passed in time order
+	void apply(Skeleton::Joint& joint);
+
+	// Filter every joint in a frame in place
+	void apply(Skeleton::JointFrame& frame);
+
+	// Re-filter a whole recording into output, splitting the work across
+	// joints and chunks of frames. Each chunk first re-runs up to warmupFrames
+	// of the preceding frames so its filter state catches up with a serial run.
+	// The result is exact if the joint dropped out during the warm-up (which
+	// resets the filter), otherwise it converges as the old history decays.
+	static void applyParallel(const Skeleton::JointFrames& input
+	                        , Skeleton::JointFrames& output
+	                        , const Parameters& parameters
+	                        , const unsigned int chunkFrames  = 8192
+	                        , const unsigned int warmupFrames = 1024);
+
+	// Time a serial and a parallel re-filter of input and print the speedup
+	// and the largest difference between the two results
+	static void benchmark(const Skeleton::JointFrames& input, const Parameters& parameters);
+};
@@ -0,0 +1,253 @@
+#include "JointPredictor.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+
+
+JointPredictor::JointPredictor( const Parameters& parameters )
+	: parameters(parameters)
+{
+	reset();
+}
+
+void JointPredictor::reset()
+{
+	for (auto i = 0; i < Skeleton::NUM_JOINT_TYPES; ++i) {
+		memset(&states[i], 0, sizeof(State));
+		states[i].valid = false;
+	}
+}
+
+void JointPredictor::update( const Skeleton::Joint& joint, const double timestamp )
+{
+	assert(joint.type >= 0 && joint.type < Skeleton::NUM_JOINT_TYPES);
+	State& state = states[joint.type];
+
+	if (joint.trackingState == Skeleton::NOT_TRACKED) {
+		if (state.valid && timestamp - state.lastSeen > parameters.lostTimeout) {
+			state.valid = false;
+		}
+		return;
+	}
+
+	const double variance = (joint.trackingState == Skeleton::TRACKED)
+	                      ? parameters.trackedNoise : parameters.inferredNoise;
+
+	const double dt = timestamp - state.time;
+	if (!state.valid || dt > parameters.lostTimeout || dt < 0.0) {
+		resetState(state, joint.position, variance, timestamp);
+		return;
+	}
+
+	if (dt > 0.0) {
+		predictState(state, dt);
+	}
+	correctState(state, joint.position, variance);
+	state.time     = timestamp;
+	state.lastSeen = timestamp;
+}
+
+void JointPredictor::update( const Skeleton::JointFrame& frame, const double timestamp )
+{
+	for (const auto& entry : frame) {
+		update(entry.second, timestamp);
+	}
+}
+
+Skeleton::Joint JointPredictor::predict( const Skeleton::Joint& joint, const double time ) const
+{
+	assert(joint.type >= 0 && joint.type < Skeleton::NUM_JOINT_TYPES);
+	const State& state = states[joint.type];
+
+	Skeleton::Joint predicted(joint);
+	if (!state.valid || joint.trackingState == Skeleton::NOT_TRACKED) {
+		return predicted;
+	}
+
+	double h = time - state.time;
+	if (h <= 0.0) return predicted;
+	if (h > parameters.maxHorizon) h = parameters.maxHorizon;
+
+	// Offset from the filtered position to the extrapolated one, and its variance
+	const double h2 = 0.5 * h * h;
+	const double (&P)[3][3] = state.P;
+	const double offsetVariance = h * h * P[1][1] + 2.0 * h * h2 * P[1][2] + h2 * h2 * P[2][2];
+
+	// Back off towards the filtered position as the extrapolation becomes less certain
+	const double weight = parameters.backoffVariance / (parameters.backoffVariance + offsetVariance);
+
+	for (auto axis = 0; axis < 3; ++axis) {
+		const double *x = state.x[axis];
+		const double offset = x[1] * h + x[2] * h2;
+		predicted.position[axis] = static_cast<float>(x[0] + weight * offset);
+	}
+
+	return predicted;
+}
+
+void JointPredictor::predictState( State& state, const double dt ) const
+{
+	const double dt2 = dt  * dt;
+	const double dt3 = dt2 * dt;
+	const bool accel = (parameters.model == CONSTANT_ACCELERATION);
+	const double ha  = accel ? 0.5 * dt2 : 0.0;
+
+	// x = F x, where F integrates velocity and acceleration over dt
+	for (auto axis = 0; axis < 3; ++axis) {
+		double *x = state.x[axis];
+		x[0] += x[1] * dt + x[2] * ha;
+		x[1] += x[2] * (accel ? dt : 0.0);
+		if (!accel) x[2] = 0.0;
+	}
+
+	// P = F P F^T
+	double F[3][3] = {
+		{ 1.0, dt,  ha },
+		{ 0.0, 1.0, accel ? dt : 0.0 },
+		{ 0.0, 0.0, accel ? 1.0 : 0.0 }
+	};
+	double FP[3][3];
+	for (auto i = 0; i < 3; ++i)
+	for (auto j = 0; j < 3; ++j) {
+		FP[i][j] = F[i][0] * state.P[0][j] + F[i][1] * state.P[1][j] + F[i][2] * state.P[2][j];
+	}
+	for (auto i = 0; i < 3; ++i)
+	for (auto j = 0; j < 3; ++j) {
+		state.P[i][j] = FP[i][0] * F[j][0] + FP[i][1] * F[j][1] + FP[i][2] * F[j][2];
+	}
+
+	// P += Q, white noise on the highest modelled derivative
+	const double q = parameters.processNoise;
+	if (accel) {
+		const double dt4 = dt3 * dt;
+		const double dt5 = dt4 * dt;
+		state.P[0][0] += q * dt5 / 20.0; state.P[0][1] += q * dt4 / 8.0; state.P[0][2] += q * dt3 / 6.0;
+		state.P[1][0] += q * dt4 / 8.0;  state.P[1][1] += q * dt3 / 3.0; state.P[1][2] += q * dt2 / 2.0;
+		state.P[2][0] += q * dt3 / 6.0;  state.P[2][1] += q * dt2 / 2.0; state.P[2][2] += q * dt;
+	} else {
+		state.P[0][0] += q * dt3 / 3.0;  state.P[0][1] += q * dt2 / 2.0;
+		state.P[1][0] += q * dt2 / 2.0;  state.P[1][1] += q * dt;
+	}
+}
+
+void JointPredictor::correctState( State& state, const glm::vec3& position, const double variance ) const
+{
+	// Only position is measured, so the gain is the first column of P over the innovation variance
+	const double S = state.P[0][0] + variance;
+	const double K[3] = { state.P[0][0] / S, state.P[1][0] / S, state.P[2][0] / S };
+
+	for (auto axis = 0; axis < 3; ++axis) {
+		double *x = state.x[axis];
+		const double innovation = position[axis] - x[0];
+		x[0] += K[0] * innovation;
+		x[1] += K[1] * innovation;
+		x[2] += K[2] * innovation;
+	}
+
+	// P = (I - K H) P
+	const double P0[3] = { state.P[0][0], state.P[0][1], state.P[0][2] };
+	for (auto i = 0; i < 3; ++i)
+	for (auto j = 0; j < 3; ++j) {
+		state.P[i][j] -= K[i] * P0[j];
+	}
+}
+
+void JointPredictor::resetState( State& state, const glm::vec3& position, const double variance, const double time ) const
+{
+	memset(&state, 0, sizeof(State));
+	for (auto axis = 0; axis < 3; ++axis) {
+		state.x[axis][0] = position[axis];
+	}
+
+	// Nothing is known about the motion yet, so start with broad velocity/acceleration priors
+	state.P[0][0] = variance;
+	state.P[1][1] = 1.0;
+	state.P[2][2] = (parameters.model == CONSTANT_ACCELERATION) ? 10.0 : 0.0;
+
+	state.time     = time;
+	state.lastSeen = time;
+	state.valid    = true;
+}
+
+void JointPredictor::evaluate( const Skeleton::JointFrames& frames
+                             , const double *horizons, const unsigned int numHorizons
+                             , const Parameters& parameters )
+{
+	const unsigned int numFrames = frames.size();
+	if (numFrames < 2 || numHorizons == 0) return;
+
+	struct Error {
+		double predictedSquared;
+		double heldSquared;
+		double predictedMax;
+		unsigned int samples;
+		unsigned int futureIndex; // first frame at or after the horizon, only ever moves forward
+	};
+	std::vector<Error> errors(numHorizons);
+	memset(&errors[0], 0, errors.size() * sizeof(Error));
+
+	JointPredictor predictor(parameters);
+	for (unsigned int i = 0; i < numFrames; ++i) {
+		const Skeleton::JointFrame& frame = frames[i];
+		if (frame.empty()) continue;
+		const double now = frame.begin()->second.timestamp;
+		predictor.update(frame, now);
+
+		for (unsigned int h = 0; h < numHorizons; ++h) {
+			const double target = now + horizons[h];
+			Error& error = errors[h];
+
+			// Find the recorded frames either side of the horizon
+			unsigned int& j = error.futureIndex;
+			if (j <= i) j = i + 1;
+			while (j < numFrames && !frames[j].empty() && frames[j].begin()->second.timestamp < target) ++j;
+			if (j >= numFrames || frames[j].empty()) continue;
+
+			const Skeleton::JointFrame& before = frames[j - 1];
+			const Skeleton::JointFrame& after  = frames[j];
+			const double t0 = before.begin()->second.timestamp;
+			const double t1 = after.begin()->second.timestamp;
+			const float  t  = (t1 > t0) ? static_cast<float>((target - t0) / (t1 - t0)) : 1.f;
+
+			for (const auto& entry : frame) {
+				const Skeleton::Joint& joint = entry.second;
+				const Skeleton::Joint& a = before.at(entry.first);
+				const Skeleton::Joint& b = after.at(entry.first);
+				if (joint.trackingState != Skeleton::TRACKED
+				 || a.trackingState     != Skeleton::TRACKED
+				 || b.trackingState     != Skeleton::TRACKED) {
+					continue;
+				}
+
+				const glm::vec3 actual    = glm::mix(a.position, b.position, t);
+				const glm::vec3 predicted = predictor.predict(joint, target).position;
+				const double predictedError = glm::distance(predicted, actual);
+				const double heldError      = glm::distance(joint.position, actual);
+
+				error.predictedSquared += predictedError * predictedError;
+				error.heldSquared      += heldError * heldError;
+				error.predictedMax      = std::max(error.predictedMax, predictedError);
+				++error.samples;
+			}
+		}
+	}
+
+	std::cout << "Joint prediction error over " << numFrames << " frames ("
+	          << (parameters.model == CONSTANT_ACCELERATION ? "constant acceleration" : "constant velocity")
+	          << " model):" << std::endl;
+	for (unsigned int h = 0; h < numHorizons; ++h) {
+		const Error& error = errors[h];
+		if (error.samples == 0) continue;
+		std::cout << "  " << horizons[h] * 1000.0 << " ms: "
+		          << "rms " << std::sqrt(error.predictedSquared / error.samples) * 1000.0 << " mm"
+		          << " (without prediction " << std::sqrt(error.heldSquared / error.samples) * 1000.0 << " mm)"
+		          << ", max " << error.predictedMax * 1000.0 << " mm"
+		          << ", " << error.samples << " samples" << std::endl;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "Skeleton.h"
+
+#include <glm/glm.hpp>
+
+
+// Per joint Kalman filter that extrapolates joint positions ahead in time,
+// to hide the delay between the sensor capturing a frame and it being shown.
+// Each joint keeps its own uncertainty, so noisy or inferred joints are
+// extrapolated less aggressively than well tracked ones.
+class JointPredictor
+{
+public:
+	enum EMotionModel {
+		CONSTANT_VELOCITY     = 0,
+		CONSTANT_ACCELERATION = (CONSTANT_VELOCITY + 1)
+	};
+
+	struct Parameters {
+		EMotionModel model;
+		double processNoise;     // spectral density of the unmodelled derivative (accel or jerk)
+		double trackedNoise;     // position measurement variance for tracked joints, in m^2
+		double inferredNoise;    // position measurement variance for inferred joints, in m^2
+		double backoffVariance;  // extrapolation variance at which prediction is halved, in m^2
+		double maxHorizon;       // never extrapolate further than this, in seconds
+		double lostTimeout;      // forget a joint that has been untracked this long, in seconds
+
+		Parameters()
+			: model(CONSTANT_ACCELERATION)
+			, processNoise(50.0)
+			, trackedNoise(0.005 * 0.005)
+			, inferredNoise(0.03 * 0.03)
+			, backoffVariance(0.02 * 0.02)
+			, maxHorizon(0.1)
+			, lostTimeout(0.5) {}
+	};
+
+private:
+	struct State {
+		double x[3][3];  // per axis: position, velocity, acceleration
+		double P[3][3];  // covariance, identical for every axis since they share noise and timing
+		double time;     // acquisition time of the last update, in seconds
+		double lastSeen; // acquisition time the joint was last tracked or inferred, in seconds
+		bool   valid;
+	};
+
+	Parameters parameters;
+	State states[Skeleton::NUM_JOINT_TYPES];
+
+public:
+	explicit JointPredictor(const Parameters& parameters = Parameters());
+
+	void reset();
+
+	// Feed a new measurement, timestamp is the frame's acquisition time in seconds
+	void update(const Skeleton::Joint& joint, const double timestamp);
+	void update(const Skeleton::JointFrame& frame, const double timestamp);
+
+	// Extrapolate a joint to the given time, on the same timeline as update().
+	// The returned joint carries the last measured orientation and tracking state.
+	Skeleton::Joint predict(const Skeleton::Joint& joint, const double time) const;
+
+	// Replay a recording through the predictor using its joint timestamps and
+	// print the prediction error against the recorded future at each horizon
+	static void evaluate(const Skeleton::JointFrames& frames
+	                   , const double *horizons, const unsigned int numHorizons
+	                   , const Parameters& parameters = Parameters());
+
+private:
+	void predictState(State& state, const double dt) const;
+	void correctState(State& state, const glm::vec3& position, const double variance) const;
+	void resetState(State& state, const glm::vec3& position, const double variance, const double time) const;
+};
@@ -0,0 +1,291 @@
+#include "KeyframeReducer.h"
+#include "Util/Parallel.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <utility>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+	const char magic[8] = { 'K', 'E', 'Y', 'F', 'R', 'A', 'M', '1' };
+	const unsigned int version = 1;
+	const std::string extension(".keyframes");
+
+	const float radiansToDegrees = 57.2957795f;
+
+	Skeleton::Joint getJoint(const Skeleton::JointFrame& frame, const Skeleton::EJointType type) {
+		const auto it = frame.find(type);
+		if (it != frame.end()) return it->second;
+
+		Skeleton::Joint joint;
+		memset(&joint, 0, sizeof(Skeleton::Joint));
+		joint.type = type;
+		joint.orientation = glm::mat4(1.f);
+		joint.trackingState = Skeleton::NOT_TRACKED;
+		return joint;
+	}
+
+	KeyframeReducer::Key toKey(const Skeleton::Joint& joint, const unsigned int frame) {
+		KeyframeReducer::Key key;
+		key.frame = frame;
+		key.position = joint.position;
+		key.orientation = glm::normalize(glm::quat_cast(glm::mat3(joint.orientation)));
+		key.trackingState = joint.trackingState;
+		return key;
+	}
+
+	// q and -q are the same rotation, interpolate along the shorter arc
+	glm::quat slerpShortest(const glm::quat& a, const glm::quat& b, const float t) {
+		return (glm::dot(a, b) < 0.f) ? glm::slerp(a, -b, t) : glm::slerp(a, b, t);
+	}
+
+	float angleBetween(const glm::quat& a, const glm::quat& b) {
+		const float d = std::min(1.f, std::fabs(glm::dot(a, b)));
+		return 2.f * std::acos(d) * radiansToDegrees;
+	}
+
+	// Interpolate between keys a and b at the given frame
+	void interpolate(const KeyframeReducer::Key& a, const KeyframeReducer::Key& b, const std::vector<float>& frameTimes
+	               , const unsigned int frame, glm::vec3& position, glm::quat& orientation) {
+		const float t0 = frameTimes[a.frame];
+		const float t1 = frameTimes[b.frame];
+		float t = 0.f;
+		if (t1 > t0)               t = (frameTimes[frame] - t0) / (t1 - t0);
+		else if (b.frame > a.frame) t = (frame - a.frame) / static_cast<float>(b.frame - a.frame);
+		t = std::max(0.f, std::min(1.f, t));
+
+		position = glm::mix(a.position, b.position, t);
+		orientation = slerpShortest(a.orientation, b.orientation, t);
+	}
+
+	void reduceChannel(const Skeleton::JointFrames& frames, const std::vector<float>& frameTimes, const Skeleton::EJointType type
+	                 , const KeyframeReducer::Bounds& bounds, KeyframeReducer::Keys& keys) {
+		keys.clear();
+		const unsigned int numFrames = frames.size();
+		if (numFrames == 0) return;
+
+		KeyframeReducer::Keys samples(numFrames);
+		for (unsigned int i = 0; i < numFrames; ++i) {
+			samples[i] = toKey(getJoint(frames[i], type), i);
+		}
+
+		// Ends of the recording and both sides of every tracking state change are always kept
+		std::vector<char> keep(numFrames, 0);
+		keep[0] = keep[numFrames - 1] = 1;
+		for (unsigned int i = 1; i < numFrames; ++i) {
+			if (samples[i].trackingState != samples[i - 1].trackingState) {
+				keep[i - 1] = keep[i] = 1;
+			}
+		}
+
+		const float invPositionBound    = 1.f / std::max(bounds.position,    1e-6f);
+		const float invOrientationBound = 1.f / std::max(bounds.orientation, 1e-6f);
+
+		// Split each segment at its worst frame until every frame is within bounds
+		std::vector<std::pair<unsigned int, unsigned int> > segments;
+		for (unsigned int a = 0, b = 1; b < numFrames; ++b) {
+			if (!keep[b]) continue;
+			segments.push_back(std::make_pair(a, b));
+			a = b;
+		}
+		while (!segments.empty()) {
+			const unsigned int a = segments.back().first;
+			const unsigned int b = segments.back().second;
+			segments.pop_back();
+
+			// Untracked positions are meaningless, nothing to preserve
+			if (b - a < 2 || samples[a].trackingState == Skeleton::NOT_TRACKED) continue;
+
+			float worstError = 1.f;
+			unsigned int worst = a;
+			for (unsigned int i = a + 1; i < b; ++i) {
+				glm::vec3 position;
+				glm::quat orientation;
+				interpolate(samples[a], samples[b], frameTimes, i, position, orientation);
+				const float error = std::max(glm::distance(position, samples[i].position) * invPositionBound
+				                           , angleBetween(orientation, samples[i].orientation) * invOrientationBound);
+				if (error > worstError) {
+					worstError = error;
+					worst = i;
+				}
+			}
+			if (worst != a) {
+				keep[worst] = 1;
+				segments.push_back(std::make_pair(a, worst));
+				segments.push_back(std::make_pair(worst, b));
+			}
+		}
+
+		for (unsigned int i = 0; i < numFrames; ++i) {
+			if (keep[i]) keys.push_back(samples[i]);
+		}
+	}
+}
+
+
+void KeyframeReducer::reduce( const Skeleton::JointFrames& frames, const Bounds& bounds, Keyframes& keyframes, Report& report )
+{
+	sf::Clock clock;
+
+	const unsigned int numFrames = frames.size();
+	keyframes.bounds = bounds;
+	keyframes.frameTimes.resize(numFrames);
+	for (unsigned int i = 0; i < numFrames; ++i) {
+		keyframes.frameTimes[i] = frames[i].empty() ? 0.f : frames[i].begin()->second.timestamp;
+	}
+
+	// Joint channels are independent
+	Parallel::forEach(Skeleton::NUM_JOINT_TYPES, [&](unsigned int j) {
+		reduceChannel(frames, keyframes.frameTimes, static_cast<Skeleton::EJointType>(j), bounds, keyframes.channels[j]);
+	});
+	report.seconds = clock.getElapsedTime().asSeconds();
+
+	// Measure what playback will actually see
+	Skeleton::JointFrames rebuilt;
+	rebuild(keyframes, rebuilt);
+
+	report.numFrames = numFrames;
+	report.numKeys = 0;
+	report.maxPositionError = 0.f;
+	report.maxOrientationError = 0.f;
+	for (auto j = 0; j < Skeleton::NUM_JOINT_TYPES; ++j) {
+		const Skeleton::EJointType type = static_cast<Skeleton::EJointType>(j);
+		report.numKeys += keyframes.channels[j].size();
+		for (unsigned int i = 0; i < numFrames; ++i) {
+			const Key original = toKey(getJoint(frames[i], type), i);
+			if (original.trackingState == Skeleton::NOT_TRACKED) continue;
+			const Key restored = toKey(rebuilt[i][type], i);
+			report.maxPositionError    = std::max(report.maxPositionError, glm::distance(original.position, restored.position));
+			report.maxOrientationError = std::max(report.maxOrientationError, angleBetween(original.orientation, restored.orientation));
+		}
+	}
+
+	const float recordingBytes = static_cast<float>(numFrames) * Skeleton::NUM_JOINT_TYPES * sizeof(Skeleton::Joint);
+	const float keyframeBytes  = static_cast<float>(numFrames) * sizeof(float) + report.numKeys * sizeof(Key);
+	report.compressionRatio = (keyframeBytes > 0.f) ? recordingBytes / keyframeBytes : 0.f;
+}
+
+void KeyframeReducer::rebuild( const Keyframes& keyframes, Skeleton::JointFrames& frames )
+{
+	const unsigned int numFrames = keyframes.frameTimes.size();
+	frames.assign(numFrames, Skeleton::JointFrame());
+
+	for (auto j = 0; j < Skeleton::NUM_JOINT_TYPES; ++j) {
+		const Keys& keys = keyframes.channels[j];
+		if (keys.empty()) continue;
+
+		// Frames are visited in order, so the bracketing keys only ever move forward
+		unsigned int k = 0;
+		for (unsigned int i = 0; i < numFrames; ++i) {
+			while (k + 1 < keys.size() && keys[k + 1].frame <= i) ++k;
+			const Key& a = keys[k];
+			const Key& b = keys[std::min<unsigned int>(k + 1, keys.size() - 1)];
+
+			glm::vec3 position(a.position);
+			glm::quat orientation(a.orientation);
+			if (a.frame < i && b.frame > i) {
+				interpolate(a, b, keyframes.frameTimes, i, position, orientation);
+			}
+
+			Skeleton::Joint& joint = frames[i][static_cast<Skeleton::EJointType>(j)];
+			joint.timestamp     = keyframes.frameTimes[i];
+			joint.position      = position;
+			joint.orientation   = glm::mat4_cast(orientation);
+			joint.type          = static_cast<Skeleton::EJointType>(j);
+			joint.trackingState = a.trackingState;
+		}
+	}
+}
+
+bool KeyframeReducer::save( const std::string& filename, const Keyframes& keyframes )
+{
+	std::ofstream stream(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!stream.is_open()) {
+		std::cerr << "Failed to open '" << filename << "' for saving keyframes." << std::endl;
+		return false;
+	}
+
+	const unsigned int numFrames = keyframes.frameTimes.size();
+	const unsigned int numJoints = Skeleton::NUM_JOINT_TYPES;
+	stream.write(magic, sizeof(magic));
+	stream.write((const char *)&version, sizeof(unsigned int));
+	stream.write((const char *)&numFrames, sizeof(unsigned int));
+	stream.write((const char *)&numJoints, sizeof(unsigned int));
+	stream.write((const char *)&keyframes.bounds, sizeof(Bounds));
+	if (numFrames > 0) {
+		stream.write((const char *)&keyframes.frameTimes[0], numFrames * sizeof(float));
+	}
+	for (unsigned int j = 0; j < numJoints; ++j) {
+		const Keys& keys = keyframes.channels[j];
+		const unsigned int numKeys = keys.size();
+		stream.write((const char *)&numKeys, sizeof(unsigned int));
+		if (numKeys > 0) {
+			stream.write((const char *)&keys[0], numKeys * sizeof(Key));
+		}
+	}
+
+	const bool ok = stream.good();
+	stream.close();
+	return ok;
+}
+
+bool KeyframeReducer::load( const std::string& filename, Keyframes& keyframes )
+{
+	std::ifstream stream(filename, std::ios::binary | std::ios::in);
+	if (!stream.is_open()) return false;
+
+	char fileMagic[8];
+	unsigned int fileVersion = 0, numFrames = 0, numJoints = 0;
+	stream.read(fileMagic, sizeof(fileMagic));
+	stream.read((char *)&fileVersion, sizeof(unsigned int));
+	stream.read((char *)&numFrames, sizeof(unsigned int));
+	stream.read((char *)&numJoints, sizeof(unsigned int));
+	if (!stream.good() || memcmp(fileMagic, magic, sizeof(magic)) != 0
+	 || fileVersion != version || numJoints != Skeleton::NUM_JOINT_TYPES) {
+		std::cerr << "'" << filename << "' is not a compatible keyframe file." << std::endl;
+		return false;
+	}
+
+	stream.read((char *)&keyframes.bounds, sizeof(Bounds));
+	keyframes.frameTimes.resize(numFrames);
+	if (numFrames > 0) {
+		stream.read((char *)&keyframes.frameTimes[0], numFrames * sizeof(float));
+	}
+	for (unsigned int j = 0; j < numJoints; ++j) {
+		unsigned int numKeys = 0;
+		stream.read((char *)&numKeys, sizeof(unsigned int));
+		if (!stream.good() || numKeys > numFrames) {
+			std::cerr << "Keyframe file '" << filename << "' is truncated." << std::endl;
+			return false;
+		}
+		Keys& keys = keyframes.channels[j];
+		keys.resize(numKeys);
+		if (numKeys > 0) {
+			stream.read((char *)&keys[0], numKeys * sizeof(Key));
+		}
+	}
+
+	const bool ok = !stream.fail();
+	stream.close();
+	return ok;
+}
+
+bool KeyframeReducer::isKeyframeFile( const std::string& filename )
+{
+	return filename.size() >= extension.size()
+	    && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+void KeyframeReducer::print( const Report& report )
+{
+	std::cout << "Reduced " << report.numFrames << " frames to " << report.numKeys << " joint keys in "
+	          << report.seconds << " seconds." << std::endl
+	          << "  compression ratio: " << report.compressionRatio << ":1" << std::endl
+	          << "  max position error: " << report.maxPositionError << " m"
+	          << ", max orientation error: " << report.maxOrientationError << " degrees" << std::endl;
+}
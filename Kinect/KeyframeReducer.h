@@ -0,0 +1,64 @@
+#pragma once
+#include "Skeleton.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <string>
+#include <vector>
+
+
+// Error bounded keyframe reduction of recordings.
+//
+// Each joint is simplified on its own with Douglas-Peucker in time: a
+// segment between two keys is accepted when linear position and slerped
+// orientation interpolation at every frame inside it stay within the
+// bounds, otherwise it is split at the worst frame. Tracking state changes
+// always get keys on both sides. Joints are simplified in parallel.
+// Frames are rebuilt by interpolating between the bracketing keys.
+class KeyframeReducer
+{
+public:
+	struct Bounds {
+		float position;    // meters
+		float orientation; // degrees
+		Bounds() : position(0.f), orientation(0.f) {}
+		Bounds(const float position, const float orientation)
+			: position(position), orientation(orientation) {}
+	};
+
+	struct Key {
+		unsigned int frame;
+		glm::vec3 position;
+		glm::quat orientation;
+		Skeleton::ETrackingState trackingState;
+	};
+	typedef std::vector<Key> Keys;
+
+	struct Keyframes {
+		std::vector<float> frameTimes; // timestamp of every original frame
+		Keys channels[Skeleton::NUM_JOINT_TYPES];
+		Bounds bounds;
+	};
+
+	struct Report {
+		unsigned int numFrames;
+		unsigned int numKeys;
+		float compressionRatio;    // recording bytes / keyframe bytes
+		float maxPositionError;    // meters, over the rebuilt recording
+		float maxOrientationError; // degrees
+		float seconds;             // time spent reducing
+	};
+
+	// Reduce a recording, the report measures errors by rebuilding it
+	static void reduce(const Skeleton::JointFrames& frames, const Bounds& bounds, Keyframes& keyframes, Report& report);
+
+	// Rebuild every original frame from the keys
+	static void rebuild(const Keyframes& keyframes, Skeleton::JointFrames& frames);
+
+	static bool save(const std::string& filename, const Keyframes& keyframes);
+	static bool load(const std::string& filename, Keyframes& keyframes);
+	static bool isKeyframeFile(const std::string& filename);
+
+	static void print(const Report& report);
+};
@@ -1,23 +1,36 @@
 #include "Kinect.h"
+#include "JointFilter.h"
+#include "BoneOrientation.h"
 #include "Core/Constants.h"
-
-#include <NuiApi.h>
+#include "Util/Latency.h"
+#include "Util/MonotonicClock.h"
+#include "Util/Profiler.h"
+#include "Util/Tracer.h"
+#ifdef _WIN32
+#include "NuiSensorSource.h"
+#endif
 
 #include <SFML/System/Clock.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <thread>
 #include <cassert>
-#include <tchar.h>
+#include <cstring>
 
-std::string toStdString(const BSTR bstr);
-Skeleton::EJointType toJointType(unsigned int i);
-NUI_SKELETON_POSITION_INDEX toPositionIndex(unsigned int i);
-glm::mat4 toMat4(const Matrix4& m);
+namespace
+{
+	// Frames of the other sensors older than this are left out of fusion, in seconds
+	const float maxFrameAge = 0.1f;
+}
 
 // TODO : allow user to change path and filename for output
 const std::string Kinect::saveFileName("../../Res/Out/joint_frames.bin");
+const std::string Kinect::stampFileName("../../Res/Out/joint_frames.stamps");
 
 
 Kinect::Kinect()
@@ -25,106 +38,187 @@ Kinect::Kinect()
 	, saving(false)
 	, numFramesSaved()
 	, clock()
-	, deviceId("?")
-	, sensors()
-	, colorStream()
-	, depthStream()
-	, nextSkeletonEvent()
-	, skeletonTrackingFlags(NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT)
+	, captures()
+	, latestFrames()
+	, receiveTimes()
+	, fusion()
+	, people()
+	, fusionFrames()
+	, pipeline(Skeleton::OFF, [this]() { notifyFrame(); })
+	, signalMutex()
+	, frameSignal()
+	, pendingSignals(0)
+#ifdef _WIN32
+	, frameEvent(CreateEventW(NULL, FALSE, FALSE, NULL))
+#endif
 	, skeleton()
+	, predictor()
+	, gestureRecognizer()
+	, gestureMutex()
+	, sensorClockOffset(0.0)
+	, sensorClockSynced(false)
+	, lastFrameNumber(Tracer::NO_FRAME)
+	, liveCaptureTime(0)
+	, firstSkeletonFrame(true)
+	, captureOrigin(0)
 	, saveStream()
-{}
+	, stampStream()
+	, bus()
+	, imagesWanted(false)
+	, hub()
+	, recording(nullptr)
+	, gestures(nullptr)
+{
+	gestures = hub.subscribe("gestures", [this](const LiveFramePtr& frame) { matchGesture(*frame); }, 32, Subscription::DROP_OLDEST);
+}
 
 Kinect::~Kinect()
 {
-	// TODO: delete each sensor and the streams
+	// Workers and jobs call back into this, stop them first
+	for (auto capture : captures) {
+		delete capture;
+	}
+	pipeline.finish();
+	hub.clear();
 	if (saveStream.is_open()) saveStream.close();
+#ifdef _WIN32
+	CloseHandle(frameEvent);
+#endif
 }
 
-bool Kinect::initialize()
+bool Kinect::initialize( SensorSource *source )
 {
-	clock.restart();
-
-	int numSensors = -1;
-	HRESULT hr = NuiGetSensorCount(&numSensors);
-	if (!SUCCEEDED(hr) || numSensors < 1) {
-		std::cerr << "Failed to find Kinect sensors." << std::endl;
-		return false;
+	std::vector<SensorSource *> sources;
+	if (source != nullptr) {
+		sources.push_back(source);
 	}
+	return initialize(sources);
+}
 
-	// Create and initialize each sensor
-	for (int i = 0; i < numSensors; ++i) {
-		INuiSensor *sensor = nullptr;		
-		hr = NuiCreateSensorByIndex(i, &sensor);
-		if (!SUCCEEDED(hr) || sensor == nullptr) {
-			std::cerr << "Failed to create Kinect sensor #" << i << std::endl;
-			return false;
-		}
-		sensors.push_back(sensor);
-
-		// Initialize sensor
-		hr = sensor->NuiInitialize(NUI_INITIALIZE_FLAG_USES_DEPTH
-								 | NUI_INITIALIZE_FLAG_USES_COLOR
-								 | NUI_INITIALIZE_FLAG_USES_SKELETON);
-		if (!SUCCEEDED(hr)) {
-			std::cerr << "Failed to initialize Kinect sensor #" << i << std::endl;
-			return false;
-		}
-		
-		// Open color stream to receive color data
-		hr = sensor->NuiImageStreamOpen(NUI_IMAGE_TYPE_COLOR
-			, NUI_IMAGE_RESOLUTION_1280x960
-			, 0    // Image stream flags, eg. near mode...
-			, 2    // Number of frames to buffer
-			, NULL // Event handle
-			, &colorStream);
-		if (!SUCCEEDED(hr)) {
-			std::cerr << "Failed to open color stream for Kinect sensor #" << i << std::endl;
-			return false;
-		}
+bool Kinect::initialize( const std::vector<SensorSource *>& sources )
+{
+	clock.restart();
 
-		// Open depth stream to receive depth data
-		// NOTE: if type: depth and player index, resolution 320x240
-		hr = sensor->NuiImageStreamOpen(NUI_IMAGE_TYPE_DEPTH
-			, NUI_IMAGE_RESOLUTION_640x480
-			, 0    // Image stream flags, eg. near mode...
-			, 2    // Number of frames to buffer
-			, NULL // Event handle
-			, &depthStream);
-		if (!SUCCEEDED(hr)) {
-			std::cerr << "Failed to open depth stream for Kinect sensor #" << i << std::endl;
-			return false;
+	std::vector<SensorSource *> opened(sources);
+	if (opened.empty()) {
+#ifdef _WIN32
+		const int numSensors = NuiSensorSource::getSensorCount();
+		for (int i = 0; i < numSensors; ++i) {
+			opened.push_back(new NuiSensorSource(i));
 		}
+#endif
+	}
 
-		// Create an event that will be signaled when skeleton data is available
-		nextSkeletonEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
-
-		// Open skeleton stream to receive skeleton data
-		hr = sensor->NuiSkeletonTrackingEnable(nextSkeletonEvent, skeletonTrackingFlags);
-		if (!SUCCEEDED(hr)) {
-			std::cerr << "Failed to enable skeleton tracking for Kinect sensor #" << i << std::endl;
-			return false;
+	for (unsigned int i = 0; i < opened.size(); ++i) {
+		SensorCapture *capture = new SensorCapture(i, opened[i], [this]() { notifyFrame(); });
+		if (!capture->start()) {
+			std::cerr << "Failed to open sensor #" << i << ", leaving it out." << std::endl;
+			delete capture;
+			continue;
 		}
-
-		deviceId = toStdString(sensor->NuiDeviceConnectionId());
-		std::cout << "Initialized Kinect #" << i << " with Device Id [" << deviceId.c_str() << "]" << std::endl;
+		captures.push_back(capture);
 	}
+	latestFrames.resize(captures.size());
+	receiveTimes.assign(captures.size(), -maxFrameAge);
+	fusionFrames.resize(captures.size());
 
-	initialized = (sensors.size() >= 1);
+	initialized = !captures.empty();
 	if (!initialized) {
 		std::cerr << "Unable to initialize Kinect." << std::endl;
 	} else {
-		std::cout << "Initialized " << sensors.size() << " Kinect device(s) "
-				  << "in " << clock.getElapsedTime().asSeconds() << " seconds."
+		std::cout << "Capturing from " << captures.size() << " sensor(s), "
+				  << "initialized in " << clock.getElapsedTime().asSeconds() << " seconds."
 				  << std::endl;
 	}
-
 	return initialized;
 }
 
-void Kinect::update()
+bool Kinect::update()
 {
-	checkForSkeletonFrame();
+	Profiler::Scope scope(Profiler::KINECT_UPDATE);
+
+	// The frame left in flight last time had the whole draw to finish in
+	bool updated = finishFrame();
+
+	// At most a queue's worth each, a worker refilling as fast as it is
+	// drained would otherwise keep the others waiting. The first sensor
+	// goes last so its frames are fused with the newest of the others.
+	// Its frames are smoothed by the pipeline rather than by the source.
+	const Skeleton::EFilteringLevel smoothing = skeleton.getFilterLevel();
+	pipeline.setSmoothing(smoothing);
+	for (unsigned int k = 1; k <= captures.size(); ++k) {
+		const unsigned int i = k % captures.size();
+		captures[i]->setSmoothing((i == 0) ? Skeleton::OFF : smoothing);
+		for (unsigned int n = 0; n < SensorCapture::QUEUE_CAPACITY && captures[i]->popFrame(latestFrames[i]); ++n) {
+			Latency::record(Latency::DEQUEUED, latestFrames[i].captureTime);
+			if (i != 0) {
+				receiveTimes[i] = clock.getElapsedTime().asSeconds();
+				continue;
+			}
+
+			// Images are converted by the capture workers, only the bodies are left
+			updated |= finishFrame();
+			FramePipeline::Input input;
+			input.skeleton = latestFrames[i];
+			input.color = nullptr;
+			input.depth = nullptr;
+			// Orientations the sensor solved don't fit the smoothed joints
+			if (smoothing != Skeleton::OFF) input.skeleton.hasOrientations = false;
+			pipeline.submit(input);
+		}
+	}
+	return updated;
+}
+
+bool Kinect::finishFrame()
+{
+	const FramePipeline::Output *finished = pipeline.finish();
+	if (finished == nullptr) return false;
+
+	Tracer::Scope trace("skeleton frame", "capture");
+	lastFrameNumber = finished->frameNumber;
+	trace.setFrame(lastFrameNumber);
+	skeletonFrameReady(finished->skeleton);
+	return true;
+}
+
+#ifdef _WIN32
+void Kinect::getFrameEvents( std::vector<HANDLE>& events, const bool includeImages )
+{
+	if (!initialized) return;
+	setCaptureImages(includeImages);
+	events.push_back(frameEvent);
+}
+#endif
+
+bool Kinect::waitForFrames( const float seconds )
+{
+	std::unique_lock<std::mutex> lock(signalMutex);
+	frameSignal.wait_for(lock, std::chrono::microseconds(static_cast<long long>(seconds * 1e6f)),
+		[&]() { return pendingSignals > 0; });
+	const bool signaled = (pendingSignals > 0);
+	pendingSignals = 0;
+	return signaled;
+}
+
+void Kinect::setCaptureImages( const bool capture )
+{
+	imagesWanted = capture;
+	for (auto c : captures) {
+		c->setCaptureImages(capture || bus.isOpen());
+	}
+}
+
+void Kinect::notifyFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(signalMutex);
+		++pendingSignals;
+	}
+	frameSignal.notify_all();
+#ifdef _WIN32
+	SetEvent(frameEvent);
+#endif
 }
 
 void Kinect::toggleSave()
@@ -135,206 +229,353 @@ void Kinect::toggleSave()
 	if (saving) {
 		if (!saveStream.is_open())
 			saveStream.open(saveFileName, std::ios::binary | std::ios::app);
+		if (!stampStream.is_open())
+			stampStream.open(stampFileName, std::ios::binary | std::ios::app);
+		// Four seconds of slack for the disk, rather a gap at the end than in the middle
+		recording = hub.subscribe("recording", [this](const LiveFramePtr& frame) { recordFrame(*frame); }, 128, Subscription::DROP_NEWEST);
 	} else {
-		std::cout << "Joint frames saved: " << numFramesSaved << std::endl;
+		// Writes out what is still queued
+		const unsigned int numDropped = recording->getStats().dropped;
+		hub.unsubscribe(recording);
+		recording = nullptr;
+		std::cout << "Joint frames saved: " << numFramesSaved;
+		if (numDropped > 0) std::cout << ", " << numDropped << " dropped";
+		std::cout << std::endl;
 		if (saveStream.is_open())
 			saveStream.close();
+		if (stampStream.is_open())
+			stampStream.close();
 	}
 }
 
-void Kinect::toggleSeatedMode()
+unsigned int Kinect::addGestureTemplate( const std::string& name, const Skeleton::JointFrames& frames )
 {
-	if (isSeatedModeEnabled()) {
-		skeletonTrackingFlags |= ~NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT;
+	std::lock_guard<std::mutex> lock(gestureMutex);
+	gestureRecognizer.addTemplate(name, frames);
+	return gestureRecognizer.getNumTemplates();
+}
+
+void Kinect::togglePublish()
+{
+	if (bus.isOpen()) {
+		std::cout << "Stopped publishing frames, " << bus.getNumPublished() << " published." << std::endl;
+		bus.close();
 	} else {
-		skeletonTrackingFlags |= NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT;
+		bus.create(FrameBus::defaultName, FrameBus::DEFAULT_SLOTS, DEPTH_STREAM_BYTES);
 	}
+	setCaptureImages(imagesWanted);
+}
 
-	HRESULT hr = getSensor()->NuiSkeletonTrackingEnable(nextSkeletonEvent, skeletonTrackingFlags);
-	if (!SUCCEEDED(hr)) {
-		std::cerr << "Failed to toggle skeleton tracking mode for Kinect sensor #0" << std::endl;
+void Kinect::toggleSeatedMode()
+{
+	for (auto capture : captures) {
+		capture->toggleSeatedMode();
 	}
 }
 
-void Kinect::getStreamData( byte *dest, const EStreamDataType& dataType, unsigned int sensorIndex )
+bool Kinect::getStreamData( unsigned char *dest, const EStreamDataType& dataType, const unsigned int sensorIndex )
 {
-	INuiSensor *sensor = getSensor(sensorIndex);
-	if (sensor == nullptr) {
-		std::cerr << "Failed to get Kinect sensor #" << sensorIndex << std::endl;
-		return;
-	}
+	Profiler::Scope scope(Profiler::STREAM_DATA);
+	if (sensorIndex >= captures.size()) return false;
 
-	HANDLE streamHandle;
-	     if (dataType == COLOR) streamHandle = colorStream;
-	else if (dataType == DEPTH) streamHandle = depthStream;
+	Tracer::Scope trace((dataType == COLOR) ? "color fetch" : "depth fetch", "capture");
 
-	// Get next frame
-	// TODO : use event notifier like skeleton
-	NUI_IMAGE_FRAME imageFrame;
-	HRESULT hr = sensor->NuiImageStreamGetNextFrame(streamHandle, 0, &imageFrame);
-	if (!SUCCEEDED(hr)) {
-		//std::cerr << "Failed to get next image frame from Kinect sensor #" << sensorIndex << std::endl;
-		return;
-	}
+	unsigned int frameNumber = Tracer::NO_FRAME;
+	const bool copied = captures[sensorIndex]->getImage(dataType, dest, frameNumber);
+	trace.setFrame(frameNumber);
+	return copied;
+}
+
+std::string Kinect::getDeviceId( const unsigned int sensorIndex ) const
+{
+	return (sensorIndex < captures.size()) ? captures[sensorIndex]->getSource().getDeviceId() : "?";
+}
 
-	// Copy frame data to destination buffer
-	NUI_LOCKED_RECT lockedRect;
-	imageFrame.pFrameTexture->LockRect(0, &lockedRect, NULL, 0);	
-	if (lockedRect.Pitch != 0) {
-		if (dataType == COLOR) {
-			const byte *curr = (const byte *) lockedRect.pBits;
-			const byte *last = curr + COLOR_STREAM_BYTES;
+SensorCapture::Stats Kinect::getCaptureStats( const unsigned int sensorIndex ) const
+{
+	return (sensorIndex < captures.size()) ? captures[sensorIndex]->getStats() : SensorCapture::Stats();
+}
 
-			// Store to dest as BGRA
-			while (curr < last) {
-				*dest++ = *curr++;
-			}
-		}
-		else if (dataType == DEPTH) {
-			const USHORT *curr = (const USHORT *) lockedRect.pBits;
-			const USHORT *last = curr + (DEPTH_STREAM_WIDTH * DEPTH_STREAM_HEIGHT);
-
-			while (curr < last) {
-				// Depth distance stored in top 13 bits, get normalized value
-				USHORT depth = NuiDepthPixelToDepth(*curr++);
-				USHORT dist  = (depth >> 3) / 2^13;
-
-				// Store to dest as BGRA
-				byte thresh = 128;
-				byte value  = (byte) (dist * 255);
-				*dest++ = (value > thresh) ? 0 : value; 
-				*dest++ = (value);
-				*dest++ = (value > thresh) ? 0 : value;
-				*dest++ = 0xff; 
-			}
+void Kinect::benchmark( const std::vector<SensorSource *>& sources, const float seconds )
+{
+	Kinect kinect;
+	if (!kinect.initialize(sources)) return;
+	kinect.setCaptureImages(true);
+
+	std::vector<std::vector<unsigned char> > images;
+	for (unsigned int i = 0; i < kinect.captures.size(); ++i) {
+		for (int type = COLOR; type <= DEPTH; ++type) {
+			unsigned int width, height;
+			kinect.captures[i]->getSource().getImageSize(static_cast<EStreamDataType>(type), width, height);
+			images.push_back(std::vector<unsigned char>(4 * width * height));
 		}
 	}
-	imageFrame.pFrameTexture->UnlockRect(0);
 
-	// Release frame
-	hr = sensor->NuiImageStreamReleaseFrame(streamHandle, &imageFrame);
-	if (!SUCCEEDED(hr)) {
-		std::cerr << "Failed to release image frame from Kinect sensor #" << sensorIndex << std::endl;
-		return;
+	sf::Clock clock;
+	while (clock.getElapsedTime().asSeconds() < seconds) {
+		if (!kinect.waitForFrames(0.1f)) continue;
+
+		Profiler::beginFrame();
+		Profiler::Scope scope(Profiler::FRAME);
+		kinect.update();
+		for (int i = 0; i < kinect.getNumSensors(); ++i) {
+			kinect.getStreamData(&images[2 * i + COLOR][0], COLOR, i);
+			kinect.getStreamData(&images[2 * i + DEPTH][0], DEPTH, i);
+		}
+	}
+	const float elapsed = clock.getElapsedTime().asSeconds();
+
+	std::cout << std::fixed << std::setprecision(1)
+	          << "Captured in " << elapsed << " seconds, per sensor:" << std::endl
+	          << std::left << std::setw(12) << "sensor" << std::right
+	          << std::setw(10) << "frames/s" << std::setw(10) << "images/s" << std::setw(10) << "dropped"
+	          << std::setw(10) << "busy %" << std::setw(12) << "max queued" << std::setw(10) << "partial" << std::endl;
+	unsigned int totalFrames = 0;
+	for (int i = 0; i < kinect.getNumSensors(); ++i) {
+		const SensorCapture::Stats stats = kinect.getCaptureStats(i);
+		totalFrames += stats.framesCaptured;
+		std::stringstream name;
+		name << "#" << i;
+		std::cout << std::left << std::setw(12) << name.str() << std::right
+		          << std::setw(10) << stats.framesCaptured / elapsed << std::setw(10) << stats.imagesCaptured / elapsed
+		          << std::setw(10) << stats.framesDropped << std::setw(10) << 100.f * stats.captureSeconds / elapsed
+		          << std::setw(12) << stats.maxQueued << std::setw(10) << stats.partialFrames << std::endl;
+	}
+	std::cout << "All sensors " << totalFrames / elapsed << " frames per second, "
+	          << totalFrames / elapsed / 30.f << "x the sensor's 30 Hz" << std::endl
+	          << "Stage times over the last " << Profiler::RING_SIZE << " samples, ms:" << std::endl
+	          << std::left << std::setw(18) << "stage" << std::right
+	          << std::setw(10) << "per frame" << std::setw(10) << "avg" << std::setw(10) << "p99"
+	          << std::setw(14) << "frames/s" << std::endl;
+
+	for (int stage = 0; stage < Profiler::NUM_STAGES; ++stage) {
+		Profiler::Summary summary;
+		Profiler::summarize(static_cast<Profiler::EStage>(stage), summary);
+		if (summary.count == 0) continue;
+
+		// Throughput the stage alone could sustain, counting how often it runs per frame
+		const float frameCost = summary.avg * summary.perFrame;
+		std::cout << std::left << std::setw(18) << Profiler::getStageName(static_cast<Profiler::EStage>(stage)) << std::right
+		          << std::setprecision(2) << std::setw(10) << summary.perFrame
+		          << std::setprecision(4) << std::setw(10) << summary.avg << std::setw(10) << summary.p99
+		          << std::setprecision(0) << std::setw(14) << ((frameCost > 0.f) ? 1000.f / frameCost : 0.f) << std::endl;
 	}
-}
 
-INuiSensor * Kinect::getSensor( unsigned int i ) const
-{
-	assert(sensors.size() > 0 && i < sensors.size());
-	return sensors[i];
+	std::cout << "Age of frames since acquisition, ms:" << std::endl
+	          << std::left << std::setw(18) << "stage" << std::right
+	          << std::setw(10) << "frames" << std::setw(10) << "p50" << std::setw(10) << "p95"
+	          << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+	for (int stage = 0; stage < Latency::NUM_STAGES; ++stage) {
+		Latency::Summary summary;
+		Latency::summarize(static_cast<Latency::EStage>(stage), summary);
+		if (summary.count == 0) continue;
+
+		std::cout << std::left << std::setw(18) << Latency::getStageName(static_cast<Latency::EStage>(stage)) << std::right
+		          << std::setw(10) << summary.count << std::setprecision(2)
+		          << std::setw(10) << summary.p50 << std::setw(10) << summary.p95
+		          << std::setw(10) << summary.p99 << std::setw(10) << summary.max << std::endl;
+	}
 }
 
-void Kinect::checkForSkeletonFrame()
+Skeleton::Joint Kinect::getPredictedJoint( const Skeleton::EJointType type, const float displayDelay )
 {
-	// Wait for 0ms to quickly test if it is time to process a skeleton frame
-	if (WAIT_OBJECT_0 == WaitForSingleObject(nextSkeletonEvent, 0)) {
-		// Get and process the skeleton frame that is ready
-		NUI_SKELETON_FRAME skeletonFrame = {0};
-		HRESULT hr = getSensor()->NuiSkeletonGetNextFrame(0, &skeletonFrame);
-		if (!SUCCEEDED(hr)) {
-			std::cerr << "Failed to get ready skeleton frame from Kinect sensor #0" << std::endl;
-			return;
-		}
-		skeletonFrameReady(skeletonFrame);
+	Skeleton::JointFrame& frame = skeleton.getCurrentJointFrame();
+	const Skeleton::JointFrame::const_iterator it = frame.find(type);
+	if (it == frame.end()) {
+		Skeleton::Joint joint;
+		memset(&joint, 0, sizeof(Skeleton::Joint));
+		joint.type = type;
+		return joint;
+	}
+	if (skeleton.isLoaded() || !sensorClockSynced) {
+		return it->second;
 	}
+
+	// Expected display time, on the sensor's acquisition timeline
+	const double displayTime = clock.getElapsedTime().asSeconds() + displayDelay - sensorClockOffset;
+	return predictor.predict(it->second, displayTime);
 }
 
-void Kinect::skeletonFrameReady( NUI_SKELETON_FRAME& skeletonFrame )
+void Kinect::skeletonFrameReady( const SensorSource::SkeletonFrame& frame )
 {
-	// Reset clock for timestamps on first run
-	static bool firstRun = true;
-	if (firstRun) {
-		firstRun = false;
+	// Start the session timeline and the local clock on the first frame
+	if (firstSkeletonFrame) {
+		firstSkeletonFrame = false;
+		captureOrigin = frame.captureTime;
 		clock.restart();
 	}
-	const float timestamp = clock.getElapsedTime().asSeconds();
+	const float receiveTime = clock.getElapsedTime().asSeconds();
+	// When the frame was taken from its source rather than when it got here,
+	// so queueing and fusion don't show up in the derivatives
+	const float timestamp = (frame.captureTime > captureOrigin)
+		? static_cast<float>(MonotonicClock::toSeconds(frame.captureTime - captureOrigin)) : 0.f;
+
+	// Track the smallest offset seen from the source's acquisition clock to the
+	// local clock so the predictor can map display times onto it
+	const double acquisitionTime = frame.acquisitionTime;
+	const double clockOffset = receiveTime - acquisitionTime;
+	if (!sensorClockSynced || clockOffset < sensorClockOffset) {
+		sensorClockOffset = clockOffset;
+		sensorClockSynced = true;
+	}
+
+	{
+		Profiler::Scope scope(Profiler::SKELETON_FUSION);
 
-	// Get data for the first tracked skeleton
-	const NUI_SKELETON_DATA *skeletonData = nullptr;
-	for (auto i = 0; i < NUI_SKELETON_COUNT; ++i) {
-		if (skeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_TRACKED) {
-			skeletonData = &skeletonFrame.SkeletonData[i];
-			break;
+		// Sensors that stopped delivering no longer see anybody
+		for (unsigned int i = 0; i < fusionFrames.size(); ++i) {
+			fusionFrames[i] = (i == 0) ? &frame : (receiveTime - receiveTimes[i] < maxFrameAge) ? &latestFrames[i] : nullptr;
 		}
+		fusion.fuse(fusionFrames, people);
+	}
+
+	Skeleton::JointFrames& others = skeleton.getOtherJointFrames();
+	others.resize(people.empty() ? 0 : people.size() - 1);
+	for (unsigned int i = 0; i < others.size(); ++i) {
+		others[i] = people[i + 1].joints;
 	}
-	if (skeletonData == nullptr) {
-		//std::cerr << "Failed to find tracked skeleton from Kinect sensor #0" << std::endl;
+	if (people.empty()) {
+		if (bus.isOpen()) publishFrame(frame);
+		publishLiveFrame(frame, timestamp);
 		return;
 	}
 
-	// Set filtering level
-	switch (skeleton.getFilterLevel()) {
-		case Skeleton::OFF:    break;
-		case Skeleton::LOW:    NuiTransformSmooth(&skeletonFrame, constants::joint_smooth_params_low);  break;
-		case Skeleton::MEDIUM: NuiTransformSmooth(&skeletonFrame, constants::joint_smooth_params_med);  break;
-		case Skeleton::HIGH:   NuiTransformSmooth(&skeletonFrame, constants::joint_smooth_params_high); break;
-	}
-
-	// Get bone orientations for this skeleton's joints
-	NUI_SKELETON_BONE_ORIENTATION boneOrientations[NUI_SKELETON_POSITION_COUNT];
-	HRESULT hr = NuiSkeletonCalculateBoneOrientations(skeletonData, boneOrientations);
-	if (!SUCCEEDED(hr)) {
-		std::cerr << "Failed to calculate bone orientations Kinect sensor #0" << std::endl;
-	}
-
-	// For each joint type...
-	for (auto i = 0; i < NUI_SKELETON_POSITION_COUNT; ++i) {
-		// Get joint data in Kinect API form
-		const NUI_SKELETON_POSITION_INDEX   positionIndex   = toPositionIndex(i);
-		const NUI_SKELETON_BONE_ORIENTATION boneOrientation = boneOrientations[positionIndex];
-		const NUI_SKELETON_POSITION_TRACKING_STATE positionTrackingState = skeletonData->eSkeletonPositionTrackingState[positionIndex];
-		const Vector4& position = skeletonData->SkeletonPositions[positionIndex];
-		const Matrix4& matrix4 = boneOrientation.absoluteRotation.rotationMatrix;
-
-		// Update the joint frame entry for this joint type
-		Skeleton::Joint& joint = skeleton.getCurrentJointFrame()[toJointType(i)];
-		joint.timestamp     = timestamp;
-		joint.position      = glm::vec3(position.x, position.y, position.z);
-		joint.orientation   = toMat4(matrix4);;
-		joint.type          = toJointType(i);
-		joint.trackingState = static_cast<Skeleton::ETrackingState>(positionTrackingState);
-
-		// Save the joint frame entry if appropriate
-		if (saving && saveStream.is_open()) {
-			saveStream.write((char *)&joint, sizeof(Skeleton::Joint));
+	{
+		Profiler::Scope scope(Profiler::LIVE_FRAME);
+
+		// Update the joint frame entries, stamped with the session capture time
+		const SkeletonFusion::Person& person = people.front();
+		Skeleton::JointFrame& jointFrame = skeleton.getCurrentJointFrame();
+		for (const auto& entry : person.joints) {
+			Skeleton::Joint& joint = jointFrame[entry.first];
+			joint = entry.second;
+			joint.timestamp = timestamp;
+		}
+
+		// Fall back to our own solver if the sources couldn't provide orientations
+		if (!person.hasOrientations) {
+			BoneOrientation::Orientations orientations;
+			BoneOrientation::solve(jointFrame, orientations);
+			for (auto& entry : jointFrame) {
+				entry.second.orientation = glm::mat4_cast(orientations.absolute[entry.first]);
+			}
 		}
+
+		skeleton.updateLiveFrame();
+		liveCaptureTime = frame.captureTime;
 	}
+	Latency::record(Latency::LIVE_FRAME, frame.captureTime);
 
-	if (saving && saveStream.is_open()) {
-		++numFramesSaved;
+	if (bus.isOpen()) {
+		publishFrame(frame);
 	}
-}
 
-// ----------------------------------------------------------------------------
-// ----------------------------------------------------------------------------
-// ----------------------------------------------------------------------------
+	// Display time prediction is read from the main loop, it stays here
+	{
+		Profiler::Scope scope(Profiler::JOINT_PREDICT);
+		predictor.update(skeleton.getCurrentJointFrame(), acquisitionTime);
+	}
 
+	publishLiveFrame(frame, timestamp);
+}
 
-std::string toStdString( const BSTR bstr )
+void Kinect::publishLiveFrame( const SensorSource::SkeletonFrame& frame, const float timestamp )
 {
-	const std::wstring wstr(bstr, SysStringLen(bstr));
-	std::string str; str.assign(wstr.begin(), wstr.end());
-	return str;
+	std::shared_ptr<LiveFrame> live(new LiveFrame());
+	live->frameNumber     = frame.frameNumber;
+	live->acquisitionTime = frame.acquisitionTime;
+	live->captureTime     = frame.captureTime;
+	live->timestamp       = timestamp;
+	live->people          = people;
+	if (!people.empty()) {
+		live->people.front().joints = skeleton.getCurrentJointFrame();
+		live->people.front().hasOrientations = true;
+	}
+	hub.publish(live);
 }
 
-Skeleton::EJointType toJointType( unsigned int i )
+void Kinect::recordFrame( const LiveFrame& frame )
 {
-	assert(i < Skeleton::NUM_JOINT_TYPES);
-	return static_cast<Skeleton::EJointType>(i);
+	if (frame.people.empty() || !saveStream.is_open()) return;
+
+	Profiler::Scope scope(Profiler::JOINT_RECORD);
+	Tracer::Scope trace("record write", "writer", frame.frameNumber);
+	for (const auto& entry : frame.people.front().joints) {
+		saveStream.write((const char *)&entry.second, sizeof(Skeleton::Joint));
+	}
+	// Joints only keep a float timestamp, the file format depends on it
+	if (stampStream.is_open()) {
+		stampStream.write((const char *)&frame.frameNumber, sizeof(frame.frameNumber));
+		stampStream.write((const char *)&frame.captureTime, sizeof(frame.captureTime));
+	}
+	++numFramesSaved;
+	Latency::record(Latency::RECORDED, frame.captureTime);
 }
 
-NUI_SKELETON_POSITION_INDEX toPositionIndex( unsigned int i )
+void Kinect::matchGesture( const LiveFrame& frame )
 {
-	assert(i < NUI_SKELETON_POSITION_COUNT);
-	return static_cast<NUI_SKELETON_POSITION_INDEX>(i);
+	if (frame.people.empty()) return;
+
+	GestureRecognizer::Match match;
+	bool recognized;
+	{
+		Profiler::Scope scope(Profiler::GESTURE_MATCH);
+		std::lock_guard<std::mutex> lock(gestureMutex);
+		recognized = gestureRecognizer.update(frame.people.front().joints, match);
+	}
+	Latency::record(Latency::GESTURE, frame.captureTime);
+	if (recognized) {
+		std::cout << "Recognized gesture '" << match.name << "' (distance " << match.distance << ")" << std::endl;
+	}
 }
 
-glm::mat4 toMat4( const Matrix4& m )
+void Kinect::publishFrame( const SensorSource::SkeletonFrame& frame )
 {
-	return glm::mat4(
-		  m.M11, m.M12, m.M13, m.M14
-		, m.M21, m.M22, m.M23, m.M24
-		, m.M31, m.M32, m.M33, m.M34
-		, m.M41, m.M42, m.M43, m.M44);
+	static_assert(FrameBus::NUM_JOINTS == Skeleton::NUM_JOINT_TYPES, "Frame bus joints out of step with the skeleton");
+	Profiler::Scope scope(Profiler::BUS_PUBLISH);
+	Tracer::Scope trace("bus publish", "writer", lastFrameNumber);
+
+	FrameBus::Frame& out = bus.beginFrame();
+	out.acquisitionTime = frame.acquisitionTime;
+	out.captureTime     = frame.captureTime;
+	out.frameNumber     = frame.frameNumber;
+	out.numBodies       = std::min(static_cast<unsigned int>(people.size()), FrameBus::MAX_BODIES);
+
+	// The first person as the skeleton shows them, with solved orientations
+	for (unsigned int b = 0; b < out.numBodies; ++b) {
+		FrameBus::Body& body = out.bodies[b];
+		body.id       = people[b].id;
+		body.numViews = people[b].numViews;
+
+		const Skeleton::JointFrame& joints = (b == 0) ? skeleton.getCurrentJointFrame() : people[b].joints;
+		for (int j = 0; j < Skeleton::NUM_JOINT_TYPES; ++j) {
+			FrameBus::Joint& joint = body.joints[j];
+			const auto it = joints.find(static_cast<Skeleton::EJointType>(j));
+			if (it == joints.end()) {
+				memset(&joint, 0, sizeof(joint));
+				joint.orientation[3] = 1.f;
+				continue;
+			}
+			const glm::quat orientation(glm::quat_cast(it->second.orientation));
+			joint.position[0]    = it->second.position.x;
+			joint.position[1]    = it->second.position.y;
+			joint.position[2]    = it->second.position.z;
+			joint.orientation[0] = orientation.x;
+			joint.orientation[1] = orientation.y;
+			joint.orientation[2] = orientation.z;
+			joint.orientation[3] = orientation.w;
+			joint.trackingState  = it->second.trackingState;
+		}
+	}
+
+	// Straight from the capture into the slot, previews shown or not
+	unsigned int depthFrameNumber = 0;
+	if (!captures.empty() && captures[0]->getUnpublishedImage(DEPTH, out.getDepth(), depthFrameNumber)) {
+		out.depthWidth       = DEPTH_STREAM_WIDTH;
+		out.depthHeight      = DEPTH_STREAM_HEIGHT;
+		out.depthFrameNumber = depthFrameNumber;
+		out.depthBytes       = DEPTH_STREAM_BYTES;
+	}
+	bus.endFrame();
+	Latency::record(Latency::PUBLISHED, frame.captureTime);
 }
@@ -1,18 +1,22 @@
 #pragma once
-#include <Windows.h>
-#define WIN32_LEAN_AND_MEAN
-
-#include <NuiApi.h>
-
 #include <SFML/System/Clock.hpp>
 
 #include "Skeleton.h"
-
+#include "SensorSource.h"
+#include "SensorCapture.h"
+#include "SkeletonFusion.h"
+#include "FrameHub.h"
+#include "FramePipeline.h"
+#include "JointPredictor.h"
+#include "GestureRecognizer.h"
+#include "Util/FrameBus.h"
+
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <string>
 #include <vector>
 
-enum EStreamDataType { COLOR, DEPTH };
 
 class Kinect
 {
@@ -26,6 +30,7 @@ public:
 	static const int DEPTH_STREAM_BYTES  = 4 * DEPTH_STREAM_WIDTH * DEPTH_STREAM_HEIGHT; // BGRA
 
 	static const std::string saveFileName;
+	static const std::string stampFileName; // frame number and capture time of every saved frame
 
 private:
 	bool initialized;
@@ -34,45 +39,139 @@ private:
 
 	sf::Clock clock;
 
-	std::string deviceId;
-	std::vector<INuiSensor *> sensors;
+	// One worker per sensor, the first one drives the skeleton
+	std::vector<SensorCapture *> captures;
+	std::vector<SensorSource::SkeletonFrame> latestFrames;
+	std::vector<float> receiveTimes;       // on clock, when each latest frame was taken from its worker
+
+	// Everybody the sensors see, merged into world space on every frame of the first sensor
+	SkeletonFusion fusion;
+	SkeletonFusion::People people;
+	std::vector<const SensorSource::SkeletonFrame *> fusionFrames;
 
-	HANDLE colorStream;
-	HANDLE depthStream;
-	HANDLE nextSkeletonEvent;
-	DWORD  skeletonTrackingFlags;
+	// Smooths the first sensor's bodies and solves their orientations on the
+	// job system, a frame is fused once the main loop comes back for it
+	FramePipeline pipeline;
+
+	// Raised by the workers whenever they have captured something
+	std::mutex signalMutex;
+	std::condition_variable frameSignal;
+	unsigned int pendingSignals;
+#ifdef _WIN32
+	HANDLE frameEvent;
+#endif
 
 	Skeleton skeleton;
+	JointPredictor predictor;
+	GestureRecognizer gestureRecognizer;
+	std::mutex gestureMutex;               // templates are added from the main loop while frames are matched
+
+	// Offset from sensor acquisition time to local clock time, in seconds
+	double sensorClockOffset;
+	bool   sensorClockSynced;
+
+	// Sensor numbering of the last skeleton frame, follows a frame through traces
+	unsigned int lastFrameNumber;
+	// MonotonicClock::now() as the frame the live skeleton shows was acquired, 0 before the first
+	uint64_t liveCaptureTime;
+	// Joints are stamped in seconds from the capture time of the first skeleton frame
+	bool     firstSkeletonFrame;
+	uint64_t captureOrigin;
 
 	std::ofstream saveStream;
+	std::ofstream stampStream;
+
+	// Every fused frame for other processes, with the newest depth image of the first sensor
+	FrameBus bus;
+	bool imagesWanted; // by setCaptureImages, images are captured while publishing either way
+
+	// Consumers of live frames, each with a queue and a thread of its own
+	FrameHub hub;
+	Subscription *recording;               // while saving
+	Subscription *gestures;
 
 public:
 	Kinect();
 	~Kinect();
 
-	bool initialize();
-	void update();
+	// Open a source and take ownership of it, every connected sensor through the Kinect SDK if none is given
+	bool initialize(SensorSource *source = nullptr);
+	// Open each source on a capture worker of its own, taking ownership of all of them
+	bool initialize(const std::vector<SensorSource *>& sources);
+	// Fuse the first sensor's frame left in the pipeline by the last call and start
+	// the pipeline on the waiting ones, true if a frame was fused
+	bool update();
+
+#ifdef _WIN32
+	// Event signaled when a worker has captured a frame, for the main loop to sleep on.
+	// Images are only captured when includeImages is set.
+	void getFrameEvents(std::vector<HANDLE>& events, const bool includeImages);
+#endif
+	// Sleep until a worker has captured a frame or for at most seconds, false on timeout
+	bool waitForFrames(const float seconds);
+	void setCaptureImages(const bool capture);
 
 	void toggleSave();
+	// Start or stop publishing frames to FrameBus::defaultName
+	void togglePublish();
 	void toggleSeatedMode();
 
-	void getStreamData(byte *dest, const EStreamDataType& dataType, unsigned int sensorIndex = 0);
+	// Copy the newest image of a stream to dest as BGRA, false if there was no new image.
+	// Images come in with the skeleton frame of the same moment, call after update().
+	bool getStreamData(unsigned char *dest, const EStreamDataType& dataType, const unsigned int sensorIndex = 0);
 
 	Skeleton& getSkeleton()             { return skeleton; }
 	const Skeleton& getSkeleton() const { return skeleton; }
 
-	bool isInitialized() const { return initialized; }
-	bool isSaving()      const { return saving; }
+	// Use a recording as a template for live gesture recognition, returns the number of templates
+	unsigned int addGestureTemplate(const std::string& name, const Skeleton::JointFrames& frames);
 
-	int  getNumSensors() const { return sensors.size(); }
-	const std::string& getDeviceId() const { return deviceId; }
+	// Live frames on a queue to poll or a callback on a thread of its own, from the main loop only.
+	// A consumer that falls behind drops frames by its policy without holding up the others.
+	Subscription *subscribe(const std::string& name, const unsigned int capacity, const Subscription::EDropPolicy policy)
+		{ return hub.subscribe(name, capacity, policy); }
+	Subscription *subscribe(const std::string& name, const Subscription::Callback& callback,
+	                        const unsigned int capacity, const Subscription::EDropPolicy policy)
+		{ return hub.subscribe(name, callback, capacity, policy); }
+	void unsubscribe(Subscription *subscription) { hub.unsubscribe(subscription); }
 
-	INuiSensor *getSensor(unsigned int i = 0) const;
+	// The skeleton follows the person with the lowest id, the others are only drawn
+	SkeletonFusion& getFusion()                   { return fusion; }
+	const SkeletonFusion::People& getPeople() const { return people; }
 
-private:
-	void checkForSkeletonFrame();
-	void skeletonFrameReady(NUI_SKELETON_FRAME& skeletonFrame);
+	// Current live joint extrapolated to displayDelay seconds from now,
+	// joints from loaded recordings are returned as they are
+	Skeleton::Joint getPredictedJoint(const Skeleton::EJointType type, const float displayDelay);
 
-	bool isSeatedModeEnabled() const { return 0 != (skeletonTrackingFlags & NUI_SKELETON_FRAME_FLAG_SEATED_SUPPORT_ENABLED); }
+	// Drive a Kinect with sources, taking ownership of them, for the given wall
+	// clock seconds without a window and print the frame rates each capture
+	// worker reached, the time spent in each stage and how old frames got
+	static void benchmark(const std::vector<SensorSource *>& sources, const float seconds);
 
+	bool isInitialized() const { return initialized; }
+	bool isSaving()      const { return saving; }
+	bool isPublishing()  const { return bus.isOpen(); }
+	unsigned int getFrameNumber() const { return lastFrameNumber; }
+	uint64_t getLiveCaptureTime() const { return liveCaptureTime; }
+
+	int  getNumSensors() const { return captures.size(); }
+	std::string getDeviceId(const unsigned int sensorIndex = 0) const;
+	SensorCapture::Stats getCaptureStats(const unsigned int sensorIndex) const;
+	// Newest skeleton frame of a sensor, as handed out by its source
+	const SensorSource::SkeletonFrame& getLatestFrame(const unsigned int sensorIndex) const { return latestFrames[sensorIndex]; }
+
+private:
+	void notifyFrame();
+	// Fuse and publish the frame in flight in the pipeline, false if there was none
+	bool finishFrame();
+	void skeletonFrameReady(const SensorSource::SkeletonFrame& frame);
+	void publishFrame(const SensorSource::SkeletonFrame& frame);
+	void publishLiveFrame(const SensorSource::SkeletonFrame& frame, const float timestamp);
+
+	// Subscription callbacks
+	void recordFrame(const LiveFrame& frame);
+	void matchGesture(const LiveFrame& frame);
+
+	Kinect(const Kinect& other);
+	Kinect& operator=(const Kinect& other);
 };
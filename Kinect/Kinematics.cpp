@@ -0,0 +1,235 @@
+#include "Kinematics.h"
+#include "Skeleton.h"
+#include "Util/Float4.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+
+static_assert(Kinematics::NUM_JOINTS == Skeleton::NUM_JOINT_TYPES, "Kinematics::NUM_JOINTS must match the skeleton");
+static_assert(Kinematics::NUM_JOINTS % 4 == 0, "Kinematics::NUM_JOINTS must fill whole SIMD lanes");
+
+const float Kinematics::maxGap = 0.25f;
+
+namespace
+{
+	// Shortest spacing differentiated, guards against duplicated timestamps
+	const float minGap = 1e-4f;
+
+	struct Vec4x3 {
+		Float4 x, y, z;
+		Vec4x3() {}
+		Vec4x3(const Float4& x, const Float4& y, const Float4& z) : x(x), y(y), z(z) {}
+
+		static Vec4x3 load(const float channels[3][Kinematics::NUM_JOINTS], const unsigned int joint) {
+			return Vec4x3(Float4::load(&channels[0][joint]), Float4::load(&channels[1][joint]), Float4::load(&channels[2][joint]));
+		}
+		void store(float channels[3][Kinematics::NUM_JOINTS], const unsigned int joint) const {
+			x.store(&channels[0][joint]);
+			y.store(&channels[1][joint]);
+			z.store(&channels[2][joint]);
+		}
+	};
+
+	inline Vec4x3 operator-(const Vec4x3& a, const Vec4x3& b) { return Vec4x3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline Vec4x3 operator*(const Vec4x3& a, const Float4& s) { return Vec4x3(a.x * s, a.y * s, a.z * s); }
+	inline Float4 length(const Vec4x3& a)                     { return sqrt4(a.x * a.x + a.y * a.y + a.z * a.z); }
+
+	// mask ? a : 0, per lane
+	inline Vec4x3 keep(const Float4& mask, const Vec4x3& a) {
+		const Float4 zero(0.f);
+		return Vec4x3(select4(mask, a.x, zero), select4(mask, a.y, zero), select4(mask, a.z, zero));
+	}
+
+	// Scalar version of Kinematics::update for a single joint, used to check the SIMD path
+	struct ScalarJoint {
+		glm::vec3 position, velocity, acceleration;
+		float timestamp;
+		unsigned int samples;
+		ScalarJoint() : position(0.f), velocity(0.f), acceleration(0.f), timestamp(0.f), samples(0) {}
+
+		// Returns the number of usable samples, capped at 4
+		unsigned int update(const glm::vec3& p, const float t, const bool tracked, glm::vec3& v, glm::vec3& a, glm::vec3& j) {
+			const float dt = t - timestamp;
+			if (!tracked)                                                   samples = 0;
+			else if (samples > 0 && dt > minGap && dt < Kinematics::maxGap) samples = std::min(samples + 1, 4u);
+			else                                                            samples = 1;
+
+			const float invDt = 1.f / std::max(dt, minGap);
+			v = (samples >= 2) ? (p - position) * invDt : glm::vec3(0.f);
+			a = (samples >= 3) ? (v - velocity) * invDt : glm::vec3(0.f);
+			j = (samples >= 4) ? (a - acceleration) * invDt : glm::vec3(0.f);
+
+			position = p;
+			velocity = v;
+			acceleration = a;
+			timestamp = t;
+			return samples;
+		}
+	};
+}
+
+
+Kinematics::Kinematics()
+{
+	reset();
+}
+
+void Kinematics::reset()
+{
+	memset(position, 0, sizeof(position));
+	memset(velocity, 0, sizeof(velocity));
+	memset(acceleration, 0, sizeof(acceleration));
+	memset(timestamp, 0, sizeof(timestamp));
+	memset(samples, 0, sizeof(samples));
+	memset(&latest, 0, sizeof(latest));
+
+	for (unsigned int j = 0; j < NUM_JOINTS; ++j) {
+		extrema.minSpeed[j] = FLT_MAX;
+		extrema.maxSpeed[j] = 0.f;
+		extrema.maxAcceleration[j] = 0.f;
+		extrema.maxJerk[j] = 0.f;
+	}
+}
+
+const Kinematics::Frame& Kinematics::update( const Sample& sample )
+{
+	update(sample, latest);
+	return latest;
+}
+
+void Kinematics::update( const Sample& sample, Frame& frame )
+{
+	const Float4 zero(0.f), one(1.f), half(0.5f);
+	const Float4 two(2.f), three(3.f), four(4.f);
+	const Float4 minDt(minGap), maxDt(maxGap);
+
+	for (unsigned int j = 0; j < NUM_JOINTS; j += 4) {
+		const Vec4x3 p = Vec4x3::load(sample.position, j);
+		const Float4 t = Float4::load(&sample.timestamp[j]);
+		const Float4 tracked = greater4(Float4::load(&sample.tracked[j]), half);
+
+		// Count consecutive usable samples: restart at 1 after a gap, 0 while untracked
+		const Float4 previousSamples = Float4::load(&samples[j]);
+		const Float4 dt = t - Float4::load(&timestamp[j]);
+		const Float4 continuous = and4(greater4(previousSamples, half), and4(greater4(dt, minDt), greater4(maxDt, dt)));
+		const Float4 n = select4(tracked, select4(continuous, min4(previousSamples + one, four), one), zero);
+		const Float4 invDt = one / max4(dt, minDt);
+
+		// Backward differences of each order, zero where there is not enough history
+		const Float4 hasVelocity     = greater4(n, two - half);
+		const Float4 hasAcceleration = greater4(n, three - half);
+		const Float4 hasJerk         = greater4(n, four - half);
+		const Vec4x3 v = keep(hasVelocity,     (p - Vec4x3::load(position, j)) * invDt);
+		const Vec4x3 a = keep(hasAcceleration, (v - Vec4x3::load(velocity, j)) * invDt);
+		const Vec4x3 k = keep(hasJerk,         (a - Vec4x3::load(acceleration, j)) * invDt);
+		const Float4 speed = length(v);
+
+		p.store(position, j);
+		v.store(velocity, j);
+		a.store(acceleration, j);
+		t.store(&timestamp[j]);
+		n.store(&samples[j]);
+
+		v.store(frame.velocity, j);
+		a.store(frame.acceleration, j);
+		k.store(frame.jerk, j);
+		speed.store(&frame.speed[j]);
+		n.store(&frame.samples[j]);
+
+		// Extrema only over frames where the derivative exists
+		const Float4 minSpeed = Float4::load(&extrema.minSpeed[j]);
+		select4(hasVelocity, min4(minSpeed, speed), minSpeed).store(&extrema.minSpeed[j]);
+		max4(Float4::load(&extrema.maxSpeed[j]), speed).store(&extrema.maxSpeed[j]);
+		max4(Float4::load(&extrema.maxAcceleration[j]), length(a)).store(&extrema.maxAcceleration[j]);
+		max4(Float4::load(&extrema.maxJerk[j]), length(k)).store(&extrema.maxJerk[j]);
+	}
+}
+
+void Kinematics::compute( const Samples& samples, Track& track )
+{
+	Kinematics kinematics;
+	track.frames.resize(samples.size());
+	for (unsigned int i = 0; i < samples.size(); ++i) {
+		kinematics.update(samples[i], track.frames[i]);
+	}
+	track.extrema = kinematics.getExtrema();
+}
+
+void Kinematics::benchmark( const Samples& samples )
+{
+	if (samples.empty()) return;
+	const unsigned int numFrames = samples.size();
+	const unsigned int numRuns = std::max(1u, 100000u / numFrames);
+
+	// Both sides write the same outputs into arrays allocated up front
+	Frames simdFrames(numFrames), scalarFrames(numFrames);
+	Extrema simdExtrema, scalarExtrema;
+
+	sf::Clock clock;
+	for (unsigned int run = 0; run < numRuns; ++run) {
+		Kinematics kinematics;
+		for (unsigned int i = 0; i < numFrames; ++i) {
+			kinematics.update(samples[i], simdFrames[i]);
+		}
+		simdExtrema = kinematics.getExtrema();
+	}
+	const float simdSeconds = clock.getElapsedTime().asSeconds();
+
+	clock.restart();
+	for (unsigned int run = 0; run < numRuns; ++run) {
+		ScalarJoint joints[NUM_JOINTS];
+		for (unsigned int j = 0; j < NUM_JOINTS; ++j) {
+			scalarExtrema.minSpeed[j] = FLT_MAX;
+			scalarExtrema.maxSpeed[j] = scalarExtrema.maxAcceleration[j] = scalarExtrema.maxJerk[j] = 0.f;
+		}
+		for (unsigned int i = 0; i < numFrames; ++i) {
+			const Sample& sample = samples[i];
+			Frame& frame = scalarFrames[i];
+			for (unsigned int j = 0; j < NUM_JOINTS; ++j) {
+				const glm::vec3 p(sample.position[0][j], sample.position[1][j], sample.position[2][j]);
+				glm::vec3 v, a, k;
+				const unsigned int n = joints[j].update(p, sample.timestamp[j], sample.tracked[j] > 0.5f, v, a, k);
+				const float speed = glm::length(v);
+				for (unsigned int c = 0; c < 3; ++c) {
+					frame.velocity[c][j]     = v[c];
+					frame.acceleration[c][j] = a[c];
+					frame.jerk[c][j]         = k[c];
+				}
+				frame.speed[j]   = speed;
+				frame.samples[j] = static_cast<float>(n);
+
+				if (n >= 2) scalarExtrema.minSpeed[j] = std::min(scalarExtrema.minSpeed[j], speed);
+				scalarExtrema.maxSpeed[j]        = std::max(scalarExtrema.maxSpeed[j], speed);
+				scalarExtrema.maxAcceleration[j] = std::max(scalarExtrema.maxAcceleration[j], glm::length(a));
+				scalarExtrema.maxJerk[j]         = std::max(scalarExtrema.maxJerk[j], glm::length(k));
+			}
+		}
+	}
+	const float scalarSeconds = clock.getElapsedTime().asSeconds();
+
+	// Jerk compounds any difference in the lower orders, so comparing it covers all three
+	float maxDifference = 0.f;
+	float maxJerk = 0.f;
+	for (unsigned int i = 0; i < numFrames; ++i) {
+		for (unsigned int j = 0; j < NUM_JOINTS; ++j) {
+			const glm::vec3 expected = scalarFrames[i].getJerk(j);
+			maxDifference = std::max(maxDifference, glm::length(simdFrames[i].getJerk(j) - expected));
+			maxJerk = std::max(maxJerk, glm::length(expected));
+		}
+	}
+	for (unsigned int j = 0; j < NUM_JOINTS; ++j) {
+		maxDifference = std::max(maxDifference, std::abs(simdExtrema.maxJerk[j] - scalarExtrema.maxJerk[j]));
+	}
+
+	const unsigned int numTimed = numRuns * numFrames;
+	std::cout << "Kinematics of " << numFrames << " frames, " << numRuns << " runs:" << std::endl
+	          << "  simd:   " << simdSeconds   * 1e6f / numTimed << " us per frame" << std::endl
+	          << "  scalar: " << scalarSeconds * 1e6f / numTimed << " us per frame" << std::endl
+	          << "  speedup: " << ((simdSeconds > 0.f) ? scalarSeconds / simdSeconds : 0.f) << "x"
+	          << ", max jerk difference " << maxDifference << " of max jerk " << maxJerk << std::endl;
+}
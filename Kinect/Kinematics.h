@@ -0,0 +1,99 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// Incremental joint kinematics: velocity, acceleration and jerk of every
+// joint by backward finite differences over the recorded timestamps.
+//
+// Everything is kept in structure of arrays form, one channel per axis with
+// all joints contiguous, so each update runs four joints per SIMD lane
+// group. A joint's derivatives restart whenever it loses tracking or its
+// samples are too far apart in time. This class only sees sample arrays so
+// Skeleton can own it, Skeleton gathers its joint frames into samples.
+class Kinematics
+{
+public:
+	// Same as Skeleton::NUM_JOINT_TYPES, a multiple of the four SIMD lanes
+	static const unsigned int NUM_JOINTS = 20;
+
+	// Joint positions of one frame
+	struct Sample {
+		float position[3][NUM_JOINTS];
+		float timestamp[NUM_JOINTS]; // in seconds
+		float tracked[NUM_JOINTS];   // 1 if the position is usable, 0 otherwise
+	};
+	typedef std::vector<Sample> Samples;
+
+	// Derivatives of every joint at one frame
+	struct Frame {
+		float velocity[3][NUM_JOINTS];     // meters / second
+		float acceleration[3][NUM_JOINTS]; // meters / second^2
+		float jerk[3][NUM_JOINTS];         // meters / second^3
+		float speed[NUM_JOINTS];
+
+		// Consecutive usable samples up to this frame, capped at 4:
+		// velocity needs 2, acceleration 3 and jerk 4, the rest are zero
+		float samples[NUM_JOINTS];
+
+		glm::vec3 getVelocity(const unsigned int joint)     const { return glm::vec3(velocity[0][joint], velocity[1][joint], velocity[2][joint]); }
+		glm::vec3 getAcceleration(const unsigned int joint) const { return glm::vec3(acceleration[0][joint], acceleration[1][joint], acceleration[2][joint]); }
+		glm::vec3 getJerk(const unsigned int joint)         const { return glm::vec3(jerk[0][joint], jerk[1][joint], jerk[2][joint]); }
+		bool hasVelocity(const unsigned int joint)     const { return samples[joint] >= 2.f; }
+		bool hasAcceleration(const unsigned int joint) const { return samples[joint] >= 3.f; }
+		bool hasJerk(const unsigned int joint)         const { return samples[joint] >= 4.f; }
+	};
+	typedef std::vector<Frame> Frames;
+
+	// Magnitude extrema of every joint over all frames seen since reset,
+	// minSpeed stays at FLT_MAX for joints that never had a velocity
+	struct Extrema {
+		float minSpeed[NUM_JOINTS];
+		float maxSpeed[NUM_JOINTS];
+		float maxAcceleration[NUM_JOINTS];
+		float maxJerk[NUM_JOINTS];
+	};
+
+	// Derivatives of a whole recording
+	struct Track {
+		Frames frames;
+		Extrema extrema;
+	};
+
+	// Samples further apart than this start the derivatives over
+	static const float maxGap;
+
+private:
+	// Previous sample and derivatives of each joint
+	float position[3][NUM_JOINTS];
+	float velocity[3][NUM_JOINTS];
+	float acceleration[3][NUM_JOINTS];
+	float timestamp[NUM_JOINTS];
+	float samples[NUM_JOINTS];
+
+	Frame latest;
+	Extrema extrema;
+
+public:
+	Kinematics();
+
+	// Forget all previous samples and extrema
+	void reset();
+
+	// Differentiate the next sample against the previous ones
+	const Frame& update(const Sample& sample);
+	// The same written straight into frame, getLatest doesn't see it
+	void update(const Sample& sample, Frame& frame);
+
+	const Frame& getLatest() const { return latest; }
+	const Extrema& getExtrema() const { return extrema; }
+
+	// Differentiate a whole recording from scratch
+	static void compute(const Samples& samples, Track& track);
+
+	// Time the SIMD update against a scalar implementation of the same
+	// differences, both writing whole frames and extrema into preallocated
+	// arrays, and print the per frame cost of each and their difference
+	static void benchmark(const Samples& samples);
+};
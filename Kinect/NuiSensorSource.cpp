@@ -0,0 +1,296 @@
+#include "NuiSensorSource.h"
+#include "Kinect.h"
+#include "JointFilter.h"
+#include "ImageConversion.h"
+#include "Util/Profiler.h"
+#include "Util/Tracer.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <iostream>
+#include <string>
+#include <cassert>
+
+std::string toStdString(const BSTR bstr);
+Skeleton::EJointType toJointType(unsigned int i);
+NUI_SKELETON_POSITION_INDEX toPositionIndex(unsigned int i);
+glm::mat4 toMat4(const Matrix4& m);
+NUI_TRANSFORM_SMOOTH_PARAMETERS toSmoothParameters(const JointFilter::Parameters& p);
+
+
+NuiSensorSource::NuiSensorSource( const int index )
+	: index(index)
+	, deviceId("?")
+	, sensor(nullptr)
+	, colorStream()
+	, depthStream()
+	, nextColorEvent()
+	, nextDepthEvent()
+	, nextSkeletonEvent()
+	, skeletonTrackingFlags(NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT)
+{}
+
+NuiSensorSource::~NuiSensorSource()
+{
+	if (sensor != nullptr) {
+		sensor->NuiShutdown();
+		sensor->Release();
+	}
+	if (nextColorEvent)    CloseHandle(nextColorEvent);
+	if (nextDepthEvent)    CloseHandle(nextDepthEvent);
+	if (nextSkeletonEvent) CloseHandle(nextSkeletonEvent);
+}
+
+int NuiSensorSource::getSensorCount()
+{
+	int numSensors = 0;
+	HRESULT hr = NuiGetSensorCount(&numSensors);
+	if (!SUCCEEDED(hr) || numSensors < 1) {
+		std::cerr << "Failed to find Kinect sensors." << std::endl;
+		return 0;
+	}
+	return numSensors;
+}
+
+bool NuiSensorSource::open()
+{
+	sf::Clock clock;
+	const int i = index;
+
+	// Create and initialize the sensor
+	HRESULT hr = NuiCreateSensorByIndex(i, &sensor);
+	if (!SUCCEEDED(hr) || sensor == nullptr) {
+		std::cerr << "Failed to create Kinect sensor #" << i << std::endl;
+		sensor = nullptr;
+		return false;
+	}
+
+	hr = sensor->NuiInitialize(NUI_INITIALIZE_FLAG_USES_DEPTH
+							 | NUI_INITIALIZE_FLAG_USES_COLOR
+							 | NUI_INITIALIZE_FLAG_USES_SKELETON);
+	if (!SUCCEEDED(hr)) {
+		std::cerr << "Failed to initialize Kinect sensor #" << i << std::endl;
+		return false;
+	}
+
+	// Create events that will be signaled when image data is available
+	nextColorEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+	nextDepthEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+	// Open color stream to receive color data
+	hr = sensor->NuiImageStreamOpen(NUI_IMAGE_TYPE_COLOR
+		, NUI_IMAGE_RESOLUTION_1280x960
+		, 0    // Image stream flags, eg. near mode...
+		, 2    // Number of frames to buffer
+		, nextColorEvent
+		, &colorStream);
+	if (!SUCCEEDED(hr)) {
+		std::cerr << "Failed to open color stream for Kinect sensor #" << i << std::endl;
+		return false;
+	}
+
+	// Open depth stream to receive depth data
+	// NOTE: if type: depth and player index, resolution 320x240
+	hr = sensor->NuiImageStreamOpen(NUI_IMAGE_TYPE_DEPTH
+		, NUI_IMAGE_RESOLUTION_640x480
+		, 0    // Image stream flags, eg. near mode...
+		, 2    // Number of frames to buffer
+		, nextDepthEvent
+		, &depthStream);
+	if (!SUCCEEDED(hr)) {
+		std::cerr << "Failed to open depth stream for Kinect sensor #" << i << std::endl;
+		return false;
+	}
+
+	// Create an event that will be signaled when skeleton data is available
+	nextSkeletonEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+	// Open skeleton stream to receive skeleton data
+	hr = sensor->NuiSkeletonTrackingEnable(nextSkeletonEvent, skeletonTrackingFlags);
+	if (!SUCCEEDED(hr)) {
+		std::cerr << "Failed to enable skeleton tracking for Kinect sensor #" << i << std::endl;
+		return false;
+	}
+
+	deviceId = toStdString(sensor->NuiDeviceConnectionId());
+	std::cout << "Initialized Kinect #" << i << " with Device Id [" << deviceId.c_str() << "] "
+			  << "in " << clock.getElapsedTime().asSeconds() << " seconds."
+			  << std::endl;
+	return true;
+}
+
+bool NuiSensorSource::getSkeletonFrame( SkeletonFrame& frame, const Skeleton::EFilteringLevel smoothing )
+{
+	// Wait for 0ms to quickly test if it is time to process a skeleton frame
+	if (WAIT_OBJECT_0 != WaitForSingleObject(nextSkeletonEvent, 0)) {
+		return false;
+	}
+	Profiler::Scope scope(Profiler::SKELETON_FETCH);
+	Tracer::Scope trace("skeleton fetch", "capture");
+
+	// Get the skeleton frame that is ready
+	NUI_SKELETON_FRAME skeletonFrame = {0};
+	HRESULT hr = sensor->NuiSkeletonGetNextFrame(0, &skeletonFrame);
+	if (!SUCCEEDED(hr)) {
+		std::cerr << "Failed to get ready skeleton frame from Kinect sensor #" << index << std::endl;
+		return false;
+	}
+	trace.setFrame(skeletonFrame.dwFrameNumber);
+
+	// Sensor timestamps are in milliseconds since the sensor started
+	frame.frameNumber     = skeletonFrame.dwFrameNumber;
+	frame.acquisitionTime = skeletonFrame.liTimeStamp.QuadPart / 1000.0;
+	frame.hasOrientations = true;
+	frame.bodies.clear();
+
+	// Set filtering level
+	if (smoothing != Skeleton::OFF) {
+		const NUI_TRANSFORM_SMOOTH_PARAMETERS smoothParameters = toSmoothParameters(JointFilter::getParameters(smoothing));
+		NuiTransformSmooth(&skeletonFrame, &smoothParameters);
+	}
+
+	// Get data for every tracked skeleton
+	for (auto s = 0; s < NUI_SKELETON_COUNT; ++s) {
+		const NUI_SKELETON_DATA *skeletonData = &skeletonFrame.SkeletonData[s];
+		if (skeletonData->eTrackingState != NUI_SKELETON_TRACKED) continue;
+
+		// Get bone orientations for this skeleton's joints
+		NUI_SKELETON_BONE_ORIENTATION boneOrientations[NUI_SKELETON_POSITION_COUNT];
+		hr = NuiSkeletonCalculateBoneOrientations(skeletonData, boneOrientations);
+		if (!SUCCEEDED(hr)) {
+			std::cerr << "Failed to calculate bone orientations Kinect sensor #" << index << ", solving them from joint positions" << std::endl;
+			frame.hasOrientations = false;
+		}
+
+		// For each joint type...
+		frame.bodies.push_back(Skeleton::JointFrame());
+		Skeleton::JointFrame& joints = frame.bodies.back();
+		for (auto i = 0; i < NUI_SKELETON_POSITION_COUNT; ++i) {
+			// Get joint data in Kinect API form
+			const NUI_SKELETON_POSITION_INDEX   positionIndex   = toPositionIndex(i);
+			const NUI_SKELETON_BONE_ORIENTATION boneOrientation = boneOrientations[positionIndex];
+			const NUI_SKELETON_POSITION_TRACKING_STATE positionTrackingState = skeletonData->eSkeletonPositionTrackingState[positionIndex];
+			const Vector4& position = skeletonData->SkeletonPositions[positionIndex];
+			const Matrix4& matrix4 = boneOrientation.absoluteRotation.rotationMatrix;
+
+			// Update the joint frame entry for this joint type
+			Skeleton::Joint& joint = joints[toJointType(i)];
+			joint.position      = glm::vec3(position.x, position.y, position.z);
+			joint.orientation   = toMat4(matrix4);
+			joint.type          = toJointType(i);
+			joint.trackingState = static_cast<Skeleton::ETrackingState>(positionTrackingState);
+		}
+	}
+	return true;
+}
+
+bool NuiSensorSource::getImage( const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber, double& acquisitionTime )
+{
+	if (sensor == nullptr) {
+		std::cerr << "Failed to get Kinect sensor #" << index << std::endl;
+		return false;
+	}
+
+	HANDLE streamHandle;
+	     if (type == COLOR) streamHandle = colorStream;
+	else if (type == DEPTH) streamHandle = depthStream;
+
+	// Get next frame, without waiting, the capture worker sleeps on the stream's event
+	NUI_IMAGE_FRAME imageFrame;
+	HRESULT hr = sensor->NuiImageStreamGetNextFrame(streamHandle, 0, &imageFrame);
+	if (!SUCCEEDED(hr)) {
+		//std::cerr << "Failed to get next image frame from Kinect sensor #" << index << std::endl;
+		return false;
+	}
+	frameNumber     = imageFrame.dwFrameNumber;
+	acquisitionTime = imageFrame.liTimeStamp.QuadPart / 1000.0;
+
+	// Copy frame data to destination buffer
+	NUI_LOCKED_RECT lockedRect;
+	imageFrame.pFrameTexture->LockRect(0, &lockedRect, NULL, 0);
+	const bool copied = (lockedRect.Pitch != 0);
+	if (copied) {
+		// Store to dest as BGRA
+		if (type == COLOR) {
+			ImageConversion::colorToBGRA((const byte *) lockedRect.pBits, dest, Kinect::COLOR_STREAM_WIDTH * Kinect::COLOR_STREAM_HEIGHT);
+		}
+		else if (type == DEPTH) {
+			ImageConversion::depthToBGRA((const USHORT *) lockedRect.pBits, dest, Kinect::DEPTH_STREAM_WIDTH * Kinect::DEPTH_STREAM_HEIGHT);
+		}
+	}
+	imageFrame.pFrameTexture->UnlockRect(0);
+
+	// Release frame
+	hr = sensor->NuiImageStreamReleaseFrame(streamHandle, &imageFrame);
+	if (!SUCCEEDED(hr)) {
+		std::cerr << "Failed to release image frame from Kinect sensor #" << index << std::endl;
+	}
+	return copied;
+}
+
+void NuiSensorSource::toggleSeatedMode()
+{
+	if (isSeatedModeEnabled()) {
+		skeletonTrackingFlags |= ~NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT;
+	} else {
+		skeletonTrackingFlags |= NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT;
+	}
+
+	HRESULT hr = sensor->NuiSkeletonTrackingEnable(nextSkeletonEvent, skeletonTrackingFlags);
+	if (!SUCCEEDED(hr)) {
+		std::cerr << "Failed to toggle skeleton tracking mode for Kinect sensor #" << index << std::endl;
+	}
+}
+
+void NuiSensorSource::getFrameEvents( std::vector<HANDLE>& events, const bool includeImages ) const
+{
+	events.push_back(nextSkeletonEvent);
+	if (includeImages) {
+		events.push_back(nextColorEvent);
+		events.push_back(nextDepthEvent);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+std::string toStdString( const BSTR bstr )
+{
+	const std::wstring wstr(bstr, SysStringLen(bstr));
+	std::string str; str.assign(wstr.begin(), wstr.end());
+	return str;
+}
+
+Skeleton::EJointType toJointType( unsigned int i )
+{
+	assert(i < Skeleton::NUM_JOINT_TYPES);
+	return static_cast<Skeleton::EJointType>(i);
+}
+
+NUI_SKELETON_POSITION_INDEX toPositionIndex( unsigned int i )
+{
+	assert(i < NUI_SKELETON_POSITION_COUNT);
+	return static_cast<NUI_SKELETON_POSITION_INDEX>(i);
+}
+
+glm::mat4 toMat4( const Matrix4& m )
+{
+	return glm::mat4(
+		  m.M11, m.M12, m.M13, m.M14
+		, m.M21, m.M22, m.M23, m.M24
+		, m.M31, m.M32, m.M33, m.M34
+		, m.M41, m.M42, m.M43, m.M44);
+}
+
+NUI_TRANSFORM_SMOOTH_PARAMETERS toSmoothParameters( const JointFilter::Parameters& p )
+{
+	NUI_TRANSFORM_SMOOTH_PARAMETERS params;
+	params.fSmoothing          = p.smoothing;
+	params.fCorrection         = p.correction;
+	params.fPrediction         = p.prediction;
+	params.fJitterRadius       = p.jitterRadius;
+	params.fMaxDeviationRadius = p.maxDeviationRadius;
+	return params;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <Windows.h>
+#define WIN32_LEAN_AND_MEAN
+
+#include <NuiApi.h>
+
+#include "SensorSource.h"
+
+#include <string>
+#include <vector>
+
+
+// One Kinect for Windows sensor through the Kinect SDK
+class NuiSensorSource : public SensorSource
+{
+private:
+	int index;
+	std::string deviceId;
+	INuiSensor *sensor;
+
+	HANDLE colorStream;
+	HANDLE depthStream;
+	HANDLE nextColorEvent;
+	HANDLE nextDepthEvent;
+	HANDLE nextSkeletonEvent;
+	DWORD  skeletonTrackingFlags;
+
+public:
+	explicit NuiSensorSource(const int index = 0);
+	~NuiSensorSource();
+
+	// Number of sensors connected, zero if the SDK finds none
+	static int getSensorCount();
+
+	bool open();
+	std::string getDeviceId() const { return deviceId; }
+
+	bool getSkeletonFrame(SkeletonFrame& frame, const Skeleton::EFilteringLevel smoothing);
+	bool getImage(const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber, double& acquisitionTime);
+
+	void toggleSeatedMode();
+
+	void getFrameEvents(std::vector<HANDLE>& events, const bool includeImages) const;
+
+	INuiSensor *getSensor() const { return sensor; }
+
+private:
+	bool isSeatedModeEnabled() const { return 0 != (skeletonTrackingFlags & NUI_SKELETON_FRAME_FLAG_SEATED_SUPPORT_ENABLED); }
+
+	NuiSensorSource(const NuiSensorSource& other);
+	NuiSensorSource& operator=(const NuiSensorSource& other);
+};
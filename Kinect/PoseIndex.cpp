@@ -0,0 +1,453 @@
+#include "PoseIndex.h"
+#include "KeyframeReducer.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <utility>
+#include <limits>
+#include <queue>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+	const char magic[8] = { 'P', 'O', 'S', 'E', 'I', 'D', 'X', '1' };
+	const unsigned int version = 1;
+
+	// Sections of the index file start on 16 byte boundaries
+	inline size_t align16(const size_t offset) { return (offset + 15) & ~static_cast<size_t>(15); }
+
+	inline float distance(const float *a, const float *b) {
+		float sum = 0.f;
+		for (unsigned int d = 0; d < PoseIndex::DIMENSION; ++d) {
+			const float diff = a[d] - b[d];
+			sum += diff * diff;
+		}
+		return std::sqrt(sum);
+	}
+
+	bool hasExtension(const std::string& filename, const std::string& extension)
+	{
+		return filename.size() >= extension.size()
+		    && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+	}
+
+#ifdef _WIN32
+	const char separator = '\\';
+#else
+	const char separator = '/';
+#endif
+
+	bool isFolder(const std::string& path)
+	{
+#ifdef _WIN32
+		const DWORD attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+	}
+
+	// Names in a folder, without . and ..
+	void listFolder(const std::string& path, std::vector<std::string>& names)
+	{
+#ifdef _WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((path + separator + "*").c_str(), &data);
+		if (find == INVALID_HANDLE_VALUE) return;
+		do {
+			const std::string name(data.cFileName);
+			if (name != "." && name != "..") names.push_back(name);
+		} while (FindNextFileA(find, &data));
+		FindClose(find);
+#else
+		DIR *dir = opendir(path.c_str());
+		if (dir == nullptr) return;
+		while (const dirent *entry = readdir(dir)) {
+			const std::string name(entry->d_name);
+			if (name != "." && name != "..") names.push_back(name);
+		}
+		closedir(dir);
+#endif
+	}
+
+	// Build the implicit vantage point tree over order[lo, hi), writing the radius of each subtree root
+	void buildRange(const float *poses, std::vector<unsigned int>& order, std::vector<float>& radii
+	              , std::vector<std::pair<float, unsigned int> >& scratch, const unsigned int lo, const unsigned int hi)
+	{
+		if (hi - lo <= 1) {
+			if (hi > lo) radii[lo] = 0.f;
+			return;
+		}
+
+		// Deterministic pseudo random vantage point, so rebuilding gives the same file
+		const unsigned int pick = lo + static_cast<unsigned int>((lo * 2654435761u + hi) % (hi - lo));
+		std::swap(order[lo], order[pick]);
+		const float *vantage = &poses[static_cast<size_t>(order[lo]) * PoseIndex::DIMENSION];
+
+		scratch.clear();
+		for (unsigned int i = lo + 1; i < hi; ++i) {
+			scratch.push_back(std::make_pair(distance(vantage, &poses[static_cast<size_t>(order[i]) * PoseIndex::DIMENSION]), order[i]));
+		}
+
+		// Split at the median distance, closer half inside the radius
+		const unsigned int mid = lo + 1 + (hi - lo - 1) / 2;
+		std::nth_element(scratch.begin(), scratch.begin() + (mid - lo - 1), scratch.end());
+		for (unsigned int i = lo + 1; i < hi; ++i) {
+			order[i] = scratch[i - lo - 1].second;
+		}
+		radii[lo] = (mid < hi) ? scratch[mid - lo - 1].first : 0.f;
+
+		buildRange(poses, order, radii, scratch, lo + 1, mid);
+		buildRange(poses, order, radii, scratch, mid, hi);
+	}
+}
+
+
+PoseIndex::PoseIndex()
+	: mappedFile()
+	, header(nullptr)
+	, radii(nullptr)
+	, refs(nullptr)
+	, poses(nullptr)
+	, filenames()
+{}
+
+bool PoseIndex::toPose( const Skeleton::JointFrame& frame, float *pose )
+{
+	const auto hip      = frame.find(Skeleton::HIP_CENTER);
+	const auto shoulder = frame.find(Skeleton::SHOULDER_CENTER);
+	if (hip == frame.end() || shoulder == frame.end()) return false;
+	if (hip->second.trackingState      == Skeleton::NOT_TRACKED
+	 || shoulder->second.trackingState == Skeleton::NOT_TRACKED) return false;
+
+	const glm::vec3& root = hip->second.position;
+	const float torso = glm::distance(root, shoulder->second.position);
+	if (torso < 1e-3f) return false;
+	const float scale = 1.f / torso;
+
+	for (auto j = 0; j < Skeleton::NUM_JOINT_TYPES; ++j) {
+		const auto it = frame.find(static_cast<Skeleton::EJointType>(j));
+		const glm::vec3 p = (it == frame.end() || it->second.trackingState == Skeleton::NOT_TRACKED)
+		                  ? glm::vec3(0.f) : (it->second.position - root) * scale;
+		pose[3 * j + 0] = p.x;
+		pose[3 * j + 1] = p.y;
+		pose[3 * j + 2] = p.z;
+	}
+	return true;
+}
+
+bool PoseIndex::build( const std::vector<std::string>& recordings, const std::string& indexFilename )
+{
+	// Poses go to a scratch file next to the index, one recording at a time,
+	// and the tree is built through a mapping of it. Memory holds about 24
+	// bytes of bookkeeping per pose, the OS pages the poses themselves.
+	const std::string posesFilename = indexFilename + ".poses";
+	std::vector<PoseRef> refs;
+	{
+		std::ofstream posesStream(posesFilename, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (!posesStream.is_open()) {
+			std::cerr << "Failed to open '" << posesFilename << "' for writing poses" << std::endl;
+			return false;
+		}
+
+		for (unsigned int f = 0; f < recordings.size(); ++f) {
+			Skeleton::JointFrames frames;
+			if (!Skeleton::readFile(recordings[f], frames)) {
+				std::cerr << "Failed to read '" << recordings[f] << "' for pose index" << std::endl;
+				continue;
+			}
+
+			float pose[DIMENSION];
+			for (unsigned int i = 0; i < frames.size(); ++i) {
+				if (!toPose(frames[i], pose)) continue;
+				posesStream.write(reinterpret_cast<const char *>(pose), sizeof(pose));
+				PoseRef ref = { f, i };
+				refs.push_back(ref);
+			}
+		}
+
+		if (!posesStream.good() || refs.size() > std::numeric_limits<unsigned int>::max()) {
+			std::cerr << "Failed to write " << refs.size() << " poses to '" << posesFilename << "'" << std::endl;
+			posesStream.close();
+			std::remove(posesFilename.c_str());
+			return false;
+		}
+	}
+
+	const unsigned int numPoses = static_cast<unsigned int>(refs.size());
+	MappedFile posesFile;
+	if (numPoses > 0 && !posesFile.open(posesFilename)) {
+		std::remove(posesFilename.c_str());
+		return false;
+	}
+	const float *poses = reinterpret_cast<const float *>(posesFile.getData());
+
+	std::vector<unsigned int> order(numPoses);
+	for (unsigned int i = 0; i < numPoses; ++i) order[i] = i;
+	std::vector<float> radii(numPoses, 0.f);
+	std::vector<std::pair<float, unsigned int> > scratch;
+	scratch.reserve(numPoses);
+	buildRange(poses, order, radii, scratch, 0, numPoses);
+
+	std::ofstream stream(indexFilename, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!stream.is_open()) {
+		std::cerr << "Failed to open '" << indexFilename << "' for writing pose index" << std::endl;
+		posesFile.close();
+		std::remove(posesFilename.c_str());
+		return false;
+	}
+
+	std::string names;
+	for (const auto& recording : recordings) {
+		names += recording;
+		names.push_back('\0');
+	}
+
+	Header header;
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version    = version;
+	header.dimension  = DIMENSION;
+	header.numPoses   = numPoses;
+	header.numFiles   = recordings.size();
+	header.namesBytes = names.size();
+	header.reserved   = 0;
+
+	// Header, names, radii, refs and poses, each section padded to 16 bytes
+	static const char padding[16] = { 0 };
+	size_t offset = 0;
+	auto write = [&](const void *data, const size_t bytes) {
+		stream.write(static_cast<const char *>(data), bytes);
+		offset += bytes;
+	};
+	auto pad = [&]() {
+		stream.write(padding, align16(offset) - offset);
+		offset = align16(offset);
+	};
+
+	write(&header, sizeof(Header));
+	pad();
+	write(names.data(), names.size());
+	pad();
+	for (unsigned int i = 0; i < numPoses; ++i) write(&radii[i], sizeof(float));
+	pad();
+	for (unsigned int i = 0; i < numPoses; ++i) write(&refs[order[i]], sizeof(PoseRef));
+	pad();
+	for (unsigned int i = 0; i < numPoses; ++i) write(&poses[static_cast<size_t>(order[i]) * DIMENSION], DIMENSION * sizeof(float));
+
+	const bool ok = stream.good();
+	stream.close();
+	posesFile.close();
+	std::remove(posesFilename.c_str());
+	return ok;
+}
+
+void PoseIndex::findRecordings( const std::string& path, std::vector<std::string>& recordings )
+{
+	if (!isFolder(path)) {
+		recordings.push_back(path);
+		return;
+	}
+
+	std::vector<std::string> names;
+	listFolder(path, names);
+	std::sort(names.begin(), names.end());
+	for (const auto& name : names) {
+		const std::string child = path + separator + name;
+		if (isFolder(child)) {
+			findRecordings(child, recordings);
+		} else if (hasExtension(name, ".bin") || KeyframeReducer::isKeyframeFile(name)) {
+			recordings.push_back(child);
+		}
+	}
+}
+
+bool PoseIndex::open( const std::string& indexFilename )
+{
+	close();
+	if (!mappedFile.open(indexFilename)) return false;
+
+	const char *data = mappedFile.getData();
+	const size_t size = mappedFile.getSize();
+	const Header *h = reinterpret_cast<const Header *>(data);
+	if (size < sizeof(Header) || memcmp(h->magic, magic, sizeof(magic)) != 0
+	 || h->version != version || h->dimension != DIMENSION) {
+		std::cerr << "'" << indexFilename << "' is not a compatible pose index" << std::endl;
+		close();
+		return false;
+	}
+
+	size_t offset = align16(sizeof(Header));
+	const char *names = data + offset;
+	offset = align16(offset + h->namesBytes);
+	const size_t radiiOffset = offset;
+	offset = align16(offset + h->numPoses * sizeof(float));
+	const size_t refsOffset = offset;
+	offset = align16(offset + h->numPoses * sizeof(PoseRef));
+	const size_t posesOffset = offset;
+	if (posesOffset + static_cast<size_t>(h->numPoses) * DIMENSION * sizeof(float) > size) {
+		std::cerr << "Pose index '" << indexFilename << "' is truncated" << std::endl;
+		close();
+		return false;
+	}
+
+	for (unsigned int f = 0, start = 0; f < h->numFiles && start < h->namesBytes; ++f) {
+		filenames.push_back(std::string(names + start));
+		start += filenames.back().size() + 1;
+	}
+
+	header = h;
+	radii  = reinterpret_cast<const float *>(data + radiiOffset);
+	refs   = reinterpret_cast<const PoseRef *>(data + refsOffset);
+	poses  = reinterpret_cast<const float *>(data + posesOffset);
+	return true;
+}
+
+void PoseIndex::close()
+{
+	mappedFile.close();
+	header = nullptr;
+	radii  = nullptr;
+	refs   = nullptr;
+	poses  = nullptr;
+	filenames.clear();
+}
+
+bool PoseIndex::query( const Skeleton::JointFrame& frame, const unsigned int k, std::vector<Result>& results ) const
+{
+	results.clear();
+
+	float pose[DIMENSION];
+	if (!isOpen() || !toPose(frame, pose)) return false;
+
+	std::vector<Neighbour> neighbours;
+	query(pose, k, neighbours);
+	for (const auto& neighbour : neighbours) {
+		const PoseRef& ref = refs[neighbour.index];
+		Result result;
+		result.filename   = (ref.file < filenames.size()) ? filenames[ref.file] : std::string();
+		result.frameIndex = ref.frame;
+		result.distance   = neighbour.distance;
+		results.push_back(result);
+	}
+	return true;
+}
+
+unsigned int PoseIndex::query( const float *pose, const unsigned int k, std::vector<Neighbour>& neighbours ) const
+{
+	neighbours.clear();
+	if (!isOpen() || k == 0) return 0;
+
+	// Max heap of the best k so far, the worst of them bounds the search
+	struct FartherFirst {
+		bool operator()(const Neighbour& a, const Neighbour& b) const { return a.distance < b.distance; }
+	};
+	std::priority_queue<Neighbour, std::vector<Neighbour>, FartherFirst> best;
+	float tau = std::numeric_limits<float>::infinity();
+
+	// Subtree ranges still to visit, with a lower bound on their distance to the query
+	struct Range {
+		unsigned int lo, hi;
+		float bound;
+	};
+	Range stack[64];
+	unsigned int top = 0;
+	Range root = { 0, header->numPoses, 0.f };
+	stack[top++] = root;
+
+	unsigned int numDistances = 0;
+	while (top > 0) {
+		const Range range = stack[--top];
+		if (range.lo >= range.hi || range.bound > tau) continue;
+
+		const float d = distance(pose, &poses[static_cast<size_t>(range.lo) * DIMENSION]);
+		++numDistances;
+		if (d < tau || best.size() < k) {
+			Neighbour neighbour = { range.lo, d };
+			best.push(neighbour);
+			if (best.size() > k) best.pop();
+			if (best.size() == k) tau = best.top().distance;
+		}
+		if (range.hi - range.lo == 1) continue;
+
+		// Push the farther half first so the nearer one is searched first
+		const unsigned int mid = range.lo + 1 + (range.hi - range.lo - 1) / 2;
+		const float r = radii[range.lo];
+		Range inside  = { range.lo + 1, mid,      std::max(0.f, d - r) };
+		Range outside = { mid,          range.hi, std::max(0.f, r - d) };
+		if (d < r) {
+			stack[top++] = outside;
+			stack[top++] = inside;
+		} else {
+			stack[top++] = inside;
+			stack[top++] = outside;
+		}
+	}
+
+	neighbours.resize(best.size());
+	for (int i = static_cast<int>(best.size()) - 1; i >= 0; --i) {
+		neighbours[i] = best.top();
+		best.pop();
+	}
+	return numDistances;
+}
+
+void PoseIndex::benchmark( const std::vector<std::string>& recordings, const std::string& indexFilename )
+{
+	sf::Clock clock;
+	if (!build(recordings, indexFilename)) return;
+	const float buildSeconds = clock.getElapsedTime().asSeconds();
+
+	PoseIndex index;
+	clock.restart();
+	if (!index.open(indexFilename)) return;
+	const float openSeconds = clock.getElapsedTime().asSeconds();
+
+	const unsigned int numPoses = index.getNumPoses();
+	if (numPoses == 0) return;
+
+	// Query with indexed poses nudged by a small deterministic offset
+	const unsigned int numQueries = std::min(1000u, numPoses);
+	const unsigned int k = 10;
+	std::vector<float> latencies;
+	std::vector<Neighbour> neighbours;
+	unsigned long long totalDistances = 0;
+	float pose[DIMENSION];
+	for (unsigned int q = 0; q < numQueries; ++q) {
+		const unsigned int source = static_cast<unsigned int>((q * 2654435761u) % numPoses);
+		for (unsigned int d = 0; d < DIMENSION; ++d) {
+			pose[d] = index.poses[static_cast<size_t>(source) * DIMENSION + d] + 0.01f * (((q + d) % 7) - 3.f);
+		}
+		clock.restart();
+		totalDistances += index.query(pose, k, neighbours);
+		latencies.push_back(clock.getElapsedTime().asSeconds() * 1000.f);
+	}
+	std::sort(latencies.begin(), latencies.end());
+	float totalLatency = 0.f;
+	for (auto latency : latencies) totalLatency += latency;
+
+	const float megabytes = index.mappedFile.getSize() / (1024.f * 1024.f);
+	std::cout << "Pose index over " << numPoses << " poses from " << recordings.size() << " recordings:" << std::endl
+	          << "  build: " << buildSeconds << " seconds, open: " << openSeconds * 1000.f << " ms" << std::endl
+	          << "  size on disk / mapped: " << megabytes << " MB ("
+	          << index.mappedFile.getSize() / static_cast<float>(numPoses) << " bytes per pose)" << std::endl
+	          << "  " << k << "-NN query latency over " << numQueries << " queries: avg "
+	          << totalLatency / numQueries << " ms, p50 " << latencies[numQueries / 2]
+	          << " ms, p99 " << latencies[(numQueries * 99) / 100] << " ms" << std::endl
+	          << "  distances computed per query: " << totalDistances / numQueries
+	          << " (" << 100.0 * totalDistances / numQueries / numPoses << "% of a linear scan)" << std::endl;
+}
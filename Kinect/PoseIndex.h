@@ -0,0 +1,87 @@
+#pragma once
+#include "Skeleton.h"
+#include "Util/MappedFile.h"
+
+#include <string>
+#include <vector>
+
+
+// Nearest neighbour search for poses across many recordings.
+//
+// Poses are all joint positions relative to the hip center and scaled by
+// torso length, so the same pose matches regardless of where or how tall
+// the person is. Poses are kept in a vantage point tree stored implicitly:
+// every subtree is a contiguous range with its vantage point first, the
+// inside half next and the outside half last, so the only tree data is one
+// radius per pose. The index file is memory mapped when opened, nothing is
+// read up front and the OS pages in only the parts queries touch.
+class PoseIndex
+{
+public:
+	static const unsigned int DIMENSION = 3 * Skeleton::NUM_JOINT_TYPES;
+
+	struct Neighbour {
+		unsigned int index; // position in the index
+		float distance;
+	};
+
+	struct Result {
+		std::string filename;
+		unsigned int frameIndex;
+		float distance;
+	};
+
+private:
+	struct Header {
+		char magic[8];
+		unsigned int version;
+		unsigned int dimension;
+		unsigned int numPoses;
+		unsigned int numFiles;
+		unsigned int namesBytes;
+		unsigned int reserved;
+	};
+
+	struct PoseRef {
+		unsigned int file;
+		unsigned int frame;
+	};
+
+	MappedFile mappedFile;
+	const Header  *header;
+	const float   *radii;
+	const PoseRef *refs;
+	const float   *poses;
+	std::vector<std::string> filenames;
+
+public:
+	PoseIndex();
+
+	// Build an index over every frame of the given recordings and write it to indexFilename.
+	// Poses pass through a scratch file beside it, so memory doesn't grow with their size.
+	static bool build(const std::vector<std::string>& recordings, const std::string& indexFilename);
+	// Add path if it is a file, or every recording in it and its subfolders if it is a
+	// folder: saved sessions (.bin) and reduced ones. Folders are listed in sorted order.
+	static void findRecordings(const std::string& path, std::vector<std::string>& recordings);
+
+	bool open(const std::string& indexFilename);
+	void close();
+	bool isOpen() const { return header != nullptr; }
+	unsigned int getNumPoses() const { return isOpen() ? header->numPoses : 0; }
+
+	// Find the k poses closest to the given frame, nearest first
+	bool query(const Skeleton::JointFrame& frame, const unsigned int k, std::vector<Result>& results) const;
+	unsigned int query(const float *pose, const unsigned int k, std::vector<Neighbour>& neighbours) const;
+
+	// Normalized pose vector of DIMENSION floats, false if the frame has no usable torso
+	static bool toPose(const Skeleton::JointFrame& frame, float *pose);
+
+	// Build, open and query an index over the given recordings, printing
+	// build time, memory footprint and query latency
+	static void benchmark(const std::vector<std::string>& recordings, const std::string& indexFilename);
+
+private:
+	// Not copyable, owns the mapping
+	PoseIndex(const PoseIndex& other);
+	PoseIndex& operator=(const PoseIndex& other);
+};
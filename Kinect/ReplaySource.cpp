@@ -0,0 +1,168 @@
+#include "ReplaySource.h"
+#include "Kinect.h"
+#include "ImageConversion.h"
+#include "Util/Profiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	const float frameDuration = 1.f / 30.f;
+}
+
+
+ReplaySource::ReplaySource( const std::string& filename, const float speed )
+	: filename(filename)
+	, speed(std::max(0.f, speed))
+	, frames()
+	, frameTimes()
+	, loopDuration(0.f)
+	, clock()
+	, numFramesServed(0)
+	, lastFrameTime(0.0)
+	, frameIndex(0)
+	, loopOffset(0.0)
+	, filter(JointFilter::getParameters(Skeleton::OFF))
+	, filterLevel(Skeleton::OFF)
+	, colorStream()
+	, depthStream()
+	, numColorFrames(0)
+	, numDepthFrames(0)
+	, lastColorFrame(0xFFFFFFFF)
+	, lastDepthFrame(0xFFFFFFFF)
+	, colorBuffer()
+	, depthBuffer()
+{}
+
+bool ReplaySource::open()
+{
+	if (!Skeleton::readFile(filename, frames) || frames.empty()) {
+		std::cerr << "Failed to read a recording to replay from '" << filename << "'." << std::endl;
+		return false;
+	}
+
+	// Same repair as Skeleton::loadFile, pacing needs increasing times
+	frameTimes.resize(frames.size());
+	for (unsigned int i = 0; i < frames.size(); ++i) {
+		const float timestamp = frames[i].empty() ? 0.f : frames[i].begin()->second.timestamp;
+		frameTimes[i] = (i > 0 && timestamp <= frameTimes[i - 1]) ? frameTimes[i - 1] + frameDuration : timestamp;
+	}
+	for (auto& time : frameTimes) {
+		time -= frameTimes.front();
+	}
+	loopDuration = frameTimes.back() + frameDuration;
+
+	numColorFrames = openImages(colorStream, filename + ".color.raw", Kinect::COLOR_STREAM_BYTES);
+	numDepthFrames = openImages(depthStream, filename + ".depth.raw", Kinect::DEPTH_STREAM_WIDTH * Kinect::DEPTH_STREAM_HEIGHT * sizeof(unsigned short));
+
+	std::cout << "Replaying " << frames.size() << " frames (" << loopDuration << " seconds) from '" << filename << "' ";
+	if (speed > 0.f) std::cout << "at " << speed << "x speed";
+	else             std::cout << "as fast as possible";
+	std::cout << ", " << numColorFrames << " color and " << numDepthFrames << " depth images." << std::endl;
+
+	clock.restart();
+	return true;
+}
+
+bool ReplaySource::getSkeletonFrame( SkeletonFrame& frame, const Skeleton::EFilteringLevel smoothing )
+{
+	if (frames.empty() || getNextFrameDelay() > 0.f) {
+		return false;
+	}
+	Profiler::Scope scope(Profiler::SKELETON_FETCH);
+
+	frame.frameNumber     = numFramesServed++;
+	frame.acquisitionTime = getNextFrameTime();
+	lastFrameTime = frame.acquisitionTime;
+	frame.hasOrientations = (smoothing == Skeleton::OFF);
+	frame.bodies.clear();
+	if (!frames[frameIndex].empty()) {
+		frame.bodies.push_back(frames[frameIndex]);
+	}
+
+	// Recorded orientations were solved from the unsmoothed positions
+	if (smoothing != filterLevel) {
+		filter = JointFilter(JointFilter::getParameters(smoothing));
+		filterLevel = smoothing;
+	}
+	if (smoothing != Skeleton::OFF && !frame.bodies.empty()) {
+		filter.apply(frame.bodies[0]);
+	}
+
+	if (++frameIndex == frames.size()) {
+		frameIndex = 0;
+		loopOffset += loopDuration;
+		filter.reset();
+	}
+	return true;
+}
+
+bool ReplaySource::getImage( const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber, double& acquisitionTime )
+{
+	// Images follow the skeleton frame last handed out, once each
+	if (numFramesServed == 0) return false;
+	frameNumber = numFramesServed - 1;
+	acquisitionTime = lastFrameTime;
+
+	if (type == COLOR) {
+		if (lastColorFrame == frameNumber) return false;
+		colorBuffer.resize(Kinect::COLOR_STREAM_BYTES);
+		if (!readImage(COLOR, frameNumber, &colorBuffer[0])) return false;
+		ImageConversion::colorToBGRA(&colorBuffer[0], dest, Kinect::COLOR_STREAM_WIDTH * Kinect::COLOR_STREAM_HEIGHT);
+		lastColorFrame = frameNumber;
+	}
+	else if (type == DEPTH) {
+		if (lastDepthFrame == frameNumber) return false;
+		depthBuffer.resize(Kinect::DEPTH_STREAM_WIDTH * Kinect::DEPTH_STREAM_HEIGHT);
+		if (!readImage(DEPTH, frameNumber, &depthBuffer[0])) return false;
+		ImageConversion::depthToBGRA(&depthBuffer[0], dest, depthBuffer.size());
+		lastDepthFrame = frameNumber;
+	}
+	return true;
+}
+
+bool ReplaySource::readImage( const EStreamDataType type, const unsigned int frameNumber, void *dest )
+{
+	if (type == COLOR) {
+		if (numColorFrames == 0) return false;
+		const std::streamoff offset = (std::streamoff) (frameNumber % numColorFrames) * Kinect::COLOR_STREAM_BYTES;
+		colorStream.clear();
+		colorStream.seekg(offset);
+		if (!colorStream.read(static_cast<char *>(dest), Kinect::COLOR_STREAM_BYTES)) return false;
+	}
+	else if (type == DEPTH) {
+		if (numDepthFrames == 0) return false;
+		const std::streamoff frameBytes = Kinect::DEPTH_STREAM_WIDTH * Kinect::DEPTH_STREAM_HEIGHT * sizeof(unsigned short);
+		depthStream.clear();
+		depthStream.seekg((frameNumber % numDepthFrames) * frameBytes);
+		if (!depthStream.read(static_cast<char *>(dest), frameBytes)) return false;
+	}
+	return true;
+}
+
+float ReplaySource::getNextFrameDelay() const
+{
+	if (speed <= 0.f) return 0.f;
+	const double delay = getNextFrameTime() / speed - clock.getElapsedTime().asSeconds();
+	return (delay > 0.0) ? static_cast<float>(delay) : 0.f;
+}
+
+double ReplaySource::getNextFrameTime() const
+{
+	return loopOffset + frameTimes[frameIndex];
+}
+
+unsigned int ReplaySource::openImages( std::ifstream& stream, const std::string& name, const unsigned int frameBytes )
+{
+	stream.open(name, std::ios::binary | std::ios::in);
+	if (!stream.is_open()) return 0;
+
+	stream.seekg(0, std::ios::end);
+	const unsigned int numImages = static_cast<unsigned int>(stream.tellg() / frameBytes);
+	if (numImages == 0) {
+		std::cerr << "Ignoring '" << name << "', it holds less than one image." << std::endl;
+		stream.close();
+	}
+	return numImages;
+}
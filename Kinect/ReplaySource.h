@@ -0,0 +1,71 @@
+#pragma once
+#include "SensorSource.h"
+#include "JointFilter.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// Plays a joint recording back as if a sensor were producing it, looping at
+// the end. Frames are paced by their recorded times divided by speed, a speed
+// of zero hands out a new frame on every call. Color and depth images are
+// replayed alongside if '<recording>.color.raw' (BGRA 1280x960 frames) or
+// '<recording>.depth.raw' (packed 640x480 depth frames) exist.
+class ReplaySource : public SensorSource
+{
+private:
+	std::string filename;
+	float speed;
+
+	Skeleton::JointFrames frames;
+	std::vector<float> frameTimes; // seconds, increasing
+	float loopDuration;
+
+	sf::Clock clock;
+	unsigned int numFramesServed;
+	double lastFrameTime;          // acquisition time of the frame last handed out
+	unsigned int frameIndex;       // of the next frame
+	double loopOffset;             // seconds added to frame times by earlier loops
+
+	JointFilter filter;
+	Skeleton::EFilteringLevel filterLevel;
+
+	std::ifstream colorStream;
+	std::ifstream depthStream;
+	unsigned int numColorFrames;
+	unsigned int numDepthFrames;
+	unsigned int lastColorFrame;   // frame numbers of the images last handed out
+	unsigned int lastDepthFrame;
+	std::vector<unsigned char>  colorBuffer;
+	std::vector<unsigned short> depthBuffer;
+
+public:
+	ReplaySource(const std::string& filename, const float speed = 1.f);
+
+	bool open();
+	std::string getDeviceId() const { return "replay:" + filename; }
+
+	bool getSkeletonFrame(SkeletonFrame& frame, const Skeleton::EFilteringLevel smoothing);
+	bool getImage(const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber, double& acquisitionTime);
+	// The image of a frame as recorded, before conversion: Kinect::COLOR_STREAM_BYTES of color
+	// or packed depth pixels. False if the recording has no images of the type.
+	bool readImage(const EStreamDataType type, const unsigned int frameNumber, void *dest);
+
+	// Frames in one pass of the recording, before it loops
+	unsigned int getNumFrames() const { return frames.size(); }
+
+	float getNextFrameDelay() const;
+	bool isPaced() const { return speed > 0.f; }
+
+private:
+	// Seconds on the replay clock at which the next frame is due
+	double getNextFrameTime() const;
+
+	unsigned int openImages(std::ifstream& stream, const std::string& name, const unsigned int frameBytes);
+
+	ReplaySource(const ReplaySource& other);
+	ReplaySource& operator=(const ReplaySource& other);
+};
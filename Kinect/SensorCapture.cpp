@@ -0,0 +1,220 @@
+#include "SensorCapture.h"
+#include "Util/MonotonicClock.h"
+#include "Util/Tracer.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	// Longest sleep before checking whether the worker should stop, in seconds
+	const float maxWait = 0.1f;
+}
+
+
+SensorCapture::SensorCapture( const unsigned int index, SensorSource *source, const std::function<void()>& notify )
+	: index(index)
+	, source(source)
+	, notify(notify)
+	, worker()
+	, running(false)
+	, captureImages(false)
+	, smoothing(Skeleton::OFF)
+	, seatedModeToggled(false)
+	, sync()
+	, mutex()
+	, spaceAvailable()
+	, frames()
+	, stats()
+{
+	for (auto& slot : images) {
+		slot.frameNumber = 0;
+		slot.fresh = false;
+		slot.unpublished = false;
+	}
+}
+
+SensorCapture::~SensorCapture()
+{
+	stop();
+	delete source;
+}
+
+bool SensorCapture::start()
+{
+	if (!source->open()) {
+		return false;
+	}
+	for (int type = COLOR; type <= DEPTH; ++type) {
+		unsigned int width, height;
+		source->getImageSize(static_cast<EStreamDataType>(type), width, height);
+		images[type].back.resize(4 * width * height);
+		images[type].ready.resize(4 * width * height);
+	}
+
+	running = true;
+	worker = std::thread(&SensorCapture::run, this);
+	return true;
+}
+
+void SensorCapture::stop()
+{
+	if (!worker.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	spaceAvailable.notify_all();
+	worker.join();
+}
+
+bool SensorCapture::popFrame( SensorSource::SkeletonFrame& frame )
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (frames.empty()) return false;
+		frame = frames.front();
+		frames.pop_front();
+	}
+	spaceAvailable.notify_one();
+	return true;
+}
+
+bool SensorCapture::getImage( const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber )
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	ImageSlot& slot = images[type];
+	if (!slot.fresh) return false;
+	memcpy(dest, &slot.ready[0], slot.ready.size());
+	frameNumber = slot.frameNumber;
+	slot.fresh = false;
+	return true;
+}
+
+bool SensorCapture::getUnpublishedImage( const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber )
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	ImageSlot& slot = images[type];
+	if (!slot.unpublished) return false;
+	memcpy(dest, &slot.ready[0], slot.ready.size());
+	frameNumber = slot.frameNumber;
+	slot.unpublished = false;
+	return true;
+}
+
+SensorCapture::Stats SensorCapture::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void SensorCapture::run()
+{
+	std::stringstream name;
+	name << "capture #" << index;
+	Tracer::setThreadName(name.str());
+
+	sf::Clock clock;
+	SensorSource::SkeletonFrame frame;
+	StreamSync::Bundle bundle;
+	while (running) {
+		waitForSource();
+
+		if (seatedModeToggled.exchange(false)) {
+			source->toggleSeatedMode();
+		}
+
+		const bool withImages = captureImages;
+		sync.setImageStream(COLOR, withImages);
+		sync.setImageStream(DEPTH, withImages);
+
+		clock.restart();
+		const uint64_t captureTime = MonotonicClock::now();
+		if (source->getSkeletonFrame(frame, static_cast<Skeleton::EFilteringLevel>(smoothing.load()))) {
+			const float seconds = clock.getElapsedTime().asSeconds();
+			frame.captureTime = captureTime;
+			sync.pushSkeleton(frame);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			++stats.framesCaptured;
+			stats.captureSeconds += seconds;
+		}
+
+		if (withImages) {
+			for (int type = COLOR; type <= DEPTH; ++type) {
+				ImageSlot& slot = images[type];
+				clock.restart();
+				unsigned int frameNumber = 0;
+				double acquisitionTime = 0.0;
+				if (source->getImage(static_cast<EStreamDataType>(type), &slot.back[0], frameNumber, acquisitionTime)) {
+					const float seconds = clock.getElapsedTime().asSeconds();
+					sync.pushImage(static_cast<EStreamDataType>(type), &slot.back[0], slot.back.size(), frameNumber, acquisitionTime);
+
+					std::lock_guard<std::mutex> lock(mutex);
+					++stats.imagesCaptured;
+					stats.captureSeconds += seconds;
+				}
+			}
+		}
+
+		bool delivered = false;
+		while (sync.popBundle(bundle)) {
+			deliver(bundle);
+			delivered = true;
+		}
+		if (delivered && notify) {
+			notify();
+		}
+	}
+}
+
+void SensorCapture::deliver( StreamSync::Bundle& bundle )
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (bundle.hasSkeleton) {
+		if (!source->isPaced()) {
+			spaceAvailable.wait(lock, [&]() { return frames.size() < QUEUE_CAPACITY || !running; });
+		} else if (frames.size() == QUEUE_CAPACITY) {
+			frames.pop_front();
+			++stats.framesDropped;
+		}
+		frames.push_back(bundle.skeleton);
+		stats.maxQueued = std::max(stats.maxQueued, static_cast<unsigned int>(frames.size()));
+		if (!bundle.complete) ++stats.partialFrames;
+	}
+
+	// The images the frame came with replace any older ones still unread
+	for (int type = COLOR; type <= DEPTH; ++type) {
+		StreamSync::Image& image = bundle.images[type];
+		if (!image.present) continue;
+		ImageSlot& slot = images[type];
+		slot.ready.swap(image.pixels);
+		slot.frameNumber = image.frameNumber;
+		slot.fresh = true;
+		slot.unpublished = true;
+	}
+}
+
+void SensorCapture::waitForSource()
+{
+	const float delay = source->getNextFrameDelay();
+	if (delay == 0.f) return;
+#ifdef _WIN32
+	if (delay < 0.f) {
+		std::vector<HANDLE> events;
+		source->getFrameEvents(events, captureImages);
+		if (!events.empty()) {
+			WaitForMultipleObjects(events.size(), &events[0], FALSE, static_cast<DWORD>(maxWait * 1000.f));
+			return;
+		}
+	}
+#endif
+	// Without events to wait on, poll at a millisecond
+	const float seconds = (delay > 0.f) ? std::min(delay, maxWait) : 0.001f;
+	std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(seconds * 1e6f)));
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "SensorSource.h"
+#include "StreamSync.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Pulls frames from one source on a worker thread of its own, so sensors are
+// read side by side instead of one after the other in the main loop. While
+// images are captured, skeleton frames are held back until the color and
+// depth images of the same moment are in, a frame at most, and are handed
+// out together with them. Skeleton frames wait in a short queue, images
+// replace the previous unread image of their stream. When the queue is full, paced sources lose their oldest frame
+// like a sensor would, sources that hand out frames on every call wait for room.
+class SensorCapture
+{
+public:
+	static const unsigned int QUEUE_CAPACITY = 8;
+
+	struct Stats
+	{
+		unsigned int framesCaptured;
+		unsigned int framesDropped;  // pushed out of a full queue before being read
+		unsigned int imagesCaptured;
+		unsigned int partialFrames;  // skeleton frames handed out without an image captured with them
+		float captureSeconds;        // spent in the source, the rest is waiting
+		unsigned int maxQueued;
+
+		Stats() : framesCaptured(0), framesDropped(0), imagesCaptured(0), partialFrames(0), captureSeconds(0.f), maxQueued(0) {}
+	};
+
+private:
+	struct ImageSlot
+	{
+		std::vector<unsigned char> back;  // written by the worker
+		std::vector<unsigned char> ready; // newest complete image
+		unsigned int frameNumber;
+		bool fresh;                       // ready hasn't been read yet
+		bool unpublished;                 // ready hasn't gone to the frame bus yet
+	};
+
+	const unsigned int index;
+	SensorSource *source;
+	std::function<void()> notify;
+
+	std::thread worker;
+	std::atomic<bool> running;
+	std::atomic<bool> captureImages;
+	std::atomic<int>  smoothing;
+	std::atomic<bool> seatedModeToggled;
+	StreamSync sync;                 // worker only
+
+	mutable std::mutex mutex;
+	std::condition_variable spaceAvailable;
+	std::deque<SensorSource::SkeletonFrame> frames;
+	ImageSlot images[2]; // COLOR, DEPTH
+	Stats stats;
+
+public:
+	// Takes ownership of source, notify is called from the worker after new frames or images
+	SensorCapture(const unsigned int index, SensorSource *source, const std::function<void()>& notify);
+	~SensorCapture();
+
+	// Open the source and start the worker, false if the source failed to open
+	bool start();
+	void stop();
+
+	// Oldest queued skeleton frame, false if there is none
+	bool popFrame(SensorSource::SkeletonFrame& frame);
+	// Copy the newest unread image of a stream, false if there is none
+	bool getImage(const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber);
+	// The same for the frame bus, which sees every image whether or not getImage took it
+	bool getUnpublishedImage(const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber);
+
+	void setCaptureImages(const bool capture) { captureImages = capture; }
+	void setSmoothing(const Skeleton::EFilteringLevel level) { smoothing = level; }
+	void toggleSeatedMode() { seatedModeToggled = true; }
+
+	Stats getStats() const;
+	unsigned int getIndex() const { return index; }
+	const SensorSource& getSource() const { return *source; }
+
+private:
+	void run();
+	// Queue a skeleton frame and make its images the newest
+	void deliver(StreamSync::Bundle& bundle);
+	// Sleep until the source may have something, or a short while to check for stop()
+	void waitForSource();
+
+	SensorCapture(const SensorCapture& other);
+	SensorCapture& operator=(const SensorCapture& other);
+};
@@ -0,0 +1,66 @@
+#pragma once
+#ifdef _WIN32
+#include <Windows.h>
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include "Skeleton.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum EStreamDataType { COLOR, DEPTH };
+
+
+// Where Kinect gets its frames from: a sensor through the Kinect SDK, a
+// replayed recording, ... Sources hand out frames without waiting and
+// without processing beyond what the sensor itself would have done.
+class SensorSource
+{
+public:
+	struct SkeletonFrame
+	{
+		unsigned int frameNumber;
+		double acquisitionTime; // seconds on the source's own clock
+		uint64_t captureTime;   // MonotonicClock::now() as the frame was taken from the source, before smoothing
+		bool hasOrientations;   // false if joint orientations still need solving
+		std::vector<Skeleton::JointFrame> bodies; // every tracked body, in the sensor's space
+
+		SkeletonFrame() : frameNumber(0), acquisitionTime(0.0), captureTime(0), hasOrientations(false), bodies() {}
+	};
+
+	virtual ~SensorSource() {}
+
+	virtual bool open() = 0;
+	virtual std::string getDeviceId() const = 0;
+
+	// Next skeleton frame with positions smoothed at the given level, false if none is ready
+	virtual bool getSkeletonFrame(SkeletonFrame& frame, const Skeleton::EFilteringLevel smoothing) = 0;
+
+	// Copy the next image of a stream to dest as BGRA, false if there is no new image.
+	// Images are stamped on the same clock as the skeleton frames.
+	virtual bool getImage(const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber, double& acquisitionTime) = 0;
+
+	// Image dimensions in pixels, the resolutions the SDK streams are opened at unless overridden
+	virtual void getImageSize(const EStreamDataType type, unsigned int& width, unsigned int& height) const
+	{
+		width  = (type == COLOR) ? 1280 : 640;
+		height = (type == COLOR) ?  960 : 480;
+	}
+
+	virtual void toggleSeatedMode() {}
+
+	// Seconds until the next frame is due for sources that keep their own time,
+	// negative for sources that signal new frames through events
+	virtual float getNextFrameDelay() const { return -1.f; }
+
+	// False for sources that hand out a new frame on every call, whose readers
+	// should hold them back rather than drop frames
+	virtual bool isPaced() const { return true; }
+
+#ifdef _WIN32
+	// Events signaled when a new frame is ready, image events stay signaled until their frames are read
+	virtual void getFrameEvents(std::vector<HANDLE>& events, const bool includeImages) const {}
+#endif
+};
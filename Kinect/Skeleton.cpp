@@ -1,28 +1,60 @@
 #include "Skeleton.h"
+#include "JointFilter.h"
+#include "BoneOrientation.h"
+#include "KeyframeReducer.h"
 #include "Util/RenderUtils.h"
+#include "Util/GLExtensions.h"
+#include "Util/Profiler.h"
+#include "Core/Constants.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <SFML/OpenGL.hpp>
+#include <SFML/System/Clock.hpp>
 #include <SFML/System/Vector3.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <cassert>
+#include <cstring>
 
 
 Skeleton::Skeleton()
 	: visibleJointFrame(nullptr)
 	, currentJointFrame()
+	, otherJointFrames()
 	, jointFrames()
+	, filteredJointFrames()
+	, liveKinematics()
+	, kinematics()
+	, filteredKinematics()
+	, interpolatedJointFrame()
+	, frameTimes()
+	, playbackTime(0.f)
+	, bracketIndex(0)
+	, interpolation(CATMULL_ROM)
+	, sphereMesh(Mesh::sphere(10, 10))
+	, cylinderMesh(Mesh::cylinder(16, 8))
+	, trackedJointBatch(sphereMesh)
+	, inferredJointBatch(sphereMesh)
+	, trackedBoneBatch(cylinderMesh)
+	, inferredBoneBatch(cylinderMesh)
+	, trails(NUM_JOINT_TYPES, constants::trail_capacity)
+	, trailFrameIndex(noTrailFrame)
+	, trailFiltered(false)
 	, loaded(false)
+	, showFiltered(false)
 	, frameIndex(0)
 	, quadric(gluNewQuadric())
 	, renderingFlags(R_JOINTS | R_BONES)
 	, filteringLevel(MEDIUM)
 {
 	visibleJointFrame = &currentJointFrame;
+	trails.setLength(constants::trail_length);
 }
 
 
@@ -34,6 +66,7 @@ Skeleton::~Skeleton()
 void Skeleton::render() const
 {
 	if (visibleJointFrame == nullptr) return;
+	Profiler::Scope scope(Profiler::SKELETON_RENDER);
 
 	glPushMatrix();
 	glTranslatef(0, 1, -1);
@@ -41,14 +74,84 @@ void Skeleton::render() const
 		if (renderingFlags & R_ORIENT) renderOrientations();
 		if (renderingFlags & R_BONES)  renderBones();
 		if (renderingFlags & R_PATH)   renderJointPaths();
+		if (renderingFlags & R_KINEMATICS) renderKinematics();
 	glPopMatrix();
 	glColor3f(1,1,1);
 }
 
+Skeleton::EJointType Skeleton::getParentJoint( EJointType type )
+{
+	static const EJointType parents[NUM_JOINT_TYPES] = {
+		HIP_CENTER,      // HIP_CENTER (root)
+		HIP_CENTER,      // SPINE
+		SPINE,           // SHOULDER_CENTER
+		SHOULDER_CENTER, // HEAD
+		SHOULDER_CENTER, // SHOULDER_LEFT
+		SHOULDER_LEFT,   // ELBOW_LEFT
+		ELBOW_LEFT,      // WRIST_LEFT
+		WRIST_LEFT,      // HAND_LEFT
+		SHOULDER_CENTER, // SHOULDER_RIGHT
+		SHOULDER_RIGHT,  // ELBOW_RIGHT
+		ELBOW_RIGHT,     // WRIST_RIGHT
+		WRIST_RIGHT,     // HAND_RIGHT
+		HIP_CENTER,      // HIP_LEFT
+		HIP_LEFT,        // KNEE_LEFT
+		KNEE_LEFT,       // ANKLE_LEFT
+		ANKLE_LEFT,      // FOOT_LEFT
+		HIP_CENTER,      // HIP_RIGHT
+		HIP_RIGHT,       // KNEE_RIGHT
+		KNEE_RIGHT,      // ANKLE_RIGHT
+		ANKLE_RIGHT      // FOOT_RIGHT
+	};
+	assert(type >= 0 && type < NUM_JOINT_TYPES);
+	return parents[type];
+}
+
+bool Skeleton::readFile( const std::string& filename, JointFrames& frames )
+{
+	// Reduced recordings play back as frames rebuilt from their keys
+	if (KeyframeReducer::isKeyframeFile(filename)) {
+		KeyframeReducer::Keyframes keyframes;
+		if (!KeyframeReducer::load(filename, keyframes)) return false;
+		JointFrames rebuilt;
+		KeyframeReducer::rebuild(keyframes, rebuilt);
+		frames.insert(frames.end(), rebuilt.begin(), rebuilt.end());
+		return true;
+	}
+
+	std::ifstream loadStream;
+	loadStream.open(filename, std::ios::binary | std::ios::in);
+	if (!loadStream.is_open()) return false;
+
+	Skeleton::JointFrame inputJointFrame;
+	Skeleton::Joint joint;
+	int numJointsRead = 0;
+	while (loadStream.good()) {
+		memset(&joint, 0, sizeof(Skeleton::Joint));
+		loadStream.read((char *)&joint, sizeof(Skeleton::Joint));
+		if (loadStream.gcount() != sizeof(Skeleton::Joint)) break;
+		inputJointFrame[joint.type] = joint;
+
+		// Done reading joints for current frame, save it and continue with next frame 
+		if (++numJointsRead == NUM_JOINT_TYPES) {
+			frames.push_back(inputJointFrame);
+			numJointsRead = 0; 
+		}
+	}
+
+	loadStream.close();
+	return true;
+}
+
 bool Skeleton::loadFile( const std::string& filename )
 {
 	if (loaded) {
 		jointFrames.clear();
+		filteredJointFrames.clear();
+		kinematics.frames.clear();
+		filteredKinematics.frames.clear();
+		frameTimes.clear();
+		showFiltered = false;
 		frameIndex = 0;
 		loaded = false;
 	}
@@ -56,40 +159,36 @@ bool Skeleton::loadFile( const std::string& filename )
 	sf::Vector3f mn( 1e30f,  1e30f,  1e30f);
 	sf::Vector3f mx(-1e30f, -1e30f, -1e30f);
 
-	std::ifstream loadStream;
-	loadStream.open(filename, std::ios::binary | std::ios::in);
-	if (loadStream.is_open()) {
-		std::cout << "Opened file: " << filename.c_str() << std::endl
-				  << "Loading joints positions..." << std::endl;
-
-		Skeleton::JointFrame inputJointFrame;    
-		Skeleton::Joint joint;
-		int numJointsRead = 0, totalJointsRead = 0, totalFramesRead = 0;
-		while (loadStream.good()) {
-			memset(&joint, 0, sizeof(Skeleton::Joint));
-			loadStream.read((char *)&joint, sizeof(Skeleton::Joint));
-			inputJointFrame[joint.type] = joint;
-			++totalJointsRead;
-			
-			mn.x = std::min(mn.x, joint.position.x);
-			mn.y = std::min(mn.y, joint.position.y);
-			mn.z = std::min(mn.z, joint.position.z);
-
-			mx.x = std::max(mx.x, joint.position.x);
-			mx.y = std::max(mx.y, joint.position.y);
-			mx.z = std::max(mx.z, joint.position.z);
-
-			// Done reading joints for current frame, save it and continue with next frame 
-			if (++numJointsRead == NUM_JOINT_TYPES) {
-				jointFrames.push_back(inputJointFrame);
-				numJointsRead = 0; 
-				++totalFramesRead;
+	std::cout << "Opening file: " << filename.c_str() << std::endl
+			  << "Loading joints positions..." << std::endl;
+	if (readFile(filename, jointFrames)) {
+		for (const auto& frame : jointFrames) {
+			for (const auto& entry : frame) {
+				const Skeleton::Joint& joint = entry.second;
+				mn.x = std::min(mn.x, joint.position.x);
+				mn.y = std::min(mn.y, joint.position.y);
+				mn.z = std::min(mn.z, joint.position.z);
+
+				mx.x = std::max(mx.x, joint.position.x);
+				mx.y = std::max(mx.y, joint.position.y);
+				mx.z = std::max(mx.z, joint.position.z);
 			}
 		}
 
-		loadStream.close();
+		Kinematics::Samples samples;
+		toSamples(jointFrames, samples);
+		Kinematics::compute(samples, kinematics);
+
+		// Playback needs increasing times, repair duplicated or missing timestamps
+		frameTimes.resize(jointFrames.size());
+		for (unsigned int i = 0; i < jointFrames.size(); ++i) {
+			const float timestamp = jointFrames[i].empty() ? 0.f : jointFrames[i].begin()->second.timestamp;
+			frameTimes[i] = (i > 0 && timestamp <= frameTimes[i - 1]) ? frameTimes[i - 1] + 1.f / 30.f : timestamp;
+		}
+		bracketIndex = 0;
+
 		loaded = true;
-		std::cout << "Loaded " << totalJointsRead << " joints in " << totalFramesRead << " frames." << std::endl
+		std::cout << "Loaded " << jointFrames.size() * NUM_JOINT_TYPES << " joints in " << jointFrames.size() << " frames." << std::endl
 				  << "Done loading skeleton data from '" << filename.c_str() << "'." << std::endl;
 	}
 
@@ -106,21 +205,215 @@ bool Skeleton::loadFile( const std::string& filename )
 	}
 
 	frameIndex = 0;
-	if (loaded) {
-		visibleJointFrame = &jointFrames[frameIndex];
-	} else {
-		visibleJointFrame = &currentJointFrame;
-	}
+	updateVisibleFrame();
 
 	return loaded;
 }
 
+bool Skeleton::saveFile( const std::string& filename ) const
+{
+	const JointFrames& frames = getVisibleFrames();
+	if (frames.empty()) return false;
+
+	std::ofstream saveStream;
+	saveStream.open(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!saveStream.is_open()) {
+		std::cerr << "Failed to open '" << filename.c_str() << "' for saving." << std::endl;
+		return false;
+	}
+
+	// Same layout Kinect writes while recording: every joint of a frame in joint type order
+	for (const auto& frame : frames) {
+		for (const auto& entry : frame) {
+			saveStream.write((const char *)&entry.second, sizeof(Skeleton::Joint));
+		}
+	}
+	saveStream.close();
+
+	std::cout << "Saved " << frames.size() << " frames to '" << filename.c_str() << "'." << std::endl;
+	return true;
+}
+
 void Skeleton::clearLoadedFrames()
 {
 	if (!loaded) return;
 	frameIndex = 0;
 	jointFrames.clear();
-	visibleJointFrame = &currentJointFrame;
+	filteredJointFrames.clear();
+	kinematics.frames.clear();
+	filteredKinematics.frames.clear();
+	frameTimes.clear();
+	bracketIndex = 0;
+	showFiltered = false;
+	updateVisibleFrame();
+}
+
+void Skeleton::refilter( EFilteringLevel level )
+{
+	if (!loaded) return;
+
+	sf::Clock clock;
+	JointFilter::applyParallel(jointFrames, filteredJointFrames, JointFilter::getParameters(level));
+	Kinematics::Samples samples;
+	toSamples(filteredJointFrames, samples);
+	Kinematics::compute(samples, filteredKinematics);
+	std::cout << "Re-filtered " << jointFrames.size() << " frames in "
+	          << clock.getElapsedTime().asSeconds() << " seconds." << std::endl;
+
+	showFiltered = true;
+	updateVisibleFrame();
+}
+
+void Skeleton::toggleFilteredTrack()
+{
+	if (!hasFilteredFrames()) return;
+	showFiltered = !showFiltered;
+	updateVisibleFrame();
+}
+
+void Skeleton::recomputeOrientations()
+{
+	if (!loaded) return;
+
+	sf::Clock clock;
+	BoneOrientation::apply(jointFrames);
+	if (hasFilteredFrames()) {
+		BoneOrientation::apply(filteredJointFrames);
+	}
+	std::cout << "Recomputed bone orientations for " << jointFrames.size() << " frames in "
+	          << clock.getElapsedTime().asSeconds() << " seconds." << std::endl;
+}
+
+void Skeleton::updateLiveFrame()
+{
+	Kinematics::Sample sample;
+	toSample(currentJointFrame, sample);
+	liveKinematics.update(sample);
+
+	if (visibleJointFrame == &currentJointFrame) {
+		appendTrails(currentJointFrame);
+	}
+}
+
+const Kinematics::Frame& Skeleton::getVisibleKinematics() const
+{
+	const Kinematics::Track& track = getVisibleKinematicTrack();
+	if (loaded && frameIndex < track.frames.size()) {
+		return track.frames[frameIndex];
+	}
+	return liveKinematics.getLatest();
+}
+
+const Kinematics::Extrema& Skeleton::getVisibleKinematicExtrema() const
+{
+	const Kinematics::Track& track = getVisibleKinematicTrack();
+	if (loaded && !track.frames.empty()) {
+		return track.extrema;
+	}
+	return liveKinematics.getExtrema();
+}
+
+void Skeleton::benchmarkKinematics() const
+{
+	const JointFrames& frames = getVisibleFrames();
+	if (frames.empty()) return;
+
+	sf::Clock clock;
+	Kinematics::Samples samples;
+	toSamples(frames, samples);
+	std::cout << "Gathered " << frames.size() << " frames into kinematics samples in "
+	          << clock.getElapsedTime().asSeconds() * 1e6f / frames.size() << " us per frame" << std::endl;
+
+	Kinematics::benchmark(samples);
+}
+
+void Skeleton::toSample( const JointFrame& frame, Kinematics::Sample& sample )
+{
+	memset(&sample, 0, sizeof(Kinematics::Sample));
+	for (const auto& entry : frame) {
+		const Joint& joint = entry.second;
+		const unsigned int j = entry.first;
+		if (j >= Kinematics::NUM_JOINTS) continue;
+		sample.position[0][j] = joint.position.x;
+		sample.position[1][j] = joint.position.y;
+		sample.position[2][j] = joint.position.z;
+		sample.timestamp[j]   = joint.timestamp;
+		sample.tracked[j]     = (joint.trackingState != NOT_TRACKED) ? 1.f : 0.f;
+	}
+}
+
+void Skeleton::toSamples( const JointFrames& frames, Kinematics::Samples& samples )
+{
+	samples.resize(frames.size());
+	for (unsigned int i = 0; i < frames.size(); ++i) {
+		toSample(frames[i], samples[i]);
+	}
+}
+
+void Skeleton::updateVisibleFrame()
+{
+	JointFrames& frames = getVisibleFrames();
+	if (loaded && frameIndex < frames.size()) {
+		visibleJointFrame = &frames[frameIndex];
+		playbackTime = frameTimes[frameIndex];
+	} else {
+		visibleJointFrame = &currentJointFrame;
+	}
+	updateTrails();
+}
+
+void Skeleton::updateTrails()
+{
+	const JointFrames& frames = getVisibleFrames();
+	if (visibleJointFrame == &currentJointFrame || frameIndex >= frames.size()) {
+		// Live frames append themselves, drop what was left from a recording
+		if (trailFrameIndex != noTrailFrame) {
+			trails.reset();
+			trailFrameIndex = noTrailFrame;
+		}
+		return;
+	}
+	if (trailFrameIndex == frameIndex && trailFiltered == showFiltered) return;
+
+	const unsigned int length = trails.getLength();
+	const unsigned int firstFrame = (frameIndex + 1 > length) ? frameIndex + 1 - length : 0;
+	const bool forward = trailFrameIndex != noTrailFrame && trailFiltered == showFiltered && trailFrameIndex < frameIndex;
+	if (forward && trailFrameIndex + 1 >= firstFrame) {
+		for (unsigned int i = trailFrameIndex + 1; i <= frameIndex; ++i) {
+			appendTrails(frames[i]);
+		}
+	} else {
+		trails.reset();
+		for (unsigned int i = firstFrame; i <= frameIndex; ++i) {
+			appendTrails(frames[i]);
+		}
+	}
+	trailFrameIndex = frameIndex;
+	trailFiltered = showFiltered;
+}
+
+void Skeleton::appendTrails( const JointFrame& frame )
+{
+	// Joints the sensor lost hold their last position rather than jumping to the origin
+	glm::vec3 positions[NUM_JOINT_TYPES];
+	for (unsigned int i = 0; i < NUM_JOINT_TYPES; ++i) {
+		const auto it = frame.find((EJointType) i);
+		if (it != frame.end() && (it->second.trackingState != NOT_TRACKED || trails.getCount() == 0)) {
+			positions[i] = it->second.position;
+		} else {
+			positions[i] = trails.getNewest(i);
+		}
+	}
+	trails.append(positions);
+}
+
+void Skeleton::setTrailLength( const unsigned int length )
+{
+	if (length == trails.getLength()) return;
+	trails.setLength(length);
+	// Longer trails need older frames, rebuild from the loaded ones
+	trailFrameIndex = noTrailFrame;
+	updateTrails();
 }
 
 void Skeleton::nextFrame()
@@ -131,7 +424,7 @@ void Skeleton::nextFrame()
 	const int numFrames = jointFrames.size();
 	if (nextFrame >= 0 && nextFrame < numFrames) {
 		frameIndex = nextFrame;
-		visibleJointFrame = &jointFrames[frameIndex];
+		updateVisibleFrame();
 	}
 }
 
@@ -143,7 +436,7 @@ void Skeleton::prevFrame()
 	const int numFrames = jointFrames.size();
 	if (prevFrame >= 0 && prevFrame < numFrames) {
 		frameIndex = prevFrame;
-		visibleJointFrame = &jointFrames[frameIndex];
+		updateVisibleFrame();
 	}
 }
 
@@ -153,10 +446,318 @@ void Skeleton::setFrameIndex( const float fraction )
 	assert(fraction >= 0.f && fraction <= 1.f);
 
 	frameIndex = static_cast<int>(floor(fraction * jointFrames.size()));
-	visibleJointFrame = &jointFrames[frameIndex];
+	updateVisibleFrame();
+}
+
+float Skeleton::getFrameSpacing() const
+{
+	if (frameTimes.size() < 2) return 1.f / 30.f;
+	return (frameTimes.back() - frameTimes.front()) / (frameTimes.size() - 1);
+}
+
+unsigned int Skeleton::findBracket( const float time ) const
+{
+	const unsigned int last = frameTimes.size() - 1;
+
+	// Sequential playback stays in the same bracket or moves to the next one
+	unsigned int i = std::min(bracketIndex, last);
+	if (frameTimes[i] <= time) {
+		if (i == last || time < frameTimes[i + 1]) return i;
+		if (i + 1 == last || time < frameTimes[i + 2]) return bracketIndex = i + 1;
+	}
+
+	const auto it = std::upper_bound(frameTimes.begin(), frameTimes.end(), time);
+	i = (it == frameTimes.begin()) ? 0 : static_cast<unsigned int>(it - frameTimes.begin()) - 1;
+	return bracketIndex = i;
+}
+
+void Skeleton::evaluate( const float time, const EInterpolation mode, JointFrame& frame ) const
+{
+	const JointFrames& frames = getVisibleFrames();
+	if (frames.empty() || frameTimes.size() != frames.size()) {
+		frame.clear();
+		return;
+	}
+
+	const unsigned int last = frames.size() - 1;
+	const unsigned int i1 = findBracket(time);
+	const unsigned int i2 = std::min(i1 + 1, last);
+	const float t = (i2 > i1) ? glm::clamp((time - frameTimes[i1]) / (frameTimes[i2] - frameTimes[i1]), 0.f, 1.f) : 0.f;
+
+	if (mode == NEAREST || i1 == i2) {
+		frame = frames[(t < 0.5f) ? i1 : i2];
+		return;
+	}
+
+	const JointFrame& f0 = frames[(i1 > 0) ? i1 - 1 : i1];
+	const JointFrame& f1 = frames[i1];
+	const JointFrame& f2 = frames[i2];
+	const JointFrame& f3 = frames[std::min(i2 + 1, last)];
+
+	for (const auto& entry : f1) {
+		const EJointType type = entry.first;
+		const Joint& j1 = entry.second;
+		Joint& joint = frame[type];
+
+		// Interpolating to or from an untracked joint would invent positions
+		const auto it2 = f2.find(type);
+		if (it2 == f2.end() || j1.trackingState == NOT_TRACKED || it2->second.trackingState == NOT_TRACKED) {
+			joint = (t < 0.5f || it2 == f2.end()) ? j1 : it2->second;
+			joint.timestamp = time;
+			continue;
+		}
+		const Joint& j2 = it2->second;
+
+		glm::vec3 position = glm::mix(j1.position, j2.position, t);
+		if (mode == CATMULL_ROM) {
+			// Neighbours outside the recording or untracked repeat the bracketing joints
+			const auto it0 = f0.find(type);
+			const auto it3 = f3.find(type);
+			const glm::vec3& p0 = (it0 != f0.end() && it0->second.trackingState != NOT_TRACKED) ? it0->second.position : j1.position;
+			const glm::vec3& p3 = (it3 != f3.end() && it3->second.trackingState != NOT_TRACKED) ? it3->second.position : j2.position;
+			const glm::vec3& p1 = j1.position;
+			const glm::vec3& p2 = j2.position;
+			const float t2 = t * t;
+			const float t3 = t2 * t;
+			position = 0.5f * ((2.f * p1)
+			                 + (p2 - p0) * t
+			                 + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2
+			                 + (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+		}
+
+		// q and -q are the same rotation, slerp along the shorter arc
+		const glm::quat q1 = glm::quat_cast(glm::mat3(j1.orientation));
+		glm::quat q2 = glm::quat_cast(glm::mat3(j2.orientation));
+		if (glm::dot(q1, q2) < 0.f) q2 = -q2;
+
+		joint.timestamp     = time;
+		joint.position      = position;
+		joint.orientation   = glm::mat4_cast(glm::slerp(q1, q2, t));
+		joint.type          = type;
+		joint.trackingState = (t < 0.5f) ? j1.trackingState : j2.trackingState;
+	}
+}
+
+void Skeleton::advancePlayback( const float seconds )
+{
+	if (!loaded || frameTimes.empty()) return;
+
+	const float start = frameTimes.front();
+	const float duration = frameTimes.back() - start;
+	playbackTime += seconds;
+	if (playbackTime > frameTimes.back() || playbackTime < start) {
+		playbackTime = (duration > 0.f) ? start + fmod(playbackTime - start, duration) : start;
+		if (playbackTime < start) playbackTime += duration;
+	}
+
+	evaluate(playbackTime, interpolation, interpolatedJointFrame);
+	frameIndex = findBracket(playbackTime);
+	visibleJointFrame = &interpolatedJointFrame;
+	updateTrails();
+}
+
+void Skeleton::benchmarkPlayback() const
+{
+	if (!loaded || frameTimes.size() < 2) return;
+
+	// Six skeletons played back at a 120 Hz display over the whole recording
+	const unsigned int numSkeletons = 6;
+	const float displayRate = 120.f;
+	const float start = frameTimes.front();
+	const float duration = frameTimes.back() - start;
+	const unsigned int numDisplayFrames = std::max(1u, static_cast<unsigned int>(duration * displayRate));
+	static const char *names[] = { "nearest", "linear", "catmull-rom" };
+
+	JointFrame frame;
+	std::cout << "Playback evaluation over " << numDisplayFrames << " display frames at " << displayRate << " Hz:" << std::endl;
+	for (auto mode = 0; mode <= CATMULL_ROM; ++mode) {
+		sf::Clock clock;
+		for (unsigned int i = 0; i < numDisplayFrames; ++i) {
+			for (unsigned int s = 0; s < numSkeletons; ++s) {
+				evaluate(start + i / displayRate, static_cast<EInterpolation>(mode), frame);
+			}
+		}
+		const float sequential = clock.getElapsedTime().asSeconds() / (numDisplayFrames * numSkeletons);
+
+		// Jumping around the recording defeats the cached bracket and falls back to a search
+		clock.restart();
+		for (unsigned int i = 0; i < numDisplayFrames; ++i) {
+			evaluate(start + ((i * 7919u) % numDisplayFrames) / displayRate, static_cast<EInterpolation>(mode), frame);
+		}
+		const float random = clock.getElapsedTime().asSeconds() / numDisplayFrames;
+
+		std::cout << "  " << names[mode] << ": " << sequential * 1e6f << " us sequential, "
+		          << random * 1e6f << " us random access, six skeletons use "
+		          << 100.f * numSkeletons * sequential * displayRate << "% of a display frame" << std::endl;
+	}
+	bracketIndex = frameIndex;
+}
+
+void Skeleton::updateRenderBatches()
+{
+	trackedJointBatch.clear();
+	inferredJointBatch.clear();
+	trackedBoneBatch.clear();
+	inferredBoneBatch.clear();
+	if (visibleJointFrame == nullptr) return;
+
+	addToRenderBatches(*visibleJointFrame);
+	if (visibleJointFrame == &currentJointFrame) {
+		for (const auto& joints : otherJointFrames) {
+			addToRenderBatches(joints);
+		}
+	}
+
+	trackedJointBatch.upload();
+	inferredJointBatch.upload();
+	trackedBoneBatch.upload();
+	inferredBoneBatch.upload();
+}
+
+void Skeleton::addToRenderBatches( const JointFrame& joints )
+{
+	// Same sizes renderJointsImmediate and renderBoneImmediate use
+	static const float trackedJointRadius  = 0.03f;
+	static const float inferredJointRadius = 0.01f;
+	static const float trackedBoneRadius   = 0.04f;
+	static const float inferredBoneRadius  = 0.02f;
+
+	if (renderingFlags & R_JOINTS) {
+		for (const auto& entry : joints) {
+			const Joint& joint = entry.second;
+			if (joint.trackingState == NOT_TRACKED) continue;
+			if (joint.trackingState == INFERRED && !(renderingFlags & R_INFER)) continue;
+
+			const bool tracked = (joint.trackingState == TRACKED);
+			const float radius = tracked ? trackedJointRadius : inferredJointRadius;
+			const glm::mat4 transform(glm::scale(glm::translate(glm::mat4(1.f), joint.position), glm::vec3(radius)));
+			(tracked ? trackedJointBatch : inferredJointBatch).add(transform);
+		}
+	}
+
+	if (renderingFlags & R_BONES) {
+		for (auto i = 0; i < NUM_JOINT_TYPES; ++i) {
+			const EJointType type = (EJointType) i;
+			if (type == HIP_CENTER) continue;
+
+			const auto from = joints.find(getParentJoint(type));
+			const auto to   = joints.find(type);
+			if (from == joints.end() || to == joints.end()) continue;
+			const ETrackingState fromState = from->second.trackingState;
+			const ETrackingState toState   = to->second.trackingState;
+			if (fromState == NOT_TRACKED || toState == NOT_TRACKED) continue;
+			if (fromState == INFERRED && toState == INFERRED) continue;
+
+			const bool tracked = (fromState == TRACKED && toState == TRACKED);
+			const float radius = tracked ? trackedBoneRadius : inferredBoneRadius;
+			glm::mat4 transform;
+			glm::mat3 normalTransform;
+			if (!getBoneTransform(from->second.position, to->second.position, radius, transform, normalTransform)) continue;
+			(tracked ? trackedBoneBatch : inferredBoneBatch).add(transform);
+		}
+	}
+}
+
+bool Skeleton::getBoneTransform( const glm::vec3& fromPosition, const glm::vec3& toPosition, const float radius,
+                                 glm::mat4& transform, glm::mat3& normalTransform )
+{
+	// Unit cylinder runs along z from the child joint to the parent joint
+	const float boneLength = glm::distance(fromPosition, toPosition);
+	if (boneLength < 1e-6f) return false;
+	const glm::vec3 z(0,0,1);
+	const glm::vec3 dir((fromPosition - toPosition) / boneLength);
+	const glm::vec3 axis = glm::cross(z, dir);
+	glm::mat4 rotation(1.f);
+	if (glm::length(axis) > 1e-6f) {
+		rotation = glm::rotate(glm::mat4(1.f), glm::degrees(acos(glm::clamp(glm::dot(z, dir), -1.f, 1.f))), glm::normalize(axis));
+	} else if (dir.z < 0.f) {
+		rotation = glm::rotate(glm::mat4(1.f), 180.f, glm::vec3(1,0,0));
+	}
+
+	transform = glm::scale(glm::translate(glm::mat4(1.f), toPosition) * rotation, glm::vec3(radius, radius, boneLength));
+	normalTransform = glm::mat3(rotation);
+	return true;
 }
 
 void Skeleton::renderJoints() const
+{
+	static const GLfloat diffuseRed[]   = { 1.0f, 0.0f, 0.0f, 1.0f };
+	static const GLfloat diffuseGreen[] = { 0.0f, 1.0f, 0.0f, 1.0f };
+	static const GLfloat diffuseWhite[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuseGreen);
+	trackedJointBatch.draw();
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuseRed);
+	inferredJointBatch.draw();
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuseWhite);
+}
+
+void Skeleton::renderBones() const
+{
+	static const GLfloat diffuseRed[]   = { 1.0f, 0.0f, 0.0f, 1.0f };
+	static const GLfloat diffuseGood[]  = { 1.0f, 0.85f, 0.73f, 1.0f };
+	static const GLfloat diffuseWhite[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuseGood);
+	trackedBoneBatch.draw();
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuseRed);
+	inferredBoneBatch.draw();
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuseWhite);
+}
+
+void Skeleton::benchmarkRendering()
+{
+	if (visibleJointFrame == nullptr) return;
+	const unsigned int numIterations = 500;
+	const unsigned int numPasses = 2; // reflection and normal
+
+	// GLU emits one begin/end block per sphere stack, one per cylinder stack and one per disk
+	const unsigned int sphereStacks = 10, cylinderStacks = 8;
+	unsigned int numJoints = 0, numBones = 0;
+	for (const auto& entry : *visibleJointFrame) {
+		if (entry.second.trackingState == TRACKED || (entry.second.trackingState == INFERRED && (renderingFlags & R_INFER))) ++numJoints;
+	}
+
+	glPushMatrix();
+	glTranslatef(0, 1, -1);
+	glFinish();
+
+	sf::Clock clock;
+	for (unsigned int i = 0; i < numIterations; ++i) {
+		for (unsigned int pass = 0; pass < numPasses; ++pass) {
+			renderJointsImmediate();
+			renderBonesImmediate();
+		}
+	}
+	glFinish();
+	const float immediateSeconds = clock.getElapsedTime().asSeconds();
+
+	clock.restart();
+	for (unsigned int i = 0; i < numIterations; ++i) {
+		updateRenderBatches();
+		for (unsigned int pass = 0; pass < numPasses; ++pass) {
+			renderJoints();
+			renderBones();
+		}
+	}
+	glFinish();
+	const float batchedSeconds = clock.getElapsedTime().asSeconds();
+	glPopMatrix();
+
+	numBones = trackedBoneBatch.getNumInstances() + inferredBoneBatch.getNumInstances();
+	const unsigned int immediateBlocks = numPasses * (numJoints * sphereStacks + numBones * (cylinderStacks + 2));
+	const unsigned int batchedDraws = numPasses * ((trackedJointBatch.empty() ? 0 : 1) + (inferredJointBatch.empty() ? 0 : 1)
+	                                             + (trackedBoneBatch.empty()  ? 0 : 1) + (inferredBoneBatch.empty()  ? 0 : 1));
+
+	std::cout << "Skeleton rendering of " << numJoints << " joints and " << numBones << " bones, "
+	          << numPasses << " passes per frame:" << std::endl
+	          << "  immediate: " << immediateSeconds * 1000.f / numIterations << " ms per frame, "
+	          << immediateBlocks << " glBegin/glEnd blocks" << std::endl
+	          << "  batched:   " << batchedSeconds * 1000.f / numIterations << " ms per frame, "
+	          << batchedDraws << " draw calls, " << (GLExtensions::hasBufferObjects() ? "vertex buffers" : "vertex arrays") << std::endl;
+}
+
+void Skeleton::renderJointsImmediate() const
 {
 	// Sphere parameters for joint primitive
 	static const double minRadius = 0.01;
@@ -228,7 +829,7 @@ void Skeleton::renderOrientations() const
 	}
 }
 
-void Skeleton::renderBone( EJointType fromType, EJointType toType ) const
+void Skeleton::renderBoneImmediate( EJointType fromType, EJointType toType ) const
 {
 	// Cylinder parameters for bone primitive
 	static const double minRadius = 0.02;
@@ -300,47 +901,28 @@ void Skeleton::renderBone( EJointType fromType, EJointType toType ) const
 	glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuseWhite);
 }
 
-void Skeleton::renderBones() const
+void Skeleton::renderBonesImmediate() const
 {
-	// Render head and shoulders
-	renderBone(HEAD, SHOULDER_CENTER);
-	renderBone(SHOULDER_CENTER, SHOULDER_LEFT);
-	renderBone(SHOULDER_CENTER, SHOULDER_RIGHT);
-
-	// Render left arm
-	renderBone(SHOULDER_LEFT, ELBOW_LEFT);
-	renderBone(ELBOW_LEFT, WRIST_LEFT);
-	renderBone(WRIST_LEFT, HAND_LEFT);
-
-	// Render right arm
-	renderBone(SHOULDER_RIGHT, ELBOW_RIGHT);
-	renderBone(ELBOW_RIGHT, WRIST_RIGHT);
-	renderBone(WRIST_RIGHT, HAND_RIGHT);
-
-	// Render torso
-	renderBone(SHOULDER_CENTER, SPINE);
-	renderBone(SPINE, HIP_CENTER);
-	renderBone(HIP_CENTER, HIP_RIGHT);
-	renderBone(HIP_CENTER, HIP_LEFT);
-
-	// Render left leg
-	renderBone(HIP_LEFT, KNEE_LEFT);
-	renderBone(KNEE_LEFT, ANKLE_LEFT);
-	renderBone(ANKLE_LEFT, FOOT_LEFT);
+	// One bone from each joint to its parent: torso, head, arms and legs
+	for (auto i = 0; i < NUM_JOINT_TYPES; ++i) {
+		const EJointType type = (EJointType) i;
+		if (type == HIP_CENTER) continue;
+		renderBoneImmediate(getParentJoint(type), type);
+	}
+}
 
-	// Render right leg
-	renderBone(HIP_RIGHT, KNEE_RIGHT);
-	renderBone(KNEE_RIGHT, ANKLE_RIGHT);
-	renderBone(ANKLE_RIGHT, FOOT_RIGHT);
+void Skeleton::renderJointPaths() const
+{
+	trails.draw(glm::vec3(1,1,0));
 }
 
-// TODO - update this for greater flexibility, number of historical frames to draw, fade out, etc...
-void Skeleton::renderJointPath( const EJointType type ) const
+void Skeleton::renderJointPathImmediate( const EJointType type, const unsigned int numFrames ) const
 {
-	if (!loaded) return;
+	const JointFrames& frames = getVisibleFrames();
+	if (!loaded || frameIndex >= frames.size()) return;
 
-	const unsigned int numFrames = 20;
-	const unsigned int lastFrame = ((frameIndex - numFrames) < 0) ? 0 : (frameIndex - numFrames);
+	// Unsigned, so compare before subtracting rather than testing for a negative difference
+	const unsigned int lastFrame = (frameIndex > numFrames) ? (frameIndex - numFrames) : 0;
 
 	glDisable(GL_LIGHTING);
 
@@ -348,7 +930,7 @@ void Skeleton::renderJointPath( const EJointType type ) const
 	glPushMatrix();
 	glBegin(GL_LINE_STRIP);
 		for (auto i = lastFrame; i <= frameIndex; ++i) {
-			glVertex3fv(glm::value_ptr(jointFrames[i].at(type).position));
+			glVertex3fv(glm::value_ptr(frames[i].at(type).position));
 		}
 	glEnd();
 	glPopMatrix();
@@ -357,9 +939,104 @@ void Skeleton::renderJointPath( const EJointType type ) const
 	glEnable(GL_LIGHTING);
 }
 
-void Skeleton::renderJointPaths() const
+void Skeleton::renderJointPathsImmediate( const unsigned int numFrames ) const
+{
+	for (auto i = 0; i < NUM_JOINT_TYPES; ++i) {
+		renderJointPathImmediate((EJointType) i, numFrames);
+	}
+}
+
+void Skeleton::benchmarkTrails()
 {
+	const JointFrames& frames = getVisibleFrames();
+	if (!loaded || frames.size() < 2) return;
+	const unsigned int numIterations = 100;
+	const unsigned int lengths[] = { constants::trail_length, 600, constants::trail_capacity };
+
+	const unsigned int savedIndex = frameIndex;
+	const unsigned int savedLength = trails.getLength();
+
+	std::cout << "Joint trails of " << NUM_JOINT_TYPES << " joints over " << frames.size() << " frames:" << std::endl;
+
+	// Appending is the per frame cost of keeping the trails current, independent of length
+	sf::Clock clock;
+	trails.reset();
+	for (const auto& frame : frames) {
+		appendTrails(frame);
+	}
+	std::cout << "  append: " << clock.getElapsedTime().asSeconds() * 1e6f / frames.size() << " us per frame" << std::endl;
+
+	glPushMatrix();
+	glTranslatef(0, 1, -1);
+	for (const auto length : lengths) {
+		// Draw from the end of the recording so every length is full where the recording allows
+		frameIndex = frames.size() - 1;
+		trails.setLength(length);
+		trailFrameIndex = noTrailFrame;
+		updateTrails();
+		const unsigned int numVertices = std::min<unsigned int>(length, frames.size());
+		glFinish();
+
+		clock.restart();
+		for (unsigned int i = 0; i < numIterations; ++i) {
+			renderJointPathsImmediate(numVertices - 1);
+		}
+		glFinish();
+		const float immediateSeconds = clock.getElapsedTime().asSeconds();
+
+		clock.restart();
+		for (unsigned int i = 0; i < numIterations; ++i) {
+			renderJointPaths();
+		}
+		glFinish();
+		const float trailSeconds = clock.getElapsedTime().asSeconds();
+
+		std::cout << "  " << numVertices << " frames: immediate "
+		          << immediateSeconds * 1000.f / numIterations << " ms, "
+		          << NUM_JOINT_TYPES * numVertices << " glVertex calls; trail buffer "
+		          << trailSeconds * 1000.f / numIterations << " ms, "
+		          << (GLExtensions::hasMultiDraw() ? "1 draw call" : "one draw call per strip") << std::endl;
+	}
+	glPopMatrix();
+
+	frameIndex = savedIndex;
+	trails.setLength(savedLength);
+	trailFrameIndex = noTrailFrame;
+	updateVisibleFrame();
+}
+
+void Skeleton::renderKinematics() const
+{
+	// Seconds of motion shown by each vector, acceleration changes much faster than position
+	static const float velocityScale     = 0.1f;
+	static const float accelerationScale = 0.01f;
+
+	const JointFrame& joints = *visibleJointFrame;
+	const Kinematics::Frame& frame = getVisibleKinematics();
+	const Kinematics::Extrema& extrema = getVisibleKinematicExtrema();
+
+	glDisable(GL_LIGHTING);
+	glBegin(GL_LINES);
 	for (auto i = 0; i < NUM_JOINT_TYPES; ++i) {
-		renderJointPath((EJointType) i);
+		const auto it = joints.find((EJointType) i);
+		if (it == joints.end() || it->second.trackingState == NOT_TRACKED) continue;
+		if (it->second.trackingState == INFERRED && !(renderingFlags & R_INFER)) continue;
+		const glm::vec3& position = it->second.position;
+
+		// Velocity from blue (still) to red (fastest this joint gets over the track)
+		if (frame.hasVelocity(i)) {
+			const float t = (extrema.maxSpeed[i] > 0.f) ? frame.speed[i] / extrema.maxSpeed[i] : 0.f;
+			glColor3f(t, 0.f, 1.f - t);
+			glVertex3fv(glm::value_ptr(position));
+			glVertex3fv(glm::value_ptr(position + frame.getVelocity(i) * velocityScale));
+		}
+		if (frame.hasAcceleration(i)) {
+			glColor3f(1.f, 0.f, 1.f);
+			glVertex3fv(glm::value_ptr(position));
+			glVertex3fv(glm::value_ptr(position + frame.getAcceleration(i) * accelerationScale));
+		}
 	}
+	glEnd();
+	glColor3f(1,1,1);
+	glEnable(GL_LIGHTING);
 }
@@ -1,13 +1,20 @@
 #pragma once
+#ifdef _WIN32
 #include <Windows.h>
 #define WIN32_LEAN_AND_MEAN
+#endif
 
 #include <SFML/OpenGL.hpp>
 
 #include <glm/glm.hpp>
 
+#include "Kinematics.h"
+#include "Util/MeshBatch.h"
+#include "Util/TrailBuffer.h"
+
 #include <vector>
 #include <map>
+#include <string>
 
 
 class Skeleton
@@ -51,6 +58,13 @@ public:
 		HIGH   = (MEDIUM + 1)
 	};
 
+	// Position interpolation between recorded frames, orientations are always slerped
+	enum EInterpolation {
+		NEAREST     = 0,
+		LINEAR      = (NEAREST + 1),
+		CATMULL_ROM = (LINEAR  + 1)
+	};
+
 	typedef struct tag_joint {
 		float     timestamp; // in seconds
 
@@ -63,6 +77,15 @@ public:
 
 	typedef std::map<EJointType, Joint> JointFrame;
 	typedef std::vector<JointFrame>     JointFrames;
+
+	// Bone hierarchy rooted at HIP_CENTER, each joint ends the bone from its parent.
+	// Parents always have a lower joint type than their children.
+	static EJointType getParentJoint(EJointType type);
+
+	// Place the unit cylinder along z as a bone of the given radius from the child joint
+	// to the parent joint, with the rotation for its normals. False if the joints coincide.
+	static bool getBoneTransform(const glm::vec3& fromPosition, const glm::vec3& toPosition, const float radius,
+	                             glm::mat4& transform, glm::mat3& normalTransform);
 	
 	// Rendering flags == [R_JOINTS | R_ORIENT | R_BONES | R_INFER]
 	// ------------------------------------------------------------
@@ -70,20 +93,49 @@ public:
 	// R_ORIENT = skeleton joint orientations
 	// R_BONES  = connections between skeleton joints
 	// R_INFER  = draw inferred joints/bones
-	// R_PATH   = draw path of particular joints over time
-	static const byte R_JOINTS = 0x01;
-	static const byte R_INFER  = 0x02;
-	static const byte R_ORIENT = 0x04;
-	static const byte R_BONES  = 0x08;
-	static const byte R_PATH   = 0x10;
-	typedef byte RenderingFlags;
+	// R_PATH   = draw fading trails of every joint over recent frames
+	// R_KINEMATICS = draw joint velocity and acceleration vectors
+	static const unsigned char R_JOINTS = 0x01;
+	static const unsigned char R_INFER  = 0x02;
+	static const unsigned char R_ORIENT = 0x04;
+	static const unsigned char R_BONES  = 0x08;
+	static const unsigned char R_PATH   = 0x10;
+	static const unsigned char R_KINEMATICS = 0x20;
+	typedef unsigned char RenderingFlags;
 
 private:
 	JointFrame *visibleJointFrame;
 	JointFrame  currentJointFrame;
+	JointFrames otherJointFrames;    // further people seen live, drawn along with currentJointFrame
 	JointFrames jointFrames;
+	JointFrames filteredJointFrames; // loaded frames re-filtered offline
+
+	Kinematics liveKinematics;             // of currentJointFrame, as frames arrive
+	Kinematics::Track kinematics;          // of jointFrames, computed on load
+	Kinematics::Track filteredKinematics;  // of filteredJointFrames
+
+	JointFrame interpolatedJointFrame;     // visible track evaluated between frames during playback
+	std::vector<float> frameTimes;         // timestamp of every loaded frame, strictly increasing
+	float playbackTime;
+	mutable unsigned int bracketIndex;     // last frame at or before the previously evaluated time
+	EInterpolation interpolation;
+
+	// Retained geometry, unit meshes copied into one batch and one draw per material
+	Mesh sphereMesh;
+	Mesh cylinderMesh;
+	MeshBatch trackedJointBatch;
+	MeshBatch inferredJointBatch;
+	MeshBatch trackedBoneBatch;
+	MeshBatch inferredBoneBatch;
+
+	// Recent positions of every joint, one appended per new frame
+	TrailBuffer trails;
+	unsigned int trailFrameIndex;          // last loaded frame appended, noTrailFrame when live
+	bool trailFiltered;                    // which track it came from
+	static const unsigned int noTrailFrame = 0xFFFFFFFF;
 
 	bool loaded;
+	bool showFiltered;
 	unsigned int frameIndex;
 	GLUquadric *quadric;
 
@@ -94,18 +146,64 @@ public:
 	Skeleton();
 	~Skeleton();
 
+	// Rebuild the joint and bone batches from the visible frame, once per
+	// frame before render(), which can then be called any number of times
+	void updateRenderBatches();
 	void render() const;
+	// Time immediate mode against batched joints and bones, two passes per frame like Application::draw
+	void benchmarkRendering();
+	// Time immediate mode joint paths against appending to and drawing the trail buffer
+	void benchmarkTrails();
 	bool isLoaded() const { return loaded; }
 	bool loadFile(const std::string& filename);
+	static bool readFile(const std::string& filename, JointFrames& frames);
+	bool saveFile(const std::string& filename) const;
 	void clearLoadedFrames();
 
+	// Re-filter the loaded frames with the given level into a side-by-side track
+	void refilter(EFilteringLevel level);
+	bool hasFilteredFrames() const { return !filteredJointFrames.empty(); }
+	void toggleFilteredTrack();
+
+	// Replace the stored bone orientations of the loaded frames with solved ones
+	void recomputeOrientations();
+
+	// Differentiate currentJointFrame and extend the live trails,
+	// call once it holds a complete new frame
+	void updateLiveFrame();
+	// Derivatives of the visible frame and extrema over its track, no recomputation
+	const Kinematics::Frame& getVisibleKinematics() const;
+	const Kinematics::Extrema& getVisibleKinematicExtrema() const;
+	// Time kinematics of the loaded frames, including gathering them into samples
+	void benchmarkKinematics() const;
+
 	void nextFrame();
 	void prevFrame();
 
+	// Evaluate the visible track at any time within the recording
+	void evaluate(const float time, const EInterpolation mode, JointFrame& frame) const;
+	// Move playback forward by the given recording time, looping at the end,
+	// and show the frame evaluated there
+	void advancePlayback(const float seconds);
+	float getPlaybackTime() const { return playbackTime; }
+	float getFrameSpacing() const;
+	// Time evaluate() for playback of six skeletons at display rate
+	void benchmarkPlayback() const;
+
+	// Number of recent frames each joint trail shows, at most constants::trail_capacity
+	void setTrailLength(const unsigned int length);
+	unsigned int getTrailLength() const { return trails.getLength(); }
+
+	void setInterpolation(EInterpolation mode) { interpolation = mode; }
+	EInterpolation getInterpolation() const    { return interpolation; }
+
 	void setFrameIndex(const float fraction);
 	unsigned int getFrameIndex() const { return frameIndex;         }
 	unsigned int getNumFrames()  const { return jointFrames.size(); }
+	const JointFrames& getJointFrames() const { return jointFrames; }
 	JointFrame& getCurrentJointFrame() { return currentJointFrame;  }
+	JointFrames& getOtherJointFrames() { return otherJointFrames;   }
+	const JointFrame& getVisibleJointFrame() const { return *visibleJointFrame; }
 	const Joint& getCurrentRightHand() { return currentJointFrame.at(HAND_RIGHT); }
 	const Joint& getCurrentLeftHand()  { return currentJointFrame.at(HAND_LEFT);  }
 
@@ -116,6 +214,7 @@ public:
 	void toggleBones()                    { renderingFlags ^= R_BONES;  }
 	void toggleInferred()                 { renderingFlags ^= R_INFER;  }
 	void toggleJointPath()                { renderingFlags ^= R_PATH;   }
+	void toggleKinematics()               { renderingFlags ^= R_KINEMATICS; }
 
 	void clearRenderFlags()               { renderingFlags  = 0;   }
 	void setRenderFlags(RenderingFlags f) { renderingFlags  = f;   }
@@ -125,14 +224,35 @@ public:
 	EFilteringLevel getFilterLevel() const     { return filteringLevel;  }
 
 private:
-	void renderJoints() const;
+	JointFrames& getVisibleFrames()             { return showFiltered ? filteredJointFrames : jointFrames; }
+	const JointFrames& getVisibleFrames() const { return showFiltered ? filteredJointFrames : jointFrames; }
+	const Kinematics::Track& getVisibleKinematicTrack() const { return showFiltered ? filteredKinematics : kinematics; }
+	void updateVisibleFrame();
+	// Bring the trails up to frameIndex, appending when playback moved forward
+	// on the same track and rebuilding from the loaded frames otherwise
+	void updateTrails();
+	void appendTrails(const JointFrame& frame);
+	unsigned int findBracket(const float time) const;
 
-	void renderBone(EJointType fromType, EJointType toType) const;
+	void addToRenderBatches(const JointFrame& joints);
+	void renderJoints() const;
 	void renderBones() const;
 
-	void renderJointPath(const EJointType type) const;
+	// Per primitive GLU rendering, kept as the reference for benchmarkRendering()
+	void renderJointsImmediate() const;
+	void renderBoneImmediate(EJointType fromType, EJointType toType) const;
+	void renderBonesImmediate() const;
+
 	void renderJointPaths() const;
+	// Per vertex paths through the loaded frames, kept as the reference for benchmarkTrails()
+	void renderJointPathImmediate(const EJointType type, const unsigned int numFrames) const;
+	void renderJointPathsImmediate(const unsigned int numFrames) const;
 
 	void renderOrientations() const;
+
+	void renderKinematics() const;
+
+	static void toSample(const JointFrame& frame, Kinematics::Sample& sample);
+	static void toSamples(const JointFrames& frames, Kinematics::Samples& samples);
 };
 
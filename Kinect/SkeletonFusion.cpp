@@ -0,0 +1,424 @@
+#include "SkeletonFusion.h"
+#include "SyntheticSource.h"
+#include "Core/Constants.h"
+#include "Util/Random.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+	const float defaultMaxRootDistance = 0.5f; // meters
+
+	// Inferred joints are guessed by the sensor, let any view that tracked them win
+	const float trackedWeight  = 1.f;
+	const float inferredWeight = 0.2f;
+
+	float getWeight(const Skeleton::ETrackingState state)
+	{
+		switch (state) {
+			case Skeleton::TRACKED:  return trackedWeight;
+			case Skeleton::INFERRED: return inferredWeight;
+			default:                 return 0.f;
+		}
+	}
+
+	bool byId(const SkeletonFusion::Person& a, const SkeletonFusion::Person& b)
+	{
+		return a.id < b.id;
+	}
+
+	// Rotation about the vertical axis through center
+	glm::mat4 turnAround(const glm::vec3& center, const float angle)
+	{
+		const float c = std::cos(angle);
+		const float s = std::sin(angle);
+		glm::mat4 m(1.f);
+		m[0] = glm::vec4(  c, 0.f,  -s, 0.f);
+		m[2] = glm::vec4(  s, 0.f,   c, 0.f);
+		const glm::vec3 rotated(c * center.x + s * center.z, center.y, -s * center.x + c * center.z);
+		m[3] = glm::vec4(center - rotated, 1.f);
+		return m;
+	}
+
+	glm::vec3 transformPoint(const glm::mat4& m, const glm::vec3& p)
+	{
+		const glm::vec4 q(m * glm::vec4(p, 1.f));
+		return glm::vec3(q.x, q.y, q.z);
+	}
+}
+
+
+SkeletonFusion::SkeletonFusion()
+	: extrinsics()
+	, maxRootDistance(defaultMaxRootDistance)
+	, nextId(0)
+	, tracks()
+	, views()
+	, numViews(0)
+	, clusters()
+	, costs()
+	, assignment()
+{}
+
+void SkeletonFusion::setExtrinsic( const unsigned int sensor, const glm::mat4& sensorToWorld )
+{
+	if (sensor >= extrinsics.size()) {
+		extrinsics.resize(sensor + 1, glm::mat4(1.f));
+	}
+	extrinsics[sensor] = sensorToWorld;
+}
+
+glm::mat4 SkeletonFusion::getExtrinsic( const unsigned int sensor ) const
+{
+	return (sensor < extrinsics.size()) ? extrinsics[sensor] : glm::mat4(1.f);
+}
+
+bool SkeletonFusion::loadCalibration( const std::string& filename )
+{
+	std::ifstream file(filename.c_str());
+	if (!file) {
+		std::cerr << "Failed to open calibration '" << filename << "'" << std::endl;
+		return false;
+	}
+
+	unsigned int numLoaded = 0;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+
+		std::istringstream ss(line);
+		unsigned int sensor;
+		float values[16];
+		ss >> sensor;
+		for (int i = 0; i < 16; ++i) ss >> values[i];
+		if (!ss) {
+			std::cerr << "Calibration '" << filename << "' has a bad line: " << line << std::endl;
+			return false;
+		}
+
+		// Written row by row, glm stores columns
+		glm::mat4 sensorToWorld;
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				sensorToWorld[column][row] = values[4 * row + column];
+			}
+		}
+		setExtrinsic(sensor, sensorToWorld);
+		++numLoaded;
+	}
+
+	std::cout << "Loaded calibration of " << numLoaded << " sensors from '" << filename << "'" << std::endl;
+	return true;
+}
+
+bool SkeletonFusion::getRoot( const Skeleton::JointFrame& joints, glm::vec3& root )
+{
+	// Fall back up the spine if the hips are lost
+	static const Skeleton::EJointType candidates[] = { Skeleton::HIP_CENTER, Skeleton::SPINE, Skeleton::SHOULDER_CENTER };
+	for (auto type : candidates) {
+		auto it = joints.find(type);
+		if (it != joints.end() && it->second.trackingState != Skeleton::NOT_TRACKED) {
+			root = it->second.position;
+			return true;
+		}
+	}
+	return false;
+}
+
+void SkeletonFusion::fuse( const std::vector<const SensorSource::SkeletonFrame *>& frames, People& people )
+{
+	// Every body in world space
+	numViews = 0;
+	for (unsigned int sensor = 0; sensor < frames.size(); ++sensor) {
+		if (frames[sensor] == nullptr) continue;
+		const SensorSource::SkeletonFrame& frame = *frames[sensor];
+
+		const glm::mat4 sensorToWorld(getExtrinsic(sensor));
+		glm::mat4 rotation(sensorToWorld);
+		rotation[3] = glm::vec4(0.f, 0.f, 0.f, 1.f);
+
+		for (auto& body : frame.bodies) {
+			if (numViews == views.size()) {
+				views.push_back(View());
+			}
+			View& view = views[numViews];
+			view.sensor = sensor;
+			view.hasOrientations = frame.hasOrientations;
+			view.joints.clear();
+			for (auto& entry : body) {
+				Skeleton::Joint& joint = view.joints[entry.first];
+				joint = entry.second;
+				joint.position    = transformPoint(sensorToWorld, joint.position);
+				joint.orientation = rotation * joint.orientation;
+			}
+			if (getRoot(view.joints, view.root)) {
+				++numViews;
+			}
+		}
+	}
+
+	// Match each sensor's bodies to the people seen by the sensors before it,
+	// one to one so two bodies of the same sensor are never merged
+	clusters.clear();
+	for (unsigned int begin = 0, end = 0; begin < numViews; begin = end) {
+		while (end < numViews && views[end].sensor == views[begin].sensor) ++end;
+
+		const unsigned int numRows = end - begin;
+		const unsigned int numColumns = clusters.size();
+		costs.resize(numRows * numColumns);
+		for (unsigned int i = 0; i < numRows; ++i) {
+			for (unsigned int j = 0; j < numColumns; ++j) {
+				costs[i * numColumns + j] = glm::distance(views[begin + i].root, clusters[j].root);
+			}
+		}
+		assign(costs, numRows, numColumns, maxRootDistance, assignment);
+
+		for (unsigned int i = 0; i < numRows; ++i) {
+			const int j = assignment[i];
+			if (j >= 0 && costs[i * numColumns + j] < maxRootDistance) {
+				Cluster& cluster = clusters[j];
+				const float n = static_cast<float>(cluster.views.size());
+				cluster.root = (n * cluster.root + views[begin + i].root) / (n + 1.f);
+				cluster.views.push_back(begin + i);
+			} else {
+				clusters.push_back(Cluster());
+				clusters.back().views.push_back(begin + i);
+				clusters.back().root = views[begin + i].root;
+			}
+		}
+	}
+
+	people.resize(clusters.size());
+	for (unsigned int i = 0; i < clusters.size(); ++i) {
+		merge(clusters[i], people[i]);
+	}
+
+	// Keep the ids of the people of the last frame that are still close by
+	const unsigned int numRows = people.size();
+	const unsigned int numColumns = tracks.size();
+	costs.resize(numRows * numColumns);
+	for (unsigned int i = 0; i < numRows; ++i) {
+		for (unsigned int j = 0; j < numColumns; ++j) {
+			costs[i * numColumns + j] = glm::distance(people[i].root, tracks[j].root);
+		}
+	}
+	assign(costs, numRows, numColumns, maxRootDistance, assignment);
+
+	for (unsigned int i = 0; i < numRows; ++i) {
+		const int j = assignment[i];
+		people[i].id = (j >= 0 && costs[i * numColumns + j] < maxRootDistance) ? tracks[j].id : nextId++;
+	}
+	std::sort(people.begin(), people.end(), byId);
+	tracks.resize(numRows);
+	for (unsigned int i = 0; i < numRows; ++i) {
+		tracks[i].id   = people[i].id;
+		tracks[i].root = people[i].root;
+	}
+}
+
+void SkeletonFusion::merge( const Cluster& cluster, Person& person ) const
+{
+	person.root     = cluster.root;
+	person.numViews = cluster.views.size();
+
+	// A single view is passed through as it is, orientations included
+	const View& first = views[cluster.views[0]];
+	if (cluster.views.size() == 1) {
+		person.joints = first.joints;
+		person.hasOrientations = first.hasOrientations;
+		return;
+	}
+
+	// Orientations of different sensors don't average, they are solved again from the merged positions
+	person.hasOrientations = false;
+	// Every joint any view has, seeded from the first view that has it and
+	// averaged over the views from there on, the ones before it lack it
+	person.joints.clear();
+	for (unsigned int v = 0; v < cluster.views.size(); ++v) {
+		for (auto& entry : views[cluster.views[v]].joints) {
+			if (person.joints.find(entry.first) != person.joints.end()) continue;
+
+			float totalWeight = 0.f;
+			glm::vec3 position(0.f);
+			Skeleton::ETrackingState state = Skeleton::NOT_TRACKED;
+			for (unsigned int w = v; w < cluster.views.size(); ++w) {
+				const View& view = views[cluster.views[w]];
+				auto it = view.joints.find(entry.first);
+				if (it == view.joints.end()) continue;
+				const Skeleton::Joint& joint = it->second;
+				const float weight = getWeight(joint.trackingState);
+				position    += weight * joint.position;
+				totalWeight += weight;
+				state = std::max(state, joint.trackingState);
+			}
+
+			Skeleton::Joint& joint = person.joints[entry.first];
+			joint = entry.second;
+			joint.orientation   = glm::mat4(1.f);
+			joint.trackingState = state;
+			if (totalWeight > 0.f) {
+				joint.position = position / totalWeight;
+			}
+		}
+	}
+}
+
+void SkeletonFusion::assign( const std::vector<float>& costs, const unsigned int numRows, const unsigned int numColumns,
+                             const float unmatchedCost, std::vector<int>& assignment )
+{
+	assignment.assign(numRows, -1);
+	if (numRows == 0 || numColumns == 0) return;
+
+	// Hungarian method on a square matrix, padded with a column per row for
+	// leaving it unmatched and rows for columns nobody takes. Indices start
+	// at 1, column 0 holds the row being added.
+	const unsigned int n = numRows + numColumns;
+	std::vector<float> u(n + 1, 0.f), v(n + 1, 0.f), minCost(n + 1);
+	std::vector<unsigned int> rowOf(n + 1, 0), previous(n + 1, 0);
+	std::vector<bool> used(n + 1);
+
+	for (unsigned int row = 1; row <= n; ++row) {
+		rowOf[0] = row;
+		unsigned int column = 0;
+		std::fill(minCost.begin(), minCost.end(), std::numeric_limits<float>::max());
+		std::fill(used.begin(), used.end(), false);
+		do {
+			used[column] = true;
+			const unsigned int i = rowOf[column];
+			float delta = std::numeric_limits<float>::max();
+			unsigned int next = 0;
+			for (unsigned int j = 1; j <= n; ++j) {
+				if (used[j]) continue;
+				float cost = 0.f;
+				if (i <= numRows) {
+					cost = (j <= numColumns) ? costs[(i - 1) * numColumns + (j - 1)] : unmatchedCost;
+				}
+				const float reduced = cost - u[i] - v[j];
+				if (reduced < minCost[j]) {
+					minCost[j]  = reduced;
+					previous[j] = column;
+				}
+				if (minCost[j] < delta) {
+					delta = minCost[j];
+					next  = j;
+				}
+			}
+			for (unsigned int j = 0; j <= n; ++j) {
+				if (used[j]) {
+					u[rowOf[j]] += delta;
+					v[j] -= delta;
+				} else {
+					minCost[j] -= delta;
+				}
+			}
+			column = next;
+		} while (rowOf[column] != 0);
+
+		// Shift the rows along the augmenting path
+		do {
+			const unsigned int next = previous[column];
+			rowOf[column] = rowOf[next];
+			column = next;
+		} while (column != 0);
+	}
+
+	for (unsigned int j = 1; j <= numColumns; ++j) {
+		if (rowOf[j] <= numRows) {
+			assignment[rowOf[j] - 1] = j - 1;
+		}
+	}
+}
+
+void SkeletonFusion::benchmark( const unsigned int numSensors, const unsigned int numBodies, const unsigned int numFrames )
+{
+	// Noise free people in front of sensor 0, which is world space
+	SyntheticSource::Options options;
+	options.numBodies    = numBodies;
+	options.frameRate    = 0.f;
+	options.noise        = 0.f;
+	options.inferredRate = 0.f;
+	options.dropoutRate  = 0.f;
+	SyntheticSource truth(options);
+	if (!truth.open()) return;
+
+	// Sensors spread evenly around the group
+	const glm::vec3 center(0.f, 0.17f, 2.65f);
+	SkeletonFusion fusion;
+	std::vector<glm::mat4> worldToSensor(numSensors);
+	for (unsigned int s = 0; s < numSensors; ++s) {
+		const float angle = constants::two_pi * s / numSensors;
+		fusion.setExtrinsic(s, turnAround(center, angle));
+		worldToSensor[s] = turnAround(center, -angle);
+	}
+
+	// What each sensor reports, in its own order, with its own jitter and inferred
+	// joints, missing a body now and then
+	std::vector<std::vector<SensorSource::SkeletonFrame> > input(numFrames, std::vector<SensorSource::SkeletonFrame>(numSensors));
+	std::vector<unsigned int> numVisible(numFrames, 0);
+	Random random;
+	SensorSource::SkeletonFrame frame;
+	for (unsigned int f = 0; f < numFrames; ++f) {
+		truth.getSkeletonFrame(frame, Skeleton::OFF);
+		std::vector<bool> visible(frame.bodies.size(), false);
+		for (unsigned int s = 0; s < numSensors; ++s) {
+			SensorSource::SkeletonFrame& seen = input[f][s];
+			seen.frameNumber     = frame.frameNumber;
+			seen.acquisitionTime = frame.acquisitionTime;
+			seen.hasOrientations = false;
+			for (unsigned int i = 0; i < frame.bodies.size(); ++i) {
+				const unsigned int b = (i + s) % frame.bodies.size();
+				if (random.signedUniform() > 0.8f) continue;
+				visible[b] = true;
+
+				seen.bodies.push_back(frame.bodies[b]);
+				for (auto& entry : seen.bodies.back()) {
+					Skeleton::Joint& joint = entry.second;
+					const bool inferred = random.signedUniform() > 0.94f;
+					const float amount = inferred ? 0.04f : 0.01f;
+					joint.trackingState = inferred ? Skeleton::INFERRED : Skeleton::TRACKED;
+					joint.position = transformPoint(worldToSensor[s], joint.position)
+					               + amount * glm::vec3(random.signedUniform(), random.signedUniform(), random.signedUniform());
+				}
+			}
+		}
+		numVisible[f] = std::count(visible.begin(), visible.end(), true);
+	}
+
+	sf::Clock clock;
+	People people;
+	std::vector<const SensorSource::SkeletonFrame *> frames(numSensors);
+	float totalSeconds = 0.f;
+	float worstSeconds = 0.f;
+	unsigned int numCorrect = 0;
+	unsigned int totalViews = 0;
+	unsigned int totalPeople = 0;
+	for (unsigned int f = 0; f < numFrames; ++f) {
+		for (unsigned int s = 0; s < numSensors; ++s) {
+			frames[s] = &input[f][s];
+		}
+		clock.restart();
+		fusion.fuse(frames, people);
+		const float seconds = clock.getElapsedTime().asSeconds();
+		totalSeconds += seconds;
+		worstSeconds = std::max(worstSeconds, seconds);
+
+		if (people.size() == numVisible[f]) ++numCorrect;
+		for (auto& person : people) totalViews += person.numViews;
+		totalPeople += people.size();
+	}
+
+	const float budget = 0.001f;
+	const float averageSeconds = totalSeconds / numFrames;
+	std::cout << "Fused " << numFrames << " frames of " << numSensors << " sensors x " << numBodies << " bodies" << std::endl
+	          << "  average: " << 1000.f * averageSeconds << " ms, worst: " << 1000.f * worstSeconds << " ms, "
+	          << ((averageSeconds < budget) ? "within" : "OVER") << " the " << 1000.f * budget << " ms budget" << std::endl
+	          << "  right number of people in " << 100.f * numCorrect / numFrames << "% of frames, "
+	          << static_cast<float>(totalViews) / std::max(totalPeople, 1u) << " views per person" << std::endl;
+}
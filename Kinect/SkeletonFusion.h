@@ -0,0 +1,93 @@
+#pragma once
+#include "Skeleton.h"
+#include "SensorSource.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+
+// Merges the bodies several sensors see into one world space skeleton per
+// person. Each sensor's bodies are moved into world space by its calibrated
+// extrinsic matrix, then matched sensor by sensor to the people found so far
+// by an optimal assignment on root joint distance. Matched bodies are averaged
+// joint by joint, tracked joints outweighing inferred ones. People keep their
+// id from frame to frame as long as their root stays close.
+class SkeletonFusion
+{
+public:
+	struct Person
+	{
+		unsigned int id;
+		glm::vec3 root;
+		Skeleton::JointFrame joints;
+		unsigned int numViews;       // sensors that saw this person
+		bool hasOrientations;        // false if orientations still need solving
+	};
+	typedef std::vector<Person> People;
+
+private:
+	struct View
+	{
+		unsigned int sensor;
+		Skeleton::JointFrame joints; // in world space
+		glm::vec3 root;
+		bool hasOrientations;
+	};
+
+	struct Cluster
+	{
+		std::vector<unsigned int> views;
+		glm::vec3 root;              // mean of the views' roots
+	};
+
+	struct Track
+	{
+		unsigned int id;
+		glm::vec3 root;
+	};
+
+	std::vector<glm::mat4> extrinsics; // sensor to world, identity if not calibrated
+	float maxRootDistance;
+	unsigned int nextId;
+	std::vector<Track> tracks;         // people of the last frame
+
+	// Reused from frame to frame
+	std::vector<View> views;
+	unsigned int numViews;
+	std::vector<Cluster> clusters;
+	std::vector<float> costs;
+	std::vector<int> assignment;
+
+public:
+	SkeletonFusion();
+
+	void setExtrinsic(const unsigned int sensor, const glm::mat4& sensorToWorld);
+	glm::mat4 getExtrinsic(const unsigned int sensor) const;
+
+	// One matrix per line, a sensor index followed by 16 numbers row by row,
+	// lines starting with # are skipped. False if the file can't be read.
+	bool loadCalibration(const std::string& filename);
+
+	// Bodies further apart than this, in meters, are never the same person
+	void setMaxRootDistance(const float meters) { maxRootDistance = meters; }
+
+	// frames[i] is the newest frame of sensor i, or null to leave it out.
+	// people is replaced, sorted by id.
+	void fuse(const std::vector<const SensorSource::SkeletonFrame *>& frames, People& people);
+
+	// Cheapest one to one assignment of rows to columns for a row major cost
+	// matrix, leaving a row unmatched costs unmatchedCost. assignment[row] is
+	// its column or -1.
+	static void assign(const std::vector<float>& costs, const unsigned int numRows, const unsigned int numColumns,
+	                   const float unmatchedCost, std::vector<int>& assignment);
+
+	// Time fusing generated people seen by several sensors around a room
+	// against the 1 ms per frame budget and check how many were matched up
+	static void benchmark(const unsigned int numSensors = 3, const unsigned int numBodies = 6, const unsigned int numFrames = 1000);
+
+private:
+	static bool getRoot(const Skeleton::JointFrame& joints, glm::vec3& root);
+	void merge(const Cluster& cluster, Person& person) const;
+};
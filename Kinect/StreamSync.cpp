@@ -0,0 +1,316 @@
+#include "StreamSync.h"
+#include "Util/Random.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+	// Frame periods a stream may stay quiet before bundles stop waiting for it
+	const double silentPeriods = 10.0;
+}
+
+
+StreamSync::StreamSync( const float frameRate )
+	: framePeriod(1.0 / frameRate)
+	, skeletons()
+	, skeletonSeen(false)
+	, lastSkeletonTime(0.0)
+	, spare()
+	, latestTime(0.0)
+	, stats()
+{
+	for (auto& stream : streams) {
+		stream.enabled  = true;
+		stream.seen     = false;
+		stream.lastTime = 0.0;
+	}
+}
+
+void StreamSync::setImageStream( const EStreamDataType type, const bool enabled )
+{
+	Stream& stream = streams[type];
+	if (stream.enabled == enabled) return;
+	stream.enabled = enabled;
+	stream.seen = false;
+	for (auto& buffered : stream.buffer) {
+		recycle(buffered.pixels);
+	}
+	stream.buffer.clear();
+}
+
+void StreamSync::pushSkeleton( const SensorSource::SkeletonFrame& frame )
+{
+	skeletons.push_back(frame);
+	skeletonSeen = true;
+	lastSkeletonTime = std::max(lastSkeletonTime, frame.acquisitionTime);
+	latestTime = std::max(latestTime, frame.acquisitionTime);
+}
+
+void StreamSync::pushImage( const EStreamDataType type, const unsigned char *pixels, const unsigned int size,
+                            const unsigned int frameNumber, const double acquisitionTime )
+{
+	Stream& stream = streams[type];
+	if (!stream.enabled) return;
+
+	if (stream.buffer.size() == MAX_BUFFERED) {
+		recycle(stream.buffer.front().pixels);
+		stream.buffer.pop_front();
+		++stats.imagesDropped;
+	}
+
+	// Kept in time order, a stream hands out its images in order anyway
+	auto it = stream.buffer.end();
+	while (it != stream.buffer.begin() && (it - 1)->acquisitionTime > acquisitionTime) --it;
+	it = stream.buffer.insert(it, Buffered());
+	it->frameNumber     = frameNumber;
+	it->acquisitionTime = acquisitionTime;
+	if (!spare.empty()) {
+		it->pixels.swap(spare.back());
+		spare.pop_back();
+	}
+	it->pixels.resize(size);
+	memcpy(&it->pixels[0], pixels, size);
+
+	stream.seen     = true;
+	stream.lastTime = std::max(stream.lastTime, acquisitionTime);
+	latestTime      = std::max(latestTime, acquisitionTime);
+}
+
+bool StreamSync::popBundle( Bundle& bundle )
+{
+	if (skeletons.empty()) {
+		return isQuiet(skeletonSeen, lastSkeletonTime) && popImages(bundle);
+	}
+	const double time = skeletons.front().acquisitionTime;
+
+	// Wait until every stream expected has an image at or past the frame, but
+	// no longer than until the next skeleton frame or a frame period of data
+	const bool overdue = skeletons.size() > 1 || latestTime >= time + framePeriod;
+	bool expected[2];
+	for (int type = COLOR; type <= DEPTH; ++type) {
+		const Stream& stream = streams[type];
+		expected[type] = stream.enabled && isExpected(stream);
+		const bool caughtUp = !stream.buffer.empty() && stream.buffer.back().acquisitionTime >= time;
+		if (expected[type] && !caughtUp && !overdue) return false;
+	}
+
+	bundle.hasSkeleton = true;
+	std::swap(bundle.skeleton, skeletons.front());
+	skeletons.pop_front();
+	bundle.complete = true;
+
+	const double maxOffset = 0.5 * framePeriod;
+	for (int type = COLOR; type <= DEPTH; ++type) {
+		Stream& stream = streams[type];
+		Image& image = bundle.images[type];
+		image.present = false;
+
+		// Closest within half a frame, images older than it can no longer match
+		int best = -1;
+		double bestOffset = maxOffset;
+		for (unsigned int i = 0; i < stream.buffer.size(); ++i) {
+			const double offset = std::abs(stream.buffer[i].acquisitionTime - time);
+			if (offset <= bestOffset) {
+				best = i;
+				bestOffset = offset;
+			}
+		}
+		unsigned int numUsed = 0;
+		while (numUsed < stream.buffer.size() && stream.buffer[numUsed].acquisitionTime < time - maxOffset) ++numUsed;
+		if (best >= 0) {
+			Buffered& match = stream.buffer[best];
+			image.present         = true;
+			image.frameNumber     = match.frameNumber;
+			image.acquisitionTime = match.acquisitionTime;
+			image.pixels.swap(match.pixels);
+			numUsed = best + 1;
+			++stats.imagesMatched;
+			stats.maxOffset = std::max(stats.maxOffset, bestOffset);
+		}
+		for (unsigned int i = 0; i < numUsed; ++i) {
+			if (static_cast<int>(i) != best) ++stats.imagesDropped;
+			recycle(stream.buffer.front().pixels);
+			stream.buffer.pop_front();
+		}
+
+		if (expected[type] && !image.present) {
+			bundle.complete = false;
+		}
+	}
+
+	++stats.bundles;
+	if (!bundle.complete) ++stats.partial;
+	return true;
+}
+
+void StreamSync::clear()
+{
+	skeletons.clear();
+	skeletonSeen = false;
+	for (auto& stream : streams) {
+		for (auto& buffered : stream.buffer) {
+			recycle(buffered.pixels);
+		}
+		stream.buffer.clear();
+		stream.seen = false;
+	}
+	latestTime = 0.0;
+}
+
+bool StreamSync::isExpected( const Stream& stream ) const
+{
+	return !isQuiet(stream.seen, stream.lastTime);
+}
+
+bool StreamSync::isQuiet( const bool seen, const double lastTime ) const
+{
+	return !seen || latestTime - lastTime >= silentPeriods * framePeriod;
+}
+
+bool StreamSync::popImages( Bundle& bundle )
+{
+	bool any = false;
+	for (int type = COLOR; type <= DEPTH; ++type) {
+		Stream& stream = streams[type];
+		Image& image = bundle.images[type];
+		image.present = !stream.buffer.empty();
+		if (!image.present) continue;
+
+		// Only the newest is worth showing
+		Buffered& newest = stream.buffer.back();
+		image.frameNumber     = newest.frameNumber;
+		image.acquisitionTime = newest.acquisitionTime;
+		image.pixels.swap(newest.pixels);
+		stats.imagesDropped += stream.buffer.size() - 1;
+		for (auto& buffered : stream.buffer) {
+			recycle(buffered.pixels);
+		}
+		stream.buffer.clear();
+		any = true;
+	}
+	bundle.hasSkeleton = false;
+	bundle.complete = false;
+	return any;
+}
+
+void StreamSync::recycle( std::vector<unsigned char>& pixels )
+{
+	if (pixels.capacity() == 0 || spare.size() > 2 * MAX_BUFFERED) return;
+	spare.push_back(std::vector<unsigned char>());
+	spare.back().swap(pixels);
+}
+
+void StreamSync::benchmark( const unsigned int numFrames )
+{
+	static const float jitters[] = { 0.f, 0.005f, 0.01f, 0.02f, 0.03f }; // seconds
+	static const double period = 1.0 / 30.0;
+	static const double lossRate = 0.02;
+	static const unsigned int imageBytes = 4 * 80 * 60;
+
+	// Skeleton frames are computed from the depth image and share its stamp,
+	// color is exposed a little later on a camera of its own. Depth arrives
+	// first, the skeleton after its processing, color after its conversion.
+	static const int SKELETON = -1;
+	static const double baseDelays[] = { 0.015, 0.005, 0.01 }; // COLOR, DEPTH, skeleton
+
+	struct Arrival
+	{
+		double time;
+		int stream;              // COLOR, DEPTH or SKELETON
+		unsigned int frameNumber;
+		double acquisitionTime;
+
+		bool operator<(const Arrival& other) const { return time < other.time; }
+	};
+
+	std::cout << std::fixed << std::setprecision(1)
+	          << "Replayed " << numFrames << " frames of 30 Hz skeleton, color and depth streams, "
+	          << 100.0 * lossRate << "% of images lost:" << std::endl
+	          << std::setw(10) << "jitter ms" << std::setw(12) << "aligned %" << std::setw(12) << "newest %"
+	          << std::setw(12) << "partial %" << std::setw(8) << "wrong"
+	          << std::setw(14) << "avg wait ms" << std::setw(14) << "max wait ms" << std::endl;
+
+	for (auto jitter : jitters) {
+		Random random;
+		std::vector<Arrival> arrivals;
+		double lastArrivals[3] = { 0.0, 0.0, 0.0 };
+		for (unsigned int f = 0; f < numFrames; ++f) {
+			const double time = f * period;
+			for (int stream = SKELETON; stream <= DEPTH; ++stream) {
+				if (stream != SKELETON && random.uniform() < lossRate) continue;
+
+				Arrival arrival;
+				arrival.stream          = stream;
+				arrival.frameNumber     = f;
+				arrival.acquisitionTime = (stream == COLOR) ? time + 0.008 + 0.004 * (random.uniform() - 0.5) : time;
+
+				// Each stream is delivered in order, out of step with the others
+				double& lastArrival = lastArrivals[stream + 1];
+				arrival.time = std::max(lastArrival, time + baseDelays[(stream == SKELETON) ? 2 : stream] + jitter * random.uniform());
+				lastArrival = arrival.time;
+				arrivals.push_back(arrival);
+			}
+		}
+		std::stable_sort(arrivals.begin(), arrivals.end());
+
+		StreamSync sync;
+		Bundle bundle;
+		SensorSource::SkeletonFrame frame;
+		std::vector<unsigned char> pixels(imageBytes);
+		std::vector<double> skeletonArrivals(numFrames, 0.0);
+		unsigned int newest[2] = { 0xFFFFFFFF, 0xFFFFFFFF };
+		unsigned int numAligned = 0, numNewestAligned = 0, numWrong = 0;
+		double waitSum = 0.0, maxWait = 0.0;
+
+		for (const auto& arrival : arrivals) {
+			if (arrival.stream == SKELETON) {
+				// What pairing every skeleton frame with the newest images would show
+				if (newest[COLOR] == arrival.frameNumber && newest[DEPTH] == arrival.frameNumber) ++numNewestAligned;
+
+				frame.frameNumber = arrival.frameNumber;
+				frame.acquisitionTime = arrival.acquisitionTime;
+				skeletonArrivals[arrival.frameNumber] = arrival.time;
+				sync.pushSkeleton(frame);
+			} else {
+				// Pixels carry their frame number, to check they travel with it
+				memcpy(&pixels[0], &arrival.frameNumber, sizeof(arrival.frameNumber));
+				newest[arrival.stream] = arrival.frameNumber;
+				sync.pushImage(static_cast<EStreamDataType>(arrival.stream), &pixels[0], imageBytes, arrival.frameNumber, arrival.acquisitionTime);
+			}
+
+			while (sync.popBundle(bundle)) {
+				if (!bundle.hasSkeleton) continue;
+				const unsigned int frameNumber = bundle.skeleton.frameNumber;
+				const double wait = arrival.time - skeletonArrivals[frameNumber];
+				waitSum += wait;
+				maxWait = std::max(maxWait, wait);
+
+				unsigned int numMatched = 0;
+				for (int type = COLOR; type <= DEPTH; ++type) {
+					const Image& image = bundle.images[type];
+					if (!image.present) continue;
+					unsigned int pixelFrame;
+					memcpy(&pixelFrame, &image.pixels[0], sizeof(pixelFrame));
+					if (image.frameNumber == frameNumber && pixelFrame == frameNumber) ++numMatched;
+					else                                                               ++numWrong;
+				}
+				if (numMatched == 2) ++numAligned;
+			}
+		}
+
+		const Stats& stats = sync.getStats();
+		std::cout << std::setw(10) << 1000.f * jitter
+		          << std::setw(12) << 100.0 * numAligned / numFrames
+		          << std::setw(12) << 100.0 * numNewestAligned / numFrames
+		          << std::setw(12) << 100.0 * stats.partial / std::max(1u, stats.bundles)
+		          << std::setw(8) << numWrong
+		          << std::setw(14) << 1000.0 * waitSum / std::max(1u, stats.bundles)
+		          << std::setw(14) << 1000.0 * maxWait << std::endl;
+	}
+	std::cout << "A frame is " << 1000.0 * period << " ms, " << (1.0 - lossRate) * (1.0 - lossRate) * 100.0
+	          << "% of frames keep both images." << std::endl;
+}
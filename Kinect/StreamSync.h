@@ -0,0 +1,104 @@
+#pragma once
+#include "SensorSource.h"
+
+#include <deque>
+#include <vector>
+
+
+// Lines up the color and depth images of a sensor with its skeleton frames
+// by acquisition time. The streams arrive on schedules of their own, so each
+// waits in a small jitter buffer until every stream has caught up with the
+// oldest skeleton frame, or until a frame period later at most. Bundles come
+// out in skeleton frame order with the closest image of each stream within
+// half a frame, flagged partial when an image that was expected is missing.
+// Streams that never delivered or went quiet are not waited for, images go
+// out on their own while the skeleton stream is quiet.
+// Not thread safe, the capture worker owns it.
+class StreamSync
+{
+public:
+	static const unsigned int MAX_BUFFERED = 4; // images per stream, the oldest are dropped beyond
+
+	struct Image
+	{
+		bool present;                      // false if nothing matched in time
+		unsigned int frameNumber;
+		double acquisitionTime;
+		std::vector<unsigned char> pixels; // BGRA, handed back to the buffer on the next bundle
+	};
+
+	struct Bundle
+	{
+		bool hasSkeleton;                  // false for images handed out while no skeleton frames come
+		SensorSource::SkeletonFrame skeleton;
+		Image images[2];                   // COLOR, DEPTH
+		bool complete;                     // every image stream expected matched
+	};
+
+	struct Stats
+	{
+		unsigned int bundles;
+		unsigned int partial;
+		unsigned int imagesMatched;
+		unsigned int imagesDropped;        // matched to nothing, or pushed out of a full buffer
+		double maxOffset;                  // largest image to skeleton frame time matched, seconds
+
+		Stats() : bundles(0), partial(0), imagesMatched(0), imagesDropped(0), maxOffset(0.0) {}
+	};
+
+private:
+	struct Buffered
+	{
+		unsigned int frameNumber;
+		double acquisitionTime;
+		std::vector<unsigned char> pixels;
+	};
+
+	struct Stream
+	{
+		bool enabled;
+		bool seen;                         // delivered since it was enabled
+		double lastTime;                   // acquisition time of its newest image
+		std::deque<Buffered> buffer;       // by acquisition time
+	};
+
+	double framePeriod;
+	std::deque<SensorSource::SkeletonFrame> skeletons;
+	bool skeletonSeen;
+	double lastSkeletonTime;
+	Stream streams[2];                     // COLOR, DEPTH
+	std::vector<std::vector<unsigned char> > spare; // pixel buffers to reuse
+	double latestTime;                     // newest acquisition time on any stream
+	Stats stats;
+
+public:
+	StreamSync(const float frameRate = 30.f);
+
+	// Images of a disabled stream are neither buffered nor waited for
+	void setImageStream(const EStreamDataType type, const bool enabled);
+
+	void pushSkeleton(const SensorSource::SkeletonFrame& frame);
+	void pushImage(const EStreamDataType type, const unsigned char *pixels, const unsigned int size,
+	               const unsigned int frameNumber, const double acquisitionTime);
+
+	// Oldest skeleton frame with its images, false while it still waits for them
+	// or, without skeleton frames, the newest images
+	bool popBundle(Bundle& bundle);
+	void clear();
+
+	const Stats& getStats() const { return stats; }
+
+	// Replay 30 Hz skeleton, color and depth streams stamped like the sensor
+	// does, delivered out of step by increasing jitter and losing a few
+	// images, and print how many bundles hold the images of their own frame,
+	// against pairing every skeleton frame with the newest images, and how
+	// late the bundles come
+	static void benchmark(const unsigned int numFrames = 3000);
+
+private:
+	// The stream has delivered and recently enough to wait for it
+	bool isExpected(const Stream& stream) const;
+	bool isQuiet(const bool seen, const double lastTime) const;
+	bool popImages(Bundle& bundle);
+	void recycle(std::vector<unsigned char>& pixels);
+};
@@ -0,0 +1,342 @@
+#include "SyntheticSource.h"
+#include "ImageConversion.h"
+#include "Core/Constants.h"
+#include "Util/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	const float sensorFrameRate = 30.f;
+	const float floorHeight = -0.8f;   // below the sensor, in meters
+	const float wallDistance = 3.9f;
+	const float nominalFocalLength = 571.26f; // depth camera, in pixels at 640x480
+	const unsigned short minDepth = 800;      // millimeters, nearer and further reads as unknown
+	const unsigned short maxDepth = 0x1FFF;
+
+	// Capsule radius of the bone ending at each joint, in meters
+	const float boneRadius[Skeleton::NUM_JOINT_TYPES] = {
+		0.f,   // HIP_CENTER (root)
+		0.13f, // SPINE
+		0.15f, // SHOULDER_CENTER
+		0.05f, // HEAD
+		0.06f, 0.045f, 0.04f, 0.04f, // left arm
+		0.06f, 0.045f, 0.04f, 0.04f, // right arm
+		0.1f,  0.07f,  0.05f, 0.04f, // left leg
+		0.1f,  0.07f,  0.05f, 0.04f  // right leg
+	};
+	const float headRadius = 0.11f;
+
+	// Rotation about the x axis, positive angles swing a hanging limb towards the sensor
+	glm::vec3 swing(const float angle, const float length)
+	{
+		return glm::vec3(0.f, -length * std::cos(angle), -length * std::sin(angle));
+	}
+}
+
+
+SyntheticSource::Options::Options()
+	: numBodies(1)
+	, frameRate(sensorFrameRate)
+	, noise(0.005f)
+	, inferredRate(0.02f)
+	, dropoutRate(0.002f)
+	, depthWidth(640)
+	, depthHeight(480)
+	, seed(1)
+{}
+
+SyntheticSource::SyntheticSource( const Options& options )
+	: options(options)
+	, bodies()
+	, random(options.seed)
+	, clock()
+	, nextFrameTime(0.0)
+	, numFramesServed(0)
+	, lastFrameTime(0.0)
+	, filters()
+	, filterLevel(Skeleton::OFF)
+	, lastDepthFrame(0xFFFFFFFF)
+	, depthBuffer()
+{}
+
+bool SyntheticSource::open()
+{
+	if (options.depthWidth == 0 || options.depthHeight == 0) {
+		std::cerr << "Failed to open synthetic source, empty depth resolution." << std::endl;
+		return false;
+	}
+
+	// Rows of up to four bodies, alternating walkers and wavers
+	const unsigned int numColumns = std::min(options.numBodies, 4u);
+	bodies.resize(options.numBodies);
+	for (unsigned int i = 0; i < bodies.size(); ++i) {
+		Body& body = bodies[i];
+		const float column = (i % 4) - 0.5f * (numColumns - 1);
+		body.waving  = (i % 2) == 1;
+		body.origin  = glm::vec3(0.75f * column, 0.17f, 2.2f + 0.9f * (i / 4));
+		body.phase   = 10.f * random.uniform();
+		body.dropout = 0;
+		pose(body, 0.f);
+	}
+	filters.assign(bodies.size(), JointFilter(JointFilter::getParameters(filterLevel)));
+	depthBuffer.resize(options.depthWidth * options.depthHeight);
+
+	std::cout << "Generating " << bodies.size() << " bodies";
+	if (options.frameRate > 0.f) std::cout << " at " << options.frameRate << " frames per second";
+	else                         std::cout << " as fast as possible";
+	std::cout << ", " << options.depthWidth << "x" << options.depthHeight << " depth." << std::endl;
+
+	clock.restart();
+	nextFrameTime = 0.0;
+	return true;
+}
+
+std::string SyntheticSource::getDeviceId() const
+{
+	std::stringstream ss;
+	ss << "synthetic:" << options.numBodies;
+	return ss.str();
+}
+
+bool SyntheticSource::getSkeletonFrame( SkeletonFrame& frame, const Skeleton::EFilteringLevel smoothing )
+{
+	if (getNextFrameDelay() > 0.f) {
+		return false;
+	}
+	Profiler::Scope scope(Profiler::SKELETON_FETCH);
+
+	// Like the sensor, frames missed by a slow reader are dropped rather than caught up on
+	float t = numFramesServed / sensorFrameRate;
+	if (options.frameRate > 0.f) {
+		const double period = 1.0 / options.frameRate;
+		const double now = clock.getElapsedTime().asSeconds();
+		if (now - nextFrameTime > period) nextFrameTime = now;
+		t = static_cast<float>(nextFrameTime);
+		nextFrameTime += period;
+	}
+
+	if (smoothing != filterLevel) {
+		filters.assign(bodies.size(), JointFilter(JointFilter::getParameters(smoothing)));
+		filterLevel = smoothing;
+	}
+
+	frame.frameNumber     = numFramesServed++;
+	frame.acquisitionTime = t;
+	lastFrameTime = t;
+	frame.hasOrientations = false;
+	frame.bodies.clear();
+
+	for (unsigned int i = 0; i < bodies.size(); ++i) {
+		Body& body = bodies[i];
+		pose(body, t);
+		if (body.dropout > 0) {
+			--body.dropout;
+			continue;
+		}
+		if (random.uniform() < options.dropoutRate) {
+			body.dropout = 5 + random.next() % 25;
+			filters[i].reset();
+			continue;
+		}
+
+		frame.bodies.push_back(Skeleton::JointFrame());
+		Skeleton::JointFrame& joints = frame.bodies.back();
+		for (int j = 0; j < Skeleton::NUM_JOINT_TYPES; ++j) {
+			Skeleton::Joint& joint = joints[static_cast<Skeleton::EJointType>(j)];
+			joint.timestamp     = t;
+			joint.orientation   = glm::mat4(1.f);
+			joint.type          = static_cast<Skeleton::EJointType>(j);
+			joint.trackingState = Skeleton::TRACKED;
+
+			// The sensor zeroes untracked joints and places inferred ones less precisely
+			const float state = random.uniform();
+			if (state < 0.25f * options.inferredRate) {
+				joint.trackingState = Skeleton::NOT_TRACKED;
+				joint.position      = glm::vec3(0.f);
+				continue;
+			}
+			const float jitter = options.noise * ((state < 1.25f * options.inferredRate) ? 4.f : 1.f);
+			if (state < 1.25f * options.inferredRate) {
+				joint.trackingState = Skeleton::INFERRED;
+			}
+			joint.position = body.positions[j] + jitter * glm::vec3(gaussian(), gaussian(), gaussian());
+		}
+
+		if (smoothing != Skeleton::OFF) {
+			filters[i].apply(joints);
+		}
+	}
+	return true;
+}
+
+bool SyntheticSource::getImage( const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber, double& acquisitionTime )
+{
+	// Depth images show the bodies of the skeleton frame last handed out, once each
+	if (type != DEPTH || numFramesServed == 0) return false;
+	frameNumber = numFramesServed - 1;
+	acquisitionTime = lastFrameTime;
+	if (lastDepthFrame == frameNumber) return false;
+
+	renderDepth();
+	ImageConversion::depthToBGRA(&depthBuffer[0], dest, depthBuffer.size());
+	lastDepthFrame = frameNumber;
+	return true;
+}
+
+void SyntheticSource::getImageSize( const EStreamDataType type, unsigned int& width, unsigned int& height ) const
+{
+	if (type == DEPTH) {
+		width  = options.depthWidth;
+		height = options.depthHeight;
+	} else {
+		SensorSource::getImageSize(type, width, height);
+	}
+}
+
+float SyntheticSource::getNextFrameDelay() const
+{
+	if (options.frameRate <= 0.f) return 0.f;
+	const double delay = nextFrameTime - clock.getElapsedTime().asSeconds();
+	return (delay > 0.0) ? static_cast<float>(delay) : 0.f;
+}
+
+void SyntheticSource::pose( Body& body, const float t )
+{
+	const float time = t + body.phase;
+	const float step = constants::two_pi * 0.9f * time;
+	glm::vec3 *p = body.positions;
+
+	// Walkers stroll side to side with a bob on each step, wavers shift their weight
+	glm::vec3 hip = body.origin;
+	if (body.waving) {
+		hip.x += 0.02f * std::sin(0.5f * time);
+	} else {
+		hip.x += 0.3f * std::sin(0.4f * time);
+		hip.y += 0.02f * std::abs(std::sin(step));
+	}
+	const float legSwing = body.waving ? 0.f : 0.4f * std::sin(step);
+	const float armSwing = body.waving ? 0.f : 0.35f * std::sin(step);
+
+	p[Skeleton::HIP_CENTER]      = hip;
+	p[Skeleton::SPINE]           = hip + glm::vec3(0.f, 0.1f, 0.f);
+	p[Skeleton::SHOULDER_CENTER] = hip + glm::vec3(0.f, 0.45f, 0.f);
+	p[Skeleton::HEAD]            = hip + glm::vec3(0.f, 0.62f, 0.f);
+
+	// Arms swing against the legs
+	p[Skeleton::SHOULDER_LEFT] = p[Skeleton::SHOULDER_CENTER] + glm::vec3(-0.18f, -0.03f, 0.f);
+	p[Skeleton::ELBOW_LEFT]    = p[Skeleton::SHOULDER_LEFT] + swing(-armSwing, 0.27f);
+	p[Skeleton::WRIST_LEFT]    = p[Skeleton::ELBOW_LEFT]    + swing(-1.3f * armSwing + 0.15f, 0.25f);
+	p[Skeleton::HAND_LEFT]     = p[Skeleton::WRIST_LEFT]    + swing(-1.3f * armSwing + 0.15f, 0.08f);
+
+	p[Skeleton::SHOULDER_RIGHT] = p[Skeleton::SHOULDER_CENTER] + glm::vec3(0.18f, -0.03f, 0.f);
+	if (body.waving) {
+		const float wave = 0.6f * std::sin(constants::two_pi * 1.5f * time);
+		const glm::vec3 forearm(std::sin(wave), std::cos(wave), 0.f);
+		p[Skeleton::ELBOW_RIGHT] = p[Skeleton::SHOULDER_RIGHT] + glm::vec3(0.22f, 0.1f, -0.05f);
+		p[Skeleton::WRIST_RIGHT] = p[Skeleton::ELBOW_RIGHT] + 0.25f * forearm;
+		p[Skeleton::HAND_RIGHT]  = p[Skeleton::WRIST_RIGHT] + 0.08f * forearm;
+	} else {
+		p[Skeleton::ELBOW_RIGHT] = p[Skeleton::SHOULDER_RIGHT] + swing(armSwing, 0.27f);
+		p[Skeleton::WRIST_RIGHT] = p[Skeleton::ELBOW_RIGHT]    + swing(1.3f * armSwing + 0.15f, 0.25f);
+		p[Skeleton::HAND_RIGHT]  = p[Skeleton::WRIST_RIGHT]    + swing(1.3f * armSwing + 0.15f, 0.08f);
+	}
+
+	// Knees bend while their leg swings back
+	const float kneeLeft  = body.waving ? 0.f : 0.3f * std::max(0.f, -std::sin(step));
+	const float kneeRight = body.waving ? 0.f : 0.3f * std::max(0.f,  std::sin(step));
+	p[Skeleton::HIP_LEFT]    = hip + glm::vec3(-0.09f, -0.05f, 0.f);
+	p[Skeleton::KNEE_LEFT]   = p[Skeleton::HIP_LEFT]   + swing(legSwing, 0.45f);
+	p[Skeleton::ANKLE_LEFT]  = p[Skeleton::KNEE_LEFT]  + swing(legSwing - kneeLeft, 0.42f);
+	p[Skeleton::FOOT_LEFT]   = p[Skeleton::ANKLE_LEFT] + glm::vec3(0.f, -0.05f, -0.1f);
+
+	p[Skeleton::HIP_RIGHT]   = hip + glm::vec3(0.09f, -0.05f, 0.f);
+	p[Skeleton::KNEE_RIGHT]  = p[Skeleton::HIP_RIGHT]   + swing(-legSwing, 0.45f);
+	p[Skeleton::ANKLE_RIGHT] = p[Skeleton::KNEE_RIGHT]  + swing(-legSwing - kneeRight, 0.42f);
+	p[Skeleton::FOOT_RIGHT]  = p[Skeleton::ANKLE_RIGHT] + glm::vec3(0.f, -0.05f, -0.1f);
+}
+
+void SyntheticSource::renderDepth()
+{
+	const unsigned int width  = options.depthWidth;
+	const unsigned int height = options.depthHeight;
+	const float focalLength = nominalFocalLength * width / 640.f;
+
+	// Back wall and the floor in front of it
+	for (unsigned int y = 0; y < height; ++y) {
+		const float slope = (0.5f * height - (y + 0.5f)) / focalLength;
+		float distance = wallDistance;
+		if (slope < 0.f) {
+			distance = std::min(distance, floorHeight / slope);
+		}
+		const unsigned int millimeters = static_cast<unsigned int>(distance * 1000.f);
+		const unsigned short packed = (millimeters < minDepth || millimeters > maxDepth) ? 0
+		                            : static_cast<unsigned short>(millimeters << ImageConversion::PLAYER_INDEX_SHIFT);
+		std::fill(depthBuffer.begin() + y * width, depthBuffer.begin() + (y + 1) * width, packed);
+	}
+
+	for (unsigned int i = 0; i < bodies.size(); ++i) {
+		const Body& body = bodies[i];
+		// Only tracked bodies are segmented, the index has room for seven
+		const unsigned short playerIndex = (body.dropout > 0) ? 0 : static_cast<unsigned short>(1 + i % 7);
+		for (int j = 1; j < Skeleton::NUM_JOINT_TYPES; ++j) {
+			const Skeleton::EJointType type = static_cast<Skeleton::EJointType>(j);
+			renderCapsule(body.positions[Skeleton::getParentJoint(type)], body.positions[type], boneRadius[type], playerIndex);
+		}
+		renderCapsule(body.positions[Skeleton::HEAD], body.positions[Skeleton::HEAD], headRadius, playerIndex);
+	}
+}
+
+void SyntheticSource::renderCapsule( const glm::vec3& from, const glm::vec3& to, const float radius, const unsigned short playerIndex )
+{
+	if (from.z < 0.1f || to.z < 0.1f) return;
+
+	const int width  = static_cast<int>(options.depthWidth);
+	const int height = static_cast<int>(options.depthHeight);
+	const float focalLength = nominalFocalLength * width / 640.f;
+	const glm::vec2 center(0.5f * width, 0.5f * height);
+
+	// Project both ends, the capsule covers the pixels near the segment between them
+	const glm::vec2 a = center + focalLength / from.z * glm::vec2(from.x, -from.y);
+	const glm::vec2 b = center + focalLength / to.z   * glm::vec2(to.x,   -to.y);
+	const float radiusA = focalLength * radius / from.z;
+	const float radiusB = focalLength * radius / to.z;
+
+	const int minX = std::max(0,          static_cast<int>(std::floor(std::min(a.x - radiusA, b.x - radiusB))));
+	const int maxX = std::min(width - 1,  static_cast<int>(std::ceil (std::max(a.x + radiusA, b.x + radiusB))));
+	const int minY = std::max(0,          static_cast<int>(std::floor(std::min(a.y - radiusA, b.y - radiusB))));
+	const int maxY = std::min(height - 1, static_cast<int>(std::ceil (std::max(a.y + radiusA, b.y + radiusB))));
+
+	const glm::vec2 ab = b - a;
+	const float lengthSquared = glm::dot(ab, ab);
+	for (int y = minY; y <= maxY; ++y) {
+		for (int x = minX; x <= maxX; ++x) {
+			const glm::vec2 p(x + 0.5f, y + 0.5f);
+			const float t = (lengthSquared > 0.f) ? glm::clamp(glm::dot(p - a, ab) / lengthSquared, 0.f, 1.f) : 0.f;
+			const glm::vec2 offset = p - (a + t * ab);
+			const float r = radiusA + t * (radiusB - radiusA);
+			const float distanceSquared = glm::dot(offset, offset);
+			if (distanceSquared >= r * r) continue;
+
+			// Rounded towards the sensor across the capsule
+			const float z = from.z + t * (to.z - from.z) - radius * std::sqrt(1.f - distanceSquared / (r * r));
+			const unsigned int millimeters = static_cast<unsigned int>(z * 1000.f);
+			if (millimeters < minDepth || millimeters > maxDepth) continue;
+
+			unsigned short& pixel = depthBuffer[y * width + x];
+			const unsigned int existing = pixel >> ImageConversion::PLAYER_INDEX_SHIFT;
+			if (existing == 0 || millimeters < existing) {
+				pixel = static_cast<unsigned short>((millimeters << ImageConversion::PLAYER_INDEX_SHIFT) | playerIndex);
+			}
+		}
+	}
+}
+
+float SyntheticSource::gaussian()
+{
+	// Sum of uniforms, close enough to normal for jitter, unit variance
+	return (random.uniform() + random.uniform() + random.uniform() + random.uniform() - 2.f) * 1.7320508f;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "SensorSource.h"
+#include "JointFilter.h"
+#include "Util/Random.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+
+// Generates animated bodies instead of reading a sensor, for load tests that
+// need more bodies, frames or pixels than a recording has. Bodies walk or wave
+// in a grid in front of the sensor with jittered joints, inferred and untracked
+// joints and short tracking dropouts. Depth frames are rendered on the CPU from
+// capsules around the bones, with player indices, the same packing the sensor
+// uses. Bodies losing tracking still appear in the depth image, without their
+// player index. There is no color stream.
+class SyntheticSource : public SensorSource
+{
+public:
+	struct Options
+	{
+		unsigned int numBodies;
+		float frameRate;       // frames per second, 0 hands out a new frame on every call
+		float noise;           // standard deviation of joint jitter, in meters
+		float inferredRate;    // chance of a joint being inferred each frame, a quarter of that untracked
+		float dropoutRate;     // chance of a body starting to lose tracking each frame
+		unsigned int depthWidth;
+		unsigned int depthHeight;
+		unsigned int seed;
+
+		Options();
+	};
+
+private:
+	struct Body
+	{
+		bool waving;           // walks in place otherwise
+		glm::vec3 origin;      // of the hip center, in meters from the sensor
+		float phase;           // seconds
+		unsigned int dropout;  // frames left without tracking
+		glm::vec3 positions[Skeleton::NUM_JOINT_TYPES]; // without jitter, for the depth image
+	};
+
+	Options options;
+	std::vector<Body> bodies;
+	Random random;
+
+	sf::Clock clock;
+	double nextFrameTime;       // on clock, in seconds
+	unsigned int numFramesServed;
+	double lastFrameTime;       // acquisition time of the skeleton frame last handed out
+
+	std::vector<JointFilter> filters; // one per body
+	Skeleton::EFilteringLevel filterLevel;
+
+	unsigned int lastDepthFrame;
+	std::vector<unsigned short> depthBuffer;
+
+public:
+	SyntheticSource(const Options& options = Options());
+
+	bool open();
+	std::string getDeviceId() const;
+
+	bool getSkeletonFrame(SkeletonFrame& frame, const Skeleton::EFilteringLevel smoothing);
+	bool getImage(const EStreamDataType type, unsigned char *dest, unsigned int& frameNumber, double& acquisitionTime);
+	void getImageSize(const EStreamDataType type, unsigned int& width, unsigned int& height) const;
+
+	float getNextFrameDelay() const;
+	bool isPaced() const { return options.frameRate > 0.f; }
+
+private:
+	// Joint positions of a body at time t in seconds
+	static void pose(Body& body, const float t);
+
+	// Packed depth of every body into depthBuffer
+	void renderDepth();
+	void renderCapsule(const glm::vec3& from, const glm::vec3& to, const float radius, const unsigned short playerIndex);
+
+	float gaussian();
+
+	SyntheticSource(const SyntheticSource& other);
+	SyntheticSource& operator=(const SyntheticSource& other);
+};
@@ -0,0 +1,17 @@
+/************************************************************************/
+/* Bench
+/* -----
+/* Kernel benchmark suite on its own, without the sensor or a window
+/************************************************************************/
+// The same timings as the testbed's --bench, for machines without the
+// Kinect SDK. Builds with the CMakeLists.txt at the root of the tree.
+//
+// bench [results.csv] [baseline.csv]      time the kernels, write the results and compare
+//                                         against a baseline, exit code 2 on a regression
+#include "Core/Benchmark.h"
+
+
+int main(int argc, char *argv[])
+{
+	return Benchmark::runAndCompare((argc > 1) ? argv[1] : "", (argc > 2) ? argv[2] : "");
+}
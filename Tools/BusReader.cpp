@@ -0,0 +1,93 @@
+/************************************************************************/
+/* BusReader
+/* ---------
+/* Reference reader of the frame bus the testbed publishes to
+/************************************************************************/
+// Needs nothing but the bus, builds on its own, on Linux with
+//   g++ -std=c++11 -O2 -I. Tools/BusReader.cpp Util/FrameBus.cpp Util/SharedMemory.cpp Util/MonotonicClock.cpp -lpthread -lrt -o busreader
+//
+// busreader [name]                                  print the frames published under name once a second
+// busreader --bench [readers] [seconds] [rate] [depth bytes]
+//                                                   time the bus with reader threads, as fast as possible at rate 0
+#include "Util/FrameBus.h"
+#include "Util/MonotonicClock.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1 && std::string(argv[1]) == "--bench") {
+		const int numReaders = (argc > 2) ? std::max(1, atoi(argv[2])) : 8;
+		const float seconds  = (argc > 3) ? static_cast<float>(atof(argv[3])) : 5.f;
+		const float rate     = (argc > 4) ? static_cast<float>(atof(argv[4])) : 30.f;
+		const int depthBytes = (argc > 5) ? std::max(0, atoi(argv[5])) : 4 * 640 * 480;
+		FrameBus::benchmark(numReaders, seconds, rate, depthBytes);
+		return 0;
+	}
+
+	const std::string name = (argc > 1) ? argv[1] : FrameBus::defaultName;
+	FrameBusReader reader;
+	while (!reader.attach(name)) {
+		std::cout << "Waiting for '" << name << "' to be published..." << std::endl;
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+	std::cout << "Attached to '" << name << "'" << std::endl;
+
+	// Frames are read in place, everything is copied out before release() says whether it held
+	double lastReport = FrameBus::now();
+	unsigned int numFrames = 0, numDepth = 0;
+	float latencySum = 0.f;
+	unsigned int numAged = 0;
+	double ageSum = 0.0;
+	FrameBus::Frame latest = FrameBus::Frame();
+	bool haveLatest = false;
+	for (;;) {
+		const FrameBus::Frame *frame = reader.acquire();
+		if (frame == nullptr) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		} else {
+			const FrameBus::Frame copy = *frame;
+			const float latency = static_cast<float>(FrameBus::now() - frame->publishTime);
+			const uint64_t readTime = MonotonicClock::now();
+			if (reader.release()) {
+				latest = copy;
+				haveLatest = true;
+				latencySum += latency;
+				if (copy.captureTime != 0 && readTime > copy.captureTime) {
+					ageSum += MonotonicClock::toMilliseconds(readTime - copy.captureTime);
+					++numAged;
+				}
+				++numFrames;
+				numDepth += (copy.depthWidth > 0);
+			}
+		}
+
+		const double now = FrameBus::now();
+		if (now - lastReport < 1.0) continue;
+
+		std::cout << std::fixed << std::setprecision(1)
+		          << numFrames / (now - lastReport) << " frames/s, " << numDepth << " depth images, "
+		          << std::setprecision(0) << ((numFrames > 0) ? 1e6f * latencySum / numFrames : 0.f) << " us latency, "
+		          << std::setprecision(2) << ((numAged > 0) ? ageSum / numAged : 0.0) << " ms since capture, "
+		          << reader.getNumMissed() << " missed, " << reader.getNumTorn() << " torn" << std::endl;
+		if (haveLatest) {
+			std::cout << std::setprecision(2) << "  frame #" << latest.frameNumber << ", " << latest.numBodies << " bodies";
+			for (unsigned int b = 0; b < latest.numBodies; ++b) {
+				const FrameBus::Joint& hip = latest.bodies[b].joints[0];
+				std::cout << "  [" << latest.bodies[b].id << "] " << hip.position[0] << " " << hip.position[1] << " " << hip.position[2];
+			}
+			std::cout << std::endl;
+		}
+		lastReport = now;
+		numFrames = numDepth = 0;
+		latencySum = 0.f;
+		numAged = 0;
+		ageSum = 0.0;
+	}
+}
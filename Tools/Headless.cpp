@@ -0,0 +1,24 @@
+/************************************************************************/
+/* Headless
+/* --------
+/* The testbed's benchmarks, load tests and export, without the Kinect SDK
+/************************************************************************/
+// For servers without Windows, a sensor or a display. Builds with the
+// CMakeLists.txt at the root of the tree, export renders through EGL's
+// surfaceless platform, in software without a GPU.
+//
+// headless <mode> [arguments]            the same modes and arguments as the testbed
+#include "Core/CommandLine.h"
+
+#include <iostream>
+
+
+int main(int argc, char *argv[])
+{
+	int exitCode = 0;
+	if (CommandLine::run(argc, argv, exitCode)) {
+		return exitCode;
+	}
+	CommandLine::printUsage(argv[0], std::cerr);
+	return 1;
+}
@@ -16,9 +16,12 @@ UserInterface::UserInterface()
 	, box(sfg::Box::Create(sfg::Box::HORIZONTAL, 0.f))
 	, infoLabel(sfg::Label::Create())
 	, playRateLabel(sfg::Label::Create())
+	, profileLabel(sfg::Label::Create())
 	, quitButton(sfg::Button::Create("Quit"))
 	, openButton(sfg::Button::Create("Open"))
 	, closeButton(sfg::Button::Create("Close"))
+	, refilterButton(sfg::Button::Create("Refilter"))
+	, reduceButton(sfg::Button::Create("Reduce"))
 	, saveButton(sfg::ToggleButton::Create("Save"))
 	, playButton(sfg::ToggleButton::Create("Play"))
 	, playRateScrollbar(sfg::Scrollbar::Create(sfg::Adjustment::Create(0.0033f, 0.0015f, 0.5f, 0.0005f, 0.01f)))
@@ -32,10 +35,13 @@ UserInterface::UserInterface()
 	, showInferredButton(sfg::CheckButton::Create("Inferred"))
 	, showJointPathButton(sfg::CheckButton::Create("Joint Path"))
 	, enableHandControlButton(sfg::CheckButton::Create("Hand Controls"))
+	, showFilteredTrackButton(sfg::CheckButton::Create("Filtered Track"))
+	, showKinematicsButton(sfg::CheckButton::Create("Kinematics"))
 	, jointFramesProgress(sfg::ProgressBar::Create())
 	, jointFramesFilename(sfg::Label::Create())
 	, jointFrameIndex(sfg::Label::Create())
 	, filterJointsCombo(sfg::ComboBox::Create())
+	, interpolationCombo(sfg::ComboBox::Create())
 {
 	setupWidgetHandlers();
 	setupWindowConfiguration();
@@ -64,6 +70,8 @@ void UserInterface::setupWidgetHandlers()
 			   saveButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onSaveButtonClick, this);
 			   playButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onPlayButtonClick, this);
 			  closeButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onCloseButtonClick, this);
+		   refilterButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onRefilterButtonClick, this);
+			 reduceButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onReduceButtonClick, this);
 		  showColorButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onShowColorButtonClick, this);
 		  showDepthButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onShowDepthButtonClick, this);
 	   showSkeletonButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onShowSkeletonButtonClick, this);
@@ -74,8 +82,11 @@ void UserInterface::setupWidgetHandlers()
 	  showJointPathButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onShowJointPathButtonClick, this);
 	showOrientationButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onShowOrientationButtonClick, this);
 	enableHandControlButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onEnableHandControlButtonClick, this);
+	showFilteredTrackButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onShowFilteredTrackButtonClick, this);
+	   showKinematicsButton->GetSignal(sfg::Button::OnLeftClick).Connect(&UserInterface::onShowKinematicsButtonClick, this);
 	    playRateScrollbar->GetSignal(sfg::Scrollbar::OnLeftClick).Connect(&UserInterface::onPlayRateScrollbarClick, this);
 		filterJointsCombo->GetSignal(sfg::ComboBox::OnSelect).Connect(&UserInterface::onFilterComboSelect, this);
+	   interpolationCombo->GetSignal(sfg::ComboBox::OnSelect).Connect(&UserInterface::onInterpolationComboSelect, this);
 	  jointFramesProgress->GetSignal(sfg::ProgressBar::OnMouseMove).Connect(&UserInterface::onProgressBarMouseMove, this);
 	// TODO: hook up other widget handlers as needed
 }
@@ -85,6 +96,9 @@ void UserInterface::setupWindowConfiguration()
 	infoLabel->SetText("Sensor [?] : ?");
 	infoLabel->SetLineWrap(true);
 
+	profileLabel->SetText(sf::String(""));
+	profileLabel->SetAlignment(sf::Vector2f(0.f, 0.f));
+
 	showColorButton->SetActive(true);
 	showDepthButton->SetActive(true);
 	showSkeletonButton->SetActive(true);
@@ -96,6 +110,8 @@ void UserInterface::setupWindowConfiguration()
 	showBonesButton->SetActive(true);
 	showJointPathButton->SetActive(false);
 	enableHandControlButton->SetActive(false);
+	showFilteredTrackButton->SetActive(false);
+	showKinematicsButton->SetActive(false);
 
 	jointFramesFilename->SetText(sf::String(""));
 	jointFramesFilename->SetLineWrap(true);
@@ -122,14 +138,23 @@ void UserInterface::setupWindowConfiguration()
 	filterJointsCombo->AppendItem("Medium joint filtering");
 	filterJointsCombo->AppendItem("High joint filtering");
 
+	// Items in Skeleton::EInterpolation order
+	interpolationCombo->AppendItem("No interpolation");
+	interpolationCombo->AppendItem("Linear interpolation");
+	interpolationCombo->AppendItem("Catmull-Rom interpolation");
+	interpolationCombo->SelectItem(Skeleton::CATMULL_ROM);
+
 	sfg::Fixed::Ptr fixed = sfg::Fixed::Create();
 
 	fixed->Put(infoLabel, sf::Vector2f(0,0));
+	fixed->Put(profileLabel, sf::Vector2f(980, 20));
 
 	fixed->Put(quitButton, sf::Vector2f(0  , 20));
 	fixed->Put(openButton, sf::Vector2f(50 , 20));
 	fixed->Put(closeButton, sf::Vector2f(100, 20));
 	fixed->Put(saveButton, sf::Vector2f(150, 20));
+	fixed->Put(refilterButton, sf::Vector2f(200, 20));
+	fixed->Put(reduceButton, sf::Vector2f(270, 20));
 
 	fixed->Put(showColorButton, sf::Vector2f(0, 60));
 	fixed->Put(showDepthButton, sf::Vector2f(0, 100));
@@ -142,6 +167,9 @@ void UserInterface::setupWindowConfiguration()
 	fixed->Put(showJointPathButton, sf::Vector2f(0, 380));
 	fixed->Put(enableHandControlButton, sf::Vector2f(0, 420));
 	fixed->Put(filterJointsCombo, sf::Vector2f(0, 460));
+	fixed->Put(showFilteredTrackButton, sf::Vector2f(0, 500));
+	fixed->Put(showKinematicsButton, sf::Vector2f(0, 540));
+	fixed->Put(interpolationCombo, sf::Vector2f(0, 565));
 
 	fixed->Put(playButton, sf::Vector2f(0, 600));
 	fixed->Put(playRateScrollbar, sf::Vector2f(80, 600));
@@ -161,6 +189,11 @@ void UserInterface::setupWindowConfiguration()
 void UserInterface::onQuitButtonClick()  { Application::request().shutdown(); }
 void UserInterface::onOpenButtonClick()  { Application::request().loadFile(); }
 void UserInterface::onCloseButtonClick() { Application::request().closeFile(); }
+void UserInterface::onRefilterButtonClick() {
+	Application::request().refilterFile();
+	showFilteredTrackButton->SetActive(Application::request().getKinect().getSkeleton().hasFilteredFrames());
+}
+void UserInterface::onReduceButtonClick() { Application::request().reduceFile(); }
 void UserInterface::onSaveButtonClick()  { Application::request().getKinect().toggleSave(); }
 void UserInterface::onShowColorButtonClick()       { Application::request().toggleShowColor(); }
 void UserInterface::onShowDepthButtonClick()       { Application::request().toggleShowDepth(); }
@@ -172,6 +205,8 @@ void UserInterface::onShowOrientationButtonClick() { Application::request().getK
 void UserInterface::onShowBonesButtonClick()       { Application::request().getKinect().getSkeleton().toggleBones(); }
 void UserInterface::onShowJointPathButtonClick()   { Application::request().getKinect().getSkeleton().toggleJointPath(); }
 void UserInterface::onEnableHandControlButtonClick() { Application::request().toggleHandControl(); }
+void UserInterface::onShowFilteredTrackButtonClick() { Application::request().toggleFilteredTrack(); }
+void UserInterface::onShowKinematicsButtonClick()    { Application::request().getKinect().getSkeleton().toggleKinematics(); }
 
 void UserInterface::onPlayButtonClick()  {
 	Application::request().toggleAutoPlay();
@@ -212,3 +247,11 @@ void UserInterface::onFilterComboSelect()
 	else if (selected == "Joint filtering - Medium") Application::request().getKinect().getSkeleton().setFilterLevel(Skeleton::MEDIUM);
 	else if (selected == "Joint filtering - High")   Application::request().getKinect().getSkeleton().setFilterLevel(Skeleton::HIGH);
 }
+
+void UserInterface::onInterpolationComboSelect()
+{
+	const int selected = interpolationCombo->GetSelectedItem();
+	if (selected >= Skeleton::NEAREST && selected <= Skeleton::CATMULL_ROM) {
+		Application::request().getKinect().getSkeleton().setInterpolation(static_cast<Skeleton::EInterpolation>(selected));
+	}
+}
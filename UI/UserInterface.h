@@ -17,10 +17,13 @@ private:
 
 	sfg::Label::Ptr infoLabel;
 	sfg::Label::Ptr playRateLabel;
+	sfg::Label::Ptr profileLabel;
 
 	sfg::Button::Ptr quitButton;
 	sfg::Button::Ptr openButton;
 	sfg::Button::Ptr closeButton;
+	sfg::Button::Ptr refilterButton;
+	sfg::Button::Ptr reduceButton;
 
 	sfg::ToggleButton::Ptr saveButton;
 	sfg::ToggleButton::Ptr playButton;
@@ -37,8 +40,11 @@ private:
 	sfg::CheckButton::Ptr showBonesButton;
 	sfg::CheckButton::Ptr showJointPathButton;
 	sfg::CheckButton::Ptr enableHandControlButton;
+	sfg::CheckButton::Ptr showFilteredTrackButton;
+	sfg::CheckButton::Ptr showKinematicsButton;
 
 	sfg::ComboBox::Ptr filterJointsCombo;
+	sfg::ComboBox::Ptr interpolationCombo;
 
 	sfg::ProgressBar::Ptr jointFramesProgress;
 	sfg::Label::Ptr jointFramesFilename;
@@ -51,6 +57,7 @@ public:
 	void handleEvent(sf::Event &event);
 
 	void setInfo    (const std::string &info) { infoLabel->SetText(sf::String(info)); }
+	void setProfile (const std::string &text) { profileLabel->SetText(sf::String(text)); }
 	void setFileName(const std::string &name) { jointFramesFilename->SetText(sf::String(name)); }
 	void setProgress(float fraction) { jointFramesProgress->SetFraction(fraction); }
 	void setIndex(int index) {
@@ -70,6 +77,8 @@ private:
 	void onOpenButtonClick();
 	void onSaveButtonClick();
 	void onCloseButtonClick();
+	void onRefilterButtonClick();
+	void onReduceButtonClick();
 	void onPlayButtonClick();
 	void onPlayRateScrollbarClick();
 	void onShowColorButtonClick();
@@ -82,7 +91,10 @@ private:
 	void onShowBonesButtonClick();
 	void onShowJointPathButtonClick();
 	void onEnableHandControlButtonClick();
+	void onShowFilteredTrackButtonClick();
+	void onShowKinematicsButtonClick();
 	void onProgressBarMouseMove();
 	void onFilterComboSelect();
+	void onInterpolationComboSelect();
 };
 
@@ -0,0 +1,72 @@
+#pragma once
+/************************************************************************/
+/* Float4
+/* ------
+/* A four lane float type, SSE when available and scalar otherwise
+/************************************************************************/
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FLOAT4_SSE
+#include <xmmintrin.h>
+#endif
+
+
+// Four floats processed in lockstep, one independent value per lane.
+// Always passed by reference, MSVC can't pass aligned types by value on x86.
+#ifdef FLOAT4_SSE
+struct Float4 {
+	__m128 v;
+	Float4() {}
+	Float4(const __m128& v) : v(v) {}
+	explicit Float4(const float s) : v(_mm_set1_ps(s)) {}
+	static Float4 load(const float *p) { return _mm_loadu_ps(p); }
+	void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+inline Float4 operator+(const Float4& a, const Float4& b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(const Float4& a, const Float4& b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(const Float4& a, const Float4& b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(const Float4& a, const Float4& b) { return _mm_div_ps(a.v, b.v); }
+inline Float4 sqrt4(const Float4& a)                      { return _mm_sqrt_ps(a.v); }
+inline Float4 min4(const Float4& a, const Float4& b)      { return _mm_min_ps(a.v, b.v); }
+inline Float4 max4(const Float4& a, const Float4& b)      { return _mm_max_ps(a.v, b.v); }
+inline Float4 greater4(const Float4& a, const Float4& b)  { return _mm_cmpgt_ps(a.v, b.v); }
+inline Float4 abs4(const Float4& a)                       { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+inline Float4 and4(const Float4& a, const Float4& b)      { return _mm_and_ps(a.v, b.v); }
+
+// mask ? a : b, per lane
+inline Float4 select4(const Float4& mask, const Float4& a, const Float4& b) {
+	return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+}
+
+// magnitude of a with the sign of b, per lane
+inline Float4 copysign4(const Float4& a, const Float4& b) {
+	const __m128 sign = _mm_set1_ps(-0.f);
+	return _mm_or_ps(_mm_andnot_ps(sign, a.v), _mm_and_ps(sign, b.v));
+}
+#else
+struct Float4 {
+	float v[4];
+	Float4() {}
+	explicit Float4(const float s) { v[0] = v[1] = v[2] = v[3] = s; }
+	static Float4 load(const float *p) { Float4 r; for (auto i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+	void store(float *p) const { for (auto i = 0; i < 4; ++i) p[i] = v[i]; }
+};
+
+#define FLOAT4_LANES(expr) Float4 r; for (auto i = 0; i < 4; ++i) r.v[i] = (expr); return r;
+inline Float4 operator+(const Float4& a, const Float4& b) { FLOAT4_LANES(a.v[i] + b.v[i]) }
+inline Float4 operator-(const Float4& a, const Float4& b) { FLOAT4_LANES(a.v[i] - b.v[i]) }
+inline Float4 operator*(const Float4& a, const Float4& b) { FLOAT4_LANES(a.v[i] * b.v[i]) }
+inline Float4 operator/(const Float4& a, const Float4& b) { FLOAT4_LANES(a.v[i] / b.v[i]) }
+inline Float4 sqrt4(const Float4& a)                      { FLOAT4_LANES(std::sqrt(a.v[i])) }
+inline Float4 min4(const Float4& a, const Float4& b)      { FLOAT4_LANES(std::min(a.v[i], b.v[i])) }
+inline Float4 max4(const Float4& a, const Float4& b)      { FLOAT4_LANES(std::max(a.v[i], b.v[i])) }
+inline Float4 greater4(const Float4& a, const Float4& b)  { FLOAT4_LANES(a.v[i] > b.v[i] ? 1.f : 0.f) }
+inline Float4 abs4(const Float4& a)                       { FLOAT4_LANES(std::fabs(a.v[i])) }
+inline Float4 and4(const Float4& a, const Float4& b)      { FLOAT4_LANES(a.v[i] != 0.f && b.v[i] != 0.f ? 1.f : 0.f) }
+inline Float4 select4(const Float4& m, const Float4& a, const Float4& b) { FLOAT4_LANES(m.v[i] != 0.f ? a.v[i] : b.v[i]) }
+inline Float4 copysign4(const Float4& a, const Float4& b) { FLOAT4_LANES(b.v[i] < 0.f ? -std::fabs(a.v[i]) : std::fabs(a.v[i])) }
+#undef FLOAT4_LANES
+#endif
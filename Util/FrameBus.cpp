@@ -0,0 +1,305 @@
+/************************************************************************/
+/* FrameBus
+/* --------
+/* Live frames in a ring in shared memory, for readers in other processes
+/************************************************************************/
+#include "FrameBus.h"
+#include "MonotonicClock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Header and slots each start on their own cache line
+	const unsigned int lineBytes = 64;
+
+	unsigned int roundUp(const unsigned int bytes)
+	{
+		return (bytes + lineBytes - 1) / lineBytes * lineBytes;
+	}
+}
+
+const std::string FrameBus::defaultName("KinectTestbedFrames");
+
+
+FrameBus::FrameBus()
+	: memory()
+	, header(nullptr)
+	, numPublished(0)
+	, writing(nullptr)
+{}
+
+FrameBus::~FrameBus()
+{
+	close();
+}
+
+bool FrameBus::create( const std::string& name, const unsigned int numSlots, const unsigned int maxDepthBytes )
+{
+	close();
+
+	const unsigned int slotStride = roundUp(sizeof(Slot) + sizeof(Frame) + maxDepthBytes);
+	if (!memory.create(name, roundUp(sizeof(Header)) + static_cast<size_t>(numSlots) * slotStride)) {
+		return false;
+	}
+
+	header = new (memory.getData()) Header();
+	header->magic         = MAGIC;
+	header->version       = VERSION;
+	header->numSlots      = numSlots;
+	header->slotStride    = slotStride;
+	header->maxDepthBytes = maxDepthBytes;
+	header->reserved      = 0;
+	header->numPublished  = 0;
+	for (unsigned int i = 0; i < numSlots; ++i) {
+		new (&getSlot(*header, i)) Slot();
+		getSlot(*header, i).state = 0;
+	}
+	numPublished = 0;
+
+	std::cout << "Publishing frames to '" << name << "', " << numSlots << " slots of "
+	          << slotStride / 1024 << " KB" << std::endl;
+	return true;
+}
+
+void FrameBus::close()
+{
+	memory.close();
+	header  = nullptr;
+	writing = nullptr;
+}
+
+FrameBus::Slot& FrameBus::getSlot( Header& header, const uint64_t sequence )
+{
+	char *slots = reinterpret_cast<char *>(&header) + roundUp(sizeof(Header));
+	return *reinterpret_cast<Slot *>(slots + (sequence % header.numSlots) * header.slotStride);
+}
+
+FrameBus::Frame& FrameBus::beginFrame()
+{
+	// Readers that see the odd state leave the slot alone
+	Slot& slot = getSlot(*header, numPublished);
+	slot.state.store(2 * numPublished + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	writing = reinterpret_cast<Frame *>(&slot + 1);
+	writing->sequence    = numPublished;
+	writing->numBodies   = 0;
+	writing->depthWidth  = 0;
+	writing->depthHeight = 0;
+	writing->depthBytes  = 0;
+	writing->captureTime = 0;
+	return *writing;
+}
+
+void FrameBus::endFrame()
+{
+	writing->publishTime = now();
+	getSlot(*header, numPublished).state.store(2 * numPublished + 2, std::memory_order_release);
+	++numPublished;
+	header->numPublished.store(numPublished, std::memory_order_release);
+	writing = nullptr;
+}
+
+double FrameBus::now()
+{
+	return MonotonicClock::toSeconds(MonotonicClock::now());
+}
+
+void FrameBus::benchmark( const unsigned int numReaders, const float seconds, const float frameRate, const unsigned int depthBytes )
+{
+	std::stringstream name;
+	name << defaultName << "Benchmark";
+
+	FrameBus bus;
+	if (!bus.create(name.str(), DEFAULT_SLOTS, depthBytes)) return;
+
+	struct Result
+	{
+		uint64_t numRead, numMissed, numTorn, numCorrupt;
+		std::vector<float> latencies; // seconds
+	};
+	std::vector<Result> results(numReaders);
+	std::atomic<bool> running(true);
+	std::atomic<unsigned int> numAttached(0);
+
+	// Readers check the depth bytes they touch against the sequence the writer stamped them with
+	std::vector<std::thread> readers;
+	for (unsigned int r = 0; r < numReaders; ++r) {
+		readers.push_back(std::thread([&, r]() {
+			FrameBusReader reader;
+			const bool attached = reader.attach(name.str());
+			++numAttached;
+			if (!attached) return;
+
+			Result& result = results[r];
+			result.numCorrupt = 0;
+			result.latencies.reserve(static_cast<size_t>(seconds * std::max(frameRate, 1000.f)));
+			while (running) {
+				const Frame *frame = reader.acquire();
+				if (frame == nullptr) {
+					std::this_thread::sleep_for(std::chrono::microseconds(50));
+					continue;
+				}
+				const float latency = static_cast<float>(now() - frame->publishTime);
+				const unsigned char stamp = static_cast<unsigned char>(frame->sequence);
+				unsigned int mismatches = 0;
+				for (unsigned int i = 0; i < frame->depthBytes; i += lineBytes) {
+					mismatches += (frame->getDepth()[i] != stamp);
+				}
+				if (reader.release()) {
+					result.latencies.push_back(latency);
+					result.numCorrupt += (mismatches > 0);
+				}
+			}
+			result.numRead   = reader.getNumRead();
+			result.numMissed = reader.getNumMissed();
+			result.numTorn   = reader.getNumTorn();
+		}));
+	}
+	while (numAttached < numReaders) {
+		std::this_thread::yield();
+	}
+
+	const double start = now();
+	double nextFrameTime = start;
+	while (now() - start < seconds) {
+		if (frameRate > 0.f) {
+			const double wait = nextFrameTime - now();
+			if (wait > 0.0) std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(wait * 1e6)));
+			nextFrameTime += 1.0 / frameRate;
+		}
+		Frame& frame = bus.beginFrame();
+		frame.frameNumber = static_cast<uint32_t>(frame.sequence);
+		frame.numBodies = MAX_BODIES;
+		frame.depthWidth = depthBytes / 4;
+		frame.depthHeight = 1;
+		frame.depthBytes = depthBytes;
+		memset(frame.getDepth(), static_cast<unsigned char>(frame.sequence), depthBytes);
+		bus.endFrame();
+	}
+	const float elapsed = static_cast<float>(now() - start);
+	running = false;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	const uint64_t numPublished = bus.getNumPublished();
+	std::cout << std::fixed << std::setprecision(1)
+	          << "Published " << numPublished << " frames of " << (sizeof(Frame) + depthBytes) / 1024 << " KB in " << elapsed
+	          << " seconds, " << numPublished / elapsed << " frames/s, to " << numReaders << " readers" << std::endl
+	          << std::setw(8) << "reader" << std::setw(10) << "read" << std::setw(10) << "missed" << std::setw(8) << "torn"
+	          << std::setw(10) << "corrupt" << std::setw(12) << "avg us" << std::setw(12) << "p99 us" << std::setw(12) << "max us" << std::endl;
+
+	uint64_t totalRead = 0;
+	for (unsigned int r = 0; r < numReaders; ++r) {
+		Result& result = results[r];
+		std::vector<float>& latencies = result.latencies;
+		std::sort(latencies.begin(), latencies.end());
+		float sum = 0.f;
+		for (auto latency : latencies) sum += latency;
+		const float average = latencies.empty() ? 0.f : sum / latencies.size();
+		const float p99     = latencies.empty() ? 0.f : latencies[latencies.size() * 99 / 100];
+		const float worst   = latencies.empty() ? 0.f : latencies.back();
+		totalRead += result.numRead;
+
+		std::cout << std::setw(8) << r << std::setw(10) << result.numRead << std::setw(10) << result.numMissed
+		          << std::setw(8) << result.numTorn << std::setw(10) << result.numCorrupt
+		          << std::setw(12) << 1e6f * average << std::setw(12) << 1e6f * p99 << std::setw(12) << 1e6f * worst << std::endl;
+	}
+	std::cout << "All readers " << totalRead / elapsed << " frames/s, "
+	          << totalRead * (sizeof(Frame) + depthBytes) / elapsed / (1024.f * 1024.f) << " MB/s read in place" << std::endl;
+}
+
+
+FrameBusReader::FrameBusReader()
+	: memory()
+	, header(nullptr)
+	, next(0)
+	, reading(0)
+	, numRead(0)
+	, numMissed(0)
+	, numTorn(0)
+{}
+
+bool FrameBusReader::attach( const std::string& name )
+{
+	detach();
+	if (!memory.open(name)) {
+		return false;
+	}
+
+	FrameBus::Header *mapped = reinterpret_cast<FrameBus::Header *>(memory.getData());
+	if (memory.getSize() < sizeof(FrameBus::Header) || mapped->magic != FrameBus::MAGIC || mapped->version != FrameBus::VERSION) {
+		std::cerr << "Shared memory '" << name << "' is not a compatible frame bus" << std::endl;
+		memory.close();
+		return false;
+	}
+
+	// Every slot the header describes has to lie inside the mapping
+	const uint64_t minSlotStride = sizeof(FrameBus::Slot) + sizeof(FrameBus::Frame) + static_cast<uint64_t>(mapped->maxDepthBytes);
+	const uint64_t busBytes      = roundUp(sizeof(FrameBus::Header)) + static_cast<uint64_t>(mapped->numSlots) * mapped->slotStride;
+	if (mapped->numSlots == 0 || mapped->slotStride < minSlotStride || busBytes > memory.getSize()) {
+		std::cerr << "Shared memory '" << name << "' is smaller than its frame bus header says" << std::endl;
+		memory.close();
+		return false;
+	}
+
+	header = mapped;
+	const uint64_t numPublished = header->numPublished.load(std::memory_order_acquire);
+	next = (numPublished > 0) ? numPublished - 1 : 0;
+	numRead = numMissed = numTorn = 0;
+	return true;
+}
+
+void FrameBusReader::detach()
+{
+	memory.close();
+	header = nullptr;
+}
+
+const FrameBus::Frame *FrameBusReader::acquire()
+{
+	for (;;) {
+		const uint64_t numPublished = header->numPublished.load(std::memory_order_acquire);
+		if (next >= numPublished) {
+			return nullptr;
+		}
+
+		// The slot after the newest may already be rewritten, skip to the one after that
+		if (numPublished - next >= header->numSlots) {
+			const uint64_t oldest = numPublished - header->numSlots + 1;
+			numMissed += oldest - next;
+			next = oldest;
+		}
+
+		FrameBus::Slot& slot = FrameBus::getSlot(*header, next);
+		if (slot.state.load(std::memory_order_acquire) == 2 * next + 2) {
+			reading = next++;
+			return reinterpret_cast<const FrameBus::Frame *>(&slot + 1);
+		}
+
+		// Overwritten since numPublished was read
+		++numMissed;
+		++next;
+	}
+}
+
+bool FrameBusReader::release()
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (FrameBus::getSlot(*header, reading).state.load(std::memory_order_relaxed) != 2 * reading + 2) {
+		++numTorn;
+		return false;
+	}
+	++numRead;
+	return true;
+}
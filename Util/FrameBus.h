@@ -0,0 +1,152 @@
+#pragma once
+/************************************************************************/
+/* FrameBus
+/* --------
+/* Live frames in a ring in shared memory, for readers in other processes
+/************************************************************************/
+#include "SharedMemory.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+// One writer fills frames in place in a fixed ring of slots, any number of
+// readers attach by name and read them in place. Every slot carries the
+// sequence number of its frame, odd while it is being written, so readers
+// notice a frame overwritten before or while they read it without ever
+// blocking the writer. Layouts are plain fixed size types, for readers
+// written in other languages.
+class FrameBus
+{
+public:
+	static const unsigned int MAX_BODIES    = 6;
+	static const unsigned int NUM_JOINTS    = 20; // Skeleton::NUM_JOINT_TYPES
+	static const unsigned int DEFAULT_SLOTS = 16;
+	static const std::string defaultName;
+
+	struct Joint
+	{
+		float position[3];      // meters, world space
+		float orientation[4];   // absolute, quaternion x y z w
+		uint32_t trackingState; // Skeleton::ETrackingState
+	};
+
+	struct Body
+	{
+		uint32_t id;            // stable while the person stays in view
+		uint32_t numViews;      // sensors that saw them
+		Joint joints[NUM_JOINTS];
+	};
+
+	struct Frame
+	{
+		uint64_t sequence;         // counts every frame published
+		double   publishTime;      // FrameBus::now() when the frame became readable
+		uint64_t captureTime;      // MonotonicClock::now() when the first sensor's frame was acquired, 0 if unknown
+		double   acquisitionTime;  // on the first sensor's clock, seconds
+		uint32_t frameNumber;      // of the first sensor
+		uint32_t numBodies;
+		Body     bodies[MAX_BODIES];
+		uint32_t depthWidth;       // 0 if the frame brings no new depth image
+		uint32_t depthHeight;
+		uint32_t depthFrameNumber;
+		uint32_t depthBytes;       // BGRA, right after the frame
+
+		const unsigned char *getDepth() const { return reinterpret_cast<const unsigned char *>(this + 1); }
+		unsigned char *getDepth()             { return reinterpret_cast<unsigned char *>(this + 1); }
+	};
+
+	// Start of the shared block, slots follow at slotStride
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t numSlots;
+		uint32_t slotStride;        // bytes from one slot to the next
+		uint32_t maxDepthBytes;
+		uint32_t reserved;
+		std::atomic<uint64_t> numPublished;
+	};
+
+	// Start of every slot, its frame follows
+	struct Slot
+	{
+		std::atomic<uint64_t> state; // 2 * sequence + 1 while written, 2 * sequence + 2 once readable, 0 never written
+		uint64_t reserved;
+	};
+
+	static const uint32_t MAGIC   = 0x4B464246; // "FBFK"
+	static const uint32_t VERSION = 2;
+
+private:
+	SharedMemory memory;
+	Header *header;
+	uint64_t numPublished;
+	Frame *writing;
+
+public:
+	FrameBus();
+	~FrameBus();
+
+	bool create(const std::string& name = defaultName, const unsigned int numSlots = DEFAULT_SLOTS, const unsigned int maxDepthBytes = 0);
+	void close();
+	bool isOpen() const { return header != nullptr; }
+
+	// The next frame to fill in place, readers see it after endFrame()
+	Frame& beginFrame();
+	void endFrame();
+
+	unsigned int getMaxDepthBytes() const { return header->maxDepthBytes; }
+	uint64_t getNumPublished() const { return numPublished; }
+
+	// Seconds on the MonotonicClock every process on the machine shares
+	static double now();
+
+	// Publish frames with a depth image of depthBytes at frameRate, as fast as
+	// possible at 0, to numReaders reader threads attached by name, and print
+	// how many frames each read, missed and read torn, and how long frames
+	// took from being published to being read
+	static void benchmark(const unsigned int numReaders, const float seconds, const float frameRate, const unsigned int depthBytes);
+
+	static Slot& getSlot(Header& header, const uint64_t sequence);
+
+private:
+	FrameBus(const FrameBus& other);
+	FrameBus& operator=(const FrameBus& other);
+};
+
+
+class FrameBusReader
+{
+private:
+	SharedMemory memory;
+	FrameBus::Header *header;
+	uint64_t next;         // sequence of the next frame to read
+	uint64_t reading;      // sequence of the acquired frame
+	uint64_t numRead;
+	uint64_t numMissed;    // overwritten before they were acquired
+	uint64_t numTorn;      // overwritten while they were being read
+
+public:
+	FrameBusReader();
+
+	// Attach to a writer's ring, reading from its newest frame on
+	bool attach(const std::string& name = FrameBus::defaultName);
+	void detach();
+	bool isAttached() const { return header != nullptr; }
+
+	// Oldest unread frame still in the ring, in place in shared memory, or
+	// null if there is none yet. Valid until release(), which tells whether
+	// the writer overwrote it in the meantime and anything read is garbage.
+	const FrameBus::Frame *acquire();
+	bool release();
+
+	uint64_t getNumRead()   const { return numRead;   }
+	uint64_t getNumMissed() const { return numMissed; }
+	uint64_t getNumTorn()   const { return numTorn;   }
+
+private:
+	FrameBusReader(const FrameBusReader& other);
+	FrameBusReader& operator=(const FrameBusReader& other);
+};
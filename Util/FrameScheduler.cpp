@@ -0,0 +1,283 @@
+/************************************************************************/
+/* FrameScheduler
+/* --------------
+/* Decides when the main loop draws, sleeping while nothing changed
+/************************************************************************/
+#include "FrameScheduler.h"
+
+#include <mmsystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+
+FrameScheduler::FrameScheduler( const float maxFrameRate )
+	: clock()
+	, maxFrameRate((maxFrameRate > 0.f) ? maxFrameRate : 0.f)
+	, lastFrameTime(-1e30f)
+	, reasons(INTERFACE_CHANGE)
+	, frameReasons(0)
+	, stats()
+{
+	resetStats();
+	// Default timer resolution rounds short sleeps up to about 16 ms, too coarse for a frame cap
+	timeBeginPeriod(1);
+}
+
+FrameScheduler::~FrameScheduler()
+{
+	timeEndPeriod(1);
+}
+
+void FrameScheduler::resetStats()
+{
+	stats.numWakeups = 0;
+	stats.numFrames = 0;
+	stats.sleepSeconds = 0.f;
+}
+
+float FrameScheduler::getFrameDelay() const
+{
+	if (maxFrameRate <= 0.f) return 0.f;
+	return lastFrameTime + 1.f / maxFrameRate - clock.getElapsedTime().asSeconds();
+}
+
+void FrameScheduler::wait( const std::vector<HANDLE>& events )
+{
+	DWORD timeout = INFINITE;
+	if (reasons != 0) {
+		const float delay = getFrameDelay();
+		if (delay <= 0.f) return;
+		// Round up, waking early would only spin until the cap allows the frame
+		timeout = static_cast<DWORD>(std::ceil(delay * 1000.f));
+	}
+
+	const float start = clock.getElapsedTime().asSeconds();
+	MsgWaitForMultipleObjectsEx(events.size(), events.empty() ? nullptr : &events[0], timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+	stats.sleepSeconds += clock.getElapsedTime().asSeconds() - start;
+	++stats.numWakeups;
+}
+
+bool FrameScheduler::beginFrame()
+{
+	if (reasons == 0 || getFrameDelay() > 0.f) return false;
+
+	frameReasons = reasons;
+	reasons = 0;
+	lastFrameTime = clock.getElapsedTime().asSeconds();
+	++stats.numFrames;
+	return true;
+}
+
+
+namespace
+{
+	const UINT inputMessage = WM_USER;
+	const UINT stopMessage  = WM_USER + 1;
+
+	struct Latency
+	{
+		unsigned int count;
+		float total;
+		float worst;
+
+		Latency() : count(0), total(0.f), worst(0.f) {}
+		void add(const float seconds) { ++count; total += seconds; worst = std::max(worst, seconds); }
+	};
+
+	struct Run
+	{
+		unsigned int numFrames;
+		float cpuSeconds;
+		float wallSeconds;
+		Latency sensor;
+		Latency input;
+
+		Run() : numFrames(0), cpuSeconds(0.f), wallSeconds(0.f), sensor(), input() {}
+	};
+
+	float getThreadSeconds() {
+		FILETIME creation, exit, kernel, user;
+		GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+		u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+		return static_cast<float>((k.QuadPart + u.QuadPart) * 1e-7);
+	}
+
+	// Stands in for drawing a frame, which keeps the loop busy for a while
+	void simulateDraw(const sf::Clock& clock, const float seconds) {
+		const float end = clock.getElapsedTime().asSeconds() + seconds;
+		while (clock.getElapsedTime().asSeconds() < end) {}
+	}
+
+	// Synthetic sensor signaling an auto reset event at a fixed rate and a
+	// replayed input trace posted to the loop thread, each stamped with the
+	// microsecond it was sent so the loop can measure how long it took to notice
+	class Harness
+	{
+	private:
+		sf::Clock& clock;
+		HANDLE sensorEvent;
+		DWORD loopThreadId;
+		std::atomic<long long> signalTime;
+
+	public:
+		Harness(sf::Clock& clock)
+			: clock(clock)
+			, sensorEvent(CreateEventW(NULL, FALSE, FALSE, NULL))
+			, loopThreadId(GetCurrentThreadId())
+			, signalTime(0)
+		{
+			// Make sure the loop thread has a message queue before anything is posted to it
+			MSG msg;
+			PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+		}
+
+		~Harness() { CloseHandle(sensorEvent); }
+
+		HANDLE getSensorEvent() const { return sensorEvent; }
+		float getSignalTime() const { return signalTime.load() * 1e-6f; }
+		float now() const { return clock.getElapsedTime().asSeconds(); }
+
+		// Feed the loop for the given time then post the stop message
+		void run(const float seconds, const float sensorRate, const std::vector<float>& inputTimes) {
+			const float start = now();
+			unsigned int nextInput = 0;
+			float nextSensor = (sensorRate > 0.f) ? start : 1e30f;
+			for (;;) {
+				const float nextTime = std::min(nextSensor, (nextInput < inputTimes.size()) ? start + inputTimes[nextInput] : 1e30f);
+				const float end = start + seconds;
+				if (nextTime >= end) {
+					Sleep(static_cast<DWORD>(std::max(0.f, end - now()) * 1000.f));
+					break;
+				}
+				const float wait = nextTime - now();
+				if (wait > 0.f) Sleep(static_cast<DWORD>(wait * 1000.f));
+
+				const long long stamp = clock.getElapsedTime().asMicroseconds();
+				if (nextTime == nextSensor) {
+					signalTime.store(stamp);
+					SetEvent(sensorEvent);
+					nextSensor += 1.f / sensorRate;
+				} else {
+					PostThreadMessage(loopThreadId, inputMessage, 0, static_cast<LPARAM>(stamp));
+					++nextInput;
+				}
+			}
+			PostThreadMessage(loopThreadId, stopMessage, 0, 0);
+		}
+
+		// Drain the message queue like processEvents, false once told to stop
+		bool pollInput(Latency& latency) {
+			bool running = true;
+			MSG msg;
+			while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+				if (msg.message == inputMessage) latency.add(now() - msg.lParam * 1e-6f);
+				if (msg.message == stopMessage)  running = false;
+			}
+			return running;
+		}
+
+		bool pollSensor(Latency& latency) {
+			if (WaitForSingleObject(sensorEvent, 0) != WAIT_OBJECT_0) return false;
+			latency.add(now() - getSignalTime());
+			return true;
+		}
+	};
+
+	// Recorded style input: drags of closely spaced mouse moves between single key presses
+	std::vector<float> makeInputTrace(const float seconds) {
+		std::vector<float> times;
+		for (float t = 0.5f; t < seconds; t += 2.f) {
+			times.push_back(t);
+			for (unsigned int i = 0; i < 40; ++i) {
+				times.push_back(t + 0.75f + i * 0.012f);
+			}
+		}
+		return times;
+	}
+
+	const float drawSeconds = 0.002f;
+
+	Run runPolling(sf::Clock& clock, const float seconds, const float sensorRate, const std::vector<float>& inputTimes) {
+		Harness harness(clock);
+		Run run;
+		const float startCpu = getThreadSeconds();
+		const float startWall = harness.now();
+		std::thread feeder([&]() { harness.run(seconds, sensorRate, inputTimes); });
+		for (;;) {
+			if (!harness.pollInput(run.input)) break;
+			harness.pollSensor(run.sensor);
+			simulateDraw(clock, drawSeconds);
+			++run.numFrames;
+		}
+		feeder.join();
+		run.cpuSeconds = getThreadSeconds() - startCpu;
+		run.wallSeconds = harness.now() - startWall;
+		return run;
+	}
+
+	Run runScheduled(sf::Clock& clock, const float seconds, const float sensorRate, const std::vector<float>& inputTimes, const float maxFrameRate) {
+		Harness harness(clock);
+		FrameScheduler scheduler(maxFrameRate);
+		const std::vector<HANDLE> events(1, harness.getSensorEvent());
+		Run run;
+		const float startCpu = getThreadSeconds();
+		const float startWall = harness.now();
+		std::thread feeder([&]() { harness.run(seconds, sensorRate, inputTimes); });
+		for (;;) {
+			scheduler.wait(events);
+			const unsigned int numInputs = run.input.count;
+			if (!harness.pollInput(run.input)) break;
+			if (run.input.count != numInputs)  scheduler.invalidate(FrameScheduler::INPUT_EVENT);
+			if (harness.pollSensor(run.sensor)) scheduler.invalidate(FrameScheduler::SENSOR_FRAME);
+			if (scheduler.beginFrame()) {
+				simulateDraw(clock, drawSeconds);
+			}
+		}
+		feeder.join();
+		run.numFrames = scheduler.getStats().numFrames;
+		run.cpuSeconds = getThreadSeconds() - startCpu;
+		run.wallSeconds = harness.now() - startWall;
+		return run;
+	}
+
+	void report(const char *name, const Run& run) {
+		std::cout << "  " << name << run.cpuSeconds * 100.f / run.wallSeconds << "% of a core, "
+		          << run.numFrames / run.wallSeconds << " frames per second";
+		if (run.sensor.count > 0) {
+			std::cout << ", sensor latency " << run.sensor.total * 1000.f / run.sensor.count
+			          << " ms (worst " << run.sensor.worst * 1000.f << ")";
+		}
+		if (run.input.count > 0) {
+			std::cout << ", input latency " << run.input.total * 1000.f / run.input.count
+			          << " ms (worst " << run.input.worst * 1000.f << ")";
+		}
+		std::cout << std::endl;
+	}
+}
+
+void FrameScheduler::benchmark( const float seconds, const float maxFrameRate )
+{
+	sf::Clock clock;
+	const float sensorRate = 30.f;
+	const std::vector<float> noInput;
+	const std::vector<float> inputTimes = makeInputTrace(seconds);
+
+	std::cout << "Frame scheduling, " << seconds << " seconds each, " << drawSeconds * 1000.f << " ms per drawn frame, "
+	          << sensorRate << " Hz synthetic sensor, " << inputTimes.size() << " replayed input events, ";
+	if (maxFrameRate > 0.f) std::cout << "capped at " << maxFrameRate << " frames per second:" << std::endl;
+	else                    std::cout << "uncapped:" << std::endl;
+
+	// The feeder sleeps between events too, keep its timing as fine as the scheduler's
+	timeBeginPeriod(1);
+	report("polling, idle:   ", runPolling(clock, seconds, 0.f, noInput));
+	report("polling, live:   ", runPolling(clock, seconds, sensorRate, inputTimes));
+	report("scheduled, idle: ", runScheduled(clock, seconds, 0.f, noInput, maxFrameRate));
+	report("scheduled, live: ", runScheduled(clock, seconds, sensorRate, inputTimes, maxFrameRate));
+	timeEndPeriod(1);
+}
@@ -0,0 +1,75 @@
+#pragma once
+/************************************************************************/
+/* FrameScheduler
+/* --------------
+/* Decides when the main loop draws, sleeping while nothing changed
+/************************************************************************/
+#include <Windows.h>
+
+#include <SFML/System/Clock.hpp>
+
+#include <vector>
+
+
+// Anything that changes what is on screen invalidates the frame with a
+// reason. wait() sleeps until one of the given event handles is signaled
+// or a message arrives for the thread, unless a frame is already due, and
+// beginFrame() says whether to draw. An optional cap keeps frames at least
+// 1 / maxFrameRate seconds apart.
+class FrameScheduler
+{
+public:
+	// Why a frame needs drawing, combined as flags
+	enum EReason {
+		SENSOR_FRAME     = 0x01,
+		PLAYBACK_TICK    = 0x02,
+		INPUT_EVENT      = 0x04,
+		INTERFACE_CHANGE = 0x08
+	};
+
+	struct Stats
+	{
+		unsigned int numWakeups;
+		unsigned int numFrames;
+		float sleepSeconds;
+	};
+
+private:
+	sf::Clock clock;
+	float maxFrameRate;
+	float lastFrameTime;
+	unsigned int reasons;      // pending, cleared when a frame begins
+	unsigned int frameReasons; // of the frame being drawn
+	Stats stats;
+
+public:
+	FrameScheduler(const float maxFrameRate = 0.f);
+	~FrameScheduler();
+
+	void invalidate(const EReason reason) { reasons |= reason; }
+	bool isDirty() const { return reasons != 0; }
+
+	// Sleep until an event is signaled, a message is queued for this thread or a
+	// pending frame is allowed by the cap, returns at once if a frame is due now
+	void wait(const std::vector<HANDLE>& events);
+
+	// True if a frame should be drawn now, takes the pending reasons
+	bool beginFrame();
+
+	// Frames per second at most, zero for no cap
+	void setMaxFrameRate(const float framesPerSecond) { maxFrameRate = (framesPerSecond > 0.f) ? framesPerSecond : 0.f; }
+	float getMaxFrameRate() const { return maxFrameRate; }
+
+	unsigned int getFrameReasons() const { return frameReasons; }
+	const Stats& getStats() const { return stats; }
+	void resetStats();
+
+	// Compare a polling loop like the original main loop against a scheduled
+	// one, fed by a synthetic 30 Hz sensor and a replayed input trace, each
+	// idle and then live for the given number of seconds
+	static void benchmark(const float seconds, const float maxFrameRate);
+
+private:
+	// Seconds until the cap allows the next frame
+	float getFrameDelay() const;
+};
@@ -0,0 +1,146 @@
+/************************************************************************/
+/* Framebuffer
+/* -----------
+/* Offscreen render target with asynchronous readback
+/************************************************************************/
+#include "Framebuffer.h"
+#include "GLExtensions.h"
+
+#include <cstring>
+#include <iostream>
+
+
+Framebuffer::Framebuffer( const unsigned int width, const unsigned int height )
+	: width(width)
+	, height(height)
+	, framebuffer(0)
+	, colorBuffer(0)
+	, depthBuffer(0)
+	, oldestRead(0)
+	, numQueued(0)
+{
+	for (unsigned int i = 0; i < NUM_READ_BUFFERS; ++i) {
+		readBuffers[i] = 0;
+	}
+}
+
+Framebuffer::~Framebuffer()
+{
+	destroy();
+}
+
+bool Framebuffer::create()
+{
+	if (framebuffer != 0) return true;
+	if (!GLExtensions::hasFramebuffers()) {
+		std::cerr << "Failed to create framebuffer, framebuffer objects are not supported." << std::endl;
+		return false;
+	}
+
+	GLExtensions::genRenderbuffers(1, &colorBuffer);
+	GLExtensions::bindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	GLExtensions::renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	GLExtensions::genRenderbuffers(1, &depthBuffer);
+	GLExtensions::bindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	GLExtensions::renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	GLExtensions::bindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLExtensions::genFramebuffers(1, &framebuffer);
+	GLExtensions::bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	GLExtensions::framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	GLExtensions::framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,  GL_RENDERBUFFER, depthBuffer);
+	const GLenum status = GLExtensions::checkFramebufferStatus(GL_FRAMEBUFFER);
+	GLExtensions::bindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Failed to create " << width << "x" << height << " framebuffer, status 0x"
+		          << std::hex << status << std::dec << std::endl;
+		destroy();
+		return false;
+	}
+
+	if (GLExtensions::hasPixelBuffers()) {
+		GLExtensions::genBuffers(NUM_READ_BUFFERS, readBuffers);
+		for (unsigned int i = 0; i < NUM_READ_BUFFERS; ++i) {
+			GLExtensions::bindBuffer(GL_PIXEL_PACK_BUFFER, readBuffers[i]);
+			GLExtensions::bufferData(GL_PIXEL_PACK_BUFFER, getBytes(), nullptr, GL_STREAM_READ);
+		}
+		GLExtensions::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	oldestRead = numQueued = 0;
+	return true;
+}
+
+void Framebuffer::destroy()
+{
+	if (readBuffers[0] != 0) {
+		GLExtensions::deleteBuffers(NUM_READ_BUFFERS, readBuffers);
+		for (unsigned int i = 0; i < NUM_READ_BUFFERS; ++i) {
+			readBuffers[i] = 0;
+		}
+	}
+	if (framebuffer != 0) GLExtensions::deleteFramebuffers(1, &framebuffer);
+	if (colorBuffer != 0) GLExtensions::deleteRenderbuffers(1, &colorBuffer);
+	if (depthBuffer != 0) GLExtensions::deleteRenderbuffers(1, &depthBuffer);
+	framebuffer = colorBuffer = depthBuffer = 0;
+	oldestRead = numQueued = 0;
+}
+
+void Framebuffer::bind()
+{
+	GLExtensions::bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+void Framebuffer::unbind()
+{
+	GLExtensions::bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool Framebuffer::queueRead()
+{
+	if (framebuffer == 0 || numQueued == NUM_READ_BUFFERS) return false;
+
+	const unsigned int slot = (oldestRead + numQueued) % NUM_READ_BUFFERS;
+	GLExtensions::bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	if (readBuffers[0] != 0) {
+		// Destination is an offset into the bound buffer, the call returns before the copy is done
+		GLExtensions::bindBuffer(GL_PIXEL_PACK_BUFFER, readBuffers[slot]);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *) 0);
+		GLExtensions::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	} else {
+		readCopies[slot].resize(getBytes());
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &readCopies[slot][0]);
+	}
+	++numQueued;
+	return true;
+}
+
+bool Framebuffer::finishRead( std::vector<GLubyte>& pixels )
+{
+	if (numQueued == 0) return false;
+
+	const unsigned int slot = oldestRead;
+	oldestRead = (oldestRead + 1) % NUM_READ_BUFFERS;
+	--numQueued;
+
+	if (readBuffers[0] == 0) {
+		pixels.swap(readCopies[slot]);
+		return true;
+	}
+
+	// Mapping waits for this read only, later ones keep going
+	pixels.resize(getBytes());
+	GLExtensions::bindBuffer(GL_PIXEL_PACK_BUFFER, readBuffers[slot]);
+	const GLubyte *mapped = (const GLubyte *) GLExtensions::mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (mapped != nullptr) {
+		memcpy(&pixels[0], mapped, getBytes());
+		GLExtensions::unmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	GLExtensions::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (mapped == nullptr) {
+		std::cerr << "Failed to map pixel buffer for framebuffer readback." << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+/************************************************************************/
+/* Framebuffer
+/* -----------
+/* Offscreen render target with asynchronous readback
+/************************************************************************/
+#include <SFML/OpenGL.hpp>
+
+#include <vector>
+
+
+// Color and depth renderbuffers of a fixed size. Reads go through a ring of
+// pixel pack buffers: queueRead() starts the copy without waiting for the
+// frame to finish rendering, finishRead() collects it a frame or more later,
+// so the GPU keeps rendering while earlier frames are copied out.
+class Framebuffer
+{
+public:
+	static const unsigned int NUM_READ_BUFFERS = 2;
+
+private:
+	unsigned int width;
+	unsigned int height;
+
+	GLuint framebuffer;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+
+	GLuint readBuffers[NUM_READ_BUFFERS];
+	std::vector<GLubyte> readCopies[NUM_READ_BUFFERS]; // without pixel buffers
+	unsigned int oldestRead;
+	unsigned int numQueued;
+
+public:
+	Framebuffer(const unsigned int width, const unsigned int height);
+	~Framebuffer();
+
+	// Needs a current context, false if framebuffers are missing or the format is unsupported
+	bool create();
+	void destroy();
+
+	// Direct rendering to this framebuffer and set the viewport to cover it
+	void bind();
+	// Back to the window's framebuffer
+	void unbind();
+
+	// Start copying the current contents, false while NUM_READ_BUFFERS reads are queued
+	bool queueRead();
+	// Oldest queued read as RGBA rows from the bottom up, false if none is queued
+	bool finishRead(std::vector<GLubyte>& pixels);
+	unsigned int getNumQueued() const { return numQueued; }
+
+	unsigned int getWidth()  const { return width;  }
+	unsigned int getHeight() const { return height; }
+	unsigned int getBytes()  const { return 4 * width * height; }
+
+private:
+	// Not copyable, owns GL objects
+	Framebuffer(const Framebuffer& other);
+	Framebuffer& operator=(const Framebuffer& other);
+};
@@ -0,0 +1,106 @@
+/************************************************************************/
+/* GLExtensions
+/* ------------
+/* Entry points beyond OpenGL 1.1, loaded at runtime from the driver
+/************************************************************************/
+#include "GLExtensions.h"
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+GLExtensions::GenBuffersProc      GLExtensions::genBuffers      = nullptr;
+GLExtensions::DeleteBuffersProc   GLExtensions::deleteBuffers   = nullptr;
+GLExtensions::BindBufferProc      GLExtensions::bindBuffer      = nullptr;
+GLExtensions::BufferDataProc      GLExtensions::bufferData      = nullptr;
+GLExtensions::BufferSubDataProc   GLExtensions::bufferSubData   = nullptr;
+GLExtensions::MultiDrawArraysProc GLExtensions::multiDrawArrays = nullptr;
+GLExtensions::MapBufferProc       GLExtensions::mapBuffer       = nullptr;
+GLExtensions::UnmapBufferProc     GLExtensions::unmapBuffer     = nullptr;
+
+GLExtensions::GenFramebuffersProc         GLExtensions::genFramebuffers         = nullptr;
+GLExtensions::DeleteFramebuffersProc      GLExtensions::deleteFramebuffers      = nullptr;
+GLExtensions::BindFramebufferProc         GLExtensions::bindFramebuffer         = nullptr;
+GLExtensions::CheckFramebufferStatusProc  GLExtensions::checkFramebufferStatus  = nullptr;
+GLExtensions::GenRenderbuffersProc        GLExtensions::genRenderbuffers        = nullptr;
+GLExtensions::DeleteRenderbuffersProc     GLExtensions::deleteRenderbuffers     = nullptr;
+GLExtensions::BindRenderbufferProc        GLExtensions::bindRenderbuffer        = nullptr;
+GLExtensions::RenderbufferStorageProc     GLExtensions::renderbufferStorage     = nullptr;
+GLExtensions::FramebufferRenderbufferProc GLExtensions::framebufferRenderbuffer = nullptr;
+
+bool GLExtensions::bufferObjects = false;
+bool GLExtensions::multiDraw     = false;
+bool GLExtensions::pixelBuffers  = false;
+bool GLExtensions::framebuffers  = false;
+
+namespace
+{
+	// Off Windows the only contexts are OffscreenContext's, which are EGL's
+	void *getProcAddress(const char *name) {
+#ifdef _WIN32
+		return (void *) wglGetProcAddress(name);
+#else
+		return (void *) eglGetProcAddress(name);
+#endif
+	}
+
+	// Try the core name first, then the extension name
+	template<typename Proc>
+	bool loadProc(Proc& proc, const char *name, const char *arbName) {
+		proc = (Proc) getProcAddress(name);
+		if (proc == nullptr) proc = (Proc) getProcAddress(arbName);
+		return proc != nullptr;
+	}
+
+	bool hasVersion(const int major, const int minor) {
+		const char *version = (const char *) glGetString(GL_VERSION);
+		int actualMajor = 0, actualMinor = 0;
+		if (version == nullptr || sscanf(version, "%d.%d", &actualMajor, &actualMinor) != 2) return false;
+		return actualMajor > major || (actualMajor == major && actualMinor >= minor);
+	}
+
+	bool hasExtension(const char *name) {
+		const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+		return extensions != nullptr && strstr(extensions, name) != nullptr;
+	}
+}
+
+
+void GLExtensions::load()
+{
+	bufferObjects = loadProc(genBuffers,    "glGenBuffers",    "glGenBuffersARB")
+	              & loadProc(deleteBuffers, "glDeleteBuffers", "glDeleteBuffersARB")
+	              & loadProc(bindBuffer,    "glBindBuffer",    "glBindBufferARB")
+	              & loadProc(bufferData,    "glBufferData",    "glBufferDataARB")
+	              & loadProc(bufferSubData, "glBufferSubData", "glBufferSubDataARB");
+
+	multiDraw = loadProc(multiDrawArrays, "glMultiDrawArrays", "glMultiDrawArraysEXT");
+
+	// Pixel buffers reuse the buffer object entry points with new targets
+	pixelBuffers = bufferObjects
+	             & loadProc(mapBuffer,   "glMapBuffer",   "glMapBufferARB")
+	             & loadProc(unmapBuffer, "glUnmapBuffer", "glUnmapBufferARB")
+	             & (hasVersion(2, 1) || hasExtension("GL_ARB_pixel_buffer_object"));
+
+	// Core and ARB_framebuffer_object share names, fall back to EXT_framebuffer_object
+	framebuffers = loadProc(genFramebuffers,         "glGenFramebuffers",         "glGenFramebuffersEXT")
+	             & loadProc(deleteFramebuffers,      "glDeleteFramebuffers",      "glDeleteFramebuffersEXT")
+	             & loadProc(bindFramebuffer,         "glBindFramebuffer",         "glBindFramebufferEXT")
+	             & loadProc(checkFramebufferStatus,  "glCheckFramebufferStatus",  "glCheckFramebufferStatusEXT")
+	             & loadProc(genRenderbuffers,        "glGenRenderbuffers",        "glGenRenderbuffersEXT")
+	             & loadProc(deleteRenderbuffers,     "glDeleteRenderbuffers",     "glDeleteRenderbuffersEXT")
+	             & loadProc(bindRenderbuffer,        "glBindRenderbuffer",        "glBindRenderbufferEXT")
+	             & loadProc(renderbufferStorage,     "glRenderbufferStorage",     "glRenderbufferStorageEXT")
+	             & loadProc(framebufferRenderbuffer, "glFramebufferRenderbuffer", "glFramebufferRenderbufferEXT");
+
+	std::cout << "OpenGL " << (const char *) glGetString(GL_VERSION) << " ("
+	          << (const char *) glGetString(GL_RENDERER) << ")" << std::endl
+	          << "  buffer objects: " << (bufferObjects ? "yes" : "no")
+	          << ", multi draw: " << (multiDraw ? "yes" : "no")
+	          << ", pixel buffers: " << (pixelBuffers ? "yes" : "no")
+	          << ", framebuffers: " << (framebuffers ? "yes" : "no") << std::endl;
+}
@@ -0,0 +1,100 @@
+#pragma once
+/************************************************************************/
+/* GLExtensions
+/* ------------
+/* Entry points beyond OpenGL 1.1, loaded at runtime from the driver
+/************************************************************************/
+#include <SFML/OpenGL.hpp>
+
+#include <cstddef>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// Buffer objects (OpenGL 1.5)
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STREAM_DRAW          0x88E0
+#define GL_STREAM_READ          0x88E1
+#define GL_STATIC_DRAW          0x88E4
+#define GL_DYNAMIC_DRAW         0x88E8
+#define GL_READ_ONLY            0x88B8
+#define GL_WRITE_ONLY           0x88B9
+#endif
+
+// Pixel buffer objects (OpenGL 2.1)
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER    0x88EB
+#define GL_PIXEL_UNPACK_BUFFER  0x88EC
+#endif
+
+// Framebuffer objects (OpenGL 3.0, same values as EXT_framebuffer_object)
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER          0x8D40
+#define GL_RENDERBUFFER         0x8D41
+#define GL_COLOR_ATTACHMENT0    0x8CE0
+#define GL_DEPTH_ATTACHMENT     0x8D00
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+#ifndef GL_DEPTH_COMPONENT24
+#define GL_DEPTH_COMPONENT24    0x81A6
+#endif
+
+
+class GLExtensions
+{
+public:
+	typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint *buffers);
+	typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint *buffers);
+	typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+	typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const GLvoid *data, GLenum usage);
+	typedef void (APIENTRY *BufferSubDataProc)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const GLvoid *data);
+	typedef void (APIENTRY *MultiDrawArraysProc)(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawcount);
+	typedef GLvoid* (APIENTRY *MapBufferProc)(GLenum target, GLenum access);
+	typedef GLboolean (APIENTRY *UnmapBufferProc)(GLenum target);
+	typedef void (APIENTRY *GenFramebuffersProc)(GLsizei n, GLuint *framebuffers);
+	typedef void (APIENTRY *DeleteFramebuffersProc)(GLsizei n, const GLuint *framebuffers);
+	typedef void (APIENTRY *BindFramebufferProc)(GLenum target, GLuint framebuffer);
+	typedef GLenum (APIENTRY *CheckFramebufferStatusProc)(GLenum target);
+	typedef void (APIENTRY *GenRenderbuffersProc)(GLsizei n, GLuint *renderbuffers);
+	typedef void (APIENTRY *DeleteRenderbuffersProc)(GLsizei n, const GLuint *renderbuffers);
+	typedef void (APIENTRY *BindRenderbufferProc)(GLenum target, GLuint renderbuffer);
+	typedef void (APIENTRY *RenderbufferStorageProc)(GLenum target, GLenum format, GLsizei width, GLsizei height);
+	typedef void (APIENTRY *FramebufferRenderbufferProc)(GLenum target, GLenum attachment, GLenum renderbufferTarget, GLuint renderbuffer);
+
+	static GenBuffersProc      genBuffers;
+	static DeleteBuffersProc   deleteBuffers;
+	static BindBufferProc      bindBuffer;
+	static BufferDataProc      bufferData;
+	static BufferSubDataProc   bufferSubData;
+	static MultiDrawArraysProc multiDrawArrays;
+	static MapBufferProc       mapBuffer;
+	static UnmapBufferProc     unmapBuffer;
+
+	static GenFramebuffersProc         genFramebuffers;
+	static DeleteFramebuffersProc      deleteFramebuffers;
+	static BindFramebufferProc         bindFramebuffer;
+	static CheckFramebufferStatusProc  checkFramebufferStatus;
+	static GenRenderbuffersProc        genRenderbuffers;
+	static DeleteRenderbuffersProc     deleteRenderbuffers;
+	static BindRenderbufferProc        bindRenderbuffer;
+	static RenderbufferStorageProc     renderbufferStorage;
+	static FramebufferRenderbufferProc framebufferRenderbuffer;
+
+	// Load every entry point from the current context, call once it exists.
+	// Missing groups leave their entry points null, callers check the has*() flags.
+	static void load();
+
+	static bool hasBufferObjects() { return bufferObjects; }
+	static bool hasMultiDraw()     { return multiDraw; }
+	static bool hasPixelBuffers()  { return pixelBuffers; }
+	static bool hasFramebuffers()  { return framebuffers; }
+
+private:
+	static bool bufferObjects;
+	static bool multiDraw;
+	static bool pixelBuffers;
+	static bool framebuffers;
+};
@@ -0,0 +1,154 @@
+/************************************************************************/
+/* ImageSequenceWriter
+/* -------------------
+/* Numbered image files encoded and written by a pool of worker threads
+/************************************************************************/
+#include "ImageSequenceWriter.h"
+
+#include <SFML/Graphics/Image.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+
+ImageSequenceWriter::ImageSequenceWriter( const std::string& prefix, const std::string& extension,
+                                          const unsigned int numThreads, const unsigned int maxQueued )
+	: prefix(prefix)
+	, extension(extension)
+	, maxQueued(std::max(1u, maxQueued))
+	, mutex()
+	, queueChanged()
+	, queue()
+	, numBusy(0)
+	, numWritten(0)
+	, numFailed(0)
+	, stopping(false)
+	, workers()
+{
+	for (unsigned int i = 0; i < std::max(1u, numThreads); ++i) {
+		workers.push_back(std::thread(&ImageSequenceWriter::work, this));
+	}
+}
+
+ImageSequenceWriter::~ImageSequenceWriter()
+{
+	finish();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	queueChanged.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void ImageSequenceWriter::write( const unsigned int index, const unsigned int width, const unsigned int height,
+                                 std::vector<unsigned char>& pixels, const bool bottomUp )
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (queue.size() >= maxQueued) {
+		queueChanged.wait(lock);
+	}
+	queue.push_back(Image());
+	Image& image = queue.back();
+	image.index    = index;
+	image.width    = width;
+	image.height   = height;
+	image.bottomUp = bottomUp;
+	image.pixels.swap(pixels);
+	pixels.clear();
+	lock.unlock();
+	queueChanged.notify_all();
+}
+
+bool ImageSequenceWriter::finish()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!queue.empty() || numBusy > 0) {
+		queueChanged.wait(lock);
+	}
+	return numFailed == 0;
+}
+
+unsigned int ImageSequenceWriter::getNumWritten()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numWritten;
+}
+
+std::string ImageSequenceWriter::getFileName( const unsigned int index ) const
+{
+	char number[16];
+	sprintf(number, "%05u", index);
+	return prefix + number + "." + extension;
+}
+
+void ImageSequenceWriter::work()
+{
+	for (;;) {
+		Image image;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (queue.empty() && !stopping) {
+				queueChanged.wait(lock);
+			}
+			if (queue.empty()) return;
+			image.index    = queue.front().index;
+			image.width    = queue.front().width;
+			image.height   = queue.front().height;
+			image.bottomUp = queue.front().bottomUp;
+			image.pixels.swap(queue.front().pixels);
+			queue.pop_front();
+			++numBusy;
+		}
+		queueChanged.notify_all();
+
+		const bool saved = save(image);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--numBusy;
+			if (saved) ++numWritten;
+			else       ++numFailed;
+		}
+		queueChanged.notify_all();
+	}
+}
+
+bool ImageSequenceWriter::save( Image& image ) const
+{
+	const std::string filename = getFileName(image.index);
+	const unsigned int rowBytes = 4 * image.width;
+
+	// OpenGL reads rows from the bottom up, image files start at the top
+	if (image.bottomUp) {
+		std::vector<unsigned char> row(rowBytes);
+		for (unsigned int top = 0, bottom = image.height - 1; top < bottom; ++top, --bottom) {
+			unsigned char *a = &image.pixels[top * rowBytes];
+			unsigned char *b = &image.pixels[bottom * rowBytes];
+			memcpy(&row[0], a, rowBytes);
+			memcpy(a, b, rowBytes);
+			memcpy(b, &row[0], rowBytes);
+		}
+	}
+
+	if (extension == "raw") {
+		std::ofstream stream(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+		if (stream.is_open()) {
+			stream.write((const char *) &image.pixels[0], image.pixels.size());
+		}
+		if (!stream.is_open() || !stream.good()) {
+			std::cerr << "Failed to write '" << filename << "'." << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	sf::Image encoder;
+	encoder.create(image.width, image.height, &image.pixels[0]);
+	return encoder.saveToFile(filename);
+}
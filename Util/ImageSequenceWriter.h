@@ -0,0 +1,67 @@
+#pragma once
+/************************************************************************/
+/* ImageSequenceWriter
+/* -------------------
+/* Numbered image files encoded and written by a pool of worker threads
+/************************************************************************/
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Images are queued from one thread and encoded on the workers, so the
+// producer can render the next frames meanwhile. The queue is bounded,
+// write() blocks while it is full rather than buffering a whole recording.
+// Formats are whatever sf::Image saves (png, bmp, tga, jpg) or "raw" for
+// plain RGBA rows from the top down.
+class ImageSequenceWriter
+{
+private:
+	struct Image
+	{
+		unsigned int index;
+		unsigned int width;
+		unsigned int height;
+		bool bottomUp;
+		std::vector<unsigned char> pixels;
+	};
+
+	std::string prefix;
+	std::string extension;
+	unsigned int maxQueued;
+
+	std::mutex mutex;
+	std::condition_variable queueChanged;
+	std::deque<Image> queue;
+	unsigned int numBusy;
+	unsigned int numWritten;
+	unsigned int numFailed;
+	bool stopping;
+	std::vector<std::thread> workers;
+
+public:
+	// Files are named prefix00000.extension, prefix00001.extension, ...
+	ImageSequenceWriter(const std::string& prefix, const std::string& extension,
+	                    const unsigned int numThreads, const unsigned int maxQueued);
+	~ImageSequenceWriter();
+
+	// Queue an RGBA image, taking its pixels and leaving the vector empty
+	void write(const unsigned int index, const unsigned int width, const unsigned int height,
+	           std::vector<unsigned char>& pixels, const bool bottomUp);
+
+	// Wait for every queued image to be written, false if any failed
+	bool finish();
+
+	unsigned int getNumWritten();
+	std::string getFileName(const unsigned int index) const;
+
+private:
+	void work();
+	bool save(Image& image) const;
+
+	ImageSequenceWriter(const ImageSequenceWriter& other);
+	ImageSequenceWriter& operator=(const ImageSequenceWriter& other);
+};
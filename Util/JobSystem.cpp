@@ -0,0 +1,272 @@
+/************************************************************************/
+/* JobSystem
+/* ---------
+/* Work stealing worker threads, and graphs of dependent jobs to run on them
+/************************************************************************/
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef _MSC_VER
+#define JOBS_THREAD_LOCAL __declspec(thread)
+#else
+#define JOBS_THREAD_LOCAL __thread
+#endif
+
+
+namespace
+{
+	// A lock per deque keeps stealing simple, jobs are coarse enough that
+	// the lock is hardly ever contended
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<JobSystem::Job> jobs;
+	};
+
+	// One queue per worker, the last one is shared by every other thread
+	std::vector<std::unique_ptr<Queue> > queues;
+	std::vector<std::thread> workers;
+	std::atomic<bool> started(false);
+	std::mutex startMutex;
+
+	std::atomic<unsigned int> numPending(0);  // queued, not yet taken
+	std::atomic<unsigned int> numSleeping(0);
+	std::atomic<bool> stopping(false);
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+
+	JOBS_THREAD_LOCAL int workerIndex = -1;
+
+	// Own jobs newest first, then the oldest of everybody else's starting
+	// past our own queue, so thieves spread over their victims
+	bool take(JobSystem::Job& job)
+	{
+		const unsigned int numQueues = queues.size();
+		if (workerIndex >= 0) {
+			Queue& own = *queues[workerIndex];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.jobs.empty()) {
+				job = std::move(own.jobs.back());
+				own.jobs.pop_back();
+				numPending.fetch_sub(1);
+				return true;
+			}
+		}
+		const unsigned int first = (workerIndex >= 0) ? workerIndex + 1 : numQueues - 1;
+		for (unsigned int k = 0; k < numQueues; ++k) {
+			const unsigned int victim = (first + k) % numQueues;
+			if (static_cast<int>(victim) == workerIndex) continue;
+
+			Queue& queue = *queues[victim];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty()) {
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+				numPending.fetch_sub(1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void work(const unsigned int index)
+	{
+		workerIndex = index;
+		std::stringstream name;
+		name << "job worker #" << index;
+		Tracer::setThreadName(name.str());
+
+		JobSystem::Job job;
+		for (;;) {
+			if (take(job)) {
+				job();
+				job = nullptr;
+				continue;
+			}
+
+			// Announce sleeping before the last look at the queues, pairs with submit()
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			numSleeping.fetch_add(1);
+			wake.wait(lock, []() { return numPending.load() > 0 || stopping.load(); });
+			numSleeping.fetch_sub(1);
+			if (stopping && numPending == 0) break;
+		}
+	}
+
+	void stopWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+		stopping = false;
+		started = false;
+	}
+
+	// Joins the workers before the queues they use are destroyed at exit
+	struct Shutdown
+	{
+		~Shutdown() { JobSystem::stop(); }
+	} shutdown;
+}
+
+
+void JobSystem::start()
+{
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	start((hardwareThreads > 1) ? hardwareThreads - 1 : 1);
+}
+
+void JobSystem::start( const unsigned int numWorkers )
+{
+	std::lock_guard<std::mutex> lock(startMutex);
+	if (started && workers.size() == numWorkers) return;
+	if (started) {
+		stopWorkers();
+	}
+	assert(numPending == 0);
+
+	queues.clear();
+	for (unsigned int i = 0; i <= numWorkers; ++i) {
+		queues.push_back(std::unique_ptr<Queue>(new Queue()));
+	}
+	for (unsigned int i = 0; i < numWorkers; ++i) {
+		workers.push_back(std::thread(work, i));
+	}
+	started = true;
+}
+
+void JobSystem::stop()
+{
+	std::lock_guard<std::mutex> lock(startMutex);
+	if (started) {
+		stopWorkers();
+	}
+}
+
+unsigned int JobSystem::getNumWorkers()
+{
+	if (!started) start();
+	return workers.size();
+}
+
+void JobSystem::submit( const Job& job )
+{
+	if (!started) start();
+
+	// Workers keep what they spawn, other threads share the last queue
+	Queue& queue = (workerIndex >= 0) ? *queues[workerIndex] : *queues.back();
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	numPending.fetch_add(1);
+	if (numSleeping.load() > 0) {
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_one();
+	}
+}
+
+bool JobSystem::runPending()
+{
+	Job job;
+	if (!started || !take(job)) return false;
+	job();
+	return true;
+}
+
+void JobSystem::wait( const std::atomic<unsigned int>& counter )
+{
+	while (counter.load(std::memory_order_acquire) != 0) {
+		if (!runPending()) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+
+JobGraph::JobGraph()
+	: nodes()
+	, remaining(0)
+	, frame(Tracer::NO_FRAME)
+{}
+
+JobGraph::~JobGraph()
+{
+	wait();
+}
+
+JobGraph::JobId JobGraph::add( const char *name, const JobSystem::Job& job )
+{
+	assert(isDone());
+	std::unique_ptr<Node> node(new Node());
+	node->name = name;
+	node->job = job;
+	node->numDependencies = 0;
+	node->pending = 0;
+	nodes.push_back(std::move(node));
+	return nodes.size() - 1;
+}
+
+void JobGraph::addDependency( const JobId job, const JobId dependsOn )
+{
+	assert(dependsOn < job && job < nodes.size());
+	nodes[dependsOn]->successors.push_back(job);
+	++nodes[job]->numDependencies;
+}
+
+void JobGraph::run( const unsigned int frame )
+{
+	assert(isDone());
+	if (nodes.empty()) return;
+
+	this->frame = frame;
+	for (auto& node : nodes) {
+		node->pending.store(node->numDependencies, std::memory_order_relaxed);
+	}
+	remaining.store(nodes.size(), std::memory_order_release);
+	for (JobId id = 0; id < nodes.size(); ++id) {
+		if (nodes[id]->numDependencies == 0) {
+			JobSystem::submit([this, id]() { execute(id); });
+		}
+	}
+}
+
+void JobGraph::wait()
+{
+	JobSystem::wait(remaining);
+}
+
+void JobGraph::clear()
+{
+	wait();
+	nodes.clear();
+}
+
+void JobGraph::execute( const JobId id )
+{
+	Node& node = *nodes[id];
+	{
+		Tracer::Scope trace(node.name, "jobs", frame);
+		node.job();
+	}
+	for (auto successor : node.successors) {
+		if (nodes[successor]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			JobSystem::submit([this, successor]() { execute(successor); });
+		}
+	}
+	// Last, whoever waits on the graph may clear it right after
+	remaining.fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,91 @@
+#pragma once
+/************************************************************************/
+/* JobSystem
+/* ---------
+/* Work stealing worker threads, and graphs of dependent jobs to run on them
+/************************************************************************/
+#include "Tracer.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+// A fixed set of workers, started on first use, each with a deque of jobs of
+// its own. Workers push and pop their own jobs at the back, where the data
+// they just touched is still in cache, and idle workers steal the oldest
+// jobs from the front of the others'. Jobs submitted from other threads go to
+// a shared queue every worker takes from. Threads waiting for jobs run
+// pending jobs meanwhile, so waiting from inside a job never deadlocks.
+class JobSystem
+{
+public:
+	typedef std::function<void()> Job;
+
+	// Start numWorkers workers, replacing any running with a different number.
+	// Only while no jobs are pending. Without a number, one per hardware
+	// thread but the caller's, as waiting callers run jobs too.
+	static void start();
+	static void start(const unsigned int numWorkers);
+	// Run what is still queued and join the workers
+	static void stop();
+
+	static unsigned int getNumWorkers();
+
+	static void submit(const Job& job);
+
+	// Run one pending job on the calling thread, false if there was none
+	static bool runPending();
+
+	// Run pending jobs until counter drops to zero
+	static void wait(const std::atomic<unsigned int>& counter);
+};
+
+
+// Jobs with dependencies between them, typically one graph per frame. Each
+// job is submitted once the jobs it depends on have all finished.
+class JobGraph
+{
+public:
+	typedef unsigned int JobId;
+
+private:
+	struct Node
+	{
+		const char *name;              // traced as, must outlive the graph
+		JobSystem::Job job;
+		std::vector<JobId> successors;
+		unsigned int numDependencies;
+		std::atomic<unsigned int> pending;
+	};
+
+	std::vector<std::unique_ptr<Node> > nodes;
+	std::atomic<unsigned int> remaining;
+	unsigned int frame;
+
+public:
+	JobGraph();
+	~JobGraph();
+
+	// Build the graph before run(), jobs may only depend on jobs added before them
+	JobId add(const char *name, const JobSystem::Job& job);
+	void addDependency(const JobId job, const JobId dependsOn);
+
+	// Submit the jobs that depend on nothing, the rest follow as they become
+	// ready. Traces tag the jobs with frame.
+	void run(const unsigned int frame = Tracer::NO_FRAME);
+	void wait();
+	bool isDone() const { return remaining.load(std::memory_order_acquire) == 0; }
+
+	// Wait for the jobs and forget them, to build the next frame's
+	void clear();
+
+	unsigned int getNumJobs() const { return nodes.size(); }
+
+private:
+	void execute(const JobId id);
+
+	JobGraph(const JobGraph& other);
+	JobGraph& operator=(const JobGraph& other);
+};
@@ -0,0 +1,172 @@
+/************************************************************************/
+/* Latency
+/* -------
+/* A static helper class for histograms of how old frames are at each stage
+/************************************************************************/
+#include "Latency.h"
+#include "MonotonicClock.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+namespace
+{
+	const char *stageNames[Latency::NUM_STAGES] = {
+		"dequeued",
+		"live frame",
+		"published",
+		"recorded",
+		"gesture",
+		"displayed"
+	};
+
+	// Zero initialized before any thread starts
+	std::atomic<unsigned int> buckets[Latency::NUM_STAGES][Latency::NUM_BUCKETS];
+	std::atomic<uint64_t> maxAges[Latency::NUM_STAGES]; // nanoseconds
+
+	static_assert(Latency::BUCKETS_PER_DOUBLING == 4, "getBucket() splits each doubling by its next two bits");
+
+	float getBucketMiddle(const unsigned int bucket)
+	{
+		return 0.5f * (Latency::getBucketStart(bucket) + Latency::getBucketEnd(bucket)) / 1000.f;
+	}
+
+	// Age in milliseconds below which a fraction of the counted frames fall
+	float getPercentile(const unsigned int *counts, const unsigned long long total, const float fraction)
+	{
+		const unsigned long long rank = static_cast<unsigned long long>(fraction * (total - 1));
+		unsigned long long seen = 0;
+		for (unsigned int bucket = 0; bucket < Latency::NUM_BUCKETS; ++bucket) {
+			seen += counts[bucket];
+			if (seen > rank) return getBucketMiddle(bucket);
+		}
+		return getBucketMiddle(Latency::NUM_BUCKETS - 1);
+	}
+}
+
+
+void Latency::record( const EStage stage, const uint64_t captureTime )
+{
+	if (captureTime == 0) return;
+	record(stage, captureTime, MonotonicClock::now());
+}
+
+void Latency::record( const EStage stage, const uint64_t captureTime, const uint64_t now )
+{
+	if (captureTime == 0) return;
+	const uint64_t age = (now > captureTime) ? now - captureTime : 0;
+	buckets[stage][getBucket(age / 1000)].fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t max = maxAges[stage].load(std::memory_order_relaxed);
+	while (age > max && !maxAges[stage].compare_exchange_weak(max, age, std::memory_order_relaxed)) {}
+}
+
+void Latency::summarize( const EStage stage, Summary& summary )
+{
+	unsigned int counts[NUM_BUCKETS];
+	unsigned long long total = 0;
+	for (unsigned int bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+		counts[bucket] = buckets[stage][bucket].load(std::memory_order_relaxed);
+		total += counts[bucket];
+	}
+
+	summary.count = total;
+	summary.p50 = summary.p95 = summary.p99 = summary.max = 0.f;
+	if (total == 0) return;
+
+	summary.p50 = getPercentile(counts, total, 0.50f);
+	summary.p95 = getPercentile(counts, total, 0.95f);
+	summary.p99 = getPercentile(counts, total, 0.99f);
+	summary.max = static_cast<float>(MonotonicClock::toMilliseconds(maxAges[stage].load(std::memory_order_relaxed)));
+}
+
+std::string Latency::getReport()
+{
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(2)
+	   << "age: p50 / p95 / p99 / max ms" << std::endl;
+	for (int stage = 0; stage < NUM_STAGES; ++stage) {
+		Summary summary;
+		summarize((EStage) stage, summary);
+		ss << stageNames[stage] << ": ";
+		if (summary.count == 0) {
+			ss << "-" << std::endl;
+			continue;
+		}
+		ss << summary.p50 << " / " << summary.p95 << " / " << summary.p99 << " / " << summary.max << std::endl;
+	}
+	return ss.str();
+}
+
+bool Latency::writeCsv( const std::string& filename )
+{
+	std::ofstream stream(filename, std::ios::out | std::ios::trunc);
+	if (!stream.is_open()) {
+		std::cerr << "Failed to open '" << filename << "' for writing." << std::endl;
+		return false;
+	}
+
+	stream << std::fixed << std::setprecision(3) << "stage,count,p50_ms,p95_ms,p99_ms,max_ms" << std::endl;
+	for (int stage = 0; stage < NUM_STAGES; ++stage) {
+		Summary summary;
+		summarize((EStage) stage, summary);
+		stream << stageNames[stage] << "," << summary.count << "," << summary.p50 << ","
+		       << summary.p95 << "," << summary.p99 << "," << summary.max << std::endl;
+	}
+
+	stream << std::endl << "stage,from_us,to_us,count" << std::endl;
+	unsigned int numRows = 0;
+	for (int stage = 0; stage < NUM_STAGES; ++stage) {
+		for (unsigned int bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+			const unsigned int count = buckets[stage][bucket].load(std::memory_order_relaxed);
+			if (count == 0) continue;
+			stream << stageNames[stage] << "," << getBucketStart(bucket) << "," << getBucketEnd(bucket) << "," << count << std::endl;
+			++numRows;
+		}
+	}
+	std::cout << "Wrote latency histograms of " << numRows << " buckets to '" << filename << "'." << std::endl;
+	return stream.good();
+}
+
+void Latency::reset()
+{
+	for (int stage = 0; stage < NUM_STAGES; ++stage) {
+		for (unsigned int bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+			buckets[stage][bucket].store(0, std::memory_order_relaxed);
+		}
+		maxAges[stage].store(0, std::memory_order_relaxed);
+	}
+}
+
+const char *Latency::getStageName( const EStage stage )
+{
+	return stageNames[stage];
+}
+
+unsigned int Latency::getBucket( const uint64_t microseconds )
+{
+	// One bucket per microsecond below 4, then the highest bit picks the
+	// doubling and the two bits below it the quarter within
+	if (microseconds < 4) return static_cast<unsigned int>(microseconds);
+	unsigned int highestBit = 2;
+	while (highestBit < 63 && (microseconds >> (highestBit + 1)) != 0) ++highestBit;
+	const unsigned int bucket = BUCKETS_PER_DOUBLING * (highestBit - 1) + static_cast<unsigned int>((microseconds >> (highestBit - 2)) & 3);
+	return std::min(bucket, NUM_BUCKETS - 1);
+}
+
+uint64_t Latency::getBucketStart( const unsigned int bucket )
+{
+	if (bucket < 4) return bucket;
+	const unsigned int highestBit = bucket / BUCKETS_PER_DOUBLING + 1;
+	return static_cast<uint64_t>(BUCKETS_PER_DOUBLING + bucket % BUCKETS_PER_DOUBLING) << (highestBit - 2);
+}
+
+uint64_t Latency::getBucketEnd( const unsigned int bucket )
+{
+	// The last bucket holds everything older too
+	return getBucketStart(bucket + 1);
+}
@@ -0,0 +1,63 @@
+#pragma once
+/************************************************************************/
+/* Latency
+/* -------
+/* A static helper class for histograms of how old frames are at each stage
+/************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+// Frames are stamped with MonotonicClock::now() as they are acquired, and
+// every stage they reach counts their age into its histogram. Buckets are
+// spaced four to a doubling from a microsecond up to about a minute, so any
+// percentile is within a fifth of the truth, and recording is one atomic
+// add, safe from any thread.
+class Latency
+{
+public:
+	enum EStage {
+		DEQUEUED   = 0,                // main loop took the frame from its capture worker
+		LIVE_FRAME = (DEQUEUED   + 1), // fused into the live skeleton
+		PUBLISHED  = (LIVE_FRAME + 1), // readable on the frame bus
+		RECORDED   = (PUBLISHED  + 1), // written to the joint file
+		GESTURE    = (RECORDED   + 1), // matched against the gesture templates
+		DISPLAYED  = (GESTURE    + 1), // on screen, window.display() returned
+		NUM_STAGES = (DISPLAYED  + 1)
+	};
+
+	static const unsigned int BUCKETS_PER_DOUBLING = 4;
+	static const unsigned int NUM_BUCKETS          = 100;
+
+	// Milliseconds, percentiles at the middle of their bucket
+	struct Summary
+	{
+		unsigned long long count;
+		float p50;
+		float p95;
+		float p99;
+		float max;
+	};
+
+	// Count the age of a frame acquired at captureTime, ignored if 0
+	static void record(const EStage stage, const uint64_t captureTime);
+	static void record(const EStage stage, const uint64_t captureTime, const uint64_t now);
+
+	static void summarize(const EStage stage, Summary& summary);
+
+	// One line per stage with p50/p95/p99/max
+	static std::string getReport();
+
+	// Every non empty bucket as stage,from_us,to_us,count, after a line of percentiles per stage
+	static bool writeCsv(const std::string& filename);
+
+	static void reset();
+
+	static const char *getStageName(const EStage stage);
+
+	// Bucket of an age in microseconds, and the ages it holds
+	static unsigned int getBucket(const uint64_t microseconds);
+	static uint64_t getBucketStart(const unsigned int bucket);
+	static uint64_t getBucketEnd(const unsigned int bucket);
+};
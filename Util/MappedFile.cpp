@@ -0,0 +1,104 @@
+/************************************************************************/
+/* MappedFile
+/* ----------
+/* A read only memory mapped view of a whole file
+/************************************************************************/
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+
+MappedFile::MappedFile()
+	: data(nullptr)
+	, size(0)
+#ifdef _WIN32
+	, fileHandle(INVALID_HANDLE_VALUE)
+	, mappingHandle(NULL)
+#else
+	, fileDescriptor(-1)
+#endif
+{}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open( const std::string& filename )
+{
+	close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL
+	                       , OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		std::cerr << "Failed to open '" << filename << "' for mapping" << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		close();
+		return false;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL) {
+		std::cerr << "Failed to create mapping for '" << filename << "'" << std::endl;
+		close();
+		return false;
+	}
+
+	data = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+	fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		std::cerr << "Failed to open '" << filename << "' for mapping" << std::endl;
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0 || info.st_size == 0) {
+		close();
+		return false;
+	}
+	size = static_cast<size_t>(info.st_size);
+
+	void *view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	data = (view == MAP_FAILED) ? nullptr : static_cast<const char *>(view);
+#endif
+
+	if (data == nullptr) {
+		std::cerr << "Failed to map view of '" << filename << "'" << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data != nullptr) UnmapViewOfFile(data);
+	if (mappingHandle != NULL) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data != nullptr) munmap(const_cast<char *>(data), size);
+	if (fileDescriptor >= 0) ::close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
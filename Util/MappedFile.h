@@ -0,0 +1,39 @@
+#pragma once
+/************************************************************************/
+/* MappedFile
+/* ----------
+/* A read only memory mapped view of a whole file
+/************************************************************************/
+#include <string>
+
+
+class MappedFile
+{
+private:
+	const char *data;
+	size_t size;
+
+#ifdef _WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Map the named file, closing any file already mapped
+	bool open(const std::string& filename);
+	void close();
+
+	bool isOpen() const { return data != nullptr; }
+	const char *getData() const { return data; }
+	size_t getSize() const { return size; }
+
+private:
+	// Not copyable, owns the mapping
+	MappedFile(const MappedFile& other);
+	MappedFile& operator=(const MappedFile& other);
+};
@@ -0,0 +1,207 @@
+/************************************************************************/
+/* MeshBatch
+/* ---------
+/* Many transformed copies of a small mesh drawn as one
+/************************************************************************/
+#include "MeshBatch.h"
+#include "GLExtensions.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const float pi = 3.1415926535897932384f;
+	const unsigned int stride = 6;
+
+	void addVertex(Mesh& mesh, const glm::vec3& position, const glm::vec3& normal) {
+		mesh.vertices.push_back(position.x);
+		mesh.vertices.push_back(position.y);
+		mesh.vertices.push_back(position.z);
+		mesh.vertices.push_back(normal.x);
+		mesh.vertices.push_back(normal.y);
+		mesh.vertices.push_back(normal.z);
+	}
+
+	void addTriangle(Mesh& mesh, const GLuint a, const GLuint b, const GLuint c) {
+		mesh.indices.push_back(a);
+		mesh.indices.push_back(b);
+		mesh.indices.push_back(c);
+	}
+
+	// Disk of unit radius at height z facing along normalZ, counter clockwise seen from outside
+	void addCap(Mesh& mesh, const unsigned int slices, const float z, const float normalZ) {
+		const glm::vec3 normal(0.f, 0.f, normalZ);
+		const GLuint center = mesh.vertices.size() / stride;
+		addVertex(mesh, glm::vec3(0.f, 0.f, z), normal);
+		for (unsigned int j = 0; j <= slices; ++j) {
+			const float phi = 2.f * pi * j / slices;
+			addVertex(mesh, glm::vec3(std::cos(phi), std::sin(phi), z), normal);
+		}
+		for (unsigned int j = 0; j < slices; ++j) {
+			if (normalZ > 0.f) addTriangle(mesh, center, center + 1 + j, center + 2 + j);
+			else               addTriangle(mesh, center, center + 2 + j, center + 1 + j);
+		}
+	}
+}
+
+
+Mesh Mesh::sphere( const unsigned int slices, const unsigned int stacks )
+{
+	Mesh mesh;
+	for (unsigned int i = 0; i <= stacks; ++i) {
+		const float theta = pi * i / stacks;
+		for (unsigned int j = 0; j <= slices; ++j) {
+			const float phi = 2.f * pi * j / slices;
+			const glm::vec3 n(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+			addVertex(mesh, n, n);
+		}
+	}
+	for (unsigned int i = 0; i < stacks; ++i) {
+		for (unsigned int j = 0; j < slices; ++j) {
+			const GLuint a = i * (slices + 1) + j;
+			const GLuint b = a + slices + 1;
+			// Rows at the poles collapse to a point, skip their degenerate halves
+			if (i > 0)          addTriangle(mesh, a, b, a + 1);
+			if (i < stacks - 1) addTriangle(mesh, a + 1, b, b + 1);
+		}
+	}
+	return mesh;
+}
+
+Mesh Mesh::cylinder( const unsigned int slices, const unsigned int stacks )
+{
+	Mesh mesh;
+	for (unsigned int i = 0; i <= stacks; ++i) {
+		const float z = static_cast<float>(i) / stacks;
+		for (unsigned int j = 0; j <= slices; ++j) {
+			const float phi = 2.f * pi * j / slices;
+			const glm::vec3 n(std::cos(phi), std::sin(phi), 0.f);
+			addVertex(mesh, glm::vec3(n.x, n.y, z), n);
+		}
+	}
+	for (unsigned int i = 0; i < stacks; ++i) {
+		for (unsigned int j = 0; j < slices; ++j) {
+			const GLuint a = i * (slices + 1) + j;
+			const GLuint b = a + slices + 1;
+			addTriangle(mesh, a, a + 1, b);
+			addTriangle(mesh, a + 1, b + 1, b);
+		}
+	}
+	addCap(mesh, slices, 0.f, -1.f);
+	addCap(mesh, slices, 1.f,  1.f);
+	return mesh;
+}
+
+
+MeshBatch::MeshBatch( const Mesh& mesh )
+	: mesh(mesh)
+	, transforms()
+	, vertices()
+	, indices()
+	, indexCapacity(0)
+	, numUploaded(0)
+	, vertexBuffer(0)
+	, indexBuffer(0)
+	, bufferCapacity(0)
+{}
+
+MeshBatch::~MeshBatch()
+{
+	if (vertexBuffer != 0) GLExtensions::deleteBuffers(1, &vertexBuffer);
+	if (indexBuffer  != 0) GLExtensions::deleteBuffers(1, &indexBuffer);
+}
+
+void MeshBatch::clear()
+{
+	transforms.clear();
+}
+
+void MeshBatch::add( const glm::mat4& transform )
+{
+	transforms.push_back(transform);
+}
+
+void MeshBatch::upload()
+{
+	const unsigned int numVertices = mesh.vertices.size() / stride;
+	numUploaded = transforms.size();
+
+	// Indices only depend on the number of copies, grown by doubling
+	if (numUploaded > indexCapacity) {
+		indexCapacity = std::max(numUploaded, 2 * indexCapacity);
+		indices.resize(indexCapacity * mesh.indices.size());
+		for (unsigned int copy = 0; copy < indexCapacity; ++copy) {
+			const GLuint base = copy * numVertices;
+			GLuint *dest = &indices[copy * mesh.indices.size()];
+			for (unsigned int i = 0; i < mesh.indices.size(); ++i) {
+				dest[i] = base + mesh.indices[i];
+			}
+		}
+	}
+
+	// Normals take the cofactors of the transform, the inverse transpose up to scale
+	vertices.resize(numUploaded * mesh.vertices.size());
+	GLfloat *dest = vertices.empty() ? nullptr : &vertices[0];
+	for (const auto& transform : transforms) {
+		const glm::vec3 x(transform[0].x, transform[0].y, transform[0].z);
+		const glm::vec3 y(transform[1].x, transform[1].y, transform[1].z);
+		const glm::vec3 z(transform[2].x, transform[2].y, transform[2].z);
+		const glm::mat3 normalTransform(glm::cross(y, z), glm::cross(z, x), glm::cross(x, y));
+		for (unsigned int v = 0; v < mesh.vertices.size(); v += stride, dest += stride) {
+			const glm::vec4 p = transform * glm::vec4(mesh.vertices[v], mesh.vertices[v + 1], mesh.vertices[v + 2], 1.f);
+			glm::vec3 n = normalTransform * glm::vec3(mesh.vertices[v + 3], mesh.vertices[v + 4], mesh.vertices[v + 5]);
+			const float length = glm::length(n);
+			if (length > 0.f) n /= length;
+			dest[0] = p.x;
+			dest[1] = p.y;
+			dest[2] = p.z;
+			dest[3] = n.x;
+			dest[4] = n.y;
+			dest[5] = n.z;
+		}
+	}
+
+	if (!GLExtensions::hasBufferObjects() || numUploaded == 0) return;
+	if (vertexBuffer == 0) GLExtensions::genBuffers(1, &vertexBuffer);
+	if (indexBuffer  == 0) GLExtensions::genBuffers(1, &indexBuffer);
+
+	// Contents change every frame, let the driver orphan the old storage
+	GLExtensions::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	GLExtensions::bufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STREAM_DRAW);
+	GLExtensions::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (bufferCapacity != indexCapacity) {
+		GLExtensions::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		GLExtensions::bufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+		GLExtensions::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		bufferCapacity = indexCapacity;
+	}
+}
+
+void MeshBatch::draw() const
+{
+	if (numUploaded == 0 || mesh.indices.empty()) return;
+
+	const GLsizei bytes = stride * sizeof(GLfloat);
+	const GLsizei count = numUploaded * mesh.indices.size();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+
+	if (bufferCapacity > 0) {
+		GLExtensions::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		GLExtensions::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glVertexPointer(3, GL_FLOAT, bytes, (const GLvoid *) 0);
+		glNormalPointer(GL_FLOAT, bytes, (const GLvoid *) (3 * sizeof(GLfloat)));
+		glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (const GLvoid *) 0);
+		GLExtensions::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		GLExtensions::bindBuffer(GL_ARRAY_BUFFER, 0);
+	} else {
+		glVertexPointer(3, GL_FLOAT, bytes, &vertices[0]);
+		glNormalPointer(GL_FLOAT, bytes, &vertices[3]);
+		glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, &indices[0]);
+	}
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
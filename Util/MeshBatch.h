@@ -0,0 +1,71 @@
+#pragma once
+/************************************************************************/
+/* MeshBatch
+/* ---------
+/* Many transformed copies of a small mesh drawn as one
+/************************************************************************/
+#include <SFML/OpenGL.hpp>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// Indexed triangle mesh, interleaved position and normal per vertex
+struct Mesh
+{
+	std::vector<GLfloat> vertices; // x, y, z, nx, ny, nz
+	std::vector<GLuint>  indices;
+
+	// Unit sphere around the origin
+	static Mesh sphere(const unsigned int slices, const unsigned int stacks);
+	// Unit radius cylinder from z = 0 to z = 1, capped at both ends
+	static Mesh cylinder(const unsigned int slices, const unsigned int stacks);
+};
+
+
+// Many copies of one unit mesh drawn with a single glDrawElements. The
+// mesh's indices, repeated once per copy, stay in a static index buffer
+// that only grows; the copies are transformed on the CPU into one stream
+// vertex buffer, so a batch costs one upload and one draw however many
+// copies it has. Falls back to client side vertex arrays when buffer
+// objects are missing.
+class MeshBatch
+{
+private:
+	const Mesh& mesh;
+	std::vector<glm::mat4> transforms;
+
+	std::vector<GLfloat> vertices; // every copy, transformed by the last upload
+	std::vector<GLuint>  indices;  // the mesh's, repeated for indexCapacity copies
+	unsigned int indexCapacity;
+	unsigned int numUploaded;      // copies the last upload prepared
+
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	unsigned int bufferCapacity;   // copies indexBuffer holds indices for
+
+public:
+	// The mesh must outlive the batch
+	explicit MeshBatch(const Mesh& mesh);
+	~MeshBatch();
+
+	void clear();
+
+	// Append a copy of the mesh, normals follow any scale
+	void add(const glm::mat4& transform);
+
+	// Transform the copies and copy them to the GPU, once after they change
+	void upload();
+
+	// Draw the copies of the last upload with the current material and modelview
+	void draw() const;
+
+	bool empty() const { return transforms.empty(); }
+	unsigned int getNumInstances() const { return transforms.size(); }
+
+private:
+	// Not copyable, owns buffer objects
+	MeshBatch(const MeshBatch& other);
+	MeshBatch& operator=(const MeshBatch& other);
+};
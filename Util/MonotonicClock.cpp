@@ -0,0 +1,31 @@
+/************************************************************************/
+/* MonotonicClock
+/* --------------
+/* Nanoseconds on a clock every thread and process on the machine shares
+/************************************************************************/
+#include "MonotonicClock.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+
+uint64_t MonotonicClock::now()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	// Whole seconds first, the counter times 10^9 overflows after a few hours
+	const uint64_t ticks     = static_cast<uint64_t>(counter.QuadPart);
+	const uint64_t perSecond = static_cast<uint64_t>(frequency.QuadPart);
+	return (ticks / perSecond) * 1000000000ull + ((ticks % perSecond) * 1000000000ull) / perSecond;
+#else
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return static_cast<uint64_t>(time.tv_sec) * 1000000000ull + time.tv_nsec;
+#endif
+}
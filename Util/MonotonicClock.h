@@ -0,0 +1,20 @@
+#pragma once
+/************************************************************************/
+/* MonotonicClock
+/* --------------
+/* Nanoseconds on a clock every thread and process on the machine shares
+/************************************************************************/
+#include <cstdint>
+
+
+// Never goes backwards and, in 64 bits of nanoseconds, never wraps in
+// practice, so a timestamp taken at acquisition can be carried through the
+// whole pipeline and subtracted anywhere, even in another process
+class MonotonicClock
+{
+public:
+	static uint64_t now();
+
+	static double toSeconds(const uint64_t nanoseconds)      { return 1e-9 * nanoseconds; }
+	static double toMilliseconds(const uint64_t nanoseconds) { return 1e-6 * nanoseconds; }
+};
@@ -0,0 +1,64 @@
+/************************************************************************/
+/* OffscreenContext
+/* ----------------
+/* OpenGL context without a window, for rendering into framebuffers
+/************************************************************************/
+#include "OffscreenContext.h"
+
+#ifndef _WIN32
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+
+#ifdef _WIN32
+
+OffscreenContext::OffscreenContext()
+	: context()
+	, valid(context.setActive(true))
+{
+	if (!valid) std::cerr << "Failed to activate offscreen OpenGL context." << std::endl;
+}
+
+OffscreenContext::~OffscreenContext()
+{}
+
+#else
+
+OffscreenContext::OffscreenContext()
+	: display(EGL_NO_DISPLAY)
+	, context(EGL_NO_CONTEXT)
+	, valid(false)
+{
+	const PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != nullptr) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	EGLint major = 0, minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+		std::cerr << "Failed to initialize a surfaceless EGL display." << std::endl;
+		return;
+	}
+
+	// Desktop OpenGL for the fixed function pipeline, no surface since rendering goes to framebuffers
+	const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = nullptr;
+	EGLint numConfigs = 0;
+	eglBindAPI(EGL_OPENGL_API);
+	eglChooseConfig(display, configAttributes, &config, 1, &numConfigs);
+	context = eglCreateContext(display, (numConfigs > 0) ? config : nullptr, EGL_NO_CONTEXT, nullptr);
+	valid = context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+	if (!valid) std::cerr << "Failed to create offscreen OpenGL context." << std::endl;
+}
+
+OffscreenContext::~OffscreenContext()
+{
+	if (display == EGL_NO_DISPLAY) return;
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+	eglTerminate(display);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+/************************************************************************/
+/* OffscreenContext
+/* ----------------
+/* OpenGL context without a window, for rendering into framebuffers
+/************************************************************************/
+#ifdef _WIN32
+#include <SFML/Window/Context.hpp>
+#else
+#include <EGL/egl.h>
+#endif
+
+
+// Current for its whole lifetime on the thread that created it. Windows
+// uses whatever opengl32.dll provides, a software renderer such as Mesa's
+// included. Elsewhere EGL's surfaceless platform is used, which needs no
+// display server and falls back to software rendering without a GPU.
+class OffscreenContext
+{
+private:
+#ifdef _WIN32
+	sf::Context context;
+#else
+	EGLDisplay display;
+	EGLContext context;
+#endif
+	bool valid;
+
+public:
+	OffscreenContext();
+	~OffscreenContext();
+
+	bool isValid() const { return valid; }
+
+private:
+	OffscreenContext(const OffscreenContext& other);
+	OffscreenContext& operator=(const OffscreenContext& other);
+};
@@ -0,0 +1,51 @@
+/************************************************************************/
+/* Parallel
+/* --------
+/* A static helper class for splitting independent work across cores
+/************************************************************************/
+#include "Parallel.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+
+
+void Parallel::forEach( const unsigned int numTasks, const Task& task )
+{
+	if (numTasks == 0) return;
+
+	const unsigned int numThreads = std::min(getNumThreads(), numTasks);
+	if (numThreads <= 1) {
+		for (unsigned int i = 0; i < numTasks; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	// Runners pull task indices from a shared counter until none are left,
+	// so uneven task sizes still balance out across threads
+	std::atomic<unsigned int> nextTask(0);
+	auto runner = [&]() {
+		unsigned int i;
+		while ((i = nextTask++) < numTasks) {
+			task(i);
+		}
+	};
+
+	// The calling thread does its share of the work too, then runs whatever
+	// else is pending until the runners it handed to the workers are done
+	std::atomic<unsigned int> numRunning(numThreads - 1);
+	for (unsigned int i = 1; i < numThreads; ++i) {
+		JobSystem::submit([&]() {
+			runner();
+			numRunning.fetch_sub(1, std::memory_order_release);
+		});
+	}
+	runner();
+	JobSystem::wait(numRunning);
+}
+
+unsigned int Parallel::getNumThreads()
+{
+	return JobSystem::getNumWorkers() + 1;
+}
@@ -0,0 +1,22 @@
+#pragma once
+/************************************************************************/
+/* Parallel
+/* --------
+/* A static helper class for splitting independent work across cores
+/************************************************************************/
+#include <functional>
+
+
+class Parallel
+{
+public:
+	typedef std::function<void(unsigned int task)> Task;
+
+	// Run task(0) .. task(numTasks - 1) on the calling thread and the job
+	// system's workers, returning once every task has completed. Tasks must
+	// be independent.
+	static void forEach(const unsigned int numTasks, const Task& task);
+
+	// Number of threads forEach() will use at most, the caller's included
+	static unsigned int getNumThreads();
+};
@@ -0,0 +1,247 @@
+/************************************************************************/
+/* Profiler
+/* --------
+/* A static helper class for timing the stages of each frame
+/************************************************************************/
+#include "Profiler.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef _MSC_VER
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+
+namespace
+{
+	struct ThreadRecord
+	{
+		Profiler::Ring rings[Profiler::NUM_STAGES];
+	};
+
+	const char *stageNames[Profiler::NUM_STAGES] = {
+		"frame",
+		"kinect update",
+		"stream data",
+		"image streams",
+		"skeleton render",
+		"gui draw",
+		"window display",
+		"skeleton fetch",
+		"live frame",
+		"joint record",
+		"joint predict",
+		"gesture match",
+		"skeleton fusion",
+		"bus publish"
+	};
+
+	// Zero initialized before any thread starts, rings are claimed once per thread and never released
+	ThreadRecord threadRecords[Profiler::MAX_THREADS];
+	std::atomic<unsigned int> numThreadRecords;
+	std::atomic<unsigned int> frameNumber;
+	float scopeOverhead = -1.f;
+
+	PROFILER_THREAD_LOCAL ThreadRecord *threadRecord = nullptr;
+	PROFILER_THREAD_LOCAL bool threadUnrecorded = false;
+
+	const sf::Clock& getClock()
+	{
+		static const sf::Clock clock;
+		return clock;
+	}
+}
+
+
+Profiler::Scope::Scope( const EStage stage )
+	: stage(stage)
+	, start(now())
+{}
+
+Profiler::Scope::~Scope()
+{
+	Ring *ring = getRing(stage);
+	if (ring != nullptr) {
+		record(*ring, start, now());
+	}
+}
+
+void Profiler::beginFrame()
+{
+	frameNumber.fetch_add(1, std::memory_order_relaxed);
+}
+
+unsigned int Profiler::getFrame()
+{
+	return frameNumber.load(std::memory_order_relaxed);
+}
+
+void Profiler::summarize( const EStage stage, Summary& summary )
+{
+	summary.count = 0;
+	summary.perFrame = summary.min = summary.avg = summary.p99 = 0.f;
+
+	std::vector<unsigned int> durations;
+	float frames = 0.f;
+	const unsigned int numThreads = std::min(numThreadRecords.load(std::memory_order_acquire), MAX_THREADS);
+	for (unsigned int t = 0; t < numThreads; ++t) {
+		const Ring& ring = threadRecords[t].rings[stage];
+		const unsigned int count = ring.count.load(std::memory_order_acquire);
+		const unsigned int held  = std::min(count, RING_SIZE);
+		if (held == 0) continue;
+
+		for (unsigned int i = count - held; i < count; ++i) {
+			durations.push_back(ring.samples[i % RING_SIZE].duration);
+		}
+		const unsigned int oldest = ring.samples[(count - held) % RING_SIZE].frame;
+		const unsigned int newest = ring.samples[(count - 1)    % RING_SIZE].frame;
+		frames = std::max(frames, (float) (newest - oldest + 1));
+	}
+	if (durations.empty()) return;
+
+	unsigned long long total = 0;
+	for (auto duration : durations) {
+		total += duration;
+	}
+	const size_t p99 = (durations.size() * 99) / 100;
+	std::nth_element(durations.begin(), durations.begin() + p99, durations.end());
+
+	summary.count    = durations.size();
+	summary.perFrame = durations.size() / frames;
+	summary.min      = *std::min_element(durations.begin(), durations.end()) / 1000.f;
+	summary.avg      = (total / (float) durations.size()) / 1000.f;
+	summary.p99      = durations[p99] / 1000.f;
+}
+
+std::string Profiler::getReport()
+{
+	if (scopeOverhead < 0.f) {
+		scopeOverhead = measureOverhead();
+	}
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(2)
+	   << "stage: min / avg / p99 ms" << std::endl;
+
+	float scopesPerFrame = 0.f;
+	Summary frame;
+	summarize(FRAME, frame);
+	for (int stage = 0; stage < NUM_STAGES; ++stage) {
+		Summary summary;
+		summarize((EStage) stage, summary);
+		scopesPerFrame += summary.perFrame;
+		ss << stageNames[stage] << ": "
+		   << summary.min << " / " << summary.avg << " / " << summary.p99;
+		if (summary.perFrame > 1.05f) {
+			ss << " (x" << std::setprecision(1) << summary.perFrame << std::setprecision(2) << ")";
+		}
+		ss << std::endl;
+	}
+
+	const float overhead = (frame.avg > 0.f) ? 100.f * scopesPerFrame * scopeOverhead / (1000.f * frame.avg) : 0.f;
+	ss << "profiler: " << std::setprecision(3) << overhead << "% of frame";
+	return ss.str();
+}
+
+bool Profiler::writeCsv( const std::string& filename )
+{
+	struct Row
+	{
+		unsigned int thread;
+		unsigned int stage;
+		Sample sample;
+
+		bool operator<(const Row& other) const { return sample.start < other.sample.start; }
+	};
+
+	std::vector<Row> rows;
+	const unsigned int numThreads = std::min(numThreadRecords.load(std::memory_order_acquire), MAX_THREADS);
+	for (unsigned int t = 0; t < numThreads; ++t) {
+		for (unsigned int stage = 0; stage < NUM_STAGES; ++stage) {
+			const Ring& ring = threadRecords[t].rings[stage];
+			const unsigned int count = ring.count.load(std::memory_order_acquire);
+			const unsigned int held  = std::min(count, RING_SIZE);
+			for (unsigned int i = count - held; i < count; ++i) {
+				Row row;
+				row.thread = t;
+				row.stage  = stage;
+				row.sample = ring.samples[i % RING_SIZE];
+				rows.push_back(row);
+			}
+		}
+	}
+	std::sort(rows.begin(), rows.end());
+
+	std::ofstream stream(filename, std::ios::out | std::ios::trunc);
+	if (!stream.is_open()) {
+		std::cerr << "Failed to open '" << filename << "' for writing." << std::endl;
+		return false;
+	}
+	stream << "thread,frame,stage,start_us,duration_us" << std::endl;
+	for (const auto& row : rows) {
+		stream << row.thread << "," << row.sample.frame << "," << stageNames[row.stage] << ","
+		       << row.sample.start << "," << row.sample.duration << std::endl;
+	}
+	std::cout << "Wrote " << rows.size() << " profiler samples to '" << filename << "'." << std::endl;
+	return stream.good();
+}
+
+float Profiler::measureOverhead( const unsigned int numScopes )
+{
+	// Same clock reads and ring write as a Scope, without touching the real rings
+	Ring *scratch = new Ring();
+	scratch->count.store(0);
+	const long long begin = now();
+	for (unsigned int i = 0; i < numScopes; ++i) {
+		const long long start = now();
+		getRing(FRAME);
+		record(*scratch, start, now());
+	}
+	const long long end = now();
+	delete scratch;
+	return (end - begin) / (float) std::max(1u, numScopes);
+}
+
+const char *Profiler::getStageName( const EStage stage )
+{
+	return stageNames[stage];
+}
+
+long long Profiler::now()
+{
+	return getClock().getElapsedTime().asMicroseconds();
+}
+
+void Profiler::record( Ring& ring, const long long start, const long long end )
+{
+	// Only the owning thread writes, publishing the sample with the new count
+	const unsigned int count = ring.count.load(std::memory_order_relaxed);
+	Sample& sample = ring.samples[count % RING_SIZE];
+	sample.start    = start;
+	sample.duration = (unsigned int) (end - start);
+	sample.frame    = frameNumber.load(std::memory_order_relaxed);
+	ring.count.store(count + 1, std::memory_order_release);
+}
+
+Profiler::Ring *Profiler::getRing( const EStage stage )
+{
+	if (threadRecord == nullptr) {
+		if (threadUnrecorded) return nullptr;
+		const unsigned int index = numThreadRecords.fetch_add(1);
+		if (index >= MAX_THREADS) {
+			threadUnrecorded = true;
+			return nullptr;
+		}
+		threadRecord = &threadRecords[index];
+	}
+	return &threadRecord->rings[stage];
+}
@@ -0,0 +1,98 @@
+#pragma once
+/************************************************************************/
+/* Profiler
+/* --------
+/* A static helper class for timing the stages of each frame
+/************************************************************************/
+#include <atomic>
+#include <string>
+
+
+// Scopes record into ring buffers owned by the thread that runs them, so
+// recording takes no lock. Readers walk every thread's rings while they are
+// being written, a sample overwritten mid-read only skews one statistic.
+class Profiler
+{
+public:
+	enum EStage {
+		FRAME           = 0, // events, update and draw, without sleeping
+		KINECT_UPDATE   = (FRAME           + 1),
+		STREAM_DATA     = (KINECT_UPDATE   + 1),
+		IMAGE_STREAMS   = (STREAM_DATA     + 1),
+		SKELETON_RENDER = (IMAGE_STREAMS   + 1),
+		GUI_DRAW        = (SKELETON_RENDER + 1),
+		WINDOW_DISPLAY  = (GUI_DRAW        + 1),
+		SKELETON_FETCH  = (WINDOW_DISPLAY  + 1), // source hands out a skeleton frame
+		LIVE_FRAME      = (SKELETON_FETCH  + 1), // orientations and live frame update
+		JOINT_RECORD    = (LIVE_FRAME      + 1),
+		JOINT_PREDICT   = (JOINT_RECORD    + 1),
+		GESTURE_MATCH   = (JOINT_PREDICT   + 1),
+		SKELETON_FUSION = (GESTURE_MATCH   + 1),
+		BUS_PUBLISH     = (SKELETON_FUSION + 1),
+		NUM_STAGES      = (BUS_PUBLISH     + 1)
+	};
+
+	static const unsigned int RING_SIZE   = 512; // samples kept per stage per thread
+	static const unsigned int MAX_THREADS = 16;  // later threads are not recorded
+
+	struct Sample
+	{
+		long long start;       // microseconds since startup
+		unsigned int duration; // microseconds
+		unsigned int frame;
+	};
+
+	struct Ring
+	{
+		Sample samples[RING_SIZE];
+		std::atomic<unsigned int> count; // total recorded, the newest is at (count - 1) % RING_SIZE
+	};
+
+	// Durations in milliseconds over the samples still held
+	struct Summary
+	{
+		unsigned int count;
+		float perFrame; // samples per frame numbered while they were taken
+		float min;
+		float avg;
+		float p99;
+	};
+
+	// Times its stage from construction to destruction
+	class Scope
+	{
+	private:
+		EStage stage;
+		long long start;
+
+	public:
+		Scope(const EStage stage);
+		~Scope();
+
+	private:
+		Scope(const Scope& other);
+		Scope& operator=(const Scope& other);
+	};
+
+	// Number the following samples as a new frame
+	static void beginFrame();
+	static unsigned int getFrame();
+
+	static void summarize(const EStage stage, Summary& summary);
+
+	// One line per stage with min/avg/p99 and the profiler's own share of the frame
+	static std::string getReport();
+
+	// Every held sample as thread,frame,stage,start_us,duration_us sorted by start
+	static bool writeCsv(const std::string& filename);
+
+	// Cost of one scope in microseconds, timed on a scratch ring
+	static float measureOverhead(const unsigned int numScopes = 100000);
+
+	static const char *getStageName(const EStage stage);
+
+private:
+	static long long now();
+	static void record(Ring& ring, const long long start, const long long end);
+	static Ring *getRing(const EStage stage);
+};
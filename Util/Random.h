@@ -0,0 +1,26 @@
+#pragma once
+/************************************************************************/
+/* Random
+/* ------
+/* Repeatable pseudo random numbers for generated inputs and benchmarks
+/************************************************************************/
+
+
+// Linear congruential generator in 32 bits: the same seed gives the same
+// sequence with every compiler and standard library, unlike <random>'s
+// distributions, so generated recordings and benchmark inputs match across
+// machines. Not for anything that needs good statistics.
+class Random
+{
+private:
+	unsigned int state;
+
+public:
+	explicit Random(const unsigned int seed = 1) : state(seed) {}
+
+	unsigned int next()   { state = state * 1664525u + 1013904223u; return state; }
+	// Uniform in [0, 1), from the 24 high bits so every value is exact in a float
+	float uniform()       { return (next() >> 8) / 16777216.f; }
+	// Uniform in [-1, 1)
+	float signedUniform() { return (next() >> 8) / 8388608.f - 1.f; }
+};
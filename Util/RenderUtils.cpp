@@ -10,7 +10,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <SFML/OpenGL.hpp>
-#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Image.hpp>
 
 using glm::vec3;
 using glm::value_ptr;
@@ -137,11 +137,20 @@ void Render::ground( const float alpha )
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	sf::Texture texture;
-	texture.loadFromImage(GetImage("grid.png"));
-	texture.bind(&texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// Created once with plain GL so it also works in contexts SFML doesn't own
+	static GLuint texture = 0;
+	if (texture == 0) {
+		const sf::Image& image = GetImage("grid.png");
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.getSize().x, image.getSize().y,
+			0, GL_RGBA, GL_UNSIGNED_BYTE, image.getPixelsPtr());
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
 
 	const float radius = 10.f;
 	glColor4f(1,1,1,alpha);
@@ -152,8 +161,6 @@ void Render::ground( const float alpha )
 		glNormal3f(0, 1, 0); glTexCoord2f(radius, radius); glVertex3f(-R, Y, -R);
 	glEnd();
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 	glDisable(GL_BLEND);
@@ -0,0 +1,147 @@
+/************************************************************************/
+/* SharedMemory
+/* ------------
+/* A named block of memory other processes on the machine can map
+/************************************************************************/
+#include "SharedMemory.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+namespace
+{
+	// Session local on Windows, POSIX names are a single path component
+#ifdef _WIN32
+	std::string getSystemName(const std::string& name) { return "Local\\" + name; }
+#else
+	std::string getSystemName(const std::string& name) { return "/" + name; }
+#endif
+}
+
+
+SharedMemory::SharedMemory()
+	: data(nullptr)
+	, size(0)
+	, name()
+	, owner(false)
+#ifdef _WIN32
+	, mappingHandle(NULL)
+#else
+	, fileDescriptor(-1)
+#endif
+{}
+
+SharedMemory::~SharedMemory()
+{
+	close();
+}
+
+bool SharedMemory::create( const std::string& name, const size_t size )
+{
+	close();
+	this->name = name;
+	this->size = size;
+
+#ifdef _WIN32
+	const unsigned long long size64 = size;
+	mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE
+	                                 , static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), getSystemName(name).c_str());
+	if (mappingHandle == NULL) {
+		std::cerr << "Failed to create shared memory '" << name << "'" << std::endl;
+		close();
+		return false;
+	}
+	if (GetLastError() == ERROR_ALREADY_EXISTS) {
+		std::cerr << "Failed to create shared memory '" << name << "', another process is using the name" << std::endl;
+		close();
+		return false;
+	}
+	owner = true;
+	data = static_cast<char *>(MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, size));
+#else
+	fileDescriptor = shm_open(getSystemName(name).c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fileDescriptor < 0 && errno == EEXIST) {
+		std::cerr << "Failed to create shared memory '" << name << "', another process is using the name"
+		          << " or left it behind in /dev/shm" << std::endl;
+		close();
+		return false;
+	}
+	owner = fileDescriptor >= 0;
+	if (fileDescriptor < 0 || ftruncate(fileDescriptor, size) != 0) {
+		std::cerr << "Failed to create shared memory '" << name << "'" << std::endl;
+		close();
+		return false;
+	}
+	void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	data = (view == MAP_FAILED) ? nullptr : static_cast<char *>(view);
+#endif
+
+	if (data == nullptr) {
+		std::cerr << "Failed to map shared memory '" << name << "'" << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool SharedMemory::open( const std::string& name )
+{
+	close();
+	this->name = name;
+
+#ifdef _WIN32
+	mappingHandle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, getSystemName(name).c_str());
+	if (mappingHandle == NULL) {
+		close();
+		return false;
+	}
+	data = static_cast<char *>(MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+	MEMORY_BASIC_INFORMATION info;
+	if (data != nullptr && VirtualQuery(data, &info, sizeof(info)) != 0) {
+		size = info.RegionSize;
+	}
+#else
+	fileDescriptor = shm_open(getSystemName(name).c_str(), O_RDWR, 0);
+	struct stat info;
+	if (fileDescriptor < 0 || fstat(fileDescriptor, &info) != 0 || info.st_size == 0) {
+		close();
+		return false;
+	}
+	size = static_cast<size_t>(info.st_size);
+	void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	data = (view == MAP_FAILED) ? nullptr : static_cast<char *>(view);
+#endif
+
+	if (data == nullptr) {
+		std::cerr << "Failed to map shared memory '" << name << "'" << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void SharedMemory::close()
+{
+#ifdef _WIN32
+	if (data != nullptr) UnmapViewOfFile(data);
+	if (mappingHandle != NULL) CloseHandle(mappingHandle);
+	mappingHandle = NULL;
+#else
+	if (data != nullptr) munmap(data, size);
+	if (fileDescriptor >= 0) ::close(fileDescriptor);
+	if (owner) shm_unlink(getSystemName(name).c_str());
+	fileDescriptor = -1;
+#endif
+	data = nullptr;
+	size = 0;
+	owner = false;
+}
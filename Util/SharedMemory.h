@@ -0,0 +1,44 @@
+#pragma once
+/************************************************************************/
+/* SharedMemory
+/* ------------
+/* A named block of memory other processes on the machine can map
+/************************************************************************/
+#include <string>
+
+
+class SharedMemory
+{
+private:
+	char *data;
+	size_t size;
+	std::string name;
+	bool owner;
+
+#ifdef _WIN32
+	void *mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+public:
+	SharedMemory();
+	~SharedMemory();
+
+	// Create a zeroed block under name, false if the name is already taken. The
+	// name goes away with the owner, mappings other processes hold stay valid.
+	// A POSIX owner that crashed leaves its name behind in /dev/shm.
+	bool create(const std::string& name, const size_t size);
+	// Map a block someone else created, as large as it was created
+	bool open(const std::string& name);
+	void close();
+
+	bool isOpen() const { return data != nullptr; }
+	char *getData() const { return data; }
+	size_t getSize() const { return size; }
+
+private:
+	// Not copyable, owns the mapping
+	SharedMemory(const SharedMemory& other);
+	SharedMemory& operator=(const SharedMemory& other);
+};
@@ -0,0 +1,218 @@
+/************************************************************************/
+/* TextureStream
+/* -------------
+/* Texture fed once per frame through a ring of pixel buffers
+/************************************************************************/
+#include "TextureStream.h"
+#include "GLExtensions.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifndef GL_BGRA_EXT
+#define GL_BGRA_EXT 0x80E1
+#endif
+
+
+TextureStream::TextureStream( const unsigned int width, const unsigned int height )
+	: width(width)
+	, height(height)
+	, texture(0)
+	, writeIndex(0)
+	, uploadIndex(0)
+	, pending(false)
+	, mapped(nullptr)
+	, staging()
+{
+	for (unsigned int i = 0; i < NUM_BUFFERS; ++i) {
+		pixelBuffers[i] = 0;
+	}
+}
+
+TextureStream::~TextureStream()
+{
+	destroy();
+}
+
+void TextureStream::create()
+{
+	if (texture != 0) return;
+
+	const std::vector<GLubyte> black(getBytes(), 0);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, &black[0]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (GLExtensions::hasPixelBuffers()) {
+		GLExtensions::genBuffers(NUM_BUFFERS, pixelBuffers);
+		for (unsigned int i = 0; i < NUM_BUFFERS; ++i) {
+			GLExtensions::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[i]);
+			GLExtensions::bufferData(GL_PIXEL_UNPACK_BUFFER, getBytes(), nullptr, GL_STREAM_DRAW);
+		}
+		GLExtensions::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	} else {
+		staging.assign(getBytes(), 0);
+	}
+	writeIndex = uploadIndex = 0;
+	pending = false;
+}
+
+void TextureStream::destroy()
+{
+	if (mapped != nullptr) endWrite(false);
+	if (pixelBuffers[0] != 0) {
+		GLExtensions::deleteBuffers(NUM_BUFFERS, pixelBuffers);
+		for (unsigned int i = 0; i < NUM_BUFFERS; ++i) {
+			pixelBuffers[i] = 0;
+		}
+	}
+	if (texture != 0) {
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+	staging.clear();
+	pending = false;
+}
+
+bool TextureStream::upload()
+{
+	if (!pending || texture == 0) return false;
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (usesPixelBuffers()) {
+		// Source is an offset into the bound buffer, the call returns before the copy is done
+		GLExtensions::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[uploadIndex]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA_EXT, GL_UNSIGNED_BYTE, (const GLvoid *) 0);
+		GLExtensions::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	} else {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA_EXT, GL_UNSIGNED_BYTE, &staging[0]);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	pending = false;
+	return true;
+}
+
+GLubyte* TextureStream::beginWrite()
+{
+	if (texture == 0) return nullptr;
+	if (!usesPixelBuffers()) return &staging[0];
+
+	// Orphan the old storage so mapping never waits on a copy still reading it
+	GLExtensions::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[writeIndex]);
+	GLExtensions::bufferData(GL_PIXEL_UNPACK_BUFFER, getBytes(), nullptr, GL_STREAM_DRAW);
+	mapped = (GLubyte *) GLExtensions::mapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	GLExtensions::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (mapped == nullptr) {
+		std::cerr << "Failed to map pixel buffer for texture streaming." << std::endl;
+	}
+	return mapped;
+}
+
+void TextureStream::endWrite( const bool changed )
+{
+	if (!usesPixelBuffers()) {
+		pending = pending || changed;
+		return;
+	}
+	if (mapped == nullptr) return;
+
+	GLExtensions::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[writeIndex]);
+	const bool intact = GLExtensions::unmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	GLExtensions::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	mapped = nullptr;
+
+	// Unchanged frames leave the texture holding the previous image
+	if (changed && intact) {
+		uploadIndex = writeIndex;
+		writeIndex = (writeIndex + 1) % NUM_BUFFERS;
+		pending = true;
+	}
+}
+
+void TextureStream::benchmark( const unsigned int width, const unsigned int height, const unsigned int numFrames )
+{
+	if (numFrames == 0) return;
+	const unsigned int bytes = 4 * width * height;
+	std::vector<GLubyte> client(bytes, 0);
+
+	std::cout << "Texture streaming of " << width << "x" << height << " BGRA images, "
+	          << numFrames << " frames (" << (const char *) glGetString(GL_RENDERER) << "):" << std::endl;
+
+	// Images are filled with a byte that changes every frame
+	struct Result { float mean, worst, total; };
+	auto report = [&](const char *name, const Result& result) {
+		std::cout << "  " << name << result.mean * 1000.f << " ms per frame, worst "
+		          << result.worst * 1000.f << " ms, " << result.total * 1000.f / numFrames
+		          << " ms per frame including the GPU" << std::endl;
+	};
+
+	// Synchronous: the driver copies client memory before glTexSubImage2D returns
+	{
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, &client[0]);
+		glFinish();
+
+		Result result = { 0.f, 0.f, 0.f };
+		sf::Clock total, frame;
+		for (unsigned int i = 0; i < numFrames; ++i) {
+			frame.restart();
+			memset(&client[0], i & 0xFF, bytes);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA_EXT, GL_UNSIGNED_BYTE, &client[0]);
+			const float seconds = frame.getElapsedTime().asSeconds();
+			result.mean += seconds;
+			result.worst = std::max(result.worst, seconds);
+		}
+		glFinish();
+		result.total = total.getElapsedTime().asSeconds();
+		result.mean /= numFrames;
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDeleteTextures(1, &texture);
+		report("synchronous:   ", result);
+	}
+
+	if (!GLExtensions::hasPixelBuffers()) {
+		std::cout << "  pixel buffers: not supported by this context" << std::endl;
+		return;
+	}
+
+	// Pixel buffers, every frame new and then every other frame unchanged
+	for (unsigned int changeEvery = 1; changeEvery <= 2; ++changeEvery) {
+		TextureStream stream(width, height);
+		stream.create();
+		glFinish();
+
+		Result result = { 0.f, 0.f, 0.f };
+		unsigned int numUploads = 0;
+		sf::Clock total, frame;
+		for (unsigned int i = 0; i < numFrames; ++i) {
+			frame.restart();
+			stream.upload();
+			GLubyte *pixels = stream.beginWrite();
+			const bool changed = pixels != nullptr && i % changeEvery == 0;
+			if (changed) {
+				memset(pixels, i & 0xFF, bytes);
+				++numUploads;
+			}
+			stream.endWrite(changed);
+			const float seconds = frame.getElapsedTime().asSeconds();
+			result.mean += seconds;
+			result.worst = std::max(result.worst, seconds);
+		}
+		stream.upload();
+		glFinish();
+		result.total = total.getElapsedTime().asSeconds();
+		result.mean /= numFrames;
+
+		report((changeEvery == 1) ? "pixel buffers: " : "half changed:  ", result);
+		std::cout << "    " << numUploads << " uploads" << std::endl;
+	}
+}
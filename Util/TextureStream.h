@@ -0,0 +1,65 @@
+#pragma once
+/************************************************************************/
+/* TextureStream
+/* -------------
+/* Texture fed once per frame through a ring of pixel buffers
+/************************************************************************/
+#include <SFML/OpenGL.hpp>
+
+#include <vector>
+
+
+// Each frame the producer writes straight into a mapped pixel buffer while
+// the buffer written the frame before is copied into the texture by the
+// driver, so the copy overlaps the next frame instead of stalling this one.
+// Images are shown one frame late and only changed images are copied.
+// Falls back to synchronous uploads from client memory without pixel buffers.
+class TextureStream
+{
+public:
+	static const unsigned int NUM_BUFFERS = 2;
+
+private:
+	unsigned int width;
+	unsigned int height;
+
+	GLuint texture;
+	GLuint pixelBuffers[NUM_BUFFERS];
+	unsigned int writeIndex;   // buffer being filled this frame
+	unsigned int uploadIndex;  // buffer filled last frame
+	bool pending;              // whether the buffer filled last frame holds a new image
+	GLubyte *mapped;
+
+	std::vector<GLubyte> staging; // without pixel buffers
+
+public:
+	TextureStream(const unsigned int width, const unsigned int height);
+	~TextureStream();
+
+	// Create the texture and buffers, needs a current context
+	void create();
+	void destroy();
+
+	// Copy the image written last frame into the texture, if it changed,
+	// true if a copy was issued
+	bool upload();
+	bool isPending() const { return pending; }
+
+	// Memory for this frame's BGRA image, getBytes() long, or null on failure.
+	// Must be followed by endWrite(), saying whether an image was written.
+	GLubyte* beginWrite();
+	void endWrite(const bool changed);
+
+	GLuint getTexture()     const { return texture; }
+	unsigned int getBytes() const { return 4 * width * height; }
+	bool usesPixelBuffers() const { return pixelBuffers[0] != 0; }
+
+	// Time synchronous uploads against pixel buffers with the current context,
+	// reporting the CPU cost per frame of writing an image and issuing its upload
+	static void benchmark(const unsigned int width, const unsigned int height, const unsigned int numFrames);
+
+private:
+	// Not copyable, owns GL objects
+	TextureStream(const TextureStream& other);
+	TextureStream& operator=(const TextureStream& other);
+};
@@ -0,0 +1,260 @@
+/************************************************************************/
+/* Tracer
+/* ------
+/* A static helper class for recording timelines as Chrome trace events
+/************************************************************************/
+#include "Tracer.h"
+
+#include <SFML/System/Clock.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#define TRACER_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACER_THREAD_LOCAL __thread
+#endif
+
+
+namespace
+{
+	// Single producer, the owning thread, appends to tail. Single consumer,
+	// whoever holds bufferMutex, reads from head and frees chunks the
+	// producer has moved past.
+	struct ThreadBuffer
+	{
+		unsigned int id;
+		std::string name; // empty until setThreadName
+		bool named; // name written this session
+		Tracer::Chunk *head;
+		unsigned int consumed;
+		Tracer::Chunk *tail;
+	};
+
+	std::mutex bufferMutex;
+	std::vector<ThreadBuffer *> buffers;
+
+	std::atomic<bool> tracing;
+	std::mutex writerMutex;
+	std::condition_variable writerWake;
+	bool writerStopping = false;
+	std::thread writer;
+
+	std::ofstream stream;
+	bool firstEvent = true;
+	unsigned long long numEventsWritten = 0;
+
+	TRACER_THREAD_LOCAL ThreadBuffer *threadBuffer = nullptr;
+
+	ThreadBuffer& getThreadBuffer()
+	{
+		if (threadBuffer == nullptr) {
+			ThreadBuffer *buffer = new ThreadBuffer();
+			buffer->named    = false;
+			buffer->head     = new Tracer::Chunk();
+			buffer->consumed = 0;
+			buffer->tail     = buffer->head;
+
+			std::lock_guard<std::mutex> lock(bufferMutex);
+			buffer->id = buffers.size();
+			buffers.push_back(buffer);
+			threadBuffer = buffer;
+		}
+		return *threadBuffer;
+	}
+
+	void writeSeparator()
+	{
+		stream << (firstEvent ? "\n" : ",\n");
+		firstEvent = false;
+	}
+
+	void writeEvent( const unsigned int thread, const Tracer::Event& event )
+	{
+		writeSeparator();
+		stream << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\"";
+		if (event.duration >= 0) {
+			stream << ",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+		} else {
+			stream << ",\"ph\":\"i\",\"s\":\"t\",\"ts\":" << event.start;
+		}
+		stream << ",\"pid\":1,\"tid\":" << thread;
+		if (event.frame != Tracer::NO_FRAME) {
+			stream << ",\"args\":{\"frame\":" << event.frame << "}";
+		}
+		stream << "}";
+		++numEventsWritten;
+	}
+
+	const sf::Clock& getClock()
+	{
+		static const sf::Clock clock;
+		return clock;
+	}
+}
+
+
+Tracer::Chunk::Chunk()
+	: count(0)
+	, next(nullptr)
+{}
+
+Tracer::Scope::Scope( const char *name, const char *category, const unsigned int frame )
+	: name(name)
+	, category(category)
+	, frame(frame)
+	, start(isTracing() ? now() : -1)
+{}
+
+Tracer::Scope::~Scope()
+{
+	if (start < 0 || !isTracing()) return;
+
+	Event event;
+	event.name     = name;
+	event.category = category;
+	event.start    = start;
+	event.duration = now() - start;
+	event.frame    = frame;
+	record(event);
+}
+
+bool Tracer::start( const std::string& filename )
+{
+	if (isTracing()) return false;
+
+	stream.open(filename, std::ios::out | std::ios::trunc);
+	if (!stream.is_open()) {
+		std::cerr << "Failed to open '" << filename << "' for tracing." << std::endl;
+		return false;
+	}
+	stream << "[";
+	firstEvent = true;
+	numEventsWritten = 0;
+
+	// Drop anything that slipped in after the last trace stopped
+	flush(true);
+
+	writerStopping = false;
+	tracing.store(true);
+	writer = std::thread(&Tracer::writeEvents);
+	std::cout << "Tracing to '" << filename << "'." << std::endl;
+	return true;
+}
+
+void Tracer::stop()
+{
+	if (!isTracing()) return;
+	tracing.store(false);
+
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		writerStopping = true;
+	}
+	writerWake.notify_all();
+	writer.join();
+
+	stream << "\n]\n";
+	stream.close();
+	std::cout << "Wrote " << numEventsWritten << " trace events." << std::endl;
+}
+
+bool Tracer::isTracing()
+{
+	return tracing.load(std::memory_order_relaxed);
+}
+
+void Tracer::instant( const char *name, const char *category, const unsigned int frame )
+{
+	if (!isTracing()) return;
+
+	Event event;
+	event.name     = name;
+	event.category = category;
+	event.start    = now();
+	event.duration = -1;
+	event.frame    = frame;
+	record(event);
+}
+
+void Tracer::setThreadName( const std::string& name )
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	buffer.name  = name;
+	buffer.named = false;
+}
+
+long long Tracer::now()
+{
+	return getClock().getElapsedTime().asMicroseconds();
+}
+
+void Tracer::record( const Event& event )
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	Chunk *tail = buffer.tail;
+	unsigned int count = tail->count.load(std::memory_order_relaxed);
+	if (count == CHUNK_SIZE) {
+		Chunk *chunk = new Chunk();
+		tail->next.store(chunk, std::memory_order_release);
+		buffer.tail = tail = chunk;
+		count = 0;
+	}
+	tail->events[count] = event;
+	tail->count.store(count + 1, std::memory_order_release);
+}
+
+void Tracer::writeEvents()
+{
+	for (;;) {
+		bool stopping;
+		{
+			std::unique_lock<std::mutex> lock(writerMutex);
+			writerWake.wait_for(lock, std::chrono::milliseconds(100));
+			stopping = writerStopping;
+		}
+		flush(false);
+		if (stopping) break;
+	}
+	stream.flush();
+}
+
+void Tracer::flush( const bool discard )
+{
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	for (auto buffer : buffers) {
+		if (discard) {
+			buffer->named = false;
+		} else if (!buffer->named && !buffer->name.empty()) {
+			writeSeparator();
+			stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+			       << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+			buffer->named = true;
+		}
+
+		for (;;) {
+			Chunk *head = buffer->head;
+			const unsigned int count = head->count.load(std::memory_order_acquire);
+			if (!discard) {
+				for (unsigned int i = buffer->consumed; i < count; ++i) {
+					writeEvent(buffer->id, head->events[i]);
+				}
+			}
+			buffer->consumed = count;
+
+			// The producer links the next chunk only after filling this one
+			Chunk *next = (count == CHUNK_SIZE) ? head->next.load(std::memory_order_acquire) : nullptr;
+			if (next == nullptr) break;
+			delete head;
+			buffer->head     = next;
+			buffer->consumed = 0;
+		}
+	}
+}
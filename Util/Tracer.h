@@ -0,0 +1,78 @@
+#pragma once
+/************************************************************************/
+/* Tracer
+/* ------
+/* A static helper class for recording timelines as Chrome trace events
+/************************************************************************/
+#include <atomic>
+#include <string>
+
+
+// Events go into chunked buffers owned by the thread that records them and
+// are written out by a background thread, so a long session costs a clock
+// read and a store per event, plus an allocation every CHUNK_SIZE events.
+// Event names and categories are kept by pointer, they must be string
+// literals. Thread names are copied.
+// The output loads in chrome://tracing or ui.perfetto.dev.
+class Tracer
+{
+public:
+	static const unsigned int NO_FRAME   = 0xFFFFFFFF;
+	static const unsigned int CHUNK_SIZE = 4096;
+
+	struct Event
+	{
+		const char *name;
+		const char *category;
+		long long start;    // microseconds since startup
+		long long duration; // microseconds, negative for instant events
+		unsigned int frame;
+	};
+
+	struct Chunk
+	{
+		Event events[CHUNK_SIZE];
+		std::atomic<unsigned int> count;
+		std::atomic<Chunk *> next;
+
+		Chunk();
+	};
+
+	// Times the enclosing block as a complete event
+	class Scope
+	{
+	private:
+		const char *name;
+		const char *category;
+		unsigned int frame;
+		long long start;
+
+	public:
+		Scope(const char *name, const char *category, const unsigned int frame = NO_FRAME);
+		~Scope();
+
+		// Tag with a frame number only known once the work has started
+		void setFrame(const unsigned int frame) { this->frame = frame; }
+
+	private:
+		Scope(const Scope& other);
+		Scope& operator=(const Scope& other);
+	};
+
+	// Start writing events to filename, false if it can't be opened or a trace is running
+	static bool start(const std::string& filename);
+	// Write every event recorded so far and close the file
+	static void stop();
+	static bool isTracing();
+
+	static void instant(const char *name, const char *category, const unsigned int frame = NO_FRAME);
+
+	// Label the calling thread in the trace viewer
+	static void setThreadName(const std::string& name);
+
+private:
+	static long long now();
+	static void record(const Event& event);
+	static void writeEvents();
+	static void flush(const bool discard);
+};
@@ -0,0 +1,199 @@
+/************************************************************************/
+/* TrailBuffer
+/* -----------
+/* Ring buffers of recent positions drawn as fading line strips
+/************************************************************************/
+#include "TrailBuffer.h"
+#include "GLExtensions.h"
+
+#include <algorithm>
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+namespace
+{
+	const unsigned int floatsPerVertex = 4;
+	const unsigned int fadeTexels = 256;
+}
+
+
+TrailBuffer::TrailBuffer( const unsigned int numTrails, const unsigned int capacity )
+	: numTrails(numTrails)
+	, capacity(std::max(2u, capacity))
+	, length(this->capacity)
+	, count(0)
+	, head(0)
+	, frameNumber(0)
+	, vertices(numTrails * (this->capacity + 1) * floatsPerVertex, 0.f)
+	, vertexBuffer(0)
+	, fadeTexture(0)
+	, dirtyBegin(0)
+	, dirtyEnd(0)
+{}
+
+TrailBuffer::~TrailBuffer()
+{
+	if (vertexBuffer != 0) GLExtensions::deleteBuffers(1, &vertexBuffer);
+	if (fadeTexture  != 0) glDeleteTextures(1, &fadeTexture);
+}
+
+void TrailBuffer::reset()
+{
+	count = 0;
+	head = 0;
+	frameNumber = 0;
+	dirtyBegin = dirtyEnd = 0;
+}
+
+void TrailBuffer::append( const glm::vec3 *positions )
+{
+	for (unsigned int trail = 0; trail < numTrails; ++trail) {
+		writeSlot(trail, head, positions[trail]);
+	}
+
+	// Slot 0 also writes its mirror at the end
+	const unsigned int lastSlot = (head == 0) ? capacity : head;
+	if (dirtyBegin == dirtyEnd) {
+		dirtyBegin = head;
+		dirtyEnd = lastSlot + 1;
+	} else {
+		dirtyBegin = std::min(dirtyBegin, head);
+		dirtyEnd = std::max(dirtyEnd, lastSlot + 1);
+	}
+
+	head = (head + 1) % capacity;
+	count = std::min(count + 1, capacity);
+	++frameNumber;
+}
+
+void TrailBuffer::writeSlot( const unsigned int trail, const unsigned int slot, const glm::vec3& position )
+{
+	GLfloat *vertex = &vertices[trail * getStride() + slot * floatsPerVertex];
+	vertex[0] = position.x;
+	vertex[1] = position.y;
+	vertex[2] = position.z;
+	vertex[3] = static_cast<GLfloat>(frameNumber);
+	if (slot == 0) {
+		std::copy(vertex, vertex + floatsPerVertex, vertex + capacity * floatsPerVertex);
+	}
+}
+
+void TrailBuffer::setLength( const unsigned int length )
+{
+	this->length = std::min(std::max(2u, length), capacity);
+}
+
+glm::vec3 TrailBuffer::getNewest( const unsigned int trail ) const
+{
+	if (count == 0 || trail >= numTrails) return glm::vec3(0.f);
+	const GLfloat *vertex = &vertices[trail * getStride() + ((head + capacity - 1) % capacity) * floatsPerVertex];
+	return glm::vec3(vertex[0], vertex[1], vertex[2]);
+}
+
+void TrailBuffer::draw( const glm::vec3& color ) const
+{
+	const unsigned int n = std::min(length, count);
+	if (n < 2 || numTrails == 0) return;
+
+	// Copy new slots of every trail, the whole buffer the first time
+	if (GLExtensions::hasBufferObjects()) {
+		if (vertexBuffer == 0) {
+			GLExtensions::genBuffers(1, &vertexBuffer);
+			GLExtensions::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			GLExtensions::bufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_DYNAMIC_DRAW);
+		} else {
+			GLExtensions::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			if (dirtyBegin != dirtyEnd) {
+				const unsigned int offset = dirtyBegin * floatsPerVertex;
+				const unsigned int size = (dirtyEnd - dirtyBegin) * floatsPerVertex;
+				for (unsigned int trail = 0; trail < numTrails; ++trail) {
+					const unsigned int first = trail * getStride() + offset;
+					GLExtensions::bufferSubData(GL_ARRAY_BUFFER, first * sizeof(GLfloat), size * sizeof(GLfloat), &vertices[first]);
+				}
+			}
+		}
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	// Opaque white with alpha rising from the oldest to the newest texel
+	if (fadeTexture == 0) {
+		GLubyte texels[fadeTexels * 4];
+		for (unsigned int i = 0; i < fadeTexels; ++i) {
+			texels[i * 4 + 0] = texels[i * 4 + 1] = texels[i * 4 + 2] = 255;
+			texels[i * 4 + 3] = static_cast<GLubyte>(i * 255 / (fadeTexels - 1));
+		}
+		glGenTextures(1, &fadeTexture);
+		glBindTexture(GL_TEXTURE_1D, fadeTexture);
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, fadeTexels, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+	}
+
+	// The newest n slots, split in two strips when they wrap past the end,
+	// the mirrored slot joins the two
+	const unsigned int oldest = (head + capacity - n) % capacity;
+	const unsigned int tail = std::min(n, capacity + 1 - oldest);
+	const unsigned int wrapped = n - std::min(n, capacity - oldest);
+	std::vector<GLint> firsts;
+	std::vector<GLsizei> counts;
+	firsts.reserve(numTrails * 2);
+	counts.reserve(numTrails * 2);
+	for (unsigned int trail = 0; trail < numTrails; ++trail) {
+		firsts.push_back(trail * (capacity + 1) + oldest);
+		counts.push_back(tail);
+		if (wrapped >= 2) {
+			firsts.push_back(trail * (capacity + 1));
+			counts.push_back(wrapped);
+		}
+	}
+
+	glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+	glEnable(GL_TEXTURE_1D);
+	glBindTexture(GL_TEXTURE_1D, fadeTexture);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glColor4f(color.x, color.y, color.z, 1.f);
+
+	// Frame numbers to [0,1] from the oldest drawn to the newest
+	const GLfloat newestFrame = static_cast<GLfloat>(frameNumber - 1);
+	glMatrixMode(GL_TEXTURE);
+	glPushMatrix();
+	glLoadIdentity();
+	glScalef(1.f / (n - 1), 1.f, 1.f);
+	glTranslatef(-(newestFrame - (n - 1)), 0.f, 0.f);
+	glMatrixMode(GL_MODELVIEW);
+
+	const GLsizei bytes = floatsPerVertex * sizeof(GLfloat);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	if (vertexBuffer != 0) {
+		glVertexPointer(3, GL_FLOAT, bytes, (const GLvoid *) 0);
+		glTexCoordPointer(1, GL_FLOAT, bytes, (const GLvoid *) (3 * sizeof(GLfloat)));
+	} else {
+		glVertexPointer(3, GL_FLOAT, bytes, &vertices[0]);
+		glTexCoordPointer(1, GL_FLOAT, bytes, &vertices[3]);
+	}
+
+	if (GLExtensions::hasMultiDraw()) {
+		GLExtensions::multiDrawArrays(GL_LINE_STRIP, &firsts[0], &counts[0], firsts.size());
+	} else {
+		for (unsigned int i = 0; i < firsts.size(); ++i) {
+			glDrawArrays(GL_LINE_STRIP, firsts[i], counts[i]);
+		}
+	}
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (vertexBuffer != 0) GLExtensions::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glMatrixMode(GL_TEXTURE);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopAttrib();
+}
@@ -0,0 +1,67 @@
+#pragma once
+/************************************************************************/
+/* TrailBuffer
+/* -----------
+/* Ring buffers of recent positions drawn as fading line strips
+/************************************************************************/
+#include <SFML/OpenGL.hpp>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// One ring buffer per trail, all advanced together by one position per
+// frame. Each vertex is written once when appended: its position and the
+// frame number it arrived in. The fade is a 1D alpha texture indexed by
+// that frame number through the texture matrix, so old vertices never
+// need rewriting as they age. Every trail is drawn with one call.
+class TrailBuffer
+{
+private:
+	unsigned int numTrails;
+	unsigned int capacity;
+	unsigned int length;
+	unsigned int count;       // valid positions per trail
+	unsigned int head;        // slot the next position goes into
+	unsigned int frameNumber; // of the next position
+
+	// Trail major, capacity + 1 slots per trail of x, y, z, frame number.
+	// The extra slot mirrors slot 0 so a wrapped trail stays connected.
+	std::vector<GLfloat> vertices;
+
+	// Created on first draw, then only slots appended since are copied over
+	mutable GLuint vertexBuffer;
+	mutable GLuint fadeTexture;
+	mutable unsigned int dirtyBegin;
+	mutable unsigned int dirtyEnd;
+
+public:
+	TrailBuffer(const unsigned int numTrails, const unsigned int capacity);
+	~TrailBuffer();
+
+	void reset();
+
+	// Add the next position of every trail
+	void append(const glm::vec3 *positions);
+
+	// Draw the newest positions of every trail, fading out towards the oldest
+	void draw(const glm::vec3& color) const;
+
+	// Number of positions drawn, at most the capacity
+	void setLength(const unsigned int length);
+	unsigned int getLength()   const { return length;   }
+	unsigned int getCapacity() const { return capacity; }
+	unsigned int getCount()    const { return count;    }
+
+	// Most recently appended position of a trail
+	glm::vec3 getNewest(const unsigned int trail) const;
+
+private:
+	unsigned int getStride() const { return (capacity + 1) * 4; }
+	void writeSlot(const unsigned int trail, const unsigned int slot, const glm::vec3& position);
+
+	// Not copyable, owns buffer objects
+	TrailBuffer(const TrailBuffer& other);
+	TrailBuffer& operator=(const TrailBuffer& other);
+};